@@ -11,8 +11,13 @@
 @implementation NSCharacterSet (SPiD)
 
 + (NSCharacterSet *)URLQueryPartAllowedCharacterSet {
-    NSMutableCharacterSet *URLQueryPartAllowedCharacterSet = [[NSCharacterSet URLQueryAllowedCharacterSet] mutableCopy];
-    [URLQueryPartAllowedCharacterSet removeCharactersInString:@"!*'();:@&=+$,/?%#[]"];
+    static NSCharacterSet *URLQueryPartAllowedCharacterSet = nil;
+    static dispatch_once_t predicate;
+    dispatch_once(&predicate, ^{
+        NSMutableCharacterSet *characterSet = [[NSCharacterSet URLQueryAllowedCharacterSet] mutableCopy];
+        [characterSet removeCharactersInString:@"!*'();:@&=+$,/?%#[]"];
+        URLQueryPartAllowedCharacterSet = [characterSet copy];
+    });
     return URLQueryPartAllowedCharacterSet;
 }
 @end
@@ -7,16 +7,42 @@
 
 #import <Foundation/Foundation.h>
 
+NS_ASSUME_NONNULL_BEGIN
+
 /** Adds Base64 encoding/decoding to `NSData` */
 
 @interface NSData (Base64)
 
+/** Decodes a Base64 string
+
+ Padding is optional, but if present the string length must be a multiple of four.
+
+ @param string The Base64 encoded string
+ @return Decoded data, nil if the string is not valid Base64
+ */
++ (nullable NSData *)sp_dataWithBase64EncodedString:(NSString *)string;
+
+/** Decodes a Base64url string as described in RFC 4648 section 5
+
+ Padding is optional, but if present the string length must be a multiple of four.
+
+ @param string The Base64url encoded string
+ @return Decoded data, nil if the string is not valid Base64url
+ */
++ (nullable NSData *)sp_dataWithBase64UrlEncodedString:(NSString *)string;
+
 /** Encodes data to a Base64 string
 
- @return Encoded string
+ @return Encoded string, nil if the data is empty
+ */
+- (nullable NSString *)sp_base64EncodedString;
+
+/** Encodes data to a Base64url string without padding, as described in RFC 4648 section 5
+
+ @return Encoded string, nil if the data is empty
  */
-- (NSString *)sp_base64EncodedString;
+- (nullable NSString *)sp_base64EncodedUrlSafeString;
 
-- (NSString *)sp_base64EncodedUrlSafeString;
+@end
 
-@end
\ No newline at end of file
+NS_ASSUME_NONNULL_END
@@ -7,58 +7,144 @@
 
 #import "NSData+Base64.h"
 
-@implementation NSData (Base64)
-
 static const char _base64EncodingTable[64] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static const char _base64UrlEncodingTable[64] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
 
-- (NSString *)sp_base64EncodedString {
-    const unsigned char *objRawData = [self bytes];
-    char *objPointer;
-    char *strResult;
+/** Decoding tables indexed by character, -1 for characters outside the alphabet */
+static int8_t _base64DecodingTable[256];
+static int8_t _base64UrlDecodingTable[256];
+
+static void SPiDInitializeBase64DecodingTables(void) {
+    static dispatch_once_t predicate;
+    dispatch_once(&predicate, ^{
+        memset(_base64DecodingTable, -1, sizeof(_base64DecodingTable));
+        memset(_base64UrlDecodingTable, -1, sizeof(_base64UrlDecodingTable));
+        for (int8_t i = 0; i < 64; i++) {
+            _base64DecodingTable[(uint8_t) _base64EncodingTable[i]] = i;
+            _base64UrlDecodingTable[(uint8_t) _base64UrlEncodingTable[i]] = i;
+        }
+    });
+}
+
+/** Encodes the data in a single pass into a buffer that is handed over to the returned string */
+static NSString *SPiDBase64Encode(NSData *data, const char *table, BOOL padded) {
+    NSUInteger length = data.length;
+    if (length == 0) {
+        return nil;
+    }
+
+    const uint8_t *in = data.bytes;
+    NSUInteger remainder = length % 3;
+    NSUInteger encodedLength = (length / 3) * 4;
+    if (remainder != 0) {
+        encodedLength += padded ? 4 : remainder + 1;
+    }
+    char *result = malloc(encodedLength);
+    char *out = result;
+
+    const uint8_t *end = in + length - remainder;
+    while (in < end) {
+        uint32_t triple = ((uint32_t) in[0] << 16) | ((uint32_t) in[1] << 8) | in[2];
+        out[0] = table[triple >> 18];
+        out[1] = table[(triple >> 12) & 0x3f];
+        out[2] = table[(triple >> 6) & 0x3f];
+        out[3] = table[triple & 0x3f];
+        in += 3;
+        out += 4;
+    }
+
+    if (remainder != 0) {
+        uint32_t triple = (uint32_t) in[0] << 16;
+        if (remainder > 1) {
+            triple |= (uint32_t) in[1] << 8;
+        }
+        *out++ = table[triple >> 18];
+        *out++ = table[(triple >> 12) & 0x3f];
+        if (remainder > 1) {
+            *out++ = table[(triple >> 6) & 0x3f];
+        } else if (padded) {
+            *out++ = '=';
+        }
+        if (padded) {
+            *out++ = '=';
+        }
+    }
+
+    return [[NSString alloc] initWithBytesNoCopy:result length:encodedLength encoding:NSASCIIStringEncoding freeWhenDone:YES];
+}
 
-    NSUInteger intLength = [self length];
-    if (intLength == 0) return nil;
+/** Decodes the string in a single pass, nil on characters outside the alphabet or a malformed length */
+static NSData *SPiDBase64Decode(NSString *string, const int8_t *table) {
+    SPiDInitializeBase64DecodingTables();
+    const char *in = [string cStringUsingEncoding:NSASCIIStringEncoding];
+    if (in == NULL) {
+        return nil;
+    }
 
-    strResult = (char *) calloc((size_t) ((((intLength + 2) / 3) * 4) + 1), sizeof(char));
-    objPointer = strResult;
+    // The C string ends at the first NUL, so a embedded NUL would silently drop the rest of the input
+    NSUInteger length = [string lengthOfBytesUsingEncoding:NSASCIIStringEncoding];
+    if (strlen(in) != length) {
+        return nil;
+    }
+    NSUInteger unpaddedLength = length;
+    while (unpaddedLength > 0 && length - unpaddedLength < 2 && in[unpaddedLength - 1] == '=') {
+        unpaddedLength--;
+    }
+    NSUInteger remainder = unpaddedLength % 4;
+    if (remainder == 1 || (unpaddedLength != length && length % 4 != 0)) {
+        return nil;
+    }
 
-    while (intLength > 2) {
-        *objPointer++ = _base64EncodingTable[objRawData[0] >> 2];
-        *objPointer++ = _base64EncodingTable[((objRawData[0] & 0x03) << 4) + (objRawData[1] >> 4)];
-        *objPointer++ = _base64EncodingTable[((objRawData[1] & 0x0f) << 2) + (objRawData[2] >> 6)];
-        *objPointer++ = _base64EncodingTable[objRawData[2] & 0x3f];
+    NSUInteger decodedLength = (unpaddedLength / 4) * 3 + (remainder ? remainder - 1 : 0);
+    NSMutableData *data = [NSMutableData dataWithLength:decodedLength];
+    uint8_t *out = data.mutableBytes;
 
-        objRawData += 3;
-        intLength -= 3;
+    const uint8_t *bytes = (const uint8_t *) in;
+    const uint8_t *end = bytes + unpaddedLength - remainder;
+    while (bytes < end) {
+        int8_t a = table[bytes[0]], b = table[bytes[1]], c = table[bytes[2]], d = table[bytes[3]];
+        // Invalid characters are -1, so one check covers all four
+        if ((a | b | c | d) < 0) {
+            return nil;
+        }
+        uint32_t quad = ((uint32_t) a << 18) | ((uint32_t) b << 12) | ((uint32_t) c << 6) | (uint32_t) d;
+        out[0] = (uint8_t) (quad >> 16);
+        out[1] = (uint8_t) (quad >> 8);
+        out[2] = (uint8_t) quad;
+        bytes += 4;
+        out += 3;
     }
 
-    if (intLength != 0) {
-        *objPointer++ = _base64EncodingTable[objRawData[0] >> 2];
-        if (intLength > 1) {
-            *objPointer++ = _base64EncodingTable[((objRawData[0] & 0x03) << 4) + (objRawData[1] >> 4)];
-            *objPointer++ = _base64EncodingTable[(objRawData[1] & 0x0f) << 2];
-            *objPointer++ = '=';
-        } else {
-            *objPointer++ = _base64EncodingTable[(objRawData[0] & 0x03) << 4];
-            *objPointer++ = '=';
-            *objPointer++ = '=';
+    if (remainder != 0) {
+        int8_t a = table[bytes[0]], b = table[bytes[1]], c = remainder > 2 ? table[bytes[2]] : 0;
+        if ((a | b | c) < 0) {
+            return nil;
+        }
+        uint32_t quad = ((uint32_t) a << 18) | ((uint32_t) b << 12) | ((uint32_t) c << 6);
+        *out++ = (uint8_t) (quad >> 16);
+        if (remainder > 2) {
+            *out = (uint8_t) (quad >> 8);
         }
     }
+    return data;
+}
+
+@implementation NSData (Base64)
 
-    // Terminate the string-based result
-    *objPointer = '\0';
++ (NSData *)sp_dataWithBase64EncodedString:(NSString *)string {
+    return SPiDBase64Decode(string, _base64DecodingTable);
+}
+
++ (NSData *)sp_dataWithBase64UrlEncodedString:(NSString *)string {
+    return SPiDBase64Decode(string, _base64UrlDecodingTable);
+}
 
-    NSString *base64String = [NSString stringWithCString:strResult encoding:NSASCIIStringEncoding];
-    free(strResult);
-    return base64String;
+- (NSString *)sp_base64EncodedString {
+    return SPiDBase64Encode(self, _base64EncodingTable, YES);
 }
 
 - (NSString *)sp_base64EncodedUrlSafeString {
-    NSString *urlSafeBase64String = [self sp_base64EncodedString];
-    urlSafeBase64String = [urlSafeBase64String stringByReplacingOccurrencesOfString:@"+" withString:@"-"];
-    urlSafeBase64String = [urlSafeBase64String stringByReplacingOccurrencesOfString:@"/" withString:@"_"];
-    urlSafeBase64String = [urlSafeBase64String stringByReplacingOccurrencesOfString:@"=" withString:@""];
-    return urlSafeBase64String;
+    return SPiDBase64Encode(self, _base64UrlEncodingTable, NO);
 }
 
 @end
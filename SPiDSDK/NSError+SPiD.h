@@ -11,6 +11,8 @@
 
 /** Creates a new `SPiDError` with SPiD OAuth2 domain and given dictionary.
 
+ The code is mapped right away, the `userInfo` descriptions are only built from the response when first read.
+
  @param dictionary Dictionary containing error data received from SPiD
  @return Returns `SPiDError` with the given data.
  */
@@ -42,7 +44,9 @@
  */
 + (instancetype)sp_apiErrorWithCode:(NSInteger)errorCode reason:(NSString *)reason descriptions:(NSDictionary *)descriptions;
 
-/**
+/** Maps a SPiD error domain to its code
+
+ The lookup is case insensitive and uses a static perfect hash table, so it costs one hash and one string compare.
 
  @param errorDomain Error domain string.
  @param error code from api or 0
@@ -50,6 +54,20 @@
  */
 + (NSInteger)sp_OAuth2ErrorCodeFromDomain:(NSString *)errorDomain andAPIErrorCode:(NSInteger)apiError;
 
+/** Checks if the error was caused by missing network connectivity
+
+ Timeouts and connections lost while the request was running are not included, SPiD may have received those.
+
+ @return Returns YES if the request never reached SPiD and can be retried when the device is back online
+ */
+- (BOOL)sp_isOfflineError;
+
+/** Checks if the connection failed while the request was being sent or answered
+
+ @return Returns YES for timeouts and lost connections, SPiD may or may not have handled the request
+ */
+- (BOOL)sp_isInterruptedRequestError;
+
 @end
 
 typedef NS_ENUM(NSInteger, SPiD) {
@@ -79,6 +97,14 @@ typedef NS_ENUM(NSInteger, SPiD) {
     SPiDUserAbortedLogin = -1100,
     SPiDJSONParseErrorCode = -1200, // JSON Parse error
 
+    SPiDJwtMalformedErrorCode = -1210, // JWT could not be decoded or uses another algorithm than HS256
+    SPiDJwtInvalidSignatureErrorCode = -1211,
+    SPiDJwtExpiredErrorCode = -1212,
+    SPiDJwtInvalidAudienceErrorCode = -1213, // JWT was issued for another client
+    SPiDJwtInvalidIssuerErrorCode = -1214, // JWT was issued by another server
+
+    SPiDSharedRefreshTimedOutErrorCode = -1220, // Another process held the shared token refresh lease for too long
+
     SPiDAPIExceptionErrorCode = -1300,
     SPiDAPIExceptionExistingUser = -1302 //User already exists
 };
\ No newline at end of file
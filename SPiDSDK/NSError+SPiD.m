@@ -8,37 +8,131 @@
 #import "NSError+SPiD.h"
 #import "SPiDClient.h"
 
-@implementation NSError (SPiD)
+typedef struct {
+    const char *name;
+    size_t length;
+    NSInteger code;
+} SPiDErrorDomainEntry;
 
-+ (instancetype)sp_errorFromJSONData:(NSDictionary *)dictionary {
-    NSString *domain;
+/** Seed for `SPiDErrorDomainSlot`, found offline so that no two domains share a slot, must be searched again when
+ domains are added */
+static const uint32_t SPiDErrorDomainHashSeed = 587;
+
+/** Error domains from SPiD indexed by the perfect hash of their lowercased name */
+static const SPiDErrorDomainEntry SPiDErrorDomainTable[32] = {
+    [0] = {"invalid_client_credentials", 26, SPiDOAuth2InvalidClientCredentialsErrorCode},
+    [1] = {"invalid_grant", 13, SPiDOAuth2InvalidGrantErrorCode},
+    [4] = {"insufficient_scope", 18, SPiDOAuth2InsufficientScopeErrorCode},
+    [7] = {"unauthorized_client", 19, SPiDOAuth2UnauthorizedClientErrorCode},
+    [8] = {"UserAbortedLogin", 16, SPiDUserAbortedLogin},
+    [11] = {"invalid_client", 14, SPiDOAuth2InvalidClientErrorCode},
+    [13] = {"invalid_user_credentials", 24, SPiDOAuth2InvalidUserCredentialsErrorCode},
+    [15] = {"invalid_token", 13, SPiDOAuth2InvalidTokenErrorCode},
+    [19] = {"redirect_uri_mismatch", 21, SPiDOAuth2RedirectURIMismatchErrorCode},
+    [20] = {"expired_token", 13, SPiDOAuth2ExpiredTokenErrorCode},
+    [23] = {"invalid_client_id", 17, SPiDOAuth2InvalidClientIDErrorCode},
+    [24] = {"invalid_request", 15, SPiDOAuth2InvalidRequestErrorCode},
+    [25] = {"ApiException", 12, SPiDAPIExceptionErrorCode},
+    [26] = {"access_denied", 13, SPiDOAuth2AccessDeniedErrorCode},
+    [27] = {"invalid_scope", 13, SPiDOAuth2InvalidScopeErrorCode},
+    [28] = {"unverified_user", 15, SPiDOAuth2UnverifiedUserErrorCode},
+    [29] = {"unsupported_response_type", 25, SPiDOAuth2UnsupportedResponseTypeErrorCode},
+    [30] = {"unknown_user", 12, SPiDOAuth2UnknownUserErrorCode},
+};
+
+/** Error created from a SPiD error response, builds `userInfo` from the response on first use */
+@interface SPiDJSONError : NSError
+
+/** Initializes the error
+
+ @param domain Error domain
+ @param code Error code
+ @param dictionary The error response
+ @return `SPiDJSONError`
+ */
+- (instancetype)initWithDomain:(NSString *)domain code:(NSInteger)code JSONData:(NSDictionary *)dictionary;
+
+/** Builds the descriptions used as `userInfo` from a error response */
++ (NSDictionary *)descriptionsFromJSONData:(NSDictionary *)dictionary domain:(NSString *)domain;
+
+@property (nonatomic, strong) NSDictionary *JSONData;
+@property (nonatomic, copy) NSDictionary *descriptions;
+
+@end
+
+@implementation SPiDJSONError
+
+- (instancetype)initWithDomain:(NSString *)domain code:(NSInteger)code JSONData:(NSDictionary *)dictionary {
+    if (self = [super initWithDomain:domain code:code userInfo:nil]) {
+        self.JSONData = dictionary;
+    }
+    return self;
+}
+
++ (NSDictionary *)descriptionsFromJSONData:(NSDictionary *)dictionary domain:(NSString *)domain {
     NSDictionary *descriptions;
-    NSInteger originalErrorCode;
-    NSInteger errorCode;
-
-    if ([[dictionary objectForKey:@"error"] isKindOfClass:[NSDictionary class]]) {
-        NSDictionary *errorDict = [dictionary objectForKey:@"error"];
-        domain = [errorDict objectForKey:@"type"];
-        originalErrorCode = [[errorDict objectForKey:@"code"] integerValue];
-        errorCode = [self sp_OAuth2ErrorCodeFromDomain:domain andAPIErrorCode:originalErrorCode];
-        if ([[errorDict objectForKey:@"description"] isKindOfClass:[NSDictionary class]]) {
-            descriptions = [errorDict objectForKey:@"description"];
+    id error = [dictionary objectForKey:@"error"];
+    if ([error isKindOfClass:[NSDictionary class]]) {
+        if ([[error objectForKey:@"description"] isKindOfClass:[NSDictionary class]]) {
+            descriptions = [error objectForKey:@"description"];
         } else {
-            descriptions = [NSDictionary dictionaryWithObjectsAndKeys:[errorDict objectForKey:@"description"], @"error", nil];
+            descriptions = [NSDictionary dictionaryWithObjectsAndKeys:[error objectForKey:@"description"], @"error", nil];
         }
     } else {
-        domain = [dictionary objectForKey:@"error"];
         descriptions = [NSDictionary dictionaryWithObjectsAndKeys:[dictionary objectForKey:@"error_description"], @"error", nil];
-        originalErrorCode = [[dictionary objectForKey:@"error_code"] integerValue];
-        errorCode = [self sp_OAuth2ErrorCodeFromDomain:domain andAPIErrorCode:originalErrorCode];
     }
 
     if (descriptions.count == 0) {
         descriptions = [NSDictionary dictionaryWithObjectsAndKeys:domain, @"error", nil];
     }
+    return descriptions;
+}
 
-    SPiDDebugLog("Received '%@' with code '%ld' and description: %@", domain, originalErrorCode, [descriptions description]);
-    return [NSError errorWithDomain:domain code:errorCode userInfo:descriptions];
+- (NSDictionary *)userInfo {
+    @synchronized (self) {
+        if (self.descriptions == nil) {
+            self.descriptions = [SPiDJSONError descriptionsFromJSONData:self.JSONData domain:self.domain];
+        }
+        return self.descriptions;
+    }
+}
+
+- (id)replacementObjectForCoder:(NSCoder *)coder {
+    // Archived as a plain NSError so that it can be decoded without this class
+    return [NSError errorWithDomain:self.domain code:self.code userInfo:self.userInfo];
+}
+
+@end
+
+/** FNV-1a of the lowercased domain, folded to a slot in `SPiDErrorDomainTable` */
+static inline uint32_t SPiDErrorDomainSlot(const char *domain, size_t length) {
+    uint32_t hash = 2166136261u ^ SPiDErrorDomainHashSeed;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (uint8_t) tolower((unsigned char) domain[i]);
+        hash *= 16777619u;
+    }
+    return (hash ^ (hash >> 16)) & 31;
+}
+
+@implementation NSError (SPiD)
+
++ (instancetype)sp_errorFromJSONData:(NSDictionary *)dictionary {
+    NSString *domain;
+    NSInteger originalErrorCode;
+
+    id error = [dictionary objectForKey:@"error"];
+    if ([error isKindOfClass:[NSDictionary class]]) {
+        domain = [error objectForKey:@"type"];
+        originalErrorCode = [[error objectForKey:@"code"] integerValue];
+    } else {
+        domain = error;
+        originalErrorCode = [[dictionary objectForKey:@"error_code"] integerValue];
+    }
+    NSInteger errorCode = [self sp_OAuth2ErrorCodeFromDomain:domain andAPIErrorCode:originalErrorCode];
+
+    SPiDDebugLog("Received '%@' with code '%ld' and response: %@", domain, originalErrorCode, dictionary);
+    // Most callers only look at the code, the descriptions are built from the response when userInfo is first read
+    return [[SPiDJSONError alloc] initWithDomain:domain code:errorCode JSONData:dictionary];
 }
 
 + (instancetype)sp_oauth2ErrorWithString:(NSString *)errorString {
@@ -66,50 +160,47 @@
 }
 
 + (NSInteger)sp_OAuth2ErrorCodeFromDomain:(NSString *)errorDomain andAPIErrorCode:(NSInteger)apiError {
-    NSInteger errorCode = 0;
-    if ([errorDomain caseInsensitiveCompare:@"redirect_uri_mismatch"] == NSOrderedSame) {
-        errorCode = SPiDOAuth2RedirectURIMismatchErrorCode;
-    } else if ([errorDomain caseInsensitiveCompare:@"unauthorized_client"] == NSOrderedSame) {
-        errorCode = SPiDOAuth2UnauthorizedClientErrorCode;
-    } else if ([errorDomain caseInsensitiveCompare:@"access_denied"] == NSOrderedSame) {
-        errorCode = SPiDOAuth2AccessDeniedErrorCode;
-    } else if ([errorDomain caseInsensitiveCompare:@"invalid_request"] == NSOrderedSame) {
-        errorCode = SPiDOAuth2InvalidRequestErrorCode;
-    } else if ([errorDomain caseInsensitiveCompare:@"unsupported_response_type"] == NSOrderedSame) {
-        errorCode = SPiDOAuth2UnsupportedResponseTypeErrorCode;
-    } else if ([errorDomain caseInsensitiveCompare:@"invalid_scope"] == NSOrderedSame) {
-        errorCode = SPiDOAuth2InvalidScopeErrorCode;
-    } else if ([errorDomain caseInsensitiveCompare:@"invalid_grant"] == NSOrderedSame) {
-        errorCode = SPiDOAuth2InvalidGrantErrorCode;
-    } else if ([errorDomain caseInsensitiveCompare:@"invalid_client"] == NSOrderedSame) {
-        errorCode = SPiDOAuth2InvalidClientErrorCode;
-    } else if ([errorDomain caseInsensitiveCompare:@"invalid_client_id"] == NSOrderedSame) {
-        errorCode = SPiDOAuth2InvalidClientIDErrorCode; // Replaced by "invalid_client" in draft 10 of oauth 2.0
-    } else if ([errorDomain caseInsensitiveCompare:@"invalid_client_credentials"] == NSOrderedSame) {
-        errorCode = SPiDOAuth2InvalidClientCredentialsErrorCode; // Replaced by "invalid_client" in draft 10 of oauth 2.0
-    } else if ([errorDomain caseInsensitiveCompare:@"invalid_token"] == NSOrderedSame) {
-        errorCode = SPiDOAuth2InvalidTokenErrorCode;
-    } else if ([errorDomain caseInsensitiveCompare:@"insufficient_scope"] == NSOrderedSame) {
-        errorCode = SPiDOAuth2InsufficientScopeErrorCode;
-    } else if ([errorDomain caseInsensitiveCompare:@"expired_token"] == NSOrderedSame) {
-        errorCode = SPiDOAuth2ExpiredTokenErrorCode;
-    } else if ([errorDomain caseInsensitiveCompare:@"ApiException"] == NSOrderedSame) {
-        if(apiError == 302) {
-            errorCode = SPiDAPIExceptionExistingUser;
-        } else {
-            errorCode = SPiDAPIExceptionErrorCode;
-        }
-    } else if ([errorDomain caseInsensitiveCompare:@"UserAbortedLogin"] == NSOrderedSame) {
-        errorCode = SPiDUserAbortedLogin;
-    } else if ([errorDomain caseInsensitiveCompare:@"unverified_user"] == NSOrderedSame) {
-        errorCode = SPiDOAuth2UnverifiedUserErrorCode;
-    } else if ([errorDomain caseInsensitiveCompare:@"invalid_user_credentials"] == NSOrderedSame) {
-        errorCode = SPiDOAuth2InvalidUserCredentialsErrorCode;
-    } else if ([errorDomain caseInsensitiveCompare:@"unknown_user"] == NSOrderedSame) {
-        errorCode = SPiDOAuth2UnknownUserErrorCode;
+    if (![errorDomain isKindOfClass:[NSString class]]) {
+        return 0;
+    }
+    // Every known domain is ASCII and at most 26 characters, anything that does not fit can not match
+    char domain[32];
+    if (![errorDomain getCString:domain maxLength:sizeof(domain) encoding:NSASCIIStringEncoding]) {
+        return 0;
+    }
+    size_t length = strlen(domain);
+    const SPiDErrorDomainEntry *entry = &SPiDErrorDomainTable[SPiDErrorDomainSlot(domain, length)];
+    if (entry->name == NULL || entry->length != length || strncasecmp(entry->name, domain, length) != 0) {
+        return 0;
+    }
+    if (entry->code == SPiDAPIExceptionErrorCode && apiError == 302) {
+        return SPiDAPIExceptionExistingUser;
     }
+    return entry->code;
+}
+
+- (BOOL)sp_isOfflineError {
+    if (![self.domain isEqualToString:NSURLErrorDomain]) {
+        return NO;
+    }
+    switch (self.code) {
+        case NSURLErrorNotConnectedToInternet:
+        case NSURLErrorCannotFindHost:
+        case NSURLErrorCannotConnectToHost:
+        case NSURLErrorDNSLookupFailed:
+        case NSURLErrorInternationalRoamingOff:
+        case NSURLErrorDataNotAllowed:
+            return YES;
+        default:
+            return NO;
+    }
+}
 
-    return errorCode;
+- (BOOL)sp_isInterruptedRequestError {
+    if (![self.domain isEqualToString:NSURLErrorDomain]) {
+        return NO;
+    }
+    return self.code == NSURLErrorTimedOut || self.code == NSURLErrorNetworkConnectionLost;
 }
 
 @end
@@ -13,6 +13,8 @@
 
 /** Generates a HMAC SHA256 signature for a string
 
+ Both the string and the key are signed as UTF-8, use `SPiDHMAC` to sign many payloads with the same key.
+
  @param key Encoding key
  @return The signature in hex
  */
@@ -6,22 +6,15 @@
 //
 
 #import "NSString+Crypto.h"
-#import <CommonCrypto/CommonHMAC.h>
+#import "SPiDHMAC.h"
 
 
 @implementation NSString (Crypto)
 
 - (NSString *)hmacSHA256withKey:(NSString *)key {
-    const char *cKey = [key cStringUsingEncoding:NSASCIIStringEncoding];
-    const char *cData = [self cStringUsingEncoding:NSASCIIStringEncoding];
-    unsigned char cHMAC[CC_SHA256_DIGEST_LENGTH];
-    CCHmac(kCCHmacAlgSHA256, (void *) cKey, strlen(cKey), (void *) cData, strlen(cData), cHMAC);
-
-    NSMutableString *result = [NSMutableString string];
-    for (int i = 0; i < sizeof cHMAC; i++) {
-        [result appendFormat:@"%02hhx", cHMAC[i]];
-    }
-    return result;
+    NSData *keyData = [key dataUsingEncoding:NSUTF8StringEncoding] ?: [NSData data];
+    NSData *data = [self dataUsingEncoding:NSUTF8StringEncoding] ?: [NSData data];
+    return [[[SPiDHMAC alloc] initWithKey:keyData] hexSignatureForData:data];
 }
 
-@end
\ No newline at end of file
+@end
@@ -12,4 +12,6 @@
 
 + (NSURLRequest *)sp_requestWithURL:(NSURL *)URL method:(NSString *)method andBody:(NSString *)body;
 
++ (NSURLRequest *)sp_requestWithURL:(NSURL *)URL method:(NSString *)method bodyData:(NSData *)bodyData;
+
 @end
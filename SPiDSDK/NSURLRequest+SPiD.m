@@ -7,19 +7,24 @@
 //
 
 #import "NSURLRequest+SPiD.h"
-#import "SPiDStatus.h"
+#import "SPiDConfiguration.h"
+#import "SPiDClient.h"
 
 @implementation NSURLRequest (SPiD)
 
 + (NSURLRequest *)sp_requestWithURL:(NSURL *)URL method:(NSString *)method andBody:(NSString *)body {
+    return [self sp_requestWithURL:URL method:method bodyData:[body dataUsingEncoding:NSUTF8StringEncoding]];
+}
+
++ (NSURLRequest *)sp_requestWithURL:(NSURL *)URL method:(NSString *)method bodyData:(NSData *)bodyData {
     NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:URL cachePolicy:NSURLRequestUseProtocolCachePolicy timeoutInterval:60.0];
     [request setHTTPMethod:method];
     
-    [request setValue:[SPiDStatus spidUserAgent] forHTTPHeaderField:@"User-Agent"];
+    [request setAllHTTPHeaderFields:[SPiDConfiguration defaultHTTPHeaders]];
     SPiDDebugLog(@"Running request: %@", URL);
     
-    if (body) {
-        [request setHTTPBody:[body dataUsingEncoding:NSUTF8StringEncoding]];
+    if (bodyData) {
+        [request setHTTPBody:bodyData];
     }
     
     return [request copy];
@@ -9,7 +9,11 @@
 
 NS_ASSUME_NONNULL_BEGIN
 
-/** Contains a access token that can be saved to the keychain */
+/** Contains a access token that can be saved to the keychain
+
+ The SDK never changes a token after it has been created, a new token replaces the old one as a whole so that it can be
+ shared between threads. Setting the properties of a token that is in use by `SPiDClient` is not thread safe.
+ */
 
 @interface SPiDAccessToken : NSObject <NSCoding>
 
@@ -51,6 +55,29 @@ NS_ASSUME_NONNULL_BEGIN
  */
 - (instancetype)initWithDictionary:(NSDictionary * _Nullable)dictionary;
 
+/** Initializes the AccessToken from its binary encoding
+
+ @param data Data created by `serializedData`
+ @return SPiDAccessToken or nil if the data is not a valid encoding
+ */
+- (nullable instancetype)initWithSerializedData:(NSData *)data;
+
+/** Encodes the token in a compact versioned binary format
+
+ The encoding starts with a magic number and a version, followed by the expiry date and the length prefixed UTF-8
+ strings. It is what the keychain stores, tokens archived with `NSKeyedArchiver` by earlier versions are still read.
+
+ @return Encoded token
+ */
+- (NSData *)serializedData;
+
+/** Checks if data starts with the binary encoding magic number
+
+ @param data Data read from storage
+ @return YES if the data should be decoded with `initWithSerializedData:`
+ */
++ (BOOL)isSerializedData:(NSData *)data;
+
 /** Checks if the access token has expired
 
 @Return Returns YES if access token has expired
@@ -14,6 +14,50 @@ static NSString *const SPiDAccessTokenExpiresInKey = @"expires_in";
 static NSString *const SPiDAccessTokenExpiresAtKey = @"expires_at";
 static NSString *const SPiDAccessTokenRefreshTokenKey = @"refresh_token";
 
+// Binary encoding: magic, version, big endian expiry date as double bits, then length prefixed strings
+static const uint8_t SPiDAccessTokenMagic[] = {'S', 'P', 'T'};
+static const uint8_t SPiDAccessTokenVersion = 1;
+static const uint32_t SPiDAccessTokenNilLength = UINT32_MAX;
+static const size_t SPiDAccessTokenHeaderLength = sizeof(SPiDAccessTokenMagic) + 1 + sizeof(uint64_t);
+
+/** Appends a length prefixed UTF-8 string, nil is written as a length of `SPiDAccessTokenNilLength` */
+static void SPiDAppendString(NSMutableData *data, NSString *string) {
+    if (string == nil) {
+        uint32_t length = CFSwapInt32HostToBig(SPiDAccessTokenNilLength);
+        [data appendBytes:&length length:sizeof(length)];
+        return;
+    }
+    NSUInteger maxLength = [string maximumLengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+    NSUInteger offset = data.length;
+    [data increaseLengthBy:sizeof(uint32_t) + maxLength];
+    NSUInteger used = 0;
+    [string getBytes:(uint8_t *) data.mutableBytes + offset + sizeof(uint32_t) maxLength:maxLength usedLength:&used encoding:NSUTF8StringEncoding options:0 range:NSMakeRange(0, string.length) remainingRange:NULL];
+    uint32_t length = CFSwapInt32HostToBig((uint32_t) used);
+    memcpy((uint8_t *) data.mutableBytes + offset, &length, sizeof(length));
+    data.length = offset + sizeof(uint32_t) + used;
+}
+
+/** Reads a length prefixed UTF-8 string and advances the offset, returns NO if the data is truncated or invalid */
+static BOOL SPiDReadString(const uint8_t *bytes, size_t length, size_t *offset, NSString **string) {
+    uint32_t stringLength;
+    if (length - *offset < sizeof(stringLength)) {
+        return NO;
+    }
+    memcpy(&stringLength, bytes + *offset, sizeof(stringLength));
+    stringLength = CFSwapInt32BigToHost(stringLength);
+    *offset += sizeof(stringLength);
+    if (stringLength == SPiDAccessTokenNilLength) {
+        *string = nil;
+        return YES;
+    }
+    if (length - *offset < stringLength) {
+        return NO;
+    }
+    *string = [[NSString alloc] initWithBytes:bytes + *offset length:stringLength encoding:NSUTF8StringEncoding];
+    *offset += stringLength;
+    return *string != nil;
+}
+
 @implementation SPiDAccessToken
 
 + (BOOL)isValidToken:(SPiDAccessToken *)accessToken {
@@ -30,10 +74,10 @@ static NSString *const SPiDAccessTokenRefreshTokenKey = @"refresh_token";
 
 - (instancetype)initWithUserID:(NSString *)userID accessToken:(NSString *)accessToken expiresAt:(NSDate *)expiresAt refreshToken:(NSString *)refreshToken {
     if (self = [super init]) {
-        _userID = userID;
-        _accessToken = accessToken;
-        _expiresAt = expiresAt;
-        _refreshToken = refreshToken;
+        _userID = [userID copy];
+        _accessToken = [accessToken copy];
+        _expiresAt = [expiresAt copy];
+        _refreshToken = [refreshToken copy];
 
         if (![SPiDAccessToken isValidToken:self]) {
             return nil;
@@ -86,6 +130,55 @@ static NSString *const SPiDAccessTokenRefreshTokenKey = @"refresh_token";
     [coder encodeObject:[self refreshToken] forKey:SPiDAccessTokenRefreshTokenKey];
 }
 
+- (instancetype)initWithSerializedData:(NSData *)data {
+    if (![SPiDAccessToken isSerializedData:data]) {
+        return nil;
+    }
+    const uint8_t *bytes = data.bytes;
+    size_t length = data.length;
+    if (bytes[sizeof(SPiDAccessTokenMagic)] != SPiDAccessTokenVersion) {
+        SPiDDebugLog(@"Unsupported access token encoding version: %d", bytes[sizeof(SPiDAccessTokenMagic)]);
+        return nil;
+    }
+
+    uint64_t bits;
+    memcpy(&bits, bytes + sizeof(SPiDAccessTokenMagic) + 1, sizeof(bits));
+    bits = CFSwapInt64BigToHost(bits);
+    double interval;
+    memcpy(&interval, &bits, sizeof(interval));
+
+    size_t offset = SPiDAccessTokenHeaderLength;
+    NSString *userID, *accessToken, *refreshToken;
+    if (!SPiDReadString(bytes, length, &offset, &userID) ||
+            !SPiDReadString(bytes, length, &offset, &accessToken) ||
+            !SPiDReadString(bytes, length, &offset, &refreshToken)) {
+        SPiDDebugLog(@"Could not decode access token, data is truncated");
+        return nil;
+    }
+    return [self initWithUserID:userID accessToken:accessToken expiresAt:[NSDate dateWithTimeIntervalSinceReferenceDate:interval] refreshToken:refreshToken];
+}
+
+- (NSData *)serializedData {
+    NSMutableData *data = [NSMutableData dataWithCapacity:SPiDAccessTokenHeaderLength + 3 * sizeof(uint32_t) + _accessToken.length + _refreshToken.length + _userID.length];
+    [data appendBytes:SPiDAccessTokenMagic length:sizeof(SPiDAccessTokenMagic)];
+    [data appendBytes:&SPiDAccessTokenVersion length:1];
+
+    double interval = [_expiresAt timeIntervalSinceReferenceDate];
+    uint64_t bits;
+    memcpy(&bits, &interval, sizeof(bits));
+    bits = CFSwapInt64HostToBig(bits);
+    [data appendBytes:&bits length:sizeof(bits)];
+
+    SPiDAppendString(data, _userID);
+    SPiDAppendString(data, _accessToken);
+    SPiDAppendString(data, _refreshToken);
+    return data;
+}
+
++ (BOOL)isSerializedData:(NSData *)data {
+    return data.length >= SPiDAccessTokenHeaderLength && memcmp(data.bytes, SPiDAccessTokenMagic, sizeof(SPiDAccessTokenMagic)) == 0;
+}
+
 - (BOOL)hasExpired {
     return ([[NSDate date] earlierDate:[self expiresAt]] == [self expiresAt]);
 }
@@ -0,0 +1,115 @@
+//
+//  SPiDAccountStore.h
+//  SPiDSDK
+//
+//  Copyright (c) 2012 Schibsted Payment. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "SPiDTokenStore.h"
+
+@class SPiDAccessToken;
+@class SPiDRefreshScheduler;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/** Prefix for the keychain identifiers of stored accounts, followed by the user ID */
+static NSString *const SPiDAccountKeychainIdentifierPrefix = @"AccessToken-";
+
+/** `SPiDAccountStore` keeps the access tokens of every user that has logged in on the device.
+
+ All accounts are read from the token store with a single query when the store is created and are then kept in
+ memory, so looking up or switching to an account never touches the keychain. Changes are written through to the
+ token store.
+ */
+
+@interface SPiDAccountStore : NSObject
+
+///---------------------------------------------------------------------------------------
+/// @name Properties
+///---------------------------------------------------------------------------------------
+
+/** Backend the accounts are persisted in */
+@property (nonatomic, strong, readonly) id<SPiDTokenStore> tokenStore;
+
+/** Prefix of the token store identifiers of the accounts, followed by the user ID */
+@property (nonatomic, copy, readonly) NSString *identifierPrefix;
+
+/** User IDs of all stored accounts */
+@property (nonatomic, copy, readonly) NSArray<NSString *> *userIDs;
+
+/** Refreshes the stored accounts before they expire, nil by default
+
+ Setting a scheduler schedules every account in the store by user ID. Accounts stored later are scheduled when they
+ are stored and removed accounts are cancelled. Accounts without a refresh token are not scheduled.
+ */
+@property (nonatomic, strong, nullable) SPiDRefreshScheduler *refreshScheduler;
+
+///---------------------------------------------------------------------------------------
+/// @name Public methods
+///---------------------------------------------------------------------------------------
+
+/** Initializes a account store backed by the keychain
+
+ @return `SPiDAccountStore`
+ */
+- (instancetype)init;
+
+/** Initializes a account store and loads the accounts persisted in the given token store
+
+ @param tokenStore Backend the accounts are persisted in
+ @return `SPiDAccountStore`
+ */
+- (instancetype)initWithTokenStore:(id<SPiDTokenStore>)tokenStore;
+
+/** Initializes a account store that keeps its accounts under the given identifier prefix
+
+ Clients for different environments use different prefixes so that their accounts are kept apart in one token store.
+
+ @param tokenStore Backend the accounts are persisted in
+ @param identifierPrefix Prefix of the identifiers, followed by the user ID
+ @return `SPiDAccountStore`
+ */
+- (instancetype)initWithTokenStore:(id<SPiDTokenStore>)tokenStore identifierPrefix:(NSString *)identifierPrefix NS_DESIGNATED_INITIALIZER;
+
+/** Returns the identifier used for a account in this store
+
+ @param userID The user ID
+ @return Token store identifier
+ */
+- (NSString *)identifierForUserID:(NSString *)userID;
+
+/** Returns the keychain identifier used for a account with the default prefix
+
+ @param userID The user ID
+ @return Keychain identifier
+ */
++ (NSString *)keychainIdentifierForUserID:(NSString *)userID;
+
+/** Returns the access token for a account
+
+ @param userID The user ID
+ @return The access token or nil if the account is not stored
+ */
+- (nullable SPiDAccessToken *)accessTokenForUserID:(NSString *)userID;
+
+/** Adds or replaces the account of the token owner
+
+ Client tokens are not stored since they do not belong to a user.
+
+ @param accessToken The user access token
+ */
+- (void)storeAccessToken:(SPiDAccessToken *)accessToken;
+
+/** Removes a account from the store and the keychain
+
+ @param userID The user ID
+ */
+- (void)removeAccessTokenForUserID:(NSString *)userID;
+
+/** Removes all accounts from the store and the keychain */
+- (void)removeAllAccessTokens;
+
+@end
+
+NS_ASSUME_NONNULL_END
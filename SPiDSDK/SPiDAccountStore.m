@@ -0,0 +1,132 @@
+//
+//  SPiDAccountStore.m
+//  SPiDSDK
+//
+//  Copyright (c) 2012 Schibsted Payment. All rights reserved.
+//
+
+#import "SPiDAccountStore.h"
+#import "SPiDAccessToken.h"
+#import "SPiDKeychainTokenStore.h"
+#import "SPiDRefreshScheduler.h"
+
+@interface SPiDAccountStore ()
+
+@property (nonatomic, strong) NSMutableDictionary<NSString *, SPiDAccessToken *> *accessTokens;
+@property (nonatomic, strong, readwrite) id<SPiDTokenStore> tokenStore;
+@property (nonatomic, copy, readwrite) NSString *identifierPrefix;
+
+/** Schedules the refresh of a account with `refreshScheduler`, if it can be refreshed */
+- (void)scheduleRefreshOfAccessToken:(SPiDAccessToken *)accessToken;
+
+@end
+
+@implementation SPiDAccountStore
+
+@synthesize refreshScheduler = _refreshScheduler;
+
+- (instancetype)init {
+    return [self initWithTokenStore:[[SPiDKeychainTokenStore alloc] init]];
+}
+
+- (instancetype)initWithTokenStore:(id<SPiDTokenStore>)tokenStore {
+    return [self initWithTokenStore:tokenStore identifierPrefix:SPiDAccountKeychainIdentifierPrefix];
+}
+
+- (instancetype)initWithTokenStore:(id<SPiDTokenStore>)tokenStore identifierPrefix:(NSString *)identifierPrefix {
+    if (self = [super init]) {
+        self.tokenStore = tokenStore;
+        self.identifierPrefix = identifierPrefix;
+        NSDictionary<NSString *, SPiDAccessToken *> *stored = [tokenStore accessTokensWithIdentifierPrefix:identifierPrefix];
+        self.accessTokens = [NSMutableDictionary dictionaryWithCapacity:stored.count];
+        for (SPiDAccessToken *accessToken in stored.allValues) {
+            if (accessToken.userID) {
+                self.accessTokens[accessToken.userID] = accessToken;
+            }
+        }
+    }
+    return self;
+}
+
++ (NSString *)keychainIdentifierForUserID:(NSString *)userID {
+    return [SPiDAccountKeychainIdentifierPrefix stringByAppendingString:userID];
+}
+
+- (NSString *)identifierForUserID:(NSString *)userID {
+    return [self.identifierPrefix stringByAppendingString:userID];
+}
+
+- (NSArray<NSString *> *)userIDs {
+    @synchronized (self) {
+        return self.accessTokens.allKeys;
+    }
+}
+
+- (SPiDRefreshScheduler *)refreshScheduler {
+    @synchronized (self) {
+        return _refreshScheduler;
+    }
+}
+
+- (void)setRefreshScheduler:(SPiDRefreshScheduler *)refreshScheduler {
+    NSArray<SPiDAccessToken *> *accessTokens;
+    @synchronized (self) {
+        _refreshScheduler = refreshScheduler;
+        accessTokens = self.accessTokens.allValues;
+    }
+    for (SPiDAccessToken *accessToken in accessTokens) {
+        [self scheduleRefreshOfAccessToken:accessToken];
+    }
+}
+
+- (SPiDAccessToken *)accessTokenForUserID:(NSString *)userID {
+    @synchronized (self) {
+        return self.accessTokens[userID];
+    }
+}
+
+- (void)storeAccessToken:(SPiDAccessToken *)accessToken {
+    if (accessToken.userID == nil || accessToken.isClientToken) {
+        return;
+    }
+    @synchronized (self) {
+        self.accessTokens[accessToken.userID] = accessToken;
+    }
+    [self.tokenStore storeAccessToken:accessToken forIdentifier:[self identifierForUserID:accessToken.userID]];
+    [self scheduleRefreshOfAccessToken:accessToken];
+}
+
+- (void)removeAccessTokenForUserID:(NSString *)userID {
+    @synchronized (self) {
+        [self.accessTokens removeObjectForKey:userID];
+    }
+    [self.tokenStore removeAccessTokenForIdentifier:[self identifierForUserID:userID]];
+    [self.refreshScheduler cancelRefreshForIdentifier:userID];
+}
+
+- (void)removeAllAccessTokens {
+    NSArray<NSString *> *userIDs;
+    @synchronized (self) {
+        userIDs = self.accessTokens.allKeys;
+        [self.accessTokens removeAllObjects];
+    }
+    for (NSString *userID in userIDs) {
+        [self.tokenStore removeAccessTokenForIdentifier:[self identifierForUserID:userID]];
+        [self.refreshScheduler cancelRefreshForIdentifier:userID];
+    }
+}
+
+#pragma mark Private methods
+
+///---------------------------------------------------------------------------------------
+/// @name Private methods
+///---------------------------------------------------------------------------------------
+
+- (void)scheduleRefreshOfAccessToken:(SPiDAccessToken *)accessToken {
+    if (accessToken.refreshToken == nil) {
+        return;
+    }
+    [self.refreshScheduler scheduleAccessToken:accessToken forIdentifier:accessToken.userID];
+}
+
+@end
@@ -17,9 +17,36 @@ NS_ASSUME_NONNULL_BEGIN
 @class SPiDAccessToken;
 @class SPiDRequest;
 @class SPiDAgreements;
+@class SPiDRequestJournal;
+@class SPiDRequestScheduler;
+@class SPiDAccountStore;
+@class SPiDSharedTokenCoordinator;
+@class SPiDRefreshScheduler;
+@class SPiDConfiguration;
+@class SPiDIdentity;
+@class SPiDUserProfile;
+@protocol SPiDTokenStore;
 
 static NSString *const defaultAPIVersionSPiD = @"2";
 static NSString *const AccessTokenKeychainIdentification = @"AccessToken";
+static NSString *const ClientAccessTokenKeychainIdentification = @"ClientAccessToken";
+
+/** Posted when a authorization code exchange interrupted by app termination has been resumed and finished
+
+ The userInfo contains `SPiDAuthorizationRecoveryLatencyKey` and, if the exchange failed, `SPiDAuthorizationRecoveryErrorKey`.
+ */
+static NSString *const SPiDClientDidRecoverAuthorizationNotification = @"SPiDClientDidRecoverAuthorizationNotification";
+static NSString *const SPiDAuthorizationRecoveryLatencyKey = @"latency";
+static NSString *const SPiDAuthorizationRecoveryErrorKey = @"error";
+
+/** Posted on the main queue when the stored access token has been loaded from the keychain */
+static NSString *const SPiDClientDidLoadAccessTokenNotification = @"SPiDClientDidLoadAccessTokenNotification";
+
+// Keys in `startupTimings`, values are durations in seconds
+static NSString *const SPiDStartupTimingInitKey = @"init";
+static NSString *const SPiDStartupTimingKeychainLoadKey = @"keychainLoad";
+static NSString *const SPiDStartupTimingAccountStoreLoadKey = @"accountStoreLoad";
+static NSString *const SPiDStartupTimingWaitKey = @"waitForLoad";
 
 // debug print used by SPiDSDK
 #ifdef DEBUG
@@ -31,7 +58,10 @@ static NSString *const AccessTokenKeychainIdentification = @"AccessToken";
 /**
  The main SDK class, all interaction with SPiD goes through this class
 
- `SPiDClient` contains a singleton instance and all calls to SPiD should go through this instance.
+ `SPiDClient` contains a singleton instance that requests use unless they are bound to another client. Apps that talk
+ to several environments or clients can create independent instances with
+ `initWithClientID:clientSecret:appURLScheme:serverURL:`, all instances send their requests through the same
+ `URLSession`. Each independent instance keeps its tokens and journals under its own `storageKey`.
  */
 
 @interface SPiDClient : NSObject
@@ -121,15 +151,118 @@ static NSString *const AccessTokenKeychainIdentification = @"AccessToken";
 /** HTML string that will be show when WebView is loading */
 @property(strong, nonatomic) NSString *webViewInitialHTML;
 
-/** The SPiD access token */
-@property(strong, nonatomic, nullable) SPiDAccessToken *accessToken;
+/** Snapshot of the settings above with the URLs, queries and headers derived from them
+
+ Built on first use and replaced when one of the settings changes, requests read from it instead of the settings.
+ */
+@property(strong, atomic, readonly) SPiDConfiguration *configuration;
+
+/** The SPiD access token
+
+ The token is a immutable snapshot that is replaced as a whole, reads and writes are atomic and can be made from any
+ thread. Read it once into a local variable when several of its values are needed.
+
+ The stored token is loaded from the keychain in the background, the first access blocks if it is made before the
+ load has finished. See `notifyWhenAccessTokenLoaded:`.
+ */
+@property(strong, atomic, nullable) SPiDAccessToken *accessToken;
+
+/** The SPiD client token
+
+ Client credentials tokens are used for requests that do not act on behalf of a user, such as signup. They are cached
+ separately from `accessToken` so that fetching one never replaces the user session.
+ */
+@property(strong, atomic, nullable) SPiDAccessToken *clientAccessToken;
+
+/** Sets if user token requests should ask for a signed id_token, default value is NO
+
+ The id_token is verified with `clientSecret` and decoded into `currentIdentity`, so the user can be shown without a
+ `meRequestWithCompletionHandler:` round trip after login.
+ */
+@property(nonatomic) BOOL requestsIdentityToken;
+
+/** Identity of the current user, decoded from the id_token of the last token response
+
+ Nil until a token response with a valid id_token has been received, and cleared on logout and account switch. The
+ identity is not persisted, after a restart it is set again by the next token refresh.
+ */
+@property(strong, atomic, nullable) SPiDIdentity *currentIdentity;
+
+/** Backend the tokens are persisted in, defaults to a `SPiDKeychainTokenStore`
+
+ Setting a new store reloads `accessToken`, `clientAccessToken` and `accountStore` from it in the background, using
+ them before the reload has finished waits for it. `SPiDClientDidLoadAccessTokenNotification` is not posted again.
+ */
+@property(nonatomic, strong) id<SPiDTokenStore> tokenStore;
+
+/** Prefix of the token identifiers and journal names of this client, derived from its client ID and server URL
+
+ Nil for the singleton instance and for clients created with `init`, which keep the names used by earlier versions so
+ that stored sessions survive an update.
+ */
+@property(nonatomic, copy, readonly, nullable) NSString *storageKey;
+
+/** Identifier of `accessToken` in `tokenStore` */
+@property(nonatomic, copy, readonly) NSString *accessTokenIdentifier;
+
+/** Identifier of `clientAccessToken` in `tokenStore` */
+@property(nonatomic, copy, readonly) NSString *clientAccessTokenIdentifier;
+
+/** Access tokens of all users that have logged in on the device, see `switchToAccountWithUserID:` */
+@property(nonatomic, strong, readonly) SPiDAccountStore *accountStore;
+
+/** Coordinates token refreshes with other processes, nil unless shared token storage is enabled */
+@property(nonatomic, strong, readonly, nullable) SPiDSharedTokenCoordinator *sharedTokenCoordinator;
 
 /** Queue for waiting requests */
 @property(nonatomic, strong, readonly) NSMutableArray *waitingRequests;
 
-/** NSURLSession for the SPiDClient */
+/** NSURLSession shared by all SPiDClient instances, so that they share one connection pool */
 @property (nonatomic, strong, readonly) NSURLSession *URLSession;
 
+/** Scheduler that decides when requests are sent, holds back deferrable requests, shared by all instances */
+@property (nonatomic, strong, readonly) SPiDRequestScheduler *requestScheduler;
+
+/** Sets if durable requests that fail while offline should be stored and replayed later, default value is NO
+
+ Stored requests are replayed when this is enabled, when the network becomes usable again and whenever another
+ request reaches SPiD.
+
+ @see `SPiDRequest.durable`
+ */
+@property(nonatomic) BOOL journalsOfflineRequests;
+
+/** Sets if the access tokens of all accounts in `accountStore` should be refreshed before they expire, default value
+ is NO
+
+ Accounts are scheduled when they are loaded or stored and refreshed like `refreshAccountWithUserID:completionHandler:`.
+ A failed refresh is retried with a growing delay, a account whose refresh token was rejected is no longer refreshed.
+ Refreshes are not coordinated with other processes, enable this in one process only when tokens are shared.
+ */
+@property(nonatomic) BOOL refreshesAccountsAhead;
+
+/** Scheduler of the account refreshes, nil unless `refreshesAccountsAhead` is enabled */
+@property(atomic, strong, readonly, nullable) SPiDRefreshScheduler *refreshScheduler;
+
+/** Journal with requests waiting to be replayed when SPiD can be reached again */
+@property(nonatomic, strong, readonly) SPiDRequestJournal *requestJournal;
+
+/** Journal holding a received authorization code until it has been exchanged, protected while the device is locked */
+@property(nonatomic, strong, readonly) SPiDRequestJournal *authorizationJournal;
+
+/** How long a received authorization code can be resumed after the app was terminated, defaults to 60 seconds */
+@property(nonatomic) NSTimeInterval authorizationCodeLifetime;
+
+/** Time it took to finish the last resumed authorization code exchange, 0 if none has been resumed */
+@property(atomic, readonly) NSTimeInterval authorizationRecoveryLatency;
+
+/** Time spent in the phases of SDK initialization
+
+ `init` is the time spent on the calling thread, `keychainLoad` and `accountStoreLoad` run in the background, and
+ `waitForLoad` is the total time callers were blocked because they used the access token before it was loaded.
+ */
+@property(nonatomic, copy, readonly) NSDictionary<NSString *, NSNumber *> *startupTimings;
+
 ///---------------------------------------------------------------------------------------
 /// @name Public Methods
 ///---------------------------------------------------------------------------------------
@@ -142,6 +275,23 @@ static NSString *const AccessTokenKeychainIdentification = @"AccessToken";
  */
 + (SPiDClient *)sharedInstance;
 
+/** Initializes a client that is independent of the singleton instance
+
+ The URLs that are not set are derived from the server URL, the same way as for the singleton instance. Requests
+ for this client must be bound to it, see `SPiDRequest.client`. Tokens and journals are stored under a `storageKey`
+ derived from the client ID and server URL, so they are not shared with clients for other environments.
+
+ @param clientID The client ID provided by SPiD
+ @param clientSecret The client secret provided by SPiD
+ @param appURLSchema The url schema for the app (eg spidtest://)
+ @param serverURL The url to SPiD
+ @return `SPiDClient`
+ */
+- (instancetype)initWithClientID:(NSString *)clientID
+                    clientSecret:(NSString *)clientSecret
+                    appURLScheme:(NSString *)appURLSchema
+                       serverURL:(NSURL *)serverURL;
+
 /** Configures the `SPiDClient` and creates a singleton instance
 
  @param clientID The client ID provided by SPiD
@@ -195,6 +345,25 @@ static NSString *const AccessTokenKeychainIdentification = @"AccessToken";
 */
 - (BOOL)handleOpenURL:(NSURL *)url;
 
+/** Exchanges a authorization code for a access token
+
+ The code is kept in a persisted journal until SPiD has responded. If the app is terminated before that the exchange
+ is resumed the next time a client for the same client ID and server is initialized, as long as the code is younger
+ than `authorizationCodeLifetime`.
+
+ @param code The authorization code received from SPiD
+ @param completionHandler Called on token request completion or error
+ @see SPiDClientDidRecoverAuthorizationNotification
+ */
+- (void)exchangeAuthorizationCode:(NSString *)code completionHandler:(nullable void (^)(NSError * __nullable))completionHandler;
+
+/** Resumes a authorization code exchange that was interrupted by app termination
+
+ Called in the background once the stored tokens have been loaded, and again when the network can be used after a
+ resumed exchange failed because the device was offline. There is normally no need to call this directly.
+ */
+- (void)resumePendingAuthorizationIfNeeded;
+
 /** Logout from SPiD
 
  This requires that the app has obtained a access token.
@@ -213,6 +382,78 @@ static NSString *const AccessTokenKeychainIdentification = @"AccessToken";
  */
 - (void)refreshAccessTokenAndRerunRequest:(SPiDRequest *)request;
 
+/** Stores a request in the offline journal
+
+ @param request The request that failed because the device is offline
+ */
+- (void)journalRequest:(SPiDRequest *)request;
+
+/** Replays the requests in the offline journal in the order they were stored
+
+ Each request is run with `startRequestWithAccessToken`, so the access token is refreshed first if needed, and is
+ removed from the journal once SPiD has responded to it. Replay stops at the first request that fails because the
+ device is still offline.
+ */
+- (void)replayJournaledRequestsIfNeeded;
+
+/** Calls the block on the main queue once the stored access token has been loaded
+
+ The stored token is loaded in the background after `setClientID:clientSecret:appURLScheme:serverURL:`. Accessing
+ `accessToken` or `isAuthorized` before that blocks until the load is done, use this to avoid blocking.
+
+ @param block Called when the token is loaded, immediately if it already is
+ */
+- (void)notifyWhenAccessTokenLoaded:(dispatch_block_t)block;
+
+/** Makes sure there is a valid client token
+
+ The cached `clientAccessToken` is reused until it expires, a new one is only requested when needed.
+
+ @param completionHandler Called when a client token is available or on error
+ */
+- (void)clientTokenWithCompletionHandler:(void (^)(NSError * __nullable))completionHandler;
+
+/** Requests a new client token and reruns the request
+
+ @param request The request to retry after a new client token has been acquired
+ */
+- (void)refreshClientTokenAndRerunRequest:(SPiDRequest *)request;
+
+/** Shares the access token with app extensions
+
+ Tokens are stored in the given keychain access group. Token refreshes are coordinated through files in the container
+ so that only one process refreshes at a time, the others reload the refreshed token from the keychain. Must be
+ called with the same values in every process, before any requests are made. Only the tokens of this client are
+ moved to the access group, other clients keep using their own storage. A custom `tokenStore` set before is kept
+ instead, the app must then make it reachable by its extensions.
+
+ @param accessGroup Keychain access group shared by the app and its extensions
+ @param containerURL App group container shared by the app and its extensions
+ */
+- (void)enableSharedTokenStorageWithAccessGroup:(NSString *)accessGroup containerURL:(NSURL *)containerURL;
+
+/** Makes a stored account the active one
+
+ The token is taken from `accountStore` without reading the keychain. Only the user ID of the active account is
+ persisted, in the user defaults, and only when it changes. Requests that are waiting for a token refresh and journaled
+ offline requests belong to the previous account and are dropped. With shared token storage the active token is also
+ written to `tokenStore`, where the other processes read it.
+
+ @param userID The user ID of the account
+ @return YES if the account was found in `accountStore`
+ */
+- (BOOL)switchToAccountWithUserID:(NSString *)userID;
+
+/** Refreshes the access token of a stored account
+
+ Accounts are refreshed independently of each other, refreshing a account that is not active leaves the active
+ access token untouched.
+
+ @param userID The user ID of the account
+ @param completionHandler Called on completion or error
+ */
+- (void)refreshAccountWithUserID:(NSString *)userID completionHandler:(nullable void (^)(NSError * __nullable))completionHandler;
+
 /** Clears current authorization request and waiting requests */
 - (void)clearAuthorizationRequest;
 
@@ -325,6 +566,27 @@ static NSString *const AccessTokenKeychainIdentification = @"AccessToken";
  */
 - (void)currentUserRequestWithCompletionHandler:(void (^)(SPiDResponse *))completionHandler;
 
+/** Requests the currently logged in user’s profile
+
+ Same request as `meRequestWithCompletionHandler:`, with the user object decoded into a `SPiDUserProfile`.
+
+ @warning Requires that the user is authorized with SPiD
+ @param completionHandler Called with the profile, or with a error if the request failed or the response had no user object
+ @see isAuthorized
+ */
+- (void)meProfileRequestWithCompletionHandler:(void (^)(SPiDUserProfile * __nullable profile, NSError * __nullable error))completionHandler;
+
+/** Requests the profile of the specified user
+
+ Same request as `userRequestWithID:completionHandler:`, with the user object decoded into a `SPiDUserProfile`.
+
+ @warning Requires that the user is authorized with SPiD
+ @param userID ID for the selected user
+ @param completionHandler Called with the profile, or with a error if the request failed or the response had no user object
+ @see isAuthorized
+ */
+- (void)userProfileRequestWithID:(NSString *)userID completionHandler:(void (^)(SPiDUserProfile * __nullable profile, NSError * __nullable error))completionHandler;
+
 /** Request all login attempts for a specific client
 
  For information about the return object see: <http://www.schibstedpayment.no/docs/doku.php?id=wiki:login_api>
@@ -337,8 +599,9 @@ static NSString *const AccessTokenKeychainIdentification = @"AccessToken";
 - (void)userLoginsRequestWithUserID:(NSString *)userID completionHandler:(void (^)(SPiDResponse *response))completionHandler;
 
 /** Checks of status of email
- 
- @warning Requires a client token with SPiD
+
+ Uses the client token, a new one is requested first if needed.
+
  @param email The email that should be checked
  @param completionHandler Called on request completion or error
  */
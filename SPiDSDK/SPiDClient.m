@@ -14,23 +14,87 @@
 #import "SPiDStatus.h"
 #import "NSData+Base64.h"
 #import "SPiDAgreements.h"
+#import "SPiDRequestJournal.h"
+#import "SPiDRequestScheduler.h"
+#import "SPiDAccountStore.h"
+#import "SPiDSharedTokenCoordinator.h"
+#import "SPiDRefreshScheduler.h"
+#import "SPiDKeychainTokenStore.h"
+#import "SPiDConfiguration.h"
+#import "SPiDUserProfile.h"
+#import "SPiDNetworkMonitor.h"
+#import "SPiDHMAC.h"
+#import <CommonCrypto/CommonDigest.h>
+
+static NSString *const SPiDOfflineRequestJournalName = @"OfflineRequests";
+static NSString *const SPiDAuthorizationJournalName = @"PendingAuthorization";
+static NSString *const SPiDAuthorizationJournalCodeKey = @"code";
+static NSString *const SPiDAuthorizationJournalReceivedAtKey = @"received_at";
+static NSString *const SPiDCurrentAccountDefaultsKey = @"SPiDCurrentAccountUserID";
+static const NSTimeInterval SPiDDefaultAuthorizationCodeLifetime = 60.0;
+static const NSTimeInterval SPiDAccountRefreshTickInterval = 10.0;
+static const NSUInteger SPiDStorageKeyLength = 16;
+static void *SPiDConfigurationObservationContext = &SPiDConfigurationObservationContext;
 
 @interface SPiDClient ()
 
-/** Runs after logout has been completed, should not be called directly */
-- (void)logoutComplete;
+/** Session used by all instances, created on first use
+
+ @return The shared `NSURLSession`
+ */
++ (NSURLSession *)sharedURLSession;
+
+/** Request scheduler used by all instances, created on first use
+
+ @return The shared `SPiDRequestScheduler`
+ */
++ (SPiDRequestScheduler *)sharedRequestScheduler;
+
+/** Initializes a client that stores its tokens and journals under the given key
+
+ @param storageKey Prefix of the token identifiers and journal names, nil to use them unprefixed
+ @return `SPiDClient`
+ */
+- (instancetype)initWithStorageKey:(nullable NSString *)storageKey;
 
-/** Builds authorization query
+/** Initializes a client with the given storage key, used for the singleton which keeps the unprefixed names
 
- @return The authorization query parameters
+ @param clientID The client ID provided by SPiD
+ @param clientSecret The client secret provided by SPiD
+ @param appURLSchema The url schema for the app (eg spidtest://)
+ @param serverURL The url to SPiD
+ @param storageKey Prefix of the token identifiers and journal names, nil to use them unprefixed
+ @return `SPiDClient`
  */
-- (NSString *)authorizationQuery;
+- (instancetype)initWithClientID:(NSString *)clientID
+                    clientSecret:(NSString *)clientSecret
+                    appURLScheme:(NSString *)appURLSchema
+                       serverURL:(NSURL *)serverURL
+                      storageKey:(nullable NSString *)storageKey;
 
-/** Builds logout query
+/** Derives the storage key of a independent client, the same client and server always get the same key
 
- @return The logout query parameters
+ @param clientID The client ID provided by SPiD
+ @param serverURL The url to SPiD
+ @return Hex encoded prefix of a SHA-256 digest of both
  */
-- (NSString *)logoutQuery;
++ (NSString *)storageKeyForClientID:(NSString *)clientID serverURL:(NSURL *)serverURL;
+
+/** Prefixes a token identifier or journal name with `storageKey`
+
+ @param name The unprefixed name
+ @return The name used by this client
+ */
+- (NSString *)storageNameWithName:(NSString *)name;
+
+/** Runs after logout has been completed, should not be called directly */
+- (void)logoutComplete;
+
+/** Settings that `configuration` is derived from
+
+ @return Key paths of the settings
+ */
++ (NSArray<NSString *> *)configurationKeyPaths;
 
 /** Helper method
 
@@ -38,10 +102,106 @@
  */
 - (BOOL)doHandleOpenURL:(NSURL *)url;
 
+/** Replays the oldest request in the offline journal and continues with the next one when it is done */
+- (void)replayNextJournaledRequest;
+
+/** Refreshes a account for `refreshScheduler`, stops refreshing it if it was removed or its refresh token rejected
+
+ @param userID The user ID of the account
+ @param completion Called with the refreshed token, or nil if the refresh failed
+ */
+- (void)refreshAccountAheadWithUserID:(NSString *)userID completion:(void (^)(SPiDAccessToken * __nullable refreshedToken))completion;
+
+/** Sends the token request for a authorization code that is already in `authorizationJournal`
+
+ The code is removed from the journal once SPiD has responded. If the request fails because the device is offline the
+ code is kept and the exchange is resumed when the network can be used again.
+
+ @param code The authorization code received from SPiD
+ @param completionHandler Called on token request completion or error
+ */
+- (void)exchangePendingAuthorizationCode:(NSString *)code completionHandler:(nullable void (^)(NSError * __nullable error))completionHandler;
+
+/** Resumes the pending authorization code exchange when the network path becomes usable, does nothing if already armed */
+- (void)resumeAuthorizationWhenReachable;
+
+/** Stops waiting for the network to resume the pending authorization code exchange */
+- (void)stopResumingAuthorizationWhenReachable;
+
+/** Refreshes the access token in coordination with other processes sharing it */
+- (void)refreshSharedAccessToken;
+
+/** Reloads the access token, client token and accounts that another process may have stored in the shared store */
+- (void)reloadSharedTokens;
+
+/** Calls the requests waiting for a token refresh with a error instead of running them again
+
+ @param error The error the requests fail with
+ */
+- (void)failWaitingRequestsWithError:(NSError *)error;
+
+/** Loads the stored tokens and accounts from `tokenStore`, runs on a background queue in `storedTokensGroup`
+
+ @param atStartup YES for the load started from init, which records `startupTimings` and posts
+ `SPiDClientDidLoadAccessTokenNotification`, NO when a new token store has been set
+ */
+- (void)loadStoredTokensAtStartup:(BOOL)atStartup;
+
+/** Persists the user ID of the active account, the user defaults are only written when it changes
+
+ @param userID The user ID of the active account, nil when logged out
+ */
+- (void)persistCurrentAccountUserID:(nullable NSString *)userID;
+
+/** Blocks until `loadStoredTokensAtStartup:` has finished, returns immediately once it has */
+- (void)waitForStoredTokens;
+
+/** Adds a entry to `startupTimings`
+
+ @param interval Duration in seconds
+ @param key Name of the startup phase
+ */
+- (void)recordStartupTiming:(NSTimeInterval)interval forKey:(NSString *)key;
+
+/** Writes pending keychain changes before the app is suspended or terminated
+
+ @param notification The application notification
+ */
+- (void)applicationWillSuspend:(NSNotification *)notification;
+
+/** Decodes the user object of a `/me` or `/user/{id}` response and calls the completion handler
+
+ @param response The received response
+ @param completionHandler Called with the profile, or with the response error
+ */
+- (void)completeProfileRequestWithResponse:(SPiDResponse *)response completionHandler:(void (^)(SPiDUserProfile *profile, NSError *error))completionHandler;
+
 @property (nonatomic, strong, readwrite) NSURLSession *URLSession;
 @property (nonatomic, strong, readwrite) NSMutableArray *waitingRequests;
 @property (nonatomic, strong) SPiDRequest *authorizationRequest;
 @property (nonatomic, copy) void (^completionHandler)(NSError *error);
+@property (nonatomic, strong, readwrite) SPiDRequestJournal *requestJournal;
+@property (nonatomic, strong, readwrite) SPiDRequestScheduler *requestScheduler;
+@property (nonatomic, strong, readwrite) SPiDAccountStore *accountStore;
+@property (nonatomic, strong, readwrite) SPiDSharedTokenCoordinator *sharedTokenCoordinator;
+@property (atomic, strong, readwrite, nullable) SPiDRefreshScheduler *refreshScheduler;
+@property (atomic, assign) BOOL refreshingSharedToken;
+@property (atomic, assign) BOOL replayingJournal;
+@property (nonatomic, strong, readwrite) SPiDRequestJournal *authorizationJournal;
+@property (nonatomic, strong, nullable) SPiDNetworkMonitor *networkMonitor;
+@property (nonatomic, strong, nullable) SPiDNetworkMonitor *authorizationNetworkMonitor;
+@property (atomic, assign) BOOL resumingAuthorization;
+@property (atomic, assign) BOOL authorizationResumeRequested;
+@property (atomic, readwrite) NSTimeInterval authorizationRecoveryLatency;
+@property (strong, atomic, nullable) SPiDAccessToken *storedAccessToken;
+@property (strong, atomic, nullable) SPiDAccessToken *storedClientAccessToken;
+@property (atomic, assign) BOOL storedTokensLoaded;
+@property (nonatomic, strong) dispatch_group_t storedTokensGroup;
+@property (nonatomic, strong) NSMutableDictionary<NSString *, NSNumber *> *mutableStartupTimings;
+@property (strong, atomic, nullable) SPiDConfiguration *currentConfiguration;
+@property (nonatomic, copy, readwrite, nullable) NSString *storageKey;
+@property (nonatomic, copy, readwrite) NSString *accessTokenIdentifier;
+@property (nonatomic, copy, readwrite) NSString *clientAccessTokenIdentifier;
 
 @end
 
@@ -63,6 +223,76 @@ static SPiDClient *sharedSPiDClientInstance = nil;
     return sharedSPiDClientInstance;
 }
 
+- (instancetype)initWithClientID:(NSString *)clientID
+                    clientSecret:(NSString *)clientSecret
+                    appURLScheme:(NSString *)appURLSchema
+                       serverURL:(NSURL *)serverURL {
+    return [self initWithClientID:clientID clientSecret:clientSecret appURLScheme:appURLSchema serverURL:serverURL
+                       storageKey:[SPiDClient storageKeyForClientID:clientID serverURL:serverURL]];
+}
+
+- (instancetype)initWithClientID:(NSString *)clientID
+                    clientSecret:(NSString *)clientSecret
+                    appURLScheme:(NSString *)appURLSchema
+                       serverURL:(NSURL *)serverURL
+                      storageKey:(NSString *)storageKey {
+    if (self = [self initWithStorageKey:storageKey]) {
+        [self setClientID:clientID];
+        [self setClientSecret:clientSecret];
+        [self setServerURL:serverURL];
+
+        NSString *escapedAppURL = [appURLSchema stringByReplacingOccurrencesOfString:@":" withString:@""];
+        escapedAppURL = [escapedAppURL stringByReplacingOccurrencesOfString:@"/" withString:@""];
+        [self setAppURLScheme:escapedAppURL];
+
+        NSString *redirectUri = nil;
+
+        // Generates URL default urls
+        if (!self.redirectURI) {
+            redirectUri = [NSString stringWithFormat:@"%@://spid", [self appURLScheme]];
+            [self setRedirectURI:[NSURL URLWithString:redirectUri]];
+        } else {
+            redirectUri = [self.redirectURI absoluteString];
+        }
+
+        if (![self authorizationURL])
+            [self setAuthorizationURL:[NSURL URLWithString:[NSString stringWithFormat:@"%@/flow/login", [self serverURL]]]];
+
+        if (![self signupURL])
+            [self setSignupURL:[NSURL URLWithString:[NSString stringWithFormat:@"%@/flow/signup", [self serverURL]]]];
+
+        if (![self accountSummaryURL])
+            [self setAccountSummaryURL:[NSURL URLWithString:[NSString stringWithFormat:@"%@/account/summary?client_id=%@", [self serverURL], clientID]]];
+
+        if (![self forgotPasswordURL]) {
+            NSString *forgotPasswordUrl = [NSString stringWithFormat:@"%@/flow/password?client_id=%@&redirect_uri=%@", [self serverURL], clientID, [SPiDUtils urlEncodeQueryParameter:redirectUri]];
+            [self setForgotPasswordURL:[NSURL URLWithString:forgotPasswordUrl]];
+        }
+
+        if (![self tokenURL])
+            [self setTokenURL:[NSURL URLWithString:[NSString stringWithFormat:@"%@/oauth/token", [self serverURL]]]];
+
+        if (![self serverClientID])
+            [self setServerClientID:clientID];
+
+        if (![self serverRedirectUri])
+            [self setServerRedirectUri:[NSURL URLWithString:[NSString stringWithFormat:@"%@://spid", [self appURLScheme]]]];
+
+        if (![self webViewInitialHTML])
+            [self setWebViewInitialHTML:@""];
+
+        if (![self logoutURL])
+            [self setLogoutURL:[NSURL URLWithString:[NSString stringWithFormat:@"%@/logout", [self serverURL]]]];
+
+        // Reads the journal and may start a token request, so it is kept off the calling thread
+        __weak SPiDClient *weakSelf = self;
+        dispatch_group_notify(self.storedTokensGroup, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+            [weakSelf resumePendingAuthorizationIfNeeded];
+        });
+    }
+    return self;
+}
+
 + (void)setClientID:(NSString *)clientID
        clientSecret:(NSString *)clientSecret
        appURLScheme:(NSString *)appURLSchema
@@ -76,58 +306,12 @@ static SPiDClient *sharedSPiDClientInstance = nil;
     }
     static dispatch_once_t predicate;
     dispatch_once(&predicate, ^{
-        sharedSPiDClientInstance = [[self alloc] init];
+        // Unprefixed storage, so that the session stored by earlier versions is picked up
+        sharedSPiDClientInstance = [[self alloc] initWithClientID:clientID clientSecret:clientSecret appURLScheme:appURLSchema serverURL:serverURL storageKey:nil];
     });
 
-    [sharedSPiDClientInstance setClientID:clientID];
-    [sharedSPiDClientInstance setClientSecret:clientSecret];
-    [sharedSPiDClientInstance setServerURL:serverURL];
-
-    NSString *escapedAppURL = [appURLSchema stringByReplacingOccurrencesOfString:@":" withString:@""];
-    escapedAppURL = [escapedAppURL stringByReplacingOccurrencesOfString:@"/" withString:@""];
-    [sharedSPiDClientInstance setAppURLScheme:escapedAppURL];
-    
-    NSString *redirectUri = nil;
-
-    // Generates URL default urls
-    if (![sharedSPiDClientInstance redirectURI]) {
-        redirectUri = [NSString stringWithFormat:@"%@://spid", [sharedSPiDClientInstance appURLScheme]];
-        [sharedSPiDClientInstance setRedirectURI:[NSURL URLWithString:redirectUri]];
-    } else {
-        redirectUri = [[sharedSPiDClientInstance redirectURI] absoluteString];
-    }
-
-    if (![sharedSPiDClientInstance authorizationURL])
-        [sharedSPiDClientInstance setAuthorizationURL:[NSURL URLWithString:[NSString stringWithFormat:@"%@/flow/login", [sharedSPiDClientInstance serverURL]]]];
-
-    if (![sharedSPiDClientInstance signupURL])
-        [sharedSPiDClientInstance setSignupURL:[NSURL URLWithString:[NSString stringWithFormat:@"%@/flow/signup", [sharedSPiDClientInstance serverURL]]]];
-    
-    if (![sharedSPiDClientInstance accountSummaryURL])
-        [sharedSPiDClientInstance setAccountSummaryURL:[NSURL URLWithString:[NSString stringWithFormat:@"%@/account/summary?client_id=%@", [sharedSPiDClientInstance serverURL], clientID]]];
-
-    if (![sharedSPiDClientInstance forgotPasswordURL]) {
-        NSString *forgotPasswordUrl = [NSString stringWithFormat:@"%@/flow/password?client_id=%@&redirect_uri=%@", [sharedSPiDClientInstance serverURL], clientID, [SPiDUtils urlEncodeQueryParameter:redirectUri]];
-        [sharedSPiDClientInstance setForgotPasswordURL:[NSURL URLWithString:forgotPasswordUrl]];
-    }
-
-    if (![sharedSPiDClientInstance tokenURL])
-        [sharedSPiDClientInstance setTokenURL:[NSURL URLWithString:[NSString stringWithFormat:@"%@/oauth/token", [sharedSPiDClientInstance serverURL]]]];
-
-    if (![sharedSPiDClientInstance serverClientID])
-        [sharedSPiDClientInstance setServerClientID:clientID];
-
-    if (![sharedSPiDClientInstance serverRedirectUri])
-        [sharedSPiDClientInstance setServerRedirectUri:[NSURL URLWithString:[NSString stringWithFormat:@"%@://spid", [sharedSPiDClientInstance appURLScheme]]]];
-
-    if (![sharedSPiDClientInstance webViewInitialHTML])
-        [sharedSPiDClientInstance setWebViewInitialHTML:@""];
-
-    if (![sharedSPiDClientInstance logoutURL])
-        [sharedSPiDClientInstance setLogoutURL:[NSURL URLWithString:[NSString stringWithFormat:@"%@/logout", [sharedSPiDClientInstance serverURL]]]];
-
     // Fire and forget
-    [SPiDStatus runStatusRequest];
+    [SPiDStatus runStatusRequestWithClient:sharedSPiDClientInstance];
 }
 
 - (void)browserRedirectAuthorizationWithCompletionHandler:(void (^)(NSError *response))completionHandler {
@@ -211,12 +395,70 @@ static SPiDClient *sharedSPiDClientInstance = nil;
     return NO;
 }
 
+- (void)exchangeAuthorizationCode:(NSString *)code completionHandler:(void (^)(NSError *error))completionHandler {
+    NSMutableDictionary *record = [NSMutableDictionary dictionary];
+    [record setObject:code forKey:SPiDAuthorizationJournalCodeKey];
+    [record setObject:@([[NSDate date] timeIntervalSince1970]) forKey:SPiDAuthorizationJournalReceivedAtKey];
+    [self.authorizationJournal removeAllRecords];
+    [self.authorizationJournal appendRecord:record];
+    [self exchangePendingAuthorizationCode:code completionHandler:completionHandler];
+}
+
+- (void)resumePendingAuthorizationIfNeeded {
+    @synchronized (self.authorizationJournal) {
+        if (self.resumingAuthorization) {
+            // The network may have come back while the running exchange was failing
+            self.authorizationResumeRequested = YES;
+            return;
+        }
+        self.resumingAuthorization = YES;
+    }
+
+    NSDictionary *record = [self.authorizationJournal firstRecord];
+    NSString *code = [record objectForKey:SPiDAuthorizationJournalCodeKey];
+    NSNumber *receivedAt = [record objectForKey:SPiDAuthorizationJournalReceivedAtKey];
+    NSDate *startedAt = [NSDate date];
+    if (record == nil || ![code isKindOfClass:[NSString class]] || ![receivedAt isKindOfClass:[NSNumber class]] ||
+            [startedAt timeIntervalSince1970] - [receivedAt doubleValue] > self.authorizationCodeLifetime) {
+        if (record) {
+            SPiDDebugLog(@"Pending authorization code has expired, discarding it");
+            [self.authorizationJournal removeAllRecords];
+        }
+        [self stopResumingAuthorizationWhenReachable];
+        @synchronized (self.authorizationJournal) {
+            self.authorizationResumeRequested = NO;
+            self.resumingAuthorization = NO;
+        }
+        return;
+    }
+
+    SPiDDebugLog(@"Resuming pending authorization code exchange");
+    [self exchangePendingAuthorizationCode:code completionHandler:^(NSError *error) {
+        self.authorizationRecoveryLatency = -[startedAt timeIntervalSinceNow];
+        SPiDDebugLog(@"Resumed authorization finished in %.3f seconds", self.authorizationRecoveryLatency);
+        BOOL resumeAgain;
+        @synchronized (self.authorizationJournal) {
+            resumeAgain = self.authorizationResumeRequested && [error sp_isOfflineError];
+            self.authorizationResumeRequested = NO;
+            self.resumingAuthorization = NO;
+        }
+
+        NSMutableDictionary *userInfo = [NSMutableDictionary dictionary];
+        [userInfo setObject:@(self.authorizationRecoveryLatency) forKey:SPiDAuthorizationRecoveryLatencyKey];
+        [userInfo setValue:error forKey:SPiDAuthorizationRecoveryErrorKey];
+        [[NSNotificationCenter defaultCenter] postNotificationName:SPiDClientDidRecoverAuthorizationNotification object:self userInfo:userInfo];
+        if (resumeAgain) {
+            [self resumePendingAuthorizationIfNeeded];
+        }
+    }];
+}
+
 - (SPiDRequest *)logoutRequestWithCompletionHandler:(void (^)(NSError *error))completionHandler {
     @synchronized (self.authorizationRequest) {
         if (self.authorizationRequest == nil) { // can't logout if we are already logging in
             // TODO: We should implement a api endpoint for logout
-            NSString *path = [@"/logout" stringByAppendingString:[self logoutQuery]];
-            SPiDRequest *request = [SPiDRequest apiGetRequestWithPath:path completionHandler:^(SPiDResponse *response) {
+            NSString *path = [@"/logout" stringByAppendingString:self.configuration.logoutQuery];
+            SPiDRequest *request = [SPiDRequest apiGetRequestWithClient:self path:path completionHandler:^(SPiDResponse *response) {
                 [self logoutComplete];
                 
                 if(completionHandler) {
@@ -235,54 +477,54 @@ static SPiDClient *sharedSPiDClientInstance = nil;
 }
 
 - (NSURL *)authorizationURLWithQuery {
-    NSString *query = [self authorizationQuery];
-    return [NSURL URLWithString:[self.authorizationURL.absoluteString stringByAppendingString:query]];
+    return self.configuration.authorizationURLWithQuery;
 }
 
 - (NSURL *)signupURLWithQuery {
-    NSString *query = [self authorizationQuery];
-    return [NSURL URLWithString:[self.signupURL.absoluteString stringByAppendingString:query]];
+    return self.configuration.signupURLWithQuery;
 }
 
 - (NSURL *)forgotPasswordURLWithQuery {
-    //NSString *query = [self getForgotPasswordQuery];
-    NSString *query = [self authorizationQuery];
-    return [NSURL URLWithString:[self.forgotPasswordURL.absoluteString stringByAppendingString:query]];
+    return self.configuration.forgotPasswordURLWithQuery;
 }
 
 - (NSURL *)logoutURLWithQuery {
-    NSString *query = [self logoutQuery];
-    return [NSURL URLWithString:[self.logoutURL.absoluteString stringByAppendingString:query]];
+    return self.configuration.logoutURLWithQuery;
 }
 
 - (NSString *)currentUserID {
-    if (self.accessToken)
-        return self.accessToken.userID;
+    SPiDAccessToken *accessToken = self.accessToken;
+    if (accessToken)
+        return accessToken.userID;
     return nil;
 }
 
 - (BOOL)isAuthorized {
-    if (self.accessToken)
-        return !self.hasTokenExpired;
+    SPiDAccessToken *accessToken = self.accessToken;
+    if (accessToken)
+        return !accessToken.hasExpired;
     return NO;
 }
 
 - (BOOL)isClientToken {
-    if (self.accessToken)
-        return self.accessToken.isClientToken;
+    SPiDAccessToken *accessToken = self.accessToken;
+    if (accessToken)
+        return accessToken.isClientToken;
     return NO;
 }
 
 - (BOOL)hasTokenExpired {
-    if (self.accessToken) {
-        return self.accessToken.hasExpired;
+    SPiDAccessToken *accessToken = self.accessToken;
+    if (accessToken) {
+        return accessToken.hasExpired;
     }
     return NO;
 }
 
 - (NSDate *)tokenExpiresAt {
-    if (self.accessToken) {
-        return self.accessToken.expiresAt;
+    SPiDAccessToken *accessToken = self.accessToken;
+    if (accessToken) {
+        return accessToken.expiresAt;
     }
     return [NSDate date];
 }
@@ -301,7 +543,7 @@ static SPiDClient *sharedSPiDClientInstance = nil;
     [data setObject:[self serverClientID] forKey:@"clientId"];
     [data setObject:[self serverClientID] forKey:@"client_id"];
     [data setObject:@"code" forKey:@"type"];
-    SPiDRequest *request = [SPiDRequest apiPostRequestWithPath:path body:data completionHandler:completionHandler];
+    SPiDRequest *request = [SPiDRequest apiPostRequestWithClient:self path:path body:data completionHandler:completionHandler];
     [request startRequestWithAccessToken];
 }
 
@@ -312,29 +554,41 @@ static SPiDClient *sharedSPiDClientInstance = nil;
     [data setObject:[self serverClientID] forKey:@"clientId"];
     [data setObject:[[self serverRedirectUri] absoluteString] forKey:@"redirectUri"];
     [data setObject:@"session" forKey:@"type"];
-    SPiDRequest *request = [SPiDRequest apiPostRequestWithPath:path body:data completionHandler:completionHandler];
+    SPiDRequest *request = [SPiDRequest apiPostRequestWithClient:self path:path body:data completionHandler:completionHandler];
     [request startRequestWithAccessToken];
 }
 
 - (void)meRequestWithCompletionHandler:(void (^)(SPiDResponse *response))completionHandler {
     NSString *path = [NSString stringWithFormat:@"/me"];
-    SPiDRequest *request = [SPiDRequest apiGetRequestWithPath:path completionHandler:completionHandler];
+    SPiDRequest *request = [SPiDRequest apiGetRequestWithClient:self path:path completionHandler:completionHandler];
     [request startRequestWithAccessToken];
 }
 
 - (void)userRequestWithID:(NSString *)userID completionHandler:(void (^)(SPiDResponse *response))completionHandler {
     NSString *path = [NSString stringWithFormat:@"/user/%@", userID];
-    SPiDRequest *request = [SPiDRequest apiGetRequestWithPath:path completionHandler:completionHandler];
+    SPiDRequest *request = [SPiDRequest apiGetRequestWithClient:self path:path completionHandler:completionHandler];
     [request startRequestWithAccessToken];
 }
 
 - (void)currentUserRequestWithCompletionHandler:(void (^)(SPiDResponse *))completionHandler {
-    [self userRequestWithID:self.accessToken.userID completionHandler:completionHandler];
+    [self userRequestWithID:[self currentUserID] completionHandler:completionHandler];
+}
+
+- (void)meProfileRequestWithCompletionHandler:(void (^)(SPiDUserProfile *profile, NSError *error))completionHandler {
+    [self meRequestWithCompletionHandler:^(SPiDResponse *response) {
+        [self completeProfileRequestWithResponse:response completionHandler:completionHandler];
+    }];
+}
+
+- (void)userProfileRequestWithID:(NSString *)userID completionHandler:(void (^)(SPiDUserProfile *profile, NSError *error))completionHandler {
+    [self userRequestWithID:userID completionHandler:^(SPiDResponse *response) {
+        [self completeProfileRequestWithResponse:response completionHandler:completionHandler];
+    }];
 }
 
 - (void)userLoginsRequestWithUserID:(NSString *)userID completionHandler:(void (^)(SPiDResponse *response))completionHandler {
     NSString *path = [NSString stringWithFormat:@"/user/%@/logins", userID];
-    SPiDRequest *request = [SPiDRequest apiGetRequestWithPath:path completionHandler:completionHandler];
+    SPiDRequest *request = [SPiDRequest apiGetRequestWithClient:self path:path completionHandler:completionHandler];
     [request startRequestWithAccessToken];
 }
 
@@ -343,8 +597,14 @@ static SPiDClient *sharedSPiDClientInstance = nil;
     NSString *encodedEmail = [data sp_base64EncodedUrlSafeString];
     
     NSString *path = [NSString stringWithFormat:@"/email/%@/status", encodedEmail];
-    SPiDRequest *request = [SPiDRequest apiGetRequestWithPath:path completionHandler:completionHandler];
-    [request startRequestWithAccessToken];
+    SPiDRequest *request = [SPiDRequest apiGetRequestWithClient:self path:path completionHandler:completionHandler];
+    [self clientTokenWithCompletionHandler:^(NSError *error) {
+        if (error) {
+            completionHandler([[SPiDResponse alloc] initWithError:error]);
+        } else {
+            [request startRequestWithClientToken];
+        }
+    }];
 }
 
 #pragma mark Private methods
@@ -353,20 +613,86 @@ static SPiDClient *sharedSPiDClientInstance = nil;
 /// @name Private methods
 ///---------------------------------------------------------------------------------------
 
++ (NSURLSession *)sharedURLSession {
+    static NSURLSession *sharedURLSession = nil;
+    static dispatch_once_t predicate;
+    dispatch_once(&predicate, ^{
+        sharedURLSession = [NSURLSession sessionWithConfiguration:[NSURLSessionConfiguration defaultSessionConfiguration]];
+    });
+    return sharedURLSession;
+}
+
++ (SPiDRequestScheduler *)sharedRequestScheduler {
+    static SPiDRequestScheduler *sharedRequestScheduler = nil;
+    static dispatch_once_t predicate;
+    dispatch_once(&predicate, ^{
+        sharedRequestScheduler = [[SPiDRequestScheduler alloc] init];
+    });
+    return sharedRequestScheduler;
+}
+
 - (id)init {
+    return [self initWithStorageKey:nil];
+}
+
+- (instancetype)initWithStorageKey:(NSString *)storageKey {
     if (self = [super init]) {
-        self.accessToken = [SPiDKeychainWrapper accessTokenFromKeychainForIdentifier:AccessTokenKeychainIdentification];
+        CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+        self.mutableStartupTimings = [NSMutableDictionary dictionary];
+        // Set before the stored tokens are loaded below
+        self.storageKey = storageKey;
+        self.accessTokenIdentifier = [self storageNameWithName:AccessTokenKeychainIdentification];
+        self.clientAccessTokenIdentifier = [self storageNameWithName:ClientAccessTokenKeychainIdentification];
+        _tokenStore = [[SPiDKeychainTokenStore alloc] init];
+        // Keychain reads and unarchiving are kept off the launch path, accessors wait only if used before they finish
+        self.storedTokensGroup = dispatch_group_create();
+        dispatch_group_async(self.storedTokensGroup, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_HIGH, 0), ^{
+            [self loadStoredTokensAtStartup:YES];
+        });
         if (![self apiVersionSPiD]) {
             [self setApiVersionSPiD:[NSString stringWithFormat:@"%@", defaultAPIVersionSPiD]];
         }
         [self setUseMobileWeb:YES];
-        self.URLSession = [NSURLSession sessionWithConfiguration:[NSURLSessionConfiguration defaultSessionConfiguration]];
+        self.URLSession = [SPiDClient sharedURLSession];
+        self.requestScheduler = [SPiDClient sharedRequestScheduler];
+        self.requestJournal = [[SPiDRequestJournal alloc] initWithFileURL:[SPiDRequestJournal defaultJournalURLWithName:[self storageNameWithName:SPiDOfflineRequestJournalName]]];
+        self.authorizationJournal = [[SPiDRequestJournal alloc] initWithFileURL:[SPiDRequestJournal defaultJournalURLWithName:[self storageNameWithName:SPiDAuthorizationJournalName]]];
+        // The code can be redeemed with the client secret shipped in the app
+        self.authorizationJournal.usesCompleteFileProtection = YES;
+        self.authorizationCodeLifetime = SPiDDefaultAuthorizationCodeLifetime;
+        for (NSString *keyPath in [SPiDClient configurationKeyPaths]) {
+            [self addObserver:self forKeyPath:keyPath options:0 context:SPiDConfigurationObservationContext];
+        }
+#if !TARGET_OS_WATCH
+        [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(applicationWillSuspend:) name:UIApplicationDidEnterBackgroundNotification object:nil];
+        [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(applicationWillSuspend:) name:UIApplicationWillTerminateNotification object:nil];
+#endif
+        [self recordStartupTiming:CFAbsoluteTimeGetCurrent() - start forKey:SPiDStartupTimingInitKey];
     }
     return self;
 }
 
++ (NSString *)storageKeyForClientID:(NSString *)clientID serverURL:(NSURL *)serverURL {
+    NSData *data = [[NSString stringWithFormat:@"%@ %@", clientID, serverURL.absoluteString] dataUsingEncoding:NSUTF8StringEncoding];
+    unsigned char digest[CC_SHA256_DIGEST_LENGTH];
+    CC_SHA256(data.bytes, (CC_LONG) data.length, digest);
+    NSString *hex = [SPiDHMAC hexStringWithData:[NSData dataWithBytes:digest length:sizeof(digest)]];
+    return [hex substringToIndex:SPiDStorageKeyLength];
+}
+
+- (NSString *)storageNameWithName:(NSString *)name {
+    return self.storageKey ? [NSString stringWithFormat:@"%@-%@", self.storageKey, name] : name;
+}
+
+- (void)dealloc {
+    for (NSString *keyPath in [SPiDClient configurationKeyPaths]) {
+        [self removeObserver:self forKeyPath:keyPath context:SPiDConfigurationObservationContext];
+    }
+}
+
 - (BOOL)doHandleOpenURL:(NSURL *)url {
-    NSString *error = [SPiDUtils getUrlParameter:url forKey:@"error"];
+    NSDictionary<NSString *, NSString *> *parameters = [SPiDUtils parametersFromURL:url];
+    NSString *error = [parameters objectForKey:@"error"];
     if (error) {
         SPiDDebugLog(@"Received error from SPiD: %@", error)
         if(self.completionHandler) {
@@ -376,13 +702,12 @@ static SPiDClient *sharedSPiDClientInstance = nil;
     } else {
         NSString *urlString = [[[url absoluteString] componentsSeparatedByString:@"?"] objectAtIndex:0];
         if ([urlString hasSuffix:@"login"]) {
-            NSString *code = [SPiDUtils getUrlParameter:url forKey:@"code"];
+            NSString *code = [parameters objectForKey:@"code"];
 
             if (code) {
                 //NSAssert(code, @"SPiDOAuth2 missing code, this should not happen.");
                 SPiDDebugLog(@"Received code: %@", code);
-                SPiDTokenRequest *request = [SPiDTokenRequest userTokenRequestWithCode:code completionHandler:self.completionHandler];
-                [request start];
+                [self exchangeAuthorizationCode:code completionHandler:self.completionHandler];
             } else {
                 // Logout
                 if(self.completionHandler) {
@@ -400,35 +725,32 @@ static SPiDClient *sharedSPiDClientInstance = nil;
     }
 }
 
-- (NSString *)authorizationQuery {
-    NSMutableDictionary *query = [NSMutableDictionary dictionary];
-    [query setObject:self.clientID forKey:@"client_id"];
-    if ([self.redirectURI.absoluteString hasSuffix:@"/"]) {
-        [query setObject:[self.redirectURI.absoluteString stringByAppendingString:@"login"] forKey:@"redirect_uri"];
-    } else {
-        [query setObject:[self.redirectURI.absoluteString stringByAppendingString:@"/login"] forKey:@"redirect_uri"];
-    }
-    [query setObject:@"authorization_code" forKey:@"grant_type"];
-    [query setObject:@"code" forKey:@"response_type"];
-    if (self.useMobileWeb)
-        [query setObject:@"mobile" forKey:@"platform"];
-    // TODO: needed for browser redirect
-    [query setObject:@"1" forKey:@"force"];
-    return [SPiDUtils encodedHttpQueryForDictionary:query];
-}
-
-- (NSString *)logoutQuery {
-    NSMutableDictionary *query = [NSMutableDictionary dictionary];
-    [query setObject:self.clientID forKey:@"client_id"];
-    if ([self.redirectURI.absoluteString hasSuffix:@"/"]) {
-        [query setObject:[self.redirectURI.absoluteString stringByAppendingString:@"logout"] forKey:@"redirect_uri"]; // add spid/logout
-    } else {
-        [query setObject:[self.redirectURI.absoluteString stringByAppendingString:@"/logout"] forKey:@"redirect_uri"]; // add spid/logout
++ (NSArray<NSString *> *)configurationKeyPaths {
+    return @[@"clientID", @"serverURL", @"redirectURI", @"authorizationURL", @"signupURL", @"forgotPasswordURL",
+             @"logoutURL", @"apiVersionSPiD", @"useMobileWeb"];
+}
+
+- (SPiDConfiguration *)configuration {
+    SPiDConfiguration *configuration = self.currentConfiguration;
+    if (configuration) {
+        return configuration;
+    }
+    @synchronized (self) {
+        if (self.currentConfiguration == nil) {
+            self.currentConfiguration = [[SPiDConfiguration alloc] initWithClient:self];
+        }
+        return self.currentConfiguration;
+    }
+}
+
+- (void)observeValueForKeyPath:(NSString *)keyPath ofObject:(id)object change:(NSDictionary<NSKeyValueChangeKey, id> *)change context:(void *)context {
+    if (context != SPiDConfigurationObservationContext) {
+        [super observeValueForKeyPath:keyPath ofObject:object change:change context:context];
+        return;
+    }
+    @synchronized (self) {
+        self.currentConfiguration = nil;
     }
-    if (self.useMobileWeb)
-        [query setObject:@"mobile" forKey:@"platform"];
-    [query setObject:@"1" forKey:@"force"];
-    return [SPiDUtils encodedHttpQueryForDictionary:query];
 }
 
 - (void)refreshAccessTokenAndRerunRequest:(SPiDRequest *)request {
@@ -437,9 +759,14 @@ static SPiDClient *sharedSPiDClientInstance = nil;
     }
     [self.waitingRequests addObject:request];
 
+    if (self.sharedTokenCoordinator) {
+        [self refreshSharedAccessToken];
+        return;
+    }
+
     @synchronized (self.authorizationRequest) {
         if (self.authorizationRequest == nil) { // can't logout if we are already logging in
-            self.authorizationRequest = [SPiDTokenRequest refreshTokenRequestWithCompletionHandler:^(NSError *error) {
+            self.authorizationRequest = [SPiDTokenRequest refreshTokenRequestWithClient:self completionHandler:^(NSError *error) {
                 [self authorizationComplete];
             }];
             [self.authorizationRequest start];
@@ -447,6 +774,414 @@ static SPiDClient *sharedSPiDClientInstance = nil;
     }
 }
 
+- (void)enableSharedTokenStorageWithAccessGroup:(NSString *)accessGroup containerURL:(NSURL *)containerURL {
+    self.sharedTokenCoordinator = [[SPiDSharedTokenCoordinator alloc] initWithDirectoryURL:[containerURL URLByAppendingPathComponent:@"SPiD" isDirectory:YES]];
+    if ([self.tokenStore isKindOfClass:[SPiDKeychainTokenStore class]]) {
+        // Switch to the tokens in the shared keychain, other clients keep their own storage. Pending writes to the
+        // private keychain are flushed by the setter.
+        self.tokenStore = [[SPiDKeychainTokenStore alloc] initWithAccessGroup:accessGroup];
+    } else {
+        SPiDDebugLog(@"Keeping custom token store %@, it must be shared with the app extensions by the app", self.tokenStore);
+    }
+    [self.sharedTokenCoordinator markCurrentGenerationSeen];
+}
+
+- (void)refreshSharedAccessToken {
+    @synchronized (self) {
+        if (self.refreshingSharedToken) {
+            return;
+        }
+        self.refreshingSharedToken = YES;
+    }
+
+    [self.sharedTokenCoordinator coordinateRefresh:^(void (^completion)(BOOL stored)) {
+        SPiDTokenRequest *request = [SPiDTokenRequest refreshTokenRequestWithClient:self completionHandler:^(NSError *error) {
+            // Other processes read the token from the keychain as soon as the generation is bumped
+            [self.tokenStore flush];
+            completion(error == nil);
+            self.refreshingSharedToken = NO;
+            [self authorizationComplete];
+        }];
+        if (request == nil) {
+            completion(NO);
+            self.refreshingSharedToken = NO;
+            [self clearAuthorizationRequest];
+            return;
+        }
+        @synchronized (self.authorizationRequest) {
+            self.authorizationRequest = request;
+        }
+        [request start];
+    } pickUp:^(BOOL refreshed) {
+        [self reloadSharedTokens];
+        self.refreshingSharedToken = NO;
+        if (refreshed) {
+            [self authorizationComplete];
+        } else {
+            [self failWaitingRequestsWithError:[NSError sp_oauth2ErrorWithCode:SPiDSharedRefreshTimedOutErrorCode reason:@"SharedRefreshTimedOut" descriptions:@{@"error": @"Timed out waiting for another process to refresh the access token"}]];
+        }
+    }];
+}
+
+- (void)reloadSharedTokens {
+    id<SPiDTokenStore> tokenStore = self.tokenStore;
+    self.accessToken = [tokenStore accessTokenForIdentifier:self.accessTokenIdentifier];
+    self.clientAccessToken = [tokenStore accessTokenForIdentifier:self.clientAccessTokenIdentifier];
+    SPiDAccountStore *accountStore = [[SPiDAccountStore alloc] initWithTokenStore:tokenStore identifierPrefix:[self.accessTokenIdentifier stringByAppendingString:@"-"]];
+    accountStore.refreshScheduler = self.refreshScheduler;
+    self.accountStore = accountStore;
+}
+
+- (void)failWaitingRequestsWithError:(NSError *)error {
+    NSArray<SPiDRequest *> *waitingRequests = self.waitingRequests;
+    [self clearAuthorizationRequest];
+    for (SPiDRequest *request in waitingRequests) {
+        if (request.completionHandler) {
+            request.completionHandler([[SPiDResponse alloc] initWithError:error]);
+        }
+    }
+}
+
+- (void)exchangePendingAuthorizationCode:(NSString *)code completionHandler:(void (^)(NSError *error))completionHandler {
+    SPiDTokenRequest *request = [SPiDTokenRequest userTokenRequestWithClient:self code:code completionHandler:^(NSError *error) {
+        if ([error sp_isOfflineError]) {
+            // Kept in the journal, tried again once the network can be used
+            [self resumeAuthorizationWhenReachable];
+        } else { // The code has been used or rejected
+            [self.authorizationJournal removeAllRecords];
+            [self stopResumingAuthorizationWhenReachable];
+        }
+        if (completionHandler) {
+            completionHandler(error);
+        }
+    }];
+    [request start];
+}
+
+- (void)resumeAuthorizationWhenReachable {
+    SPiDNetworkMonitor *monitor;
+    @synchronized (self.authorizationJournal) {
+        if (self.authorizationNetworkMonitor) {
+            return;
+        }
+        __weak SPiDClient *weakSelf = self;
+        monitor = [[SPiDNetworkMonitor alloc] initWithReachableHandler:^{
+            [weakSelf resumePendingAuthorizationIfNeeded];
+        }];
+        self.authorizationNetworkMonitor = monitor;
+    }
+    [monitor start];
+}
+
+- (void)stopResumingAuthorizationWhenReachable {
+    SPiDNetworkMonitor *monitor;
+    @synchronized (self.authorizationJournal) {
+        monitor = self.authorizationNetworkMonitor;
+        self.authorizationNetworkMonitor = nil;
+    }
+    [monitor cancel];
+}
+
+- (void)journalRequest:(SPiDRequest *)request {
+    SPiDDebugLog(@"Offline, storing request to %@ in journal", request.URL);
+    [self.requestJournal appendRecord:[request journalRecord]];
+}
+
+- (void)setJournalsOfflineRequests:(BOOL)journalsOfflineRequests {
+    _journalsOfflineRequests = journalsOfflineRequests;
+    if (!journalsOfflineRequests) {
+        [self.networkMonitor cancel];
+        self.networkMonitor = nil;
+        return;
+    }
+    if (self.networkMonitor) {
+        return;
+    }
+
+    __weak SPiDClient *weakSelf = self;
+    self.networkMonitor = [[SPiDNetworkMonitor alloc] initWithReachableHandler:^{
+        [weakSelf replayJournaledRequestsIfNeeded];
+    }];
+    [self.networkMonitor start];
+    // Requests journaled before the app was terminated, also on systems without path monitoring
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_LOW, 0), ^{
+        [weakSelf replayJournaledRequestsIfNeeded];
+    });
+}
+
+- (void)setRefreshesAccountsAhead:(BOOL)refreshesAccountsAhead {
+    _refreshesAccountsAhead = refreshesAccountsAhead;
+    __weak SPiDClient *weakSelf = self;
+    if (!refreshesAccountsAhead) {
+        [self.refreshScheduler stop];
+        self.refreshScheduler = nil;
+    } else if (self.refreshScheduler == nil) {
+        self.refreshScheduler = [[SPiDRefreshScheduler alloc] initWithTickInterval:SPiDAccountRefreshTickInterval refreshHandler:^(NSString *userID, SPiDAccessToken *accessToken, void (^completion)(SPiDAccessToken *)) {
+            [weakSelf refreshAccountAheadWithUserID:userID completion:completion];
+        }];
+        [self.refreshScheduler start];
+    }
+    // The stored accounts are scheduled once they have been loaded, stores loaded later get the scheduler when loaded
+    dispatch_group_notify(self.storedTokensGroup, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_LOW, 0), ^{
+        SPiDClient *strongSelf = weakSelf;
+        strongSelf.accountStore.refreshScheduler = strongSelf.refreshScheduler;
+    });
+}
+
+- (void)refreshAccountAheadWithUserID:(NSString *)userID completion:(void (^)(SPiDAccessToken *refreshedToken))completion {
+    if ([self.accountStore accessTokenForUserID:userID] == nil) {
+        // Removed from a store that has since been replaced
+        [self.refreshScheduler cancelRefreshForIdentifier:userID];
+        completion(nil);
+        return;
+    }
+    __weak SPiDClient *weakSelf = self;
+    [self refreshAccountWithUserID:userID completionHandler:^(NSError *error) {
+        SPiDClient *strongSelf = weakSelf;
+        if (error.code == SPiDOAuth2InvalidGrantErrorCode) {
+            // Retrying a rejected refresh token would fail the same way
+            [strongSelf.refreshScheduler cancelRefreshForIdentifier:userID];
+        }
+        // The refreshed token has been stored, which scheduled it again
+        completion(error ? nil : [strongSelf.accountStore accessTokenForUserID:userID]);
+    }];
+}
+
+- (void)replayJournaledRequestsIfNeeded {
+    if (!self.journalsOfflineRequests || self.accessToken == nil) {
+        return;
+    }
+    @synchronized (self.requestJournal) {
+        if (self.replayingJournal || self.requestJournal.count == 0) {
+            return;
+        }
+        self.replayingJournal = YES;
+    }
+    SPiDDebugLog(@"Replaying %lu journaled requests", (unsigned long) self.requestJournal.count);
+    [self replayNextJournaledRequest];
+}
+
+- (void)replayNextJournaledRequest {
+    NSDictionary *record = [self.requestJournal firstRecord];
+    if (record == nil || self.accessToken == nil) {
+        self.replayingJournal = NO;
+        return;
+    }
+
+    SPiDRequest *request = [SPiDRequest requestWithJournalRecord:record completionHandler:^(SPiDResponse *response) {
+        if ([response.error sp_isOfflineError]) {
+            SPiDDebugLog(@"Still offline, keeping journaled requests");
+            self.replayingJournal = NO;
+            return;
+        }
+        // SPiD has responded, retrying will not give a different result
+        [self.requestJournal removeFirstRecord];
+        [self replayNextJournaledRequest];
+    }];
+    if (request == nil) {
+        [self.requestJournal removeFirstRecord];
+        [self replayNextJournaledRequest];
+    } else {
+        request.client = self;
+        [request startRequestWithAccessToken];
+    }
+}
+
+- (SPiDAccessToken *)accessToken {
+    [self waitForStoredTokens];
+    return self.storedAccessToken;
+}
+
+- (void)setAccessToken:(SPiDAccessToken *)accessToken {
+    // Waiting keeps the token being loaded from replacing a newer one
+    [self waitForStoredTokens];
+    self.storedAccessToken = accessToken;
+    [self persistCurrentAccountUserID:accessToken.userID];
+}
+
+- (SPiDAccessToken *)clientAccessToken {
+    [self waitForStoredTokens];
+    return self.storedClientAccessToken;
+}
+
+- (void)setClientAccessToken:(SPiDAccessToken *)clientAccessToken {
+    [self waitForStoredTokens];
+    self.storedClientAccessToken = clientAccessToken;
+}
+
+- (void)setTokenStore:(id<SPiDTokenStore>)tokenStore {
+    [self waitForStoredTokens];
+    id<SPiDTokenStore> previousTokenStore = _tokenStore;
+    _tokenStore = tokenStore;
+    // The tokens in memory came from the previous store, accessors wait until they have been read from the new one
+    dispatch_group_enter(self.storedTokensGroup);
+    self.storedTokensLoaded = NO;
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_HIGH, 0), ^{
+        [previousTokenStore flush];
+        [self loadStoredTokensAtStartup:NO];
+        dispatch_group_leave(self.storedTokensGroup);
+    });
+}
+
+- (SPiDAccountStore *)accountStore {
+    [self waitForStoredTokens];
+    return _accountStore;
+}
+
+- (NSDictionary<NSString *, NSNumber *> *)startupTimings {
+    @synchronized (self.mutableStartupTimings) {
+        return [self.mutableStartupTimings copy];
+    }
+}
+
+- (void)notifyWhenAccessTokenLoaded:(dispatch_block_t)block {
+    dispatch_group_notify(self.storedTokensGroup, dispatch_get_main_queue(), block);
+}
+
+- (void)loadStoredTokensAtStartup:(BOOL)atStartup {
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    id<SPiDTokenStore> tokenStore = self.tokenStore;
+    SPiDAccessToken *accessToken = [tokenStore accessTokenForIdentifier:self.accessTokenIdentifier];
+    SPiDAccessToken *clientAccessToken = [tokenStore accessTokenForIdentifier:self.clientAccessTokenIdentifier];
+    if (accessToken.isClientToken) {
+        // Stored by a earlier version that kept client tokens in the user slot
+        if (clientAccessToken == nil) {
+            clientAccessToken = accessToken;
+            [tokenStore storeAccessToken:clientAccessToken forIdentifier:self.clientAccessTokenIdentifier];
+        }
+        accessToken = nil;
+        [tokenStore removeAccessTokenForIdentifier:self.accessTokenIdentifier];
+    }
+    self.storedAccessToken = accessToken;
+    self.storedClientAccessToken = clientAccessToken;
+    if (atStartup) {
+        [self recordStartupTiming:CFAbsoluteTimeGetCurrent() - start forKey:SPiDStartupTimingKeychainLoadKey];
+    }
+
+    start = CFAbsoluteTimeGetCurrent();
+    SPiDAccountStore *accountStore = [[SPiDAccountStore alloc] initWithTokenStore:tokenStore identifierPrefix:[self.accessTokenIdentifier stringByAppendingString:@"-"]];
+    if (accessToken && [accountStore accessTokenForUserID:accessToken.userID] == nil) {
+        // Logged in before accounts were stored
+        [accountStore storeAccessToken:accessToken];
+    }
+    // A account switched to is persisted as a user ID, its token is the one in the account store
+    NSString *currentUserID = [[NSUserDefaults standardUserDefaults] stringForKey:[self storageNameWithName:SPiDCurrentAccountDefaultsKey]];
+    SPiDAccessToken *currentAccount = currentUserID ? [accountStore accessTokenForUserID:currentUserID] : nil;
+    if (currentAccount) {
+        self.storedAccessToken = currentAccount;
+    }
+    accountStore.refreshScheduler = self.refreshScheduler;
+    self.accountStore = accountStore;
+    self.storedTokensLoaded = YES;
+    if (!atStartup) {
+        return;
+    }
+    [self recordStartupTiming:CFAbsoluteTimeGetCurrent() - start forKey:SPiDStartupTimingAccountStoreLoadKey];
+    dispatch_async(dispatch_get_main_queue(), ^{
+        [[NSNotificationCenter defaultCenter] postNotificationName:SPiDClientDidLoadAccessTokenNotification object:self];
+    });
+}
+
+- (void)waitForStoredTokens {
+    if (self.storedTokensLoaded) {
+        return;
+    }
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    dispatch_group_wait(self.storedTokensGroup, DISPATCH_TIME_FOREVER);
+    SPiDDebugLog(@"Waited %.1f ms for stored access token", (CFAbsoluteTimeGetCurrent() - start) * 1000);
+    @synchronized (self.mutableStartupTimings) {
+        NSTimeInterval waited = [self.mutableStartupTimings[SPiDStartupTimingWaitKey] doubleValue];
+        self.mutableStartupTimings[SPiDStartupTimingWaitKey] = @(waited + CFAbsoluteTimeGetCurrent() - start);
+    }
+}
+
+- (void)persistCurrentAccountUserID:(NSString *)userID {
+    NSUserDefaults *defaults = [NSUserDefaults standardUserDefaults];
+    NSString *key = [self storageNameWithName:SPiDCurrentAccountDefaultsKey];
+    NSString *persistedUserID = [defaults stringForKey:key];
+    if (persistedUserID == userID || [persistedUserID isEqualToString:userID]) {
+        return;
+    }
+    [defaults setObject:userID forKey:key];
+}
+
+- (void)recordStartupTiming:(NSTimeInterval)interval forKey:(NSString *)key {
+    @synchronized (self.mutableStartupTimings) {
+        self.mutableStartupTimings[key] = @(interval);
+    }
+}
+
+- (void)applicationWillSuspend:(NSNotification *)notification {
+    [self.tokenStore flush];
+}
+
+- (void)clientTokenWithCompletionHandler:(void (^)(NSError *error))completionHandler {
+    SPiDAccessToken *clientAccessToken = self.clientAccessToken;
+    if (clientAccessToken && !clientAccessToken.hasExpired) {
+        SPiDDebugLog(@"Client token found");
+        completionHandler(nil);
+        return;
+    }
+
+    SPiDDebugLog(@"No client token found, trying to request one");
+    SPiDTokenRequest *request = [SPiDTokenRequest clientTokenRequestWithClient:self completionHandler:completionHandler];
+    [request start];
+}
+
+- (void)refreshClientTokenAndRerunRequest:(SPiDRequest *)request {
+    self.clientAccessToken = nil;
+    [self clientTokenWithCompletionHandler:^(NSError *error) {
+        if (error) {
+            // Rerunning without a client token would only hide the error behind a invalid_token response
+            if (request.completionHandler) {
+                request.completionHandler([[SPiDResponse alloc] initWithError:error]);
+            }
+        } else {
+            [request startRequestWithClientToken];
+        }
+    }];
+}
+
+- (BOOL)switchToAccountWithUserID:(NSString *)userID {
+    SPiDAccessToken *accessToken = [self.accountStore accessTokenForUserID:userID];
+    if (accessToken == nil) {
+        SPiDDebugLog(@"No stored account for user: %@", userID);
+        return NO;
+    }
+    if ([accessToken.userID isEqualToString:[self currentUserID]]) {
+        return YES;
+    }
+
+    SPiDDebugLog(@"Switching to account for user: %@", userID);
+    [self clearAuthorizationRequest];
+    // Journaled requests belong to the previous account
+    [self.requestJournal removeAllRecords];
+    // Only the user ID is persisted, the token is already stored as a account
+    self.accessToken = accessToken;
+    self.currentIdentity = nil;
+    if (self.sharedTokenCoordinator) {
+        // Other processes read the active token from the shared store
+        [self.tokenStore storeAccessToken:accessToken forIdentifier:self.accessTokenIdentifier];
+    }
+    return YES;
+}
+
+- (void)refreshAccountWithUserID:(NSString *)userID completionHandler:(void (^)(NSError *error))completionHandler {
+    SPiDAccessToken *accessToken = [self.accountStore accessTokenForUserID:userID];
+    SPiDTokenRequest *request = accessToken ? [SPiDTokenRequest refreshTokenRequestWithClient:self accessToken:accessToken completionHandler:^(NSError *error) {
+        if (completionHandler) {
+            completionHandler(error);
+        }
+    }] : nil;
+    if (request == nil) {
+        if (completionHandler) {
+            completionHandler([NSError sp_oauth2ErrorWithCode:SPiDOAuth2InvalidGrantErrorCode reason:@"No refresh token for account" descriptions:@{@"error": @"No refresh token for account"}]);
+        }
+        return;
+    }
+    [request start];
+}
+
 - (void)clearAuthorizationRequest {
     @synchronized (self.authorizationRequest) {
         self.authorizationRequest = nil;
@@ -455,7 +1190,10 @@ static SPiDClient *sharedSPiDClientInstance = nil;
 }
 
 - (void)authorizationComplete {
-    SPiDDebugLog(@"Received access token: %@ expires at: %@ refresh token: %@", self.accessToken.accessToken, self.accessToken.expiresAt, self.accessToken.refreshToken);
+#ifdef DEBUG
+    SPiDAccessToken *accessToken = self.accessToken;
+    SPiDDebugLog(@"Received access token: %@ expires at: %@ refresh token: %@", accessToken.accessToken, accessToken.expiresAt, accessToken.refreshToken);
+#endif
     if (self.waitingRequests) {
         SPiDDebugLog(@"Found %lu waiting request, running again", [self.waitingRequests count]);
         for (SPiDRequest *request in self.waitingRequests) {
@@ -468,24 +1206,50 @@ static SPiDClient *sharedSPiDClientInstance = nil;
 
 - (void)logoutComplete {
     SPiDDebugLog(@"Logged out from SPiD");
+    NSString *userID = [self currentUserID];
+    if (userID) {
+        [self.accountStore removeAccessTokenForUserID:userID];
+    }
     self.accessToken = nil;
+    self.currentIdentity = nil;
+
+    [self.tokenStore removeAccessTokenForIdentifier:self.accessTokenIdentifier];
 
-    [SPiDKeychainWrapper removeAccessTokenFromKeychainForIdentifier:AccessTokenKeychainIdentification];
+    // Journaled requests belong to the user that just logged out
+    [self.requestJournal removeAllRecords];
 
     [self clearAuthorizationRequest];
 
     self.waitingRequests = nil;
 }
 
+- (void)completeProfileRequestWithResponse:(SPiDResponse *)response completionHandler:(void (^)(SPiDUserProfile *profile, NSError *error))completionHandler {
+    if (!completionHandler) {
+        return;
+    }
+    if (response.error) {
+        completionHandler(nil, response.error);
+        return;
+    }
+    SPiDUserProfile *profile = [SPiDUserProfile profileWithResponse:response];
+    if (profile) {
+        completionHandler(profile, nil);
+    } else {
+        SPiDDebugLog(@"Response did not contain a user object: %@", response.rawJSON);
+        completionHandler(nil, [NSError sp_oauth2ErrorWithCode:SPiDJSONParseErrorCode reason:@"Missing user object" descriptions:@{@"error": @"Missing user object"}]);
+    }
+}
+
 @end
 
 @implementation SPiDClient (Agreements)
 
 - (BOOL)fetchAgreementsWithSuccess:(void (^)(SPiDAgreements *))success andFailure:(void (^)(NSError *))failure {
-    if([self.accessToken isClientToken] || !self.accessToken) { return NO; } // Exit early if we don't have a client token or it is a client token.
+    SPiDAccessToken *accessToken = self.accessToken;
+    if([accessToken isClientToken] || !accessToken) { return NO; } // Exit early if we don't have a client token or it is a client token.
 
-    NSString *path = [NSString stringWithFormat:@"/user/%@/agreements", self.accessToken.userID];
-    [[SPiDRequest apiGetRequestWithPath:path completionHandler:^(SPiDResponse *response) {
+    NSString *path = [NSString stringWithFormat:@"/user/%@/agreements", accessToken.userID];
+    [[SPiDRequest apiGetRequestWithClient:self path:path completionHandler:^(SPiDResponse *response) {
         // Any errors in the response?
         if(response.error) {
             // Make sure we have a failure block
@@ -512,10 +1276,11 @@ static SPiDClient *sharedSPiDClientInstance = nil;
 }
 
 - (BOOL)acceptAgreementsWithSuccess:(void (^)())success andFailure:(void (^)(NSError *))failure {
-    if([self.accessToken isClientToken] || !self.accessToken) { return NO; } // Exit early if we don't have a client token or it is a client token.
+    SPiDAccessToken *accessToken = self.accessToken;
+    if([accessToken isClientToken] || !accessToken) { return NO; } // Exit early if we don't have a client token or it is a client token.
 
-    NSString *path = [NSString stringWithFormat:@"/user/%@/agreements/accept", self.accessToken.userID];
-    [[SPiDRequest apiPostRequestWithPath:path body:nil completionHandler:^(SPiDResponse *response) {
+    NSString *path = [NSString stringWithFormat:@"/user/%@/agreements/accept", accessToken.userID];
+    SPiDRequest *request = [SPiDRequest apiPostRequestWithClient:self path:path body:nil completionHandler:^(SPiDResponse *response) {
         // Any errors in the response?
         if(response.error) {
             // Make sure we have a failure block
@@ -535,7 +1300,9 @@ static SPiDClient *sharedSPiDClientInstance = nil;
             }
         }
 
-    }] startRequestWithAccessToken];
+    }];
+    request.durable = YES;
+    [request startRequestWithAccessToken];
 
     return YES;
 }
@@ -0,0 +1,78 @@
+//
+//  SPiDConfiguration.h
+//  SPiDSDK
+//
+//  Copyright (c) 2012 Schibsted Payment. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+@class SPiDClient;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/** `SPiDConfiguration` is an immutable snapshot of the settings of a `SPiDClient`.
+
+ Everything that is derived from the settings, the API prefix, the encoded authorization and logout queries, the URLs
+ with these queries and the default headers, is computed once when the snapshot is created. The client replaces its
+ snapshot when one of the settings changes, so request construction only reads from it.
+ */
+
+@interface SPiDConfiguration : NSObject
+
+///---------------------------------------------------------------------------------------
+/// @name Properties
+///---------------------------------------------------------------------------------------
+
+/** Client ID the snapshot was created for */
+@property (nonatomic, copy, readonly, nullable) NSString *clientID;
+
+/** The server URL as a string, without trailing query */
+@property (nonatomic, copy, readonly) NSString *serverURLString;
+
+/** Path prefix of API requests, e.g. /api/2 */
+@property (nonatomic, copy, readonly) NSString *APIPathPrefix;
+
+/** Encoded authorization query starting with ? */
+@property (nonatomic, copy, readonly) NSString *authorizationQuery;
+
+/** Encoded logout query starting with ? */
+@property (nonatomic, copy, readonly) NSString *logoutQuery;
+
+/** Authorization URL with the authorization query */
+@property (nonatomic, strong, readonly, nullable) NSURL *authorizationURLWithQuery;
+
+/** Signup URL with the authorization query */
+@property (nonatomic, strong, readonly, nullable) NSURL *signupURLWithQuery;
+
+/** Forgot password URL with the authorization query */
+@property (nonatomic, strong, readonly, nullable) NSURL *forgotPasswordURLWithQuery;
+
+/** Logout URL with the logout query */
+@property (nonatomic, strong, readonly, nullable) NSURL *logoutURLWithQuery;
+
+/** Headers added to every request, contains the User-Agent */
+@property (nonatomic, copy, readonly) NSDictionary<NSString *, NSString *> *HTTPHeaders;
+
+///---------------------------------------------------------------------------------------
+/// @name Public methods
+///---------------------------------------------------------------------------------------
+
+/** Creates a snapshot of the current settings of a client
+
+ @param client The client
+ @return `SPiDConfiguration`
+ */
+- (instancetype)initWithClient:(SPiDClient *)client;
+
+/** Headers added to every request, the same for all clients
+
+ Built from Info.plist and the device on first use.
+
+ @return Dictionary with the User-Agent header
+ */
++ (NSDictionary<NSString *, NSString *> *)defaultHTTPHeaders;
+
+@end
+
+NS_ASSUME_NONNULL_END
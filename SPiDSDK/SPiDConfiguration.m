@@ -0,0 +1,124 @@
+//
+//  SPiDConfiguration.m
+//  SPiDSDK
+//
+//  Copyright (c) 2012 Schibsted Payment. All rights reserved.
+//
+
+#import "SPiDConfiguration.h"
+#import "SPiDClient.h"
+#import "SPiDStatus.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface SPiDConfiguration ()
+
+/** Builds the authorization query
+
+ @param client The client
+ @return The encoded query
+ */
++ (NSString *)authorizationQueryForClient:(SPiDClient *)client;
+
+/** Builds the logout query
+
+ @param client The client
+ @return The encoded query
+ */
++ (NSString *)logoutQueryForClient:(SPiDClient *)client;
+
+/** Appends a query to a URL
+
+ @param query The encoded query
+ @param URL The URL, may be nil
+ @return The URL with the query or nil if there was no URL
+ */
++ (nullable NSURL *)URLWithQuery:(NSString *)query appendedToURL:(nullable NSURL *)URL;
+
+@property (nonatomic, copy, readwrite, nullable) NSString *clientID;
+@property (nonatomic, copy, readwrite) NSString *serverURLString;
+@property (nonatomic, copy, readwrite) NSString *APIPathPrefix;
+@property (nonatomic, copy, readwrite) NSString *authorizationQuery;
+@property (nonatomic, copy, readwrite) NSString *logoutQuery;
+@property (nonatomic, strong, readwrite, nullable) NSURL *authorizationURLWithQuery;
+@property (nonatomic, strong, readwrite, nullable) NSURL *signupURLWithQuery;
+@property (nonatomic, strong, readwrite, nullable) NSURL *forgotPasswordURLWithQuery;
+@property (nonatomic, strong, readwrite, nullable) NSURL *logoutURLWithQuery;
+@property (nonatomic, copy, readwrite) NSDictionary<NSString *, NSString *> *HTTPHeaders;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+@implementation SPiDConfiguration
+
+- (instancetype)initWithClient:(SPiDClient *)client {
+    if (self = [super init]) {
+        self.clientID = client.clientID;
+        self.serverURLString = client.serverURL.absoluteString ?: @"";
+        self.APIPathPrefix = [NSString stringWithFormat:@"/api/%@", client.apiVersionSPiD];
+        self.authorizationQuery = [SPiDConfiguration authorizationQueryForClient:client];
+        self.logoutQuery = [SPiDConfiguration logoutQueryForClient:client];
+        self.authorizationURLWithQuery = [SPiDConfiguration URLWithQuery:self.authorizationQuery appendedToURL:client.authorizationURL];
+        self.signupURLWithQuery = [SPiDConfiguration URLWithQuery:self.authorizationQuery appendedToURL:client.signupURL];
+        self.forgotPasswordURLWithQuery = [SPiDConfiguration URLWithQuery:self.authorizationQuery appendedToURL:client.forgotPasswordURL];
+        self.logoutURLWithQuery = [SPiDConfiguration URLWithQuery:self.logoutQuery appendedToURL:client.logoutURL];
+        self.HTTPHeaders = [SPiDConfiguration defaultHTTPHeaders];
+    }
+    return self;
+}
+
++ (NSDictionary<NSString *, NSString *> *)defaultHTTPHeaders {
+    static NSDictionary<NSString *, NSString *> *defaultHTTPHeaders = nil;
+    static dispatch_once_t predicate;
+    dispatch_once(&predicate, ^{
+        defaultHTTPHeaders = @{@"User-Agent": [SPiDStatus spidUserAgent]};
+    });
+    return defaultHTTPHeaders;
+}
+
+#pragma mark Private methods
+
+///---------------------------------------------------------------------------------------
+/// @name Private methods
+///---------------------------------------------------------------------------------------
+
++ (NSString *)authorizationQueryForClient:(SPiDClient *)client {
+    NSMutableDictionary *query = [NSMutableDictionary dictionary];
+    [query setValue:client.clientID forKey:@"client_id"];
+    if ([client.redirectURI.absoluteString hasSuffix:@"/"]) {
+        [query setValue:[client.redirectURI.absoluteString stringByAppendingString:@"login"] forKey:@"redirect_uri"];
+    } else {
+        [query setValue:[client.redirectURI.absoluteString stringByAppendingString:@"/login"] forKey:@"redirect_uri"];
+    }
+    [query setObject:@"authorization_code" forKey:@"grant_type"];
+    [query setObject:@"code" forKey:@"response_type"];
+    if (client.useMobileWeb)
+        [query setObject:@"mobile" forKey:@"platform"];
+    // TODO: needed for browser redirect
+    [query setObject:@"1" forKey:@"force"];
+    return [SPiDUtils encodedHttpQueryForDictionary:query];
+}
+
++ (NSString *)logoutQueryForClient:(SPiDClient *)client {
+    NSMutableDictionary *query = [NSMutableDictionary dictionary];
+    [query setValue:client.clientID forKey:@"client_id"];
+    if ([client.redirectURI.absoluteString hasSuffix:@"/"]) {
+        [query setValue:[client.redirectURI.absoluteString stringByAppendingString:@"logout"] forKey:@"redirect_uri"]; // add spid/logout
+    } else {
+        [query setValue:[client.redirectURI.absoluteString stringByAppendingString:@"/logout"] forKey:@"redirect_uri"]; // add spid/logout
+    }
+    if (client.useMobileWeb)
+        [query setObject:@"mobile" forKey:@"platform"];
+    [query setObject:@"1" forKey:@"force"];
+    return [SPiDUtils encodedHttpQueryForDictionary:query];
+}
+
++ (NSURL *)URLWithQuery:(NSString *)query appendedToURL:(NSURL *)URL {
+    if (URL == nil) {
+        return nil;
+    }
+    return [NSURL URLWithString:[URL.absoluteString stringByAppendingString:query]];
+}
+
+@end
@@ -0,0 +1,50 @@
+//
+//  SPiDFileTokenStore.h
+//  SPiDSDK
+//
+//  Copyright (c) 2012 Schibsted Payment. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "SPiDTokenStore.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/** `SPiDFileTokenStore` stores every access token in its own encrypted file.
+
+ Tokens are encrypted with AES-256-CBC under a random IV and authenticated with HMAC-SHA256 over the version, IV and
+ ciphertext, both keys are derived from the key passed to the initializer. A file that has been modified or was
+ written with another key is treated as missing. Files are replaced with an atomic rename, so a reader sees either
+ the old or the new token. Files are protected with `NSFileProtectionCompleteUntilFirstUserAuthentication`, so they
+ can be read by background refreshes once the device has been unlocked after boot.
+
+ It does not depend on the keychain and can be used where no keychain is available, for example in unit tests.
+ */
+
+@interface SPiDFileTokenStore : NSObject <SPiDTokenStore>
+
+///---------------------------------------------------------------------------------------
+/// @name Properties
+///---------------------------------------------------------------------------------------
+
+/** Directory holding the token files */
+@property (nonatomic, strong, readonly) NSURL *directoryURL;
+
+///---------------------------------------------------------------------------------------
+/// @name Public methods
+///---------------------------------------------------------------------------------------
+
+/** Initializes a store in the given directory
+
+ The directory is created if needed. The key must be kept secret, anyone with the key and the files can read the
+ tokens.
+
+ @param directoryURL Directory for the token files
+ @param key Secret key, at least 32 bytes
+ @return `SPiDFileTokenStore` or nil if the key is too short
+ */
+- (nullable instancetype)initWithDirectoryURL:(NSURL *)directoryURL key:(NSData *)key;
+
+@end
+
+NS_ASSUME_NONNULL_END
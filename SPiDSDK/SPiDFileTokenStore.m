@@ -0,0 +1,210 @@
+//
+//  SPiDFileTokenStore.m
+//  SPiDSDK
+//
+//  Copyright (c) 2012 Schibsted Payment. All rights reserved.
+//
+
+#import "SPiDFileTokenStore.h"
+#import "SPiDAccessToken.h"
+#import "SPiDClient.h"
+#import "SPiDHMAC.h"
+#import <CommonCrypto/CommonCrypto.h>
+#import <CommonCrypto/CommonRandom.h>
+
+static NSString *const SPiDTokenFileExtension = @"token";
+static const uint8_t SPiDTokenFileVersion = 1;
+static const NSUInteger SPiDTokenFileMinimumKeyLength = 32;
+
+@interface SPiDFileTokenStore ()
+
+/** Returns the file used for a identifier, the file name is the hex encoded identifier */
+- (NSURL *)fileURLForIdentifier:(NSString *)identifier;
+
+/** Decodes the identifier from a token file name
+
+ @return The identifier or nil if the file is not a token file
+ */
+- (nullable NSString *)identifierForFileURL:(NSURL *)fileURL;
+
+/** Encrypts and authenticates a encoded token */
+- (nullable NSData *)sealData:(NSData *)data;
+
+/** Verifies and decrypts the contents of a token file
+
+ @return The encoded token or nil if the file has been modified or was written with another key
+ */
+- (nullable NSData *)openData:(NSData *)data;
+
+@property (nonatomic, strong, readwrite) NSURL *directoryURL;
+@property (nonatomic, copy) NSData *encryptionKey;
+@property (nonatomic, strong) SPiDHMAC *authenticator;
+
+@end
+
+@implementation SPiDFileTokenStore
+
+- (instancetype)initWithDirectoryURL:(NSURL *)directoryURL key:(NSData *)key {
+    if (key.length < SPiDTokenFileMinimumKeyLength) {
+        SPiDDebugLog(@"File token store key must be at least %lu bytes", (unsigned long) SPiDTokenFileMinimumKeyLength);
+        return nil;
+    }
+    if (self = [super init]) {
+        self.directoryURL = directoryURL;
+        // Separate keys for encryption and authentication, derived with HMAC-SHA256 over fixed labels
+        uint8_t derived[CC_SHA256_DIGEST_LENGTH];
+        CCHmac(kCCHmacAlgSHA256, key.bytes, key.length, "SPiD encryption", 15, derived);
+        self.encryptionKey = [NSData dataWithBytes:derived length:kCCKeySizeAES256];
+        CCHmac(kCCHmacAlgSHA256, key.bytes, key.length, "SPiD authentication", 19, derived);
+        self.authenticator = [[SPiDHMAC alloc] initWithKey:[NSData dataWithBytes:derived length:sizeof(derived)]];
+        // Token refreshes in the background must be able to read the files while the device is locked
+        [[NSFileManager defaultManager] createDirectoryAtURL:directoryURL withIntermediateDirectories:YES attributes:@{NSFileProtectionKey: NSFileProtectionCompleteUntilFirstUserAuthentication} error:nil];
+    }
+    return self;
+}
+
+- (SPiDAccessToken *)accessTokenForIdentifier:(NSString *)identifier {
+    NSData *data = [NSData dataWithContentsOfURL:[self fileURLForIdentifier:identifier]];
+    if (data == nil) {
+        return nil;
+    }
+    NSData *encoded = [self openData:data];
+    if (encoded == nil) {
+        SPiDDebugLog(@"Ignoring token file that failed authentication: %@", identifier);
+        return nil;
+    }
+    return [[SPiDAccessToken alloc] initWithSerializedData:encoded];
+}
+
+- (NSDictionary<NSString *, SPiDAccessToken *> *)accessTokensWithIdentifierPrefix:(NSString *)prefix {
+    NSMutableDictionary<NSString *, SPiDAccessToken *> *accessTokens = [NSMutableDictionary dictionary];
+    NSArray<NSURL *> *fileURLs = [[NSFileManager defaultManager] contentsOfDirectoryAtURL:self.directoryURL includingPropertiesForKeys:nil options:NSDirectoryEnumerationSkipsHiddenFiles error:nil];
+    for (NSURL *fileURL in fileURLs) {
+        NSString *identifier = [self identifierForFileURL:fileURL];
+        if (![identifier hasPrefix:prefix]) {
+            continue;
+        }
+        SPiDAccessToken *accessToken = [self accessTokenForIdentifier:identifier];
+        if (accessToken) {
+            accessTokens[identifier] = accessToken;
+        }
+    }
+    return accessTokens;
+}
+
+- (void)storeAccessToken:(SPiDAccessToken *)accessToken forIdentifier:(NSString *)identifier {
+    NSData *sealed = [self sealData:[accessToken serializedData]];
+    if (sealed == nil) {
+        SPiDDebugLog(@"Could not encrypt token: %@", identifier);
+        return;
+    }
+    NSError *error = nil;
+    // Written to a temporary file and renamed over the old one
+    NSDataWritingOptions options = NSDataWritingAtomic | NSDataWritingFileProtectionCompleteUntilFirstUserAuthentication;
+    if (![sealed writeToURL:[self fileURLForIdentifier:identifier] options:options error:&error]) {
+        SPiDDebugLog(@"Could not write token file: %@", error);
+    }
+}
+
+- (void)removeAccessTokenForIdentifier:(NSString *)identifier {
+    [[NSFileManager defaultManager] removeItemAtURL:[self fileURLForIdentifier:identifier] error:nil];
+}
+
+- (void)flush {
+    // Writes are synchronous
+}
+
+#pragma mark Private methods
+
+///---------------------------------------------------------------------------------------
+/// @name Private methods
+///---------------------------------------------------------------------------------------
+
+- (NSURL *)fileURLForIdentifier:(NSString *)identifier {
+    NSData *data = [identifier dataUsingEncoding:NSUTF8StringEncoding];
+    const uint8_t *bytes = data.bytes;
+    NSMutableString *name = [NSMutableString stringWithCapacity:data.length * 2];
+    for (NSUInteger i = 0; i < data.length; i++) {
+        [name appendFormat:@"%02x", bytes[i]];
+    }
+    return [[self.directoryURL URLByAppendingPathComponent:name] URLByAppendingPathExtension:SPiDTokenFileExtension];
+}
+
+- (NSString *)identifierForFileURL:(NSURL *)fileURL {
+    if (![fileURL.pathExtension isEqualToString:SPiDTokenFileExtension]) {
+        return nil;
+    }
+    NSString *name = [fileURL.lastPathComponent stringByDeletingPathExtension];
+    const char *hex = name.UTF8String;
+    size_t length = strlen(hex);
+    if (length % 2 != 0) {
+        return nil;
+    }
+    NSMutableData *data = [NSMutableData dataWithLength:length / 2];
+    uint8_t *bytes = data.mutableBytes;
+    for (size_t i = 0; i < length / 2; i++) {
+        unsigned int byte;
+        if (sscanf(hex + i * 2, "%2x", &byte) != 1) {
+            return nil;
+        }
+        bytes[i] = (uint8_t) byte;
+    }
+    return [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding];
+}
+
+- (NSData *)sealData:(NSData *)data {
+    // version | IV | ciphertext | HMAC-SHA256(version | IV | ciphertext)
+    size_t headerLength = 1 + kCCBlockSizeAES128;
+    NSMutableData *sealed = [NSMutableData dataWithLength:headerLength + data.length + kCCBlockSizeAES128 + CC_SHA256_DIGEST_LENGTH];
+    uint8_t *bytes = sealed.mutableBytes;
+    bytes[0] = SPiDTokenFileVersion;
+    if (CCRandomGenerateBytes(bytes + 1, kCCBlockSizeAES128) != kCCSuccess) {
+        return nil;
+    }
+
+    size_t encryptedLength = 0;
+    CCCryptorStatus status = CCCrypt(kCCEncrypt, kCCAlgorithmAES, kCCOptionPKCS7Padding,
+            self.encryptionKey.bytes, self.encryptionKey.length, bytes + 1,
+            data.bytes, data.length,
+            bytes + headerLength, data.length + kCCBlockSizeAES128, &encryptedLength);
+    if (status != kCCSuccess) {
+        return nil;
+    }
+
+    sealed.length = headerLength + encryptedLength;
+    [sealed appendData:[self.authenticator signatureForData:sealed]];
+    return sealed;
+}
+
+- (NSData *)openData:(NSData *)data {
+    size_t headerLength = 1 + kCCBlockSizeAES128;
+    if (data.length < headerLength + kCCBlockSizeAES128 + CC_SHA256_DIGEST_LENGTH) {
+        return nil;
+    }
+    const uint8_t *bytes = data.bytes;
+    if (bytes[0] != SPiDTokenFileVersion) {
+        return nil;
+    }
+
+    size_t authenticatedLength = data.length - CC_SHA256_DIGEST_LENGTH;
+    NSData *authenticated = [NSData dataWithBytesNoCopy:(void *) bytes length:authenticatedLength freeWhenDone:NO];
+    NSData *mac = [NSData dataWithBytesNoCopy:(void *) (bytes + authenticatedLength) length:CC_SHA256_DIGEST_LENGTH freeWhenDone:NO];
+    if (![self.authenticator verifySignature:mac forData:authenticated]) {
+        return nil;
+    }
+
+    size_t encryptedLength = authenticatedLength - headerLength;
+    NSMutableData *decrypted = [NSMutableData dataWithLength:encryptedLength];
+    size_t decryptedLength = 0;
+    CCCryptorStatus status = CCCrypt(kCCDecrypt, kCCAlgorithmAES, kCCOptionPKCS7Padding,
+            self.encryptionKey.bytes, self.encryptionKey.length, bytes + 1,
+            bytes + headerLength, encryptedLength,
+            decrypted.mutableBytes, decrypted.length, &decryptedLength);
+    if (status != kCCSuccess) {
+        return nil;
+    }
+    decrypted.length = decryptedLength;
+    return decrypted;
+}
+
+@end
@@ -0,0 +1,97 @@
+//
+//  SPiDHMAC.h
+//  SPiDSDK
+//
+//  Copyright (c) 2012 Schibsted Payment. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/** Length in bytes of a HMAC-SHA256 signature */
+extern const NSUInteger SPiDHMACSignatureLength;
+
+/** `SPiDHMAC` computes HMAC-SHA256 signatures with a signing secret that is keyed once.
+
+ The inner and outer hash state for the secret is computed in the initializer, so each signature only hashes the
+ payload. The one shot methods start from a private copy of that state and can be called from any thread.
+
+ For payloads that arrive in parts, use `updateWithData:` followed by `finalSignature`. The streaming state belongs to
+ the instance, so use one instance (or a `copy`) per stream.
+ */
+
+@interface SPiDHMAC : NSObject <NSCopying>
+
+///---------------------------------------------------------------------------------------
+/// @name Public methods
+///---------------------------------------------------------------------------------------
+
+/** Initializes a `SPiDHMAC` for a signing secret
+
+ @param key The signing secret
+ @return `SPiDHMAC`
+ */
+- (instancetype)initWithKey:(NSData *)key NS_DESIGNATED_INITIALIZER;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/** Signs data
+
+ @param data The payload
+ @return The raw signature, `SPiDHMACSignatureLength` bytes
+ */
+- (NSData *)signatureForData:(NSData *)data;
+
+/** Signs data
+
+ @param data The payload
+ @return The signature as lowercase hex
+ */
+- (NSString *)hexSignatureForData:(NSData *)data;
+
+/** Checks a raw signature in constant time
+
+ @param signature The raw signature to check
+ @param data The payload
+ @return YES if the signature is valid for the payload
+ */
+- (BOOL)verifySignature:(NSData *)signature forData:(NSData *)data;
+
+/** Adds a part of a streamed payload
+
+ @param data The next part of the payload
+ */
+- (void)updateWithData:(NSData *)data;
+
+/** Adds a part of a streamed payload
+
+ @param bytes The next part of the payload
+ @param length Number of bytes
+ */
+- (void)updateWithBytes:(const void *)bytes length:(size_t)length;
+
+/** Finishes the streamed payload and resets the stream for the next one
+
+ @return The raw signature of everything added since the last reset
+ */
+- (NSData *)finalSignature;
+
+/** Encodes data as lowercase hex
+
+ @param data The data to encode
+ @return The hex string
+ */
++ (NSString *)hexStringWithData:(NSData *)data;
+
+/** Compares two byte strings in a time that depends only on their length
+
+ @param data The first byte string
+ @param otherData The second byte string
+ @return YES if they are equal
+ */
++ (BOOL)isData:(NSData *)data constantTimeEqualToData:(NSData *)otherData;
+
+@end
+
+NS_ASSUME_NONNULL_END
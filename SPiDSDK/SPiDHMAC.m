@@ -0,0 +1,124 @@
+//
+//  SPiDHMAC.m
+//  SPiDSDK
+//
+//  Copyright (c) 2012 Schibsted Payment. All rights reserved.
+//
+
+#import "SPiDHMAC.h"
+#import <CommonCrypto/CommonHMAC.h>
+
+const NSUInteger SPiDHMACSignatureLength = CC_SHA256_DIGEST_LENGTH;
+
+static const char SPiDLowercaseHexDigits[] = "0123456789abcdef";
+
+/** Encodes bytes as lowercase hex with a lookup table */
+static NSString *SPiDHexString(const uint8_t *bytes, NSUInteger length) {
+    if (length == 0) {
+        return @"";
+    }
+    char *hex = malloc(length * 2);
+    for (NSUInteger i = 0; i < length; i++) {
+        hex[2 * i] = SPiDLowercaseHexDigits[bytes[i] >> 4];
+        hex[2 * i + 1] = SPiDLowercaseHexDigits[bytes[i] & 0x0F];
+    }
+    return [[NSString alloc] initWithBytesNoCopy:hex length:length * 2 encoding:NSASCIIStringEncoding freeWhenDone:YES];
+}
+
+/** Compares without an early exit, so the time taken does not reveal how many bytes matched */
+static BOOL SPiDConstantTimeEqual(const uint8_t *bytes, const uint8_t *otherBytes, NSUInteger length) {
+    uint8_t difference = 0;
+    for (NSUInteger i = 0; i < length; i++) {
+        difference |= bytes[i] ^ otherBytes[i];
+    }
+    return difference == 0;
+}
+
+@interface SPiDHMAC ()
+
+/** Signs bytes starting from a copy of the keyed context, so concurrent callers do not share state
+
+ @param signature Buffer for `SPiDHMACSignatureLength` bytes
+ @param bytes The payload
+ @param length Number of bytes
+ */
+- (void)getSignature:(uint8_t *)signature forBytes:(const void *)bytes length:(size_t)length;
+
+@end
+
+@implementation SPiDHMAC {
+    /** Context keyed with the secret, never finalized, copied for each signature */
+    CCHmacContext _keyedContext;
+    /** Context for the current stream */
+    CCHmacContext _streamContext;
+}
+
+- (instancetype)initWithKey:(NSData *)key {
+    if (self = [super init]) {
+        CCHmacInit(&_keyedContext, kCCHmacAlgSHA256, key.bytes, key.length);
+        _streamContext = _keyedContext;
+    }
+    return self;
+}
+
+- (id)copyWithZone:(NSZone *)zone {
+    SPiDHMAC *copy = [[[self class] allocWithZone:zone] initWithKey:[NSData data]];
+    copy->_keyedContext = _keyedContext;
+    copy->_streamContext = _streamContext;
+    return copy;
+}
+
+- (NSData *)signatureForData:(NSData *)data {
+    uint8_t signature[CC_SHA256_DIGEST_LENGTH];
+    [self getSignature:signature forBytes:data.bytes length:data.length];
+    return [NSData dataWithBytes:signature length:sizeof(signature)];
+}
+
+- (NSString *)hexSignatureForData:(NSData *)data {
+    uint8_t signature[CC_SHA256_DIGEST_LENGTH];
+    [self getSignature:signature forBytes:data.bytes length:data.length];
+    return SPiDHexString(signature, sizeof(signature));
+}
+
+- (BOOL)verifySignature:(NSData *)signature forData:(NSData *)data {
+    uint8_t expected[CC_SHA256_DIGEST_LENGTH];
+    [self getSignature:expected forBytes:data.bytes length:data.length];
+    return signature.length == sizeof(expected) && SPiDConstantTimeEqual(expected, signature.bytes, sizeof(expected));
+}
+
+- (void)updateWithData:(NSData *)data {
+    [self updateWithBytes:data.bytes length:data.length];
+}
+
+- (void)updateWithBytes:(const void *)bytes length:(size_t)length {
+    CCHmacUpdate(&_streamContext, bytes, length);
+}
+
+- (NSData *)finalSignature {
+    uint8_t signature[CC_SHA256_DIGEST_LENGTH];
+    CCHmacFinal(&_streamContext, signature);
+    _streamContext = _keyedContext;
+    return [NSData dataWithBytes:signature length:sizeof(signature)];
+}
+
++ (NSString *)hexStringWithData:(NSData *)data {
+    return SPiDHexString(data.bytes, data.length);
+}
+
++ (BOOL)isData:(NSData *)data constantTimeEqualToData:(NSData *)otherData {
+    return data.length == otherData.length && SPiDConstantTimeEqual(data.bytes, otherData.bytes, data.length);
+}
+
+#pragma mark Private methods
+
+///---------------------------------------------------------------------------------------
+/// @name Private methods
+///---------------------------------------------------------------------------------------
+
+- (void)getSignature:(uint8_t *)signature forBytes:(const void *)bytes length:(size_t)length {
+    CCHmacContext context = _keyedContext;
+    CCHmacUpdate(&context, bytes, length);
+    CCHmacFinal(&context, signature);
+}
+
+@end
@@ -0,0 +1,72 @@
+//
+//  SPiDIdentity.h
+//  SPiDSDK
+//
+//  Copyright (c) 2012 Schibsted Payment. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/** Identity of the logged in user, decoded from the signed id_token of a token response
+
+ The id_token is verified locally, so the user ID, email and name are available as soon as the token response arrives
+ without a `meRequestWithCompletionHandler:` round trip. Identities are immutable.
+ */
+
+@interface SPiDIdentity : NSObject
+
+///---------------------------------------------------------------------------------------
+/// @name Properties
+///---------------------------------------------------------------------------------------
+
+/** User ID, the `sub` claim */
+@property (nonatomic, copy, readonly) NSString *userID;
+
+/** Email address, the `email` claim */
+@property (nonatomic, copy, readonly, nullable) NSString *email;
+
+/** Display name, the `name` claim, or `preferred_username` if there is no name */
+@property (nonatomic, copy, readonly, nullable) NSString *displayName;
+
+/** Given name, the `given_name` claim */
+@property (nonatomic, copy, readonly, nullable) NSString *givenName;
+
+/** Family name, the `family_name` claim */
+@property (nonatomic, copy, readonly, nullable) NSString *familyName;
+
+/** Expiry date of the id_token, the `exp` claim */
+@property (nonatomic, copy, readonly, nullable) NSDate *expiresAt;
+
+/** All claims of the id_token */
+@property (nonatomic, copy, readonly) NSDictionary<NSString *, id> *claims;
+
+///---------------------------------------------------------------------------------------
+/// @name Public methods
+///---------------------------------------------------------------------------------------
+
+/** Verifies a HS256 id_token and decodes the identity
+
+ The signature is checked with the client secret, `aud` must contain the client ID, `iss` must be the server URL and
+ the token must have an `exp` claim that has not passed. A trailing slash is ignored when comparing the issuer.
+
+ @param idToken The id_token from the token response
+ @param clientID The client ID the token was issued to
+ @param clientSecret The client secret used as signing key
+ @param issuer The server URL that issued the token
+ @param error Set to a `SPiDJwt` error if the id_token is rejected
+ @return `SPiDIdentity`, nil if the id_token is rejected
+ */
++ (nullable instancetype)identityWithIDToken:(NSString *)idToken clientID:(NSString *)clientID clientSecret:(NSString *)clientSecret issuer:(NSURL *)issuer error:(NSError **)error;
+
+/** Initializes the identity from decoded claims
+
+ @param claims Verified id_token claims
+ @return `SPiDIdentity`, nil if there is no `sub` claim
+ */
+- (nullable instancetype)initWithClaims:(NSDictionary<NSString *, id> *)claims;
+
+@end
+
+NS_ASSUME_NONNULL_END
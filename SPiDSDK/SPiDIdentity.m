@@ -0,0 +1,111 @@
+//
+//  SPiDIdentity.m
+//  SPiDSDK
+//
+//  Copyright (c) 2012 Schibsted Payment. All rights reserved.
+//
+
+#import "SPiDIdentity.h"
+#import "SPiDJwtCodec.h"
+#import "NSError+SPiD.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface SPiDIdentity ()
+
+/** Returns the claim if it is a string, otherwise nil */
++ (nullable NSString *)stringClaim:(NSString *)name inClaims:(NSDictionary<NSString *, id> *)claims;
+
+/** Returns the URL string without trailing slashes */
++ (NSString *)issuerStringWithoutTrailingSlash:(NSString *)issuer;
+
+@property (nonatomic, copy, readwrite) NSString *userID;
+@property (nonatomic, copy, readwrite, nullable) NSString *email;
+@property (nonatomic, copy, readwrite, nullable) NSString *displayName;
+@property (nonatomic, copy, readwrite, nullable) NSString *givenName;
+@property (nonatomic, copy, readwrite, nullable) NSString *familyName;
+@property (nonatomic, copy, readwrite, nullable) NSDate *expiresAt;
+@property (nonatomic, copy, readwrite) NSDictionary<NSString *, id> *claims;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+@implementation SPiDIdentity
+
++ (instancetype)identityWithIDToken:(NSString *)idToken clientID:(NSString *)clientID clientSecret:(NSString *)clientSecret issuer:(NSURL *)issuer error:(NSError **)error {
+    NSDictionary<NSString *, id> *claims = [[SPiDJwtCodec codecWithSignSecret:clientSecret] verifiedClaimsFromJwt:idToken error:error];
+    if (claims == nil) {
+        return nil;
+    }
+
+    // The codec only checks exp when present, an id_token without it would never expire
+    if (![[claims objectForKey:@"exp"] isKindOfClass:[NSNumber class]]) {
+        if (error) *error = [NSError sp_oauth2ErrorWithCode:SPiDJwtMalformedErrorCode reason:@"Missing id_token expiration" descriptions:@{@"error": @"Missing id_token expiration"}];
+        return nil;
+    }
+
+    NSString *tokenIssuer = [SPiDIdentity stringClaim:@"iss" inClaims:claims];
+    if (tokenIssuer == nil || ![[self issuerStringWithoutTrailingSlash:tokenIssuer] isEqualToString:[self issuerStringWithoutTrailingSlash:issuer.absoluteString]]) {
+        if (error) *error = [NSError sp_oauth2ErrorWithCode:SPiDJwtInvalidIssuerErrorCode reason:@"Invalid id_token issuer" descriptions:@{@"error": @"Invalid id_token issuer"}];
+        return nil;
+    }
+
+    // A id_token issued to another client must not be accepted even if it is signed with the same secret
+    id audience = [claims objectForKey:@"aud"];
+    BOOL isAudience = [audience isKindOfClass:[NSArray class]] ? [audience containsObject:clientID] : [audience isEqual:clientID];
+    if (!isAudience) {
+        if (error) *error = [NSError sp_oauth2ErrorWithCode:SPiDJwtInvalidAudienceErrorCode reason:@"Invalid id_token audience" descriptions:@{@"error": @"Invalid id_token audience"}];
+        return nil;
+    }
+
+    SPiDIdentity *identity = [[self alloc] initWithClaims:claims];
+    if (identity == nil && error) {
+        *error = [NSError sp_oauth2ErrorWithCode:SPiDJwtMalformedErrorCode reason:@"Missing id_token subject" descriptions:@{@"error": @"Missing id_token subject"}];
+    }
+    return identity;
+}
+
+- (instancetype)initWithClaims:(NSDictionary<NSString *, id> *)claims {
+    NSString *userID = [SPiDIdentity stringClaim:@"sub" inClaims:claims];
+    if (userID.length == 0) {
+        return nil;
+    }
+    if (self = [super init]) {
+        self.userID = userID;
+        self.email = [SPiDIdentity stringClaim:@"email" inClaims:claims];
+        self.displayName = [SPiDIdentity stringClaim:@"name" inClaims:claims] ?: [SPiDIdentity stringClaim:@"preferred_username" inClaims:claims];
+        self.givenName = [SPiDIdentity stringClaim:@"given_name" inClaims:claims];
+        self.familyName = [SPiDIdentity stringClaim:@"family_name" inClaims:claims];
+        id expiration = [claims objectForKey:@"exp"];
+        if ([expiration isKindOfClass:[NSNumber class]]) {
+            self.expiresAt = [NSDate dateWithTimeIntervalSince1970:[expiration doubleValue]];
+        }
+        self.claims = claims;
+    }
+    return self;
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@: %p userID: %@ email: %@ displayName: %@>", NSStringFromClass([self class]), self, self.userID, self.email, self.displayName];
+}
+
+#pragma mark Private methods
+
+///---------------------------------------------------------------------------------------
+/// @name Private methods
+///---------------------------------------------------------------------------------------
+
++ (NSString *)stringClaim:(NSString *)name inClaims:(NSDictionary<NSString *, id> *)claims {
+    id value = [claims objectForKey:name];
+    return [value isKindOfClass:[NSString class]] ? value : nil;
+}
+
++ (NSString *)issuerStringWithoutTrailingSlash:(NSString *)issuer {
+    while ([issuer hasSuffix:@"/"]) {
+        issuer = [issuer substringToIndex:issuer.length - 1];
+    }
+    return issuer;
+}
+
+@end
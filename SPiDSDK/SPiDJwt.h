@@ -10,7 +10,10 @@
 static NSString *const JSON_WEB_ALGORITHM_HS256 = @"HS256";
 static NSString *const JSON_WEB_TOKEN_TYP_JWT = @"JWT";
 
-/** Contains a JWT token */
+/** Contains a JWT token with the claims SPiD expects for a Facebook assertion
+
+ Encoding is done by `SPiDJwtCodec`, use it directly for other claims and for verifying JWTs.
+ */
 
 @interface SPiDJwt : NSObject
 
@@ -42,10 +45,17 @@ static NSString *const JSON_WEB_TOKEN_TYP_JWT = @"JWT";
 */
 + (instancetype)jwtTokenWithDictionary:(NSDictionary *)dictionary;
 
-/* Encodes JWT token to a string
+/* Encodes JWT token to a string signed with the sign secret of the singleton client
 
  @return JWT encoded as a string
 */
 - (NSString *)encodedJwtString;
 
+/** Encodes JWT token to a string signed with the given secret
+
+ @param signSecret The secret used for the HS256 signature, usually `SPiDClient.signSecret`
+ @return JWT encoded as a string, nil if the JWT is invalid
+*/
+- (NSString *)encodedJwtStringWithSignSecret:(NSString *)signSecret;
+
 @end
\ No newline at end of file
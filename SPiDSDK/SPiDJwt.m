@@ -7,8 +7,7 @@
 
 #import "SPiDJwt.h"
 #import "SPiDClient.h"
-#import "NSData+Base64.h"
-#import "NSString+Crypto.h"
+#import "SPiDJwtCodec.h"
 
 @interface SPiDJwt ()
 /* Validates the JWT token
@@ -37,42 +36,31 @@
 }
 
 - (NSString *)encodedJwtString {
+    return [self encodedJwtStringWithSignSecret:[[SPiDClient sharedInstance] signSecret]];
+}
+
+- (NSString *)encodedJwtStringWithSignSecret:(NSString *)signSecret {
     if (![self validateJwt]) {
         return nil;
     }
-    if ([[SPiDClient sharedInstance] signSecret] == nil) {
+    if (signSecret == nil) {
         SPiDDebugLog(@"No signing secret found, cannot use JWT");
         return nil;
     }
 
-    NSError *jsonError;
-    NSDictionary *headerDictionary = [[NSDictionary alloc] initWithObjectsAndKeys:JSON_WEB_ALGORITHM_HS256, @"alg",
-                                                                                  JSON_WEB_TOKEN_TYP_JWT, @"typ", nil];
-    NSData *headerJson = [NSJSONSerialization dataWithJSONObject:headerDictionary options:(NSJSONWritingOptions) 0 error:&jsonError];
-    NSString *header = [headerJson sp_base64EncodedString];
-    if (jsonError != nil) {
-        SPiDDebugLog(@"Error encoding JWT header");
-        return nil;
-    }
-
-    NSDictionary *claimDictionary = [[NSDictionary alloc] initWithObjectsAndKeys:self.iss, @"iss",
-                                                                                 self.sub, @"sub",
-                                                                                 self.aud, @"aud",
-                                                                                 self.exp, @"exp",
-                                                                                 self.tokenType, @"token_type",
-                                                                                 self.tokenValue, @"token_value",
-                                                                                 nil];
-
-    NSData *claimJson = [NSJSONSerialization dataWithJSONObject:claimDictionary options:(NSJSONWritingOptions) 0 error:&jsonError];
-    NSString *claim = [claimJson sp_base64EncodedString];
-    if (jsonError != nil) {
-        SPiDDebugLog(@"Error encoding JWT claim");
-        return nil;
+    NSMutableDictionary *claims = [NSMutableDictionary dictionaryWithCapacity:6];
+    [claims setObject:self.iss forKey:@"iss"];
+    [claims setObject:self.sub forKey:@"sub"];
+    [claims setObject:self.aud forKey:@"aud"];
+    // A date is written as NumericDate, callers that pass a preformatted string get it as is
+    id expiration = self.exp;
+    if ([expiration isKindOfClass:[NSDate class]]) {
+        expiration = @((long long) [self.exp timeIntervalSince1970]);
     }
-
-    NSString *payload = [NSString stringWithFormat:@"%@.%@", header, claim];
-    NSString *signature = [payload hmacSHA256withKey:[[SPiDClient sharedInstance] signSecret]];
-    return [NSString stringWithFormat:@"%@.%@.%@", header, claim, signature];
+    [claims setObject:expiration forKey:@"exp"];
+    [claims setObject:self.tokenType forKey:@"token_type"];
+    [claims setObject:self.tokenValue forKey:@"token_value"];
+    return [[SPiDJwtCodec codecWithSignSecret:signSecret] encodedJwtWithClaims:claims];
 }
 
 #pragma mark Private methods
@@ -0,0 +1,87 @@
+//
+//  SPiDJwtCodec.h
+//  SPiDSDK
+//
+//  Copyright (c) 2012 Schibsted Payment. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/** `SPiDJwtCodec` encodes, decodes and verifies HS256 signed JSON Web Tokens as described in RFC 7519.
+
+ Segments are Base64url encoded without padding and the signature is the raw HMAC-SHA256, as in RFC 7515. The header
+ is always `{"alg":"HS256","typ":"JWT"}` and is encoded once for all codecs. The signing secret is keyed once per
+ codec, so keep the codec around, or use `codecWithSignSecret:`, when signing or verifying more than one token.
+
+ A codec can be used from several threads at once.
+ */
+
+@interface SPiDJwtCodec : NSObject
+
+///---------------------------------------------------------------------------------------
+/// @name Properties
+///---------------------------------------------------------------------------------------
+
+/** Clock skew allowed when checking `exp`, defaults to 60 seconds */
+@property (atomic, assign) NSTimeInterval expirationLeeway;
+
+///---------------------------------------------------------------------------------------
+/// @name Public methods
+///---------------------------------------------------------------------------------------
+
+/** Returns a cached codec for a signing secret
+
+ Codecs are cached per secret, so signing with the sign secret and verifying with the client secret, or using several
+ clients, does not key the HMAC again on each call.
+
+ @param signSecret The signing secret
+ @return `SPiDJwtCodec`
+ */
++ (instancetype)codecWithSignSecret:(NSString *)signSecret;
+
+/** Initializes a `SPiDJwtCodec` with a signing secret
+
+ @param signSecret The signing secret, used as UTF-8
+ @return `SPiDJwtCodec`
+ */
+- (instancetype)initWithSignSecret:(NSString *)signSecret;
+
+/** Initializes a `SPiDJwtCodec` with a binary key
+
+ @param key The signing key
+ @return `SPiDJwtCodec`
+ */
+- (instancetype)initWithKey:(NSData *)key NS_DESIGNATED_INITIALIZER;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/** Encodes and signs a JWT
+
+ @param claims The claims, must be valid JSON
+ @return The JWT in compact serialization, nil if the claims can not be serialized
+ */
+- (nullable NSString *)encodedJwtWithClaims:(NSDictionary<NSString *, id> *)claims;
+
+/** Decodes a JWT after checking the algorithm, the signature and, if present, the expiration time
+
+ @param jwt The JWT in compact serialization
+ @param error Set to a `SPiDJwtMalformedErrorCode`, `SPiDJwtInvalidSignatureErrorCode` or `SPiDJwtExpiredErrorCode`
+ error if the JWT is rejected
+ @return The claims, nil if the JWT is rejected
+ */
+- (nullable NSDictionary<NSString *, id> *)verifiedClaimsFromJwt:(NSString *)jwt error:(NSError **)error;
+
+/** Decodes the claims of a JWT without verifying it
+
+ Only use the result for display or routing, never to make trust decisions.
+
+ @param jwt The JWT in compact serialization
+ @return The claims, nil if the JWT can not be decoded
+ */
++ (nullable NSDictionary<NSString *, id> *)unverifiedClaimsFromJwt:(NSString *)jwt;
+
+@end
+
+NS_ASSUME_NONNULL_END
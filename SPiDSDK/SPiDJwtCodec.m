@@ -0,0 +1,191 @@
+//
+//  SPiDJwtCodec.m
+//  SPiDSDK
+//
+//  Copyright (c) 2012 Schibsted Payment. All rights reserved.
+//
+
+#import "SPiDJwtCodec.h"
+#import "SPiDJwt.h"
+#import "SPiDHMAC.h"
+#import "SPiDClient.h"
+#import "NSData+Base64.h"
+#import "NSError+SPiD.h"
+
+static const NSTimeInterval SPiDJwtDefaultExpirationLeeway = 60;
+// Enough for the client and sign secrets of a few clients
+static const NSUInteger SPiDJwtCodecCacheLimit = 8;
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface SPiDJwtCodec ()
+
+/** The Base64url encoded header followed by the segment separator, shared by all codecs */
++ (NSData *)headerSegment;
+
+/** Splits a JWT into its three segments
+
+ @return The segments, nil if the JWT does not have exactly three
+ */
++ (nullable NSArray<NSString *> *)segmentsOfJwt:(NSString *)jwt;
+
+/** Decodes a Base64url encoded JSON object
+
+ @return The object, nil if the segment is not a encoded JSON object
+ */
++ (nullable NSDictionary<NSString *, id> *)JSONObjectFromSegment:(NSString *)segment;
+
+/** Creates a JWT error with a description */
++ (NSError *)errorWithCode:(NSInteger)code description:(NSString *)description;
+
+@property (nonatomic, copy) NSString *signSecret;
+@property (nonatomic, strong) SPiDHMAC *hmac;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+@implementation SPiDJwtCodec
+
+#pragma mark Public methods
+
+///---------------------------------------------------------------------------------------
+/// @name Public methods
+///---------------------------------------------------------------------------------------
+
++ (instancetype)codecWithSignSecret:(NSString *)signSecret {
+    static NSCache<NSString *, SPiDJwtCodec *> *codecs = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        codecs = [[NSCache alloc] init];
+        codecs.countLimit = SPiDJwtCodecCacheLimit;
+    });
+    SPiDJwtCodec *codec = [codecs objectForKey:signSecret];
+    if (codec == nil) {
+        codec = [[SPiDJwtCodec alloc] initWithSignSecret:signSecret];
+        [codecs setObject:codec forKey:signSecret];
+    }
+    return codec;
+}
+
+- (instancetype)initWithSignSecret:(NSString *)signSecret {
+    if (self = [self initWithKey:[signSecret dataUsingEncoding:NSUTF8StringEncoding] ?: [NSData data]]) {
+        self.signSecret = signSecret;
+    }
+    return self;
+}
+
+- (instancetype)initWithKey:(NSData *)key {
+    if (self = [super init]) {
+        self.hmac = [[SPiDHMAC alloc] initWithKey:key];
+        self.expirationLeeway = SPiDJwtDefaultExpirationLeeway;
+    }
+    return self;
+}
+
+- (NSString *)encodedJwtWithClaims:(NSDictionary<NSString *, id> *)claims {
+    if (![NSJSONSerialization isValidJSONObject:claims]) {
+        SPiDDebugLog(@"JWT claims are not valid JSON: %@", claims);
+        return nil;
+    }
+    NSError *jsonError;
+    NSData *claimJson = [NSJSONSerialization dataWithJSONObject:claims options:(NSJSONWritingOptions) 0 error:&jsonError];
+    if (claimJson == nil) {
+        SPiDDebugLog(@"Error encoding JWT claim: %@", jsonError);
+        return nil;
+    }
+
+    NSData *header = [SPiDJwtCodec headerSegment];
+    NSData *claim = [[claimJson sp_base64EncodedUrlSafeString] dataUsingEncoding:NSASCIIStringEncoding];
+    // Base64url of a HMAC-SHA256 signature is 43 characters
+    NSMutableData *jwt = [NSMutableData dataWithCapacity:header.length + claim.length + 44];
+    [jwt appendData:header];
+    [jwt appendData:claim];
+    NSData *signature = [self.hmac signatureForData:jwt];
+    [jwt appendBytes:"." length:1];
+    [jwt appendData:[[signature sp_base64EncodedUrlSafeString] dataUsingEncoding:NSASCIIStringEncoding]];
+    return [[NSString alloc] initWithData:jwt encoding:NSASCIIStringEncoding];
+}
+
+- (NSDictionary<NSString *, id> *)verifiedClaimsFromJwt:(NSString *)jwt error:(NSError **)error {
+    NSArray<NSString *> *segments = [SPiDJwtCodec segmentsOfJwt:jwt];
+    NSDictionary *header = segments ? [SPiDJwtCodec JSONObjectFromSegment:segments[0]] : nil;
+    if (header == nil) {
+        if (error) *error = [SPiDJwtCodec errorWithCode:SPiDJwtMalformedErrorCode description:@"Malformed JWT"];
+        return nil;
+    }
+    // Only accept the algorithm the key is meant for, never "none"
+    if (![[header objectForKey:@"alg"] isEqual:JSON_WEB_ALGORITHM_HS256]) {
+        if (error) *error = [SPiDJwtCodec errorWithCode:SPiDJwtMalformedErrorCode description:@"Unsupported JWT algorithm"];
+        return nil;
+    }
+
+    NSUInteger signedLength = segments[0].length + 1 + segments[1].length;
+    NSData *signedData = [[jwt substringToIndex:signedLength] dataUsingEncoding:NSASCIIStringEncoding];
+    NSData *signature = [NSData sp_dataWithBase64UrlEncodedString:segments[2]];
+    if (signedData == nil || signature == nil || ![self.hmac verifySignature:signature forData:signedData]) {
+        if (error) *error = [SPiDJwtCodec errorWithCode:SPiDJwtInvalidSignatureErrorCode description:@"Invalid JWT signature"];
+        return nil;
+    }
+
+    NSDictionary *claims = [SPiDJwtCodec JSONObjectFromSegment:segments[1]];
+    if (claims == nil) {
+        if (error) *error = [SPiDJwtCodec errorWithCode:SPiDJwtMalformedErrorCode description:@"Malformed JWT claims"];
+        return nil;
+    }
+    id expiration = [claims objectForKey:@"exp"];
+    if (expiration && ![expiration isKindOfClass:[NSNumber class]]) {
+        if (error) *error = [SPiDJwtCodec errorWithCode:SPiDJwtMalformedErrorCode description:@"Malformed JWT expiration time"];
+        return nil;
+    }
+    if (expiration && [expiration doubleValue] + self.expirationLeeway <= [[NSDate date] timeIntervalSince1970]) {
+        if (error) *error = [SPiDJwtCodec errorWithCode:SPiDJwtExpiredErrorCode description:@"Expired JWT"];
+        return nil;
+    }
+    return claims;
+}
+
++ (NSDictionary<NSString *, id> *)unverifiedClaimsFromJwt:(NSString *)jwt {
+    NSArray<NSString *> *segments = [SPiDJwtCodec segmentsOfJwt:jwt];
+    return segments ? [SPiDJwtCodec JSONObjectFromSegment:segments[1]] : nil;
+}
+
+#pragma mark Private methods
+
+///---------------------------------------------------------------------------------------
+/// @name Private methods
+///---------------------------------------------------------------------------------------
+
++ (NSData *)headerSegment {
+    static NSData *headerSegment = nil;
+    static dispatch_once_t predicate;
+    dispatch_once(&predicate, ^{
+        NSString *headerJson = [NSString stringWithFormat:@"{\"alg\":\"%@\",\"typ\":\"%@\"}", JSON_WEB_ALGORITHM_HS256, JSON_WEB_TOKEN_TYP_JWT];
+        NSString *header = [[headerJson dataUsingEncoding:NSUTF8StringEncoding] sp_base64EncodedUrlSafeString];
+        headerSegment = [[header stringByAppendingString:@"."] dataUsingEncoding:NSASCIIStringEncoding];
+    });
+    return headerSegment;
+}
+
++ (NSArray<NSString *> *)segmentsOfJwt:(NSString *)jwt {
+    if (![jwt isKindOfClass:[NSString class]]) {
+        return nil;
+    }
+    NSArray<NSString *> *segments = [jwt componentsSeparatedByString:@"."];
+    return segments.count == 3 ? segments : nil;
+}
+
++ (NSDictionary<NSString *, id> *)JSONObjectFromSegment:(NSString *)segment {
+    NSData *data = [NSData sp_dataWithBase64UrlEncodedString:segment];
+    if (data == nil) {
+        return nil;
+    }
+    id object = [NSJSONSerialization JSONObjectWithData:data options:(NSJSONReadingOptions) 0 error:nil];
+    return [object isKindOfClass:[NSDictionary class]] ? object : nil;
+}
+
++ (NSError *)errorWithCode:(NSInteger)code description:(NSString *)description {
+    return [NSError sp_oauth2ErrorWithCode:code reason:description descriptions:@{@"error": description}];
+}
+
+@end
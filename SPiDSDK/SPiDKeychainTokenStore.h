@@ -0,0 +1,47 @@
+//
+//  SPiDKeychainTokenStore.h
+//  SPiDSDK
+//
+//  Copyright (c) 2012 Schibsted Payment. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "SPiDTokenStore.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/** `SPiDKeychainTokenStore` stores access tokens in the keychain using `SPiDKeychainWrapper`.
+
+ Writes go through the write-behind queue of `SPiDKeychainWrapper`. A store created with a keychain access group
+ shares its tokens with the app extensions in that group, other stores are not affected by it.
+ */
+
+@interface SPiDKeychainTokenStore : NSObject <SPiDTokenStore>
+
+///---------------------------------------------------------------------------------------
+/// @name Properties
+///---------------------------------------------------------------------------------------
+
+/** The keychain access group the tokens are stored in, nil for the private keychain of the app */
+@property (nonatomic, copy, readonly, nullable) NSString *accessGroup;
+
+///---------------------------------------------------------------------------------------
+/// @name Public methods
+///---------------------------------------------------------------------------------------
+
+/** Initializes a store using the private keychain of the app
+
+ @return `SPiDKeychainTokenStore`
+ */
+- (instancetype)init;
+
+/** Initializes a store using a keychain access group
+
+ @param accessGroup The keychain access group, or nil to use the private keychain of the app
+ @return `SPiDKeychainTokenStore`
+ */
+- (instancetype)initWithAccessGroup:(nullable NSString *)accessGroup;
+
+@end
+
+NS_ASSUME_NONNULL_END
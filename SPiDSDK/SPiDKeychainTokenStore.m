@@ -0,0 +1,50 @@
+//
+//  SPiDKeychainTokenStore.m
+//  SPiDSDK
+//
+//  Copyright (c) 2012 Schibsted Payment. All rights reserved.
+//
+
+#import "SPiDKeychainTokenStore.h"
+#import "SPiDKeychainWrapper.h"
+
+@interface SPiDKeychainTokenStore ()
+
+@property (nonatomic, copy, readwrite, nullable) NSString *accessGroup;
+
+@end
+
+@implementation SPiDKeychainTokenStore
+
+- (instancetype)init {
+    return [self initWithAccessGroup:nil];
+}
+
+- (instancetype)initWithAccessGroup:(NSString *)accessGroup {
+    if (self = [super init]) {
+        self.accessGroup = accessGroup;
+    }
+    return self;
+}
+
+- (SPiDAccessToken *)accessTokenForIdentifier:(NSString *)identifier {
+    return [SPiDKeychainWrapper accessTokenFromKeychainForIdentifier:identifier accessGroup:self.accessGroup];
+}
+
+- (NSDictionary<NSString *, SPiDAccessToken *> *)accessTokensWithIdentifierPrefix:(NSString *)prefix {
+    return [SPiDKeychainWrapper accessTokensFromKeychainWithIdentifierPrefix:prefix accessGroup:self.accessGroup];
+}
+
+- (void)storeAccessToken:(SPiDAccessToken *)accessToken forIdentifier:(NSString *)identifier {
+    [SPiDKeychainWrapper storeAccessTokenInBackground:accessToken forIdentifier:identifier accessGroup:self.accessGroup];
+}
+
+- (void)removeAccessTokenForIdentifier:(NSString *)identifier {
+    [SPiDKeychainWrapper removeAccessTokenInBackgroundForIdentifier:identifier accessGroup:self.accessGroup];
+}
+
+- (void)flush {
+    [SPiDKeychainWrapper flushPendingWrites];
+}
+
+@end
@@ -10,22 +10,81 @@
 
 /** `SPiDKeychainWrapper` is a wrapper used to simplfy keychain access.
  It is used by the `SPiDClient` for all keychain operations.
+ All writes are performed on a serial queue. Background writes return immediately and are coalesced, only the latest
+ value for each identifier is written, and reads see pending writes before they reach the keychain.
+ Items can also be stored in a keychain access group, such as one shared by a app and its extensions. Those are kept
+ under a service name derived from the group instead of the bundle identifier, since extensions have their own.
  Note that all keychain items are available in the iPhone simulator to all apps since the application is not signed!
 */
 
+NS_ASSUME_NONNULL_BEGIN
+
+/** Performs the keychain writes of `SPiDKeychainWrapper`, called on its serial write queue */
+@protocol SPiDKeychainWriter <NSObject>
+
+/** Adds or updates a keychain item
+
+ @param accessToken Access token to save
+ @param identifier Unique identification for this keychain item
+ @return YES if successful otherwise NO
+ */
+- (BOOL)writeAccessToken:(SPiDAccessToken *)accessToken forIdentifier:(NSString *)identifier;
+
+/** Deletes a keychain item
+
+ @param identifier Unique identification for this keychain item
+ */
+- (void)deleteAccessTokenForIdentifier:(NSString *)identifier;
+
+@end
+
 @interface SPiDKeychainWrapper : NSObject
 
 ///---------------------------------------------------------------------------------------
 /// @name Public methods
 ///---------------------------------------------------------------------------------------
 
+/** Replaces the keychain writes, used by tests to observe the write queue
+
+ @param writer Performs all writes instead of the keychain, or nil to write to the keychain
+ */
++ (void)setWriter:(nullable id<SPiDKeychainWriter>)writer;
+
 /** Get access token from keychain
  Tries to load the access token from the keychain
 
  @param identifier Unique identification for this keychain item
  @return Access token if available otherwise nil
  */
-+ (SPiDAccessToken *)accessTokenFromKeychainForIdentifier:(NSString *)identifier;
++ (nullable SPiDAccessToken *)accessTokenFromKeychainForIdentifier:(NSString *)identifier;
+
+/** Get access token from a keychain access group
+ Tries to load the access token from the items shared in the access group
+
+ @param identifier Unique identification for this keychain item
+ @param accessGroup The keychain access group, or nil to use the private keychain of the app
+ @return Access token if available otherwise nil
+ */
++ (nullable SPiDAccessToken *)accessTokenFromKeychainForIdentifier:(NSString *)identifier accessGroup:(nullable NSString *)accessGroup;
+
+/** Get all access tokens with a common identifier prefix from keychain
+ Loads all matching items with a single keychain query, a prefix ending with '-' is matched against the label written
+ with every item, which is the identifier up to and including its last '-'. Identifiers with another '-' after such
+ a prefix are not found.
+
+ @param prefix Prefix of the keychain item identifiers
+ @return Access tokens keyed by their identifier
+ */
++ (NSDictionary<NSString *, SPiDAccessToken *> *)accessTokensFromKeychainWithIdentifierPrefix:(NSString *)prefix;
+
+/** Get all access tokens with a common identifier prefix from a keychain access group
+ Loads all matching items with a single keychain query, see `accessTokensFromKeychainWithIdentifierPrefix:`
+
+ @param prefix Prefix of the keychain item identifiers
+ @param accessGroup The keychain access group, or nil to use the private keychain of the app
+ @return Access tokens keyed by their identifier
+ */
++ (NSDictionary<NSString *, SPiDAccessToken *> *)accessTokensFromKeychainWithIdentifierPrefix:(NSString *)prefix accessGroup:(nullable NSString *)accessGroup;
 
 /** Saves access token to keychain
  Tries to save the access token to the keychain
@@ -36,6 +95,49 @@
  */
 + (BOOL)storeInKeychainAccessTokenWithValue:(SPiDAccessToken *)accessToken forIdentifier:(NSString *)identifier;
 
+/** Saves access token to keychain in the background
+ Replaces any pending write for the same identifier
+
+ @param accessToken Access token to save
+ @param identifier Unique identification for this keychain item
+ */
++ (void)storeAccessTokenInBackground:(SPiDAccessToken *)accessToken forIdentifier:(NSString *)identifier;
+
+/** Saves access token to a keychain access group in the background
+ Replaces any pending write for the same identifier in the same access group
+
+ @param accessToken Access token to save
+ @param identifier Unique identification for this keychain item
+ @param accessGroup The keychain access group, or nil to use the private keychain of the app
+ */
++ (void)storeAccessTokenInBackground:(SPiDAccessToken *)accessToken forIdentifier:(NSString *)identifier accessGroup:(nullable NSString *)accessGroup;
+
+/** Remove access token from keychain in the background
+ Replaces any pending write for the same identifier
+
+ @param identifier Unique identification for this keychain item
+ */
++ (void)removeAccessTokenInBackgroundForIdentifier:(NSString *)identifier;
+
+/** Remove access token from a keychain access group in the background
+ Replaces any pending write for the same identifier in the same access group
+
+ @param identifier Unique identification for this keychain item
+ @param accessGroup The keychain access group, or nil to use the private keychain of the app
+ */
++ (void)removeAccessTokenInBackgroundForIdentifier:(NSString *)identifier accessGroup:(nullable NSString *)accessGroup;
+
+/** Performs all pending background writes before returning
+ Should be called before the app is terminated
+ */
++ (void)flushPendingWrites;
+
+/** Number of background writes that have not reached the keychain yet
+
+ @return Number of pending writes
+ */
++ (NSUInteger)pendingWriteCount;
+
 /** Update access token in keychain
  Tries to update the access token in the keychain
 
@@ -52,4 +154,6 @@
  */
 + (void)removeAccessTokenFromKeychainForIdentifier:(NSString *)identifier;
 
-@end
\ No newline at end of file
+@end
+
+NS_ASSUME_NONNULL_END
\ No newline at end of file
@@ -8,25 +8,108 @@
 #import "SPiDKeychainWrapper.h"
 #import "SPiDClient.h"
 
+static NSString *const SPiDPrivateKeychainGroupKey = @"";
+static id<SPiDKeychainWriter> SPiDKeychainWriterOverride = nil;
+
+NS_ASSUME_NONNULL_BEGIN
+
 @interface SPiDKeychainWrapper ()
 
 /** Generates a service name to use for the keychain
 
- The service will have the form 'bundleIdentifier-SPiD'
+ The service will have the form 'bundleIdentifier-SPiD', or 'accessGroup-SPiD' for items in a access group
 
+ @param accessGroup The keychain access group, or nil for the private keychain of the app
  @return Service name
  */
-+ (NSString *)serviceNameForSPiD;
++ (NSString *)serviceNameForAccessGroup:(nullable NSString *)accessGroup;
 
 /** Creates the basic search query used for all keychain operations
 
  @param identifier Unique identifier for the keychain item
+ @param accessGroup The keychain access group, or nil for the private keychain of the app
  @return Query as a `NSMutableDictionary`
   */
-+ (NSMutableDictionary *)setupSearchQueryForIdentifier:(NSString *)identifier;
++ (NSMutableDictionary *)setupSearchQueryForIdentifier:(NSString *)identifier accessGroup:(nullable NSString *)accessGroup;
+
+/** Returns the label stored with a item, the identifier up to and including its last '-'
+
+ The accounts of a `SPiDAccountStore` share a label, so that they are loaded with a query on the label instead of
+ reading every item of the service.
+
+ @param identifier Unique identifier for the keychain item
+ @return Label or nil if the identifier has no '-'
+ */
++ (nullable NSString *)labelForIdentifier:(NSString *)identifier;
+
+/** Decodes a stored access token
+
+ Tokens archived with `NSKeyedArchiver` by earlier versions are stored again in the binary encoding.
+
+ @param data Data read from the keychain
+ @param identifier Unique identification for this keychain item
+ @param accessGroup The keychain access group the item was read from
+ @return Access token or nil if the data could not be decoded
+ */
++ (nullable SPiDAccessToken *)accessTokenFromData:(NSData *)data forIdentifier:(NSString *)identifier accessGroup:(nullable NSString *)accessGroup;
+
+/** Serial queue that performs all keychain writes */
++ (dispatch_queue_t)writeQueue;
+
+/** Writes not yet performed, keyed by access group and then by identifier, `NSNull` marks a removal
+
+ The private keychain uses a empty access group key. Must only be used while synchronized on the returned dictionary.
+ */
++ (NSMutableDictionary<NSString *, NSMutableDictionary<NSString *, id> *> *)pendingWrites;
+
+/** Returns the pending write for a item, must be called while synchronized on `pendingWrites`
+
+ @param identifier Unique identification for this keychain item
+ @param accessGroup The keychain access group, or nil for the private keychain of the app
+ @return Access token, `NSNull` for a removal, or nil if nothing is pending
+ */
++ (nullable id)pendingWriteForIdentifier:(NSString *)identifier accessGroup:(nullable NSString *)accessGroup;
+
+/** Drops the pending write for a item that is about to be written directly
+
+ @param identifier Unique identification for this keychain item
+ @param accessGroup The keychain access group, or nil for the private keychain of the app
+ */
++ (void)discardPendingWriteForIdentifier:(NSString *)identifier accessGroup:(nullable NSString *)accessGroup;
+
+/** Adds a write to the pending writes and schedules them
+
+ @param value Access token or `NSNull` for a removal
+ @param identifier Unique identification for this keychain item
+ @param accessGroup The keychain access group, or nil for the private keychain of the app
+ */
++ (void)enqueueWriteWithValue:(id)value forIdentifier:(NSString *)identifier accessGroup:(nullable NSString *)accessGroup;
+
+/** Performs the pending writes, must be called on the write queue */
++ (void)performPendingWrites;
+
+/** The writer set with `setWriter:`, nil when writing to the keychain */
++ (nullable id<SPiDKeychainWriter>)writer;
+
+/** Adds or updates the keychain item through the writer, must be called on the write queue */
++ (BOOL)performWriteAccessToken:(SPiDAccessToken *)accessToken forIdentifier:(NSString *)identifier accessGroup:(nullable NSString *)accessGroup;
+
+/** Deletes the keychain item through the writer, must be called on the write queue */
++ (void)performDeleteAccessTokenForIdentifier:(NSString *)identifier accessGroup:(nullable NSString *)accessGroup;
+
+/** Updates a existing keychain item */
++ (BOOL)updateAccessTokenInKeychainWithValue:(SPiDAccessToken *)accessToken forIdentifier:(NSString *)identifier accessGroup:(nullable NSString *)accessGroup;
+
+/** Adds or updates the keychain item, must be called on the write queue */
++ (BOOL)writeAccessToken:(SPiDAccessToken *)accessToken forIdentifier:(NSString *)identifier accessGroup:(nullable NSString *)accessGroup;
+
+/** Deletes the keychain item, must be called on the write queue */
++ (void)deleteAccessTokenForIdentifier:(NSString *)identifier accessGroup:(nullable NSString *)accessGroup;
 
 @end
 
+NS_ASSUME_NONNULL_END
+
 @implementation SPiDKeychainWrapper
 
 #pragma mark Public methods
@@ -35,8 +118,26 @@
 /// @name Public methods
 ///---------------------------------------------------------------------------------------
 
-+ (SPiDAccessToken *)accessTokenFromKeychainForIdentifier:(NSString *)identifier; {
-    NSMutableDictionary *query = [self setupSearchQueryForIdentifier:identifier];
++ (void)setWriter:(id<SPiDKeychainWriter>)writer {
+    @synchronized (self) {
+        SPiDKeychainWriterOverride = writer;
+    }
+}
+
++ (SPiDAccessToken *)accessTokenFromKeychainForIdentifier:(NSString *)identifier {
+    return [self accessTokenFromKeychainForIdentifier:identifier accessGroup:nil];
+}
+
++ (SPiDAccessToken *)accessTokenFromKeychainForIdentifier:(NSString *)identifier accessGroup:(NSString *)accessGroup {
+    NSMutableDictionary<NSString *, NSMutableDictionary<NSString *, id> *> *pendingWrites = [self pendingWrites];
+    @synchronized (pendingWrites) {
+        id pending = [self pendingWriteForIdentifier:identifier accessGroup:accessGroup];
+        if (pending) {
+            return (pending == [NSNull null]) ? nil : pending;
+        }
+    }
+
+    NSMutableDictionary *query = [self setupSearchQueryForIdentifier:identifier accessGroup:accessGroup];
 
     // search attributes
     [query setObject:(__bridge id) kCFBooleanTrue forKey:(__bridge id) kSecMatchLimitOne];
@@ -46,7 +147,7 @@
     OSStatus status = SecItemCopyMatching((__bridge CFDictionaryRef) query, &cfData);
     if (status == noErr) {
         NSData *result = (__bridge_transfer NSData *) cfData;
-        SPiDAccessToken *accessToken = [NSKeyedUnarchiver unarchiveObjectWithData:result];
+        SPiDAccessToken *accessToken = [self accessTokenFromData:result forIdentifier:identifier accessGroup:accessGroup];
         return accessToken;
     } else {
         //NSAssert(status == errSecItemNotFound, @"Error reading from keychain");
@@ -54,42 +155,289 @@
     }
 }
 
++ (NSDictionary<NSString *, SPiDAccessToken *> *)accessTokensFromKeychainWithIdentifierPrefix:(NSString *)prefix {
+    return [self accessTokensFromKeychainWithIdentifierPrefix:prefix accessGroup:nil];
+}
+
++ (NSDictionary<NSString *, SPiDAccessToken *> *)accessTokensFromKeychainWithIdentifierPrefix:(NSString *)prefix accessGroup:(NSString *)accessGroup {
+    NSMutableDictionary *query = [[NSMutableDictionary alloc] init];
+    [query setObject:(__bridge id) kSecClassGenericPassword forKey:(__bridge id) kSecClass];
+    [query setObject:[self serviceNameForAccessGroup:accessGroup] forKey:(__bridge id) kSecAttrService];
+    if (accessGroup) {
+        [query setObject:accessGroup forKey:(__bridge id) kSecAttrAccessGroup];
+    }
+
+    if ([prefix hasSuffix:@"-"]) {
+        // Only the items of the prefix are read, instead of every item of the service
+        [query setObject:prefix forKey:(__bridge id) kSecAttrLabel];
+    }
+
+    // search attributes
+    [query setObject:(__bridge id) kSecMatchLimitAll forKey:(__bridge id) kSecMatchLimit];
+    [query setObject:(__bridge id) kCFBooleanTrue forKey:(__bridge id) kSecReturnAttributes];
+    [query setObject:(__bridge id) kCFBooleanTrue forKey:(__bridge id) kSecReturnData];
+
+    NSMutableDictionary<NSString *, SPiDAccessToken *> *accessTokens = [NSMutableDictionary dictionary];
+    CFTypeRef cfItems = nil;
+    OSStatus status = SecItemCopyMatching((__bridge CFDictionaryRef) query, &cfItems);
+    if (status == noErr) {
+        NSArray *items = (__bridge_transfer NSArray *) cfItems;
+        for (NSDictionary *item in items) {
+            NSString *identifier = [item objectForKey:(__bridge id) kSecAttrAccount];
+            NSData *data = [item objectForKey:(__bridge id) kSecValueData];
+            if (![identifier hasPrefix:prefix] || data == nil) {
+                continue;
+            }
+            SPiDAccessToken *accessToken = [self accessTokenFromData:data forIdentifier:identifier accessGroup:accessGroup];
+            if (accessToken) {
+                [accessTokens setObject:accessToken forKey:identifier];
+            }
+        }
+    }
+
+    NSMutableDictionary<NSString *, NSMutableDictionary<NSString *, id> *> *pendingWrites = [self pendingWrites];
+    @synchronized (pendingWrites) {
+        [[pendingWrites objectForKey:accessGroup ?: SPiDPrivateKeychainGroupKey] enumerateKeysAndObjectsUsingBlock:^(NSString *identifier, id pending, BOOL *stop) {
+            if (![identifier hasPrefix:prefix]) {
+                return;
+            }
+            if (pending == [NSNull null]) {
+                [accessTokens removeObjectForKey:identifier];
+            } else {
+                [accessTokens setObject:pending forKey:identifier];
+            }
+        }];
+    }
+    return accessTokens;
+}
+
 + (BOOL)storeInKeychainAccessTokenWithValue:(SPiDAccessToken *)accessToken forIdentifier:(NSString *)identifier {
-    NSData *data = [NSKeyedArchiver archivedDataWithRootObject:accessToken];
-    NSMutableDictionary *query = [self setupSearchQueryForIdentifier:identifier];
+    [self discardPendingWriteForIdentifier:identifier accessGroup:nil];
+    __block BOOL stored;
+    dispatch_sync([self writeQueue], ^{
+        stored = [self performWriteAccessToken:accessToken forIdentifier:identifier accessGroup:nil];
+    });
+    return stored;
+}
+
++ (void)storeAccessTokenInBackground:(SPiDAccessToken *)accessToken forIdentifier:(NSString *)identifier {
+    [self enqueueWriteWithValue:accessToken forIdentifier:identifier accessGroup:nil];
+}
+
++ (void)storeAccessTokenInBackground:(SPiDAccessToken *)accessToken forIdentifier:(NSString *)identifier accessGroup:(NSString *)accessGroup {
+    [self enqueueWriteWithValue:accessToken forIdentifier:identifier accessGroup:accessGroup];
+}
+
++ (void)removeAccessTokenInBackgroundForIdentifier:(NSString *)identifier {
+    [self enqueueWriteWithValue:[NSNull null] forIdentifier:identifier accessGroup:nil];
+}
+
++ (void)removeAccessTokenInBackgroundForIdentifier:(NSString *)identifier accessGroup:(NSString *)accessGroup {
+    [self enqueueWriteWithValue:[NSNull null] forIdentifier:identifier accessGroup:accessGroup];
+}
+
++ (void)flushPendingWrites {
+    dispatch_sync([self writeQueue], ^{
+        [self performPendingWrites];
+    });
+}
+
++ (NSUInteger)pendingWriteCount {
+    NSMutableDictionary<NSString *, NSMutableDictionary<NSString *, id> *> *pendingWrites = [self pendingWrites];
+    @synchronized (pendingWrites) {
+        NSUInteger count = 0;
+        for (NSString *groupKey in pendingWrites) {
+            count += [pendingWrites objectForKey:groupKey].count;
+        }
+        return count;
+    }
+}
+
++ (BOOL)updateAccessTokenInKeychainWithValue:(SPiDAccessToken *)accessToken forIdentifier:(NSString *)identifier {
+    return [self updateAccessTokenInKeychainWithValue:accessToken forIdentifier:identifier accessGroup:nil];
+}
+
++ (void)removeAccessTokenFromKeychainForIdentifier:(NSString *)identifier {
+    [self discardPendingWriteForIdentifier:identifier accessGroup:nil];
+    dispatch_sync([self writeQueue], ^{
+        [self performDeleteAccessTokenForIdentifier:identifier accessGroup:nil];
+    });
+}
+
+#pragma mark Private methods
+
+///---------------------------------------------------------------------------------------
+/// @name Private methods
+///---------------------------------------------------------------------------------------
+
++ (SPiDAccessToken *)accessTokenFromData:(NSData *)data forIdentifier:(NSString *)identifier accessGroup:(NSString *)accessGroup {
+    if ([SPiDAccessToken isSerializedData:data]) {
+        return [[SPiDAccessToken alloc] initWithSerializedData:data];
+    }
+    SPiDAccessToken *accessToken = [NSKeyedUnarchiver unarchiveObjectWithData:data];
+    if ([accessToken isKindOfClass:[SPiDAccessToken class]]) {
+        SPiDDebugLog(@"Migrating archived access token: %@", identifier);
+        [self storeAccessTokenInBackground:accessToken forIdentifier:identifier accessGroup:accessGroup];
+        return accessToken;
+    }
+    return nil;
+}
+
++ (dispatch_queue_t)writeQueue {
+    static dispatch_queue_t queue;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        queue = dispatch_queue_create("com.spid.sdk.keychain", DISPATCH_QUEUE_SERIAL);
+    });
+    return queue;
+}
+
++ (NSMutableDictionary<NSString *, NSMutableDictionary<NSString *, id> *> *)pendingWrites {
+    static NSMutableDictionary<NSString *, NSMutableDictionary<NSString *, id> *> *pendingWrites;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        pendingWrites = [NSMutableDictionary dictionary];
+    });
+    return pendingWrites;
+}
+
++ (id)pendingWriteForIdentifier:(NSString *)identifier accessGroup:(NSString *)accessGroup {
+    return [[[self pendingWrites] objectForKey:accessGroup ?: SPiDPrivateKeychainGroupKey] objectForKey:identifier];
+}
+
++ (void)discardPendingWriteForIdentifier:(NSString *)identifier accessGroup:(NSString *)accessGroup {
+    NSMutableDictionary<NSString *, NSMutableDictionary<NSString *, id> *> *pendingWrites = [self pendingWrites];
+    @synchronized (pendingWrites) {
+        [[pendingWrites objectForKey:accessGroup ?: SPiDPrivateKeychainGroupKey] removeObjectForKey:identifier];
+    }
+}
+
++ (void)enqueueWriteWithValue:(id)value forIdentifier:(NSString *)identifier accessGroup:(NSString *)accessGroup {
+    NSMutableDictionary<NSString *, NSMutableDictionary<NSString *, id> *> *pendingWrites = [self pendingWrites];
+    NSString *groupKey = accessGroup ?: SPiDPrivateKeychainGroupKey;
+    BOOL scheduled = NO;
+    @synchronized (pendingWrites) {
+        // A write that is already pending is replaced, only the latest value reaches the keychain
+        for (NSString *key in pendingWrites) {
+            scheduled = scheduled || [pendingWrites objectForKey:key].count > 0;
+        }
+        NSMutableDictionary<NSString *, id> *groupWrites = [pendingWrites objectForKey:groupKey];
+        if (groupWrites == nil) {
+            groupWrites = [NSMutableDictionary dictionary];
+            [pendingWrites setObject:groupWrites forKey:groupKey];
+        }
+        [groupWrites setObject:value forKey:identifier];
+    }
+    if (!scheduled) {
+        dispatch_async([self writeQueue], ^{
+            [self performPendingWrites];
+        });
+    }
+}
+
++ (void)performPendingWrites {
+    NSMutableDictionary<NSString *, NSMutableDictionary<NSString *, id> *> *pendingWrites = [self pendingWrites];
+    NSMutableDictionary<NSString *, NSDictionary<NSString *, id> *> *writes = [NSMutableDictionary dictionary];
+    @synchronized (pendingWrites) {
+        for (NSString *groupKey in pendingWrites) {
+            [writes setObject:[[pendingWrites objectForKey:groupKey] copy] forKey:groupKey];
+        }
+    }
+    [writes enumerateKeysAndObjectsUsingBlock:^(NSString *groupKey, NSDictionary<NSString *, id> *groupWrites, BOOL *stopGroups) {
+        NSString *accessGroup = [groupKey isEqualToString:SPiDPrivateKeychainGroupKey] ? nil : groupKey;
+        [groupWrites enumerateKeysAndObjectsUsingBlock:^(NSString *identifier, id value, BOOL *stop) {
+            if (value == [NSNull null]) {
+                [self performDeleteAccessTokenForIdentifier:identifier accessGroup:accessGroup];
+            } else {
+                [self performWriteAccessToken:value forIdentifier:identifier accessGroup:accessGroup];
+            }
+        }];
+    }];
+    @synchronized (pendingWrites) {
+        // Writes stay visible to readers until they have reached the keychain, newer values are left for the next pass
+        BOOL remaining = NO;
+        for (NSString *groupKey in pendingWrites) {
+            NSMutableDictionary<NSString *, id> *groupWrites = [pendingWrites objectForKey:groupKey];
+            NSDictionary<NSString *, id> *written = [writes objectForKey:groupKey];
+            for (NSString *identifier in written) {
+                if ([groupWrites objectForKey:identifier] == [written objectForKey:identifier]) {
+                    [groupWrites removeObjectForKey:identifier];
+                }
+            }
+            remaining = remaining || groupWrites.count > 0;
+        }
+        if (remaining) {
+            dispatch_async([self writeQueue], ^{
+                [self performPendingWrites];
+            });
+        }
+    }
+}
+
++ (id<SPiDKeychainWriter>)writer {
+    @synchronized (self) {
+        return SPiDKeychainWriterOverride;
+    }
+}
+
++ (BOOL)performWriteAccessToken:(SPiDAccessToken *)accessToken forIdentifier:(NSString *)identifier accessGroup:(NSString *)accessGroup {
+    id<SPiDKeychainWriter> writer = [self writer];
+    return writer ? [writer writeAccessToken:accessToken forIdentifier:identifier] : [self writeAccessToken:accessToken forIdentifier:identifier accessGroup:accessGroup];
+}
+
++ (void)performDeleteAccessTokenForIdentifier:(NSString *)identifier accessGroup:(NSString *)accessGroup {
+    id<SPiDKeychainWriter> writer = [self writer];
+    if (writer) {
+        [writer deleteAccessTokenForIdentifier:identifier];
+    } else {
+        [self deleteAccessTokenForIdentifier:identifier accessGroup:accessGroup];
+    }
+}
+
++ (BOOL)updateAccessTokenInKeychainWithValue:(SPiDAccessToken *)accessToken forIdentifier:(NSString *)identifier accessGroup:(NSString *)accessGroup {
+    NSData *data = [accessToken serializedData];
+    NSMutableDictionary *searchQuery = [self setupSearchQueryForIdentifier:identifier accessGroup:accessGroup];
+    NSMutableDictionary *updateQuery = [[NSMutableDictionary alloc] init];
 
     // add data
-    [query setObject:data forKey:(__bridge id) kSecValueData];
+    [updateQuery setObject:data forKey:(__bridge id) kSecValueData];
+    NSString *label = [self labelForIdentifier:identifier];
+    if (label) {
+        [updateQuery setObject:label forKey:(__bridge id) kSecAttrLabel];
+    }
 
-    OSStatus status = SecItemAdd((__bridge CFDictionaryRef) query, NULL);
+    OSStatus status = SecItemUpdate((__bridge CFDictionaryRef) searchQuery, (__bridge CFDictionaryRef) updateQuery);
     if (status == errSecSuccess) {
         return YES;
-    } else if (status == errSecDuplicateItem) {
-        return [self updateAccessTokenInKeychainWithValue:accessToken forIdentifier:identifier];
     } else {
-        // TODO: should we throw error instead?
         return NO;
     }
 }
 
-+ (BOOL)updateAccessTokenInKeychainWithValue:(SPiDAccessToken *)accessToken forIdentifier:(NSString *)identifier {
-    NSData *data = [NSKeyedArchiver archivedDataWithRootObject:accessToken];
-    NSMutableDictionary *searchQuery = [self setupSearchQueryForIdentifier:identifier];
-    NSMutableDictionary *updateQuery = [[NSMutableDictionary alloc] init];
++ (BOOL)writeAccessToken:(SPiDAccessToken *)accessToken forIdentifier:(NSString *)identifier accessGroup:(NSString *)accessGroup {
+    NSData *data = [accessToken serializedData];
+    NSMutableDictionary *query = [self setupSearchQueryForIdentifier:identifier accessGroup:accessGroup];
 
     // add data
-    [updateQuery setObject:data forKey:(__bridge id) kSecValueData];
+    [query setObject:data forKey:(__bridge id) kSecValueData];
+    NSString *label = [self labelForIdentifier:identifier];
+    if (label) {
+        [query setObject:label forKey:(__bridge id) kSecAttrLabel];
+    }
 
-    OSStatus status = SecItemUpdate((__bridge CFDictionaryRef) searchQuery, (__bridge CFDictionaryRef) updateQuery);
+    OSStatus status = SecItemAdd((__bridge CFDictionaryRef) query, NULL);
     if (status == errSecSuccess) {
         return YES;
+    } else if (status == errSecDuplicateItem) {
+        return [self updateAccessTokenInKeychainWithValue:accessToken forIdentifier:identifier accessGroup:accessGroup];
     } else {
+        // TODO: should we throw error instead?
         return NO;
     }
 }
 
-+ (void)removeAccessTokenFromKeychainForIdentifier:(NSString *)identifier {
-    NSMutableDictionary *query = [self setupSearchQueryForIdentifier:identifier];
++ (void)deleteAccessTokenForIdentifier:(NSString *)identifier accessGroup:(NSString *)accessGroup {
+    NSMutableDictionary *query = [self setupSearchQueryForIdentifier:identifier accessGroup:accessGroup];
 
     OSStatus status = SecItemDelete((__bridge CFDictionaryRef) query);
     if (status != noErr) {
@@ -97,18 +445,16 @@
     }
 }
 
-#pragma mark Private methods
-
-///---------------------------------------------------------------------------------------
-/// @name Private methods
-///---------------------------------------------------------------------------------------
-
-+ (NSString *)serviceNameForSPiD {
++ (NSString *)serviceNameForAccessGroup:(NSString *)accessGroup {
+    if (accessGroup) {
+        // Extensions have their own bundle identifiers
+        return [NSString stringWithFormat:@"%@-SPiD", accessGroup];
+    }
     NSString *appName = [[NSBundle mainBundle] bundleIdentifier];
     return [NSString stringWithFormat:@"%@-SPiD", appName];
 }
 
-+ (NSMutableDictionary *)setupSearchQueryForIdentifier:(NSString *)identifier {
++ (NSMutableDictionary *)setupSearchQueryForIdentifier:(NSString *)identifier accessGroup:(NSString *)accessGroup {
     NSMutableDictionary *query = [[NSMutableDictionary alloc] init];
 
     [query setObject:(__bridge id) kSecClassGenericPassword forKey:(__bridge id) kSecClass];
@@ -116,9 +462,20 @@
     // set unique identification
     [query setObject:identifier forKey:(__bridge id) kSecAttrGeneric];
     [query setObject:identifier forKey:(__bridge id) kSecAttrAccount];
-    [query setObject:[self serviceNameForSPiD] forKey:(__bridge id) kSecAttrService];
+    [query setObject:[self serviceNameForAccessGroup:accessGroup] forKey:(__bridge id) kSecAttrService];
+    if (accessGroup) {
+        [query setObject:accessGroup forKey:(__bridge id) kSecAttrAccessGroup];
+    }
 
     return query;
 }
 
-@end
\ No newline at end of file
++ (NSString *)labelForIdentifier:(NSString *)identifier {
+    NSRange range = [identifier rangeOfString:@"-" options:NSBackwardsSearch];
+    if (range.location == NSNotFound) {
+        return nil;
+    }
+    return [identifier substringToIndex:NSMaxRange(range)];
+}
+
+@end
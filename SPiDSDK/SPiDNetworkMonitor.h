@@ -0,0 +1,52 @@
+//
+//  SPiDNetworkMonitor.h
+//  SPiDSDK
+//
+//  Copyright (c) 2012 Schibsted Payment. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/** `SPiDNetworkMonitor` reports when the device has a usable network path again.
+
+ The path is observed with `nw_path_monitor` on iOS 12, tvOS 12 and watchOS 5 and later. On earlier systems the
+ monitor never reports, requests journaled while offline are then replayed when another request reaches SPiD.
+ */
+
+@interface SPiDNetworkMonitor : NSObject
+
+///---------------------------------------------------------------------------------------
+/// @name Properties
+///---------------------------------------------------------------------------------------
+
+/** YES if the last reported path could be used to send requests */
+@property (atomic, assign, readonly, getter=isSatisfied) BOOL satisfied;
+
+///---------------------------------------------------------------------------------------
+/// @name Public methods
+///---------------------------------------------------------------------------------------
+
+/** Initializes a monitor, the network path is observed once `start` is called
+
+ @param reachableHandler Called on a background queue when the path becomes usable, also for the first path reported
+ @return `SPiDNetworkMonitor`
+ */
+- (instancetype)initWithReachableHandler:(dispatch_block_t)reachableHandler;
+
+/** Starts observing the network path, does nothing on systems without path monitoring */
+- (void)start;
+
+/** Records a path update, called by the path monitor and by tests to simulate connectivity changes
+
+ @param satisfied YES if the path can be used to send requests
+ */
+- (void)pathDidUpdateWithSatisfied:(BOOL)satisfied;
+
+/** Stops observing the network path, the handler is not called after this */
+- (void)cancel;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,76 @@
+//
+//  SPiDNetworkMonitor.m
+//  SPiDSDK
+//
+//  Copyright (c) 2012 Schibsted Payment. All rights reserved.
+//
+
+#import "SPiDNetworkMonitor.h"
+#import "SPiDClient.h"
+#import <Network/Network.h>
+
+@interface SPiDNetworkMonitor ()
+
+@property (atomic, assign, readwrite, getter=isSatisfied) BOOL satisfied;
+@property (atomic, copy, nullable) dispatch_block_t reachableHandler;
+@property (nonatomic, strong) dispatch_queue_t queue;
+// nw_path_monitor_t, typed as id since the type is not available on all supported systems
+@property (nonatomic, strong, nullable) id pathMonitor;
+
+@end
+
+@implementation SPiDNetworkMonitor
+
+- (instancetype)initWithReachableHandler:(dispatch_block_t)reachableHandler {
+    if (self = [super init]) {
+        self.reachableHandler = reachableHandler;
+        self.queue = dispatch_queue_create("com.schibsted.spid.networkmonitor", DISPATCH_QUEUE_SERIAL);
+    }
+    return self;
+}
+
+- (void)start {
+    if (@available(iOS 12.0, tvOS 12.0, watchOS 5.0, *)) {
+        if (self.pathMonitor || self.reachableHandler == nil) {
+            return;
+        }
+        nw_path_monitor_t pathMonitor = nw_path_monitor_create();
+        __weak SPiDNetworkMonitor *weakSelf = self;
+        nw_path_monitor_set_update_handler(pathMonitor, ^(nw_path_t path) {
+            [weakSelf pathDidUpdateWithSatisfied:nw_path_get_status(path) == nw_path_status_satisfied];
+        });
+        nw_path_monitor_set_queue(pathMonitor, self.queue);
+        nw_path_monitor_start(pathMonitor);
+        self.pathMonitor = pathMonitor;
+    }
+}
+
+- (void)dealloc {
+    [self cancel];
+}
+
+- (void)pathDidUpdateWithSatisfied:(BOOL)satisfied {
+    dispatch_block_t reachableHandler = nil;
+    @synchronized (self) {
+        if (satisfied && !self.satisfied) {
+            reachableHandler = self.reachableHandler;
+        }
+        self.satisfied = satisfied;
+    }
+    if (reachableHandler) {
+        SPiDDebugLog(@"Network path is usable again");
+        reachableHandler();
+    }
+}
+
+- (void)cancel {
+    self.reachableHandler = nil;
+    if (@available(iOS 12.0, tvOS 12.0, watchOS 5.0, *)) {
+        if (self.pathMonitor) {
+            nw_path_monitor_cancel((nw_path_monitor_t) self.pathMonitor);
+            self.pathMonitor = nil;
+        }
+    }
+}
+
+@end
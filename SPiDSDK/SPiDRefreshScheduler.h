@@ -0,0 +1,109 @@
+//
+//  SPiDRefreshScheduler.h
+//  SPiDSDK
+//
+//  Copyright (c) 2012 Schibsted Payment. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+@class SPiDAccessToken;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/** Refreshes a token, must call the completion block with the new token, or nil if the refresh failed */
+typedef void (^SPiDRefreshHandler)(NSString *identifier, SPiDAccessToken *accessToken, void (^completion)(SPiDAccessToken * __nullable refreshedToken));
+
+/** `SPiDRefreshScheduler` refreshes a large number of tokens ahead of their expiry.
+
+ Tokens are kept in a hierarchical timer wheel, four levels of 64 slots where every level covers 64 times the range of
+ the one below, so scheduling and cancelling are O(1) whatever the number of tokens. Each refresh is due
+ `refreshAhead` before the token expires, moved earlier by a random part of `jitter` so that tokens issued together
+ are not all refreshed in the same tick. Due refreshes wait in a queue until one of the `maximumConcurrentRefreshes`
+ slots is free. A refreshed token is scheduled again. A failed refresh is retried after `retryInterval`, doubled with
+ every failure in a row up to `maximumRetryInterval`.
+ */
+
+@interface SPiDRefreshScheduler : NSObject
+
+///---------------------------------------------------------------------------------------
+/// @name Properties
+///---------------------------------------------------------------------------------------
+
+/** How long before expiry a token is refreshed, defaults to 60 seconds */
+@property (atomic, assign) NSTimeInterval refreshAhead;
+
+/** Largest random amount a refresh is moved earlier, defaults to 30 seconds */
+@property (atomic, assign) NSTimeInterval jitter;
+
+/** Most refreshes running at the same time, defaults to 4 */
+@property (atomic, assign) NSUInteger maximumConcurrentRefreshes;
+
+/** Delay before the first retry of a failed refresh, defaults to 5 seconds */
+@property (atomic, assign) NSTimeInterval retryInterval;
+
+/** Largest delay between retries of a failed refresh, defaults to 5 minutes */
+@property (atomic, assign) NSTimeInterval maximumRetryInterval;
+
+/** Resolution of the timer wheel */
+@property (nonatomic, assign, readonly) NSTimeInterval tickInterval;
+
+/** Number of tokens waiting for their refresh, scheduled or due */
+@property (nonatomic, assign, readonly) NSUInteger queueDepth;
+
+/** Number of refreshes that are due but waiting for a free slot */
+@property (nonatomic, assign, readonly) NSUInteger readyCount;
+
+/** Number of refreshes currently running */
+@property (nonatomic, assign, readonly) NSUInteger inFlightCount;
+
+/** Largest delay between the time a refresh was due and the time it was started */
+@property (nonatomic, assign, readonly) NSTimeInterval maximumLateness;
+
+/** Average delay between the time a refresh was due and the time it was started */
+@property (nonatomic, assign, readonly) NSTimeInterval averageLateness;
+
+///---------------------------------------------------------------------------------------
+/// @name Public methods
+///---------------------------------------------------------------------------------------
+
+/** Initializes a scheduler
+
+ @param tickInterval Resolution of the timer wheel, for example 1 second
+ @param refreshHandler Called on a background queue for every due refresh
+ @return `SPiDRefreshScheduler`
+ */
+- (instancetype)initWithTickInterval:(NSTimeInterval)tickInterval refreshHandler:(SPiDRefreshHandler)refreshHandler;
+
+/** Schedules the refresh of a token, replacing any refresh scheduled for the same identifier
+
+ @param accessToken The token to refresh
+ @param identifier Unique identification of the token
+ */
+- (void)scheduleAccessToken:(SPiDAccessToken *)accessToken forIdentifier:(NSString *)identifier;
+
+/** Cancels a scheduled refresh
+
+ A refresh that is already running still calls its completion, but the refreshed token is not scheduled again.
+
+ @param identifier Unique identification of the token
+ */
+- (void)cancelRefreshForIdentifier:(NSString *)identifier;
+
+/** Starts a timer that advances the wheel every `tickInterval` */
+- (void)start;
+
+/** Stops the timer */
+- (void)stop;
+
+/** Advances the wheel to the given time and starts the refreshes that have become due
+
+ Called by the timer, can be called directly to drive the scheduler with a simulated clock.
+
+ @param date The current time
+ */
+- (void)advanceToDate:(NSDate *)date;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,372 @@
+//
+//  SPiDRefreshScheduler.m
+//  SPiDSDK
+//
+//  Copyright (c) 2012 Schibsted Payment. All rights reserved.
+//
+
+#import "SPiDRefreshScheduler.h"
+#import "SPiDAccessToken.h"
+#import "SPiDClient.h"
+
+static const NSUInteger SPiDWheelLevels = 4;
+static const NSUInteger SPiDWheelBits = 6;
+static const NSUInteger SPiDWheelSlots = 1 << SPiDWheelBits;
+static const uint64_t SPiDWheelSlotMask = SPiDWheelSlots - 1;
+
+static const NSTimeInterval SPiDDefaultRefreshAhead = 60.0;
+static const NSTimeInterval SPiDDefaultRefreshJitter = 30.0;
+static const NSUInteger SPiDDefaultMaximumConcurrentRefreshes = 4;
+static const NSTimeInterval SPiDDefaultRefreshRetryInterval = 5.0;
+static const NSTimeInterval SPiDDefaultMaximumRefreshRetryInterval = 300.0;
+
+/** A scheduled refresh */
+@interface SPiDRefreshEntry : NSObject {
+@public
+    NSString *_identifier;
+    SPiDAccessToken *_accessToken;
+    NSTimeInterval _dueTime;
+    uint64_t _dueTick;
+    /** Number of refreshes of this token that have failed in a row */
+    NSUInteger _failureCount;
+    BOOL _cancelled;
+}
+@end
+
+@implementation SPiDRefreshEntry
+@end
+
+@interface SPiDRefreshScheduler ()
+
+/** Runs all ticks up to the given time and starts the refreshes that became due */
+- (void)advanceOnQueueToTime:(NSTimeInterval)time;
+
+/** Puts an entry in the wheel slot for its due tick, or in the ready queue if it is already due */
+- (void)insertEntry:(SPiDRefreshEntry *)entry;
+
+/** Advances the wheel by one tick, cascading entries from the higher levels */
+- (void)tick;
+
+/** Starts ready refreshes while there are free slots */
+- (void)startReadyRefreshes;
+
+/** Called on the queue when a refresh has completed */
+- (void)completeRefreshForEntry:(SPiDRefreshEntry *)entry withAccessToken:(SPiDAccessToken *)accessToken;
+
+/** Schedules a failed refresh again after a delay that doubles with every failure, up to `maximumRetryInterval` */
+- (void)retryRefreshForEntry:(SPiDRefreshEntry *)entry;
+
+/** Current time on the clock of the wheel, the time of the last advance plus the time elapsed since then */
+- (NSTimeInterval)now;
+
+@property (nonatomic, assign, readwrite) NSTimeInterval tickInterval;
+@property (nonatomic, copy) SPiDRefreshHandler refreshHandler;
+@property (nonatomic, strong) dispatch_queue_t queue;
+@property (nonatomic, strong) dispatch_source_t timer;
+/** Slots of all levels, level * `SPiDWheelSlots` + slot */
+@property (nonatomic, copy) NSArray<NSMutableArray<SPiDRefreshEntry *> *> *slots;
+@property (nonatomic, strong) NSMutableDictionary<NSString *, SPiDRefreshEntry *> *entries;
+/** Entries whose refresh handler is running, marked cancelled if they are cancelled meanwhile */
+@property (nonatomic, strong) NSMutableDictionary<NSString *, SPiDRefreshEntry *> *runningEntries;
+@property (nonatomic, strong) NSMutableArray<SPiDRefreshEntry *> *readyEntries;
+@property (nonatomic, assign) uint64_t currentTick;
+@property (nonatomic, assign) NSTimeInterval currentTime;
+/** System uptime at the last advance, keeps `now` moving between ticks whether the clock is real or simulated */
+@property (nonatomic, assign) NSTimeInterval currentUptime;
+@property (nonatomic, assign) NSUInteger runningCount;
+@property (nonatomic, assign) NSUInteger startedCount;
+@property (nonatomic, assign) NSTimeInterval totalLateness;
+@property (nonatomic, assign) NSTimeInterval worstLateness;
+
+@end
+
+@implementation SPiDRefreshScheduler
+
+- (instancetype)initWithTickInterval:(NSTimeInterval)tickInterval refreshHandler:(SPiDRefreshHandler)refreshHandler {
+    if (self = [super init]) {
+        self.tickInterval = tickInterval;
+        self.refreshHandler = refreshHandler;
+        self.refreshAhead = SPiDDefaultRefreshAhead;
+        self.jitter = SPiDDefaultRefreshJitter;
+        self.maximumConcurrentRefreshes = SPiDDefaultMaximumConcurrentRefreshes;
+        self.retryInterval = SPiDDefaultRefreshRetryInterval;
+        self.maximumRetryInterval = SPiDDefaultMaximumRefreshRetryInterval;
+        self.queue = dispatch_queue_create("com.spid.sdk.refreshscheduler", DISPATCH_QUEUE_SERIAL);
+
+        NSMutableArray *slots = [NSMutableArray arrayWithCapacity:SPiDWheelLevels * SPiDWheelSlots];
+        for (NSUInteger i = 0; i < SPiDWheelLevels * SPiDWheelSlots; i++) {
+            [slots addObject:[NSMutableArray array]];
+        }
+        self.slots = slots;
+        self.entries = [NSMutableDictionary dictionary];
+        self.runningEntries = [NSMutableDictionary dictionary];
+        self.readyEntries = [NSMutableArray array];
+        self.currentTime = [NSDate timeIntervalSinceReferenceDate];
+        self.currentUptime = [NSProcessInfo processInfo].systemUptime;
+        self.currentTick = (uint64_t) (self.currentTime / tickInterval);
+    }
+    return self;
+}
+
+- (void)dealloc {
+    if (_timer) {
+        dispatch_source_cancel(_timer);
+    }
+}
+
+- (NSUInteger)queueDepth {
+    __block NSUInteger depth;
+    dispatch_sync(self.queue, ^{
+        depth = self.entries.count;
+    });
+    return depth;
+}
+
+- (NSUInteger)readyCount {
+    __block NSUInteger count = 0;
+    dispatch_sync(self.queue, ^{
+        for (SPiDRefreshEntry *entry in self.readyEntries) {
+            count += entry->_cancelled ? 0 : 1;
+        }
+    });
+    return count;
+}
+
+- (NSUInteger)inFlightCount {
+    __block NSUInteger count;
+    dispatch_sync(self.queue, ^{
+        count = self.runningCount;
+    });
+    return count;
+}
+
+- (NSTimeInterval)maximumLateness {
+    __block NSTimeInterval lateness;
+    dispatch_sync(self.queue, ^{
+        lateness = self.worstLateness;
+    });
+    return lateness;
+}
+
+- (NSTimeInterval)averageLateness {
+    __block NSTimeInterval lateness;
+    dispatch_sync(self.queue, ^{
+        lateness = self.startedCount > 0 ? self.totalLateness / self.startedCount : 0;
+    });
+    return lateness;
+}
+
+- (void)scheduleAccessToken:(SPiDAccessToken *)accessToken forIdentifier:(NSString *)identifier {
+    NSTimeInterval jitter = self.jitter * ((double) arc4random() / UINT32_MAX);
+    NSTimeInterval dueTime = [accessToken.expiresAt timeIntervalSinceReferenceDate] - self.refreshAhead - jitter;
+    dispatch_sync(self.queue, ^{
+        SPiDRefreshEntry *previous = self.entries[identifier];
+        if (previous) {
+            previous->_cancelled = YES;
+        }
+
+        SPiDRefreshEntry *entry = [[SPiDRefreshEntry alloc] init];
+        entry->_identifier = [identifier copy];
+        entry->_accessToken = accessToken;
+        entry->_dueTime = dueTime;
+        entry->_dueTick = dueTime > 0 ? (uint64_t) ceil(dueTime / self.tickInterval) : 0;
+        self.entries[entry->_identifier] = entry;
+        [self insertEntry:entry];
+        [self startReadyRefreshes];
+    });
+}
+
+- (void)cancelRefreshForIdentifier:(NSString *)identifier {
+    dispatch_sync(self.queue, ^{
+        // Cancelled entries are dropped when their slot is reached
+        SPiDRefreshEntry *entry = self.entries[identifier];
+        if (entry) {
+            entry->_cancelled = YES;
+            [self.entries removeObjectForKey:identifier];
+        }
+        // A running refresh still completes, but is not scheduled again
+        SPiDRefreshEntry *runningEntry = self.runningEntries[identifier];
+        if (runningEntry) {
+            runningEntry->_cancelled = YES;
+        }
+    });
+}
+
+- (void)start {
+    dispatch_sync(self.queue, ^{
+        if (self.timer) {
+            return;
+        }
+        self.timer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, self.queue);
+        uint64_t interval = (uint64_t) (self.tickInterval * NSEC_PER_SEC);
+        dispatch_source_set_timer(self.timer, dispatch_time(DISPATCH_TIME_NOW, (int64_t) interval), interval, interval / 10);
+        __weak SPiDRefreshScheduler *weakSelf = self;
+        dispatch_source_set_event_handler(self.timer, ^{
+            SPiDRefreshScheduler *strongSelf = weakSelf;
+            [strongSelf advanceOnQueueToTime:[NSDate timeIntervalSinceReferenceDate]];
+        });
+        dispatch_resume(self.timer);
+    });
+}
+
+- (void)stop {
+    dispatch_sync(self.queue, ^{
+        if (self.timer) {
+            dispatch_source_cancel(self.timer);
+            self.timer = nil;
+        }
+    });
+}
+
+- (void)advanceToDate:(NSDate *)date {
+    dispatch_sync(self.queue, ^{
+        [self advanceOnQueueToTime:[date timeIntervalSinceReferenceDate]];
+    });
+}
+
+#pragma mark Private methods
+
+///---------------------------------------------------------------------------------------
+/// @name Private methods
+///---------------------------------------------------------------------------------------
+
+- (void)advanceOnQueueToTime:(NSTimeInterval)time {
+    if (time < self.currentTime) {
+        return;
+    }
+    self.currentTime = time;
+    self.currentUptime = [NSProcessInfo processInfo].systemUptime;
+    uint64_t targetTick = (uint64_t) (time / self.tickInterval);
+    while (self.currentTick < targetTick) {
+        [self tick];
+    }
+    [self startReadyRefreshes];
+}
+
+- (void)insertEntry:(SPiDRefreshEntry *)entry {
+    uint64_t currentTick = self.currentTick;
+    if (entry->_dueTick <= currentTick) {
+        [self.readyEntries addObject:entry];
+        return;
+    }
+
+    uint64_t due = entry->_dueTick;
+    uint64_t delta = due - currentTick;
+    uint64_t range = 1ull << (SPiDWheelBits * SPiDWheelLevels);
+    if (delta >= range) {
+        // Beyond the wheel, parked in the last slot reachable from now and cascaded again from there
+        due = currentTick + range - 1;
+        delta = range - 1;
+    }
+    for (NSUInteger level = 0; level < SPiDWheelLevels; level++) {
+        if (delta < (1ull << (SPiDWheelBits * (level + 1)))) {
+            NSUInteger slot = (NSUInteger) ((due >> (SPiDWheelBits * level)) & SPiDWheelSlotMask);
+            [self.slots[level * SPiDWheelSlots + slot] addObject:entry];
+            return;
+        }
+    }
+}
+
+- (void)tick {
+    uint64_t tick = ++self.currentTick;
+
+    // A higher level slot is emptied into the lower levels when all the bits below it wrap around
+    for (NSUInteger level = 1; level < SPiDWheelLevels; level++) {
+        if ((tick & ((1ull << (SPiDWheelBits * level)) - 1)) != 0) {
+            break;
+        }
+        NSUInteger index = level * SPiDWheelSlots + (NSUInteger) ((tick >> (SPiDWheelBits * level)) & SPiDWheelSlotMask);
+        NSArray<SPiDRefreshEntry *> *entries = [self.slots[index] copy];
+        [self.slots[index] removeAllObjects];
+        for (SPiDRefreshEntry *entry in entries) {
+            if (!entry->_cancelled) {
+                [self insertEntry:entry];
+            }
+        }
+    }
+
+    NSMutableArray<SPiDRefreshEntry *> *slot = self.slots[(NSUInteger) (tick & SPiDWheelSlotMask)];
+    if (slot.count == 0) {
+        return;
+    }
+    NSArray<SPiDRefreshEntry *> *entries = [slot copy];
+    [slot removeAllObjects];
+    for (SPiDRefreshEntry *entry in entries) {
+        if (!entry->_cancelled) {
+            [self insertEntry:entry];
+        }
+    }
+}
+
+- (void)startReadyRefreshes {
+    while (self.runningCount < self.maximumConcurrentRefreshes && self.readyEntries.count > 0) {
+        SPiDRefreshEntry *entry = self.readyEntries.firstObject;
+        [self.readyEntries removeObjectAtIndex:0];
+        if (entry->_cancelled) {
+            continue;
+        }
+        [self.entries removeObjectForKey:entry->_identifier];
+        self.runningEntries[entry->_identifier] = entry;
+
+        // Started now, which is later than the last tick if the refresh waited for a slot to be freed
+        NSTimeInterval lateness = MAX([self now] - entry->_dueTime, 0);
+        self.startedCount++;
+        self.totalLateness += lateness;
+        self.worstLateness = MAX(self.worstLateness, lateness);
+        self.runningCount++;
+
+        SPiDRefreshHandler refreshHandler = self.refreshHandler;
+        dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_LOW, 0), ^{
+            refreshHandler(entry->_identifier, entry->_accessToken, ^(SPiDAccessToken *refreshedToken) {
+                dispatch_async(self.queue, ^{
+                    [self completeRefreshForEntry:entry withAccessToken:refreshedToken];
+                });
+            });
+        });
+    }
+}
+
+- (void)completeRefreshForEntry:(SPiDRefreshEntry *)entry withAccessToken:(SPiDAccessToken *)accessToken {
+    self.runningCount--;
+    if (self.runningEntries[entry->_identifier] == entry) {
+        [self.runningEntries removeObjectForKey:entry->_identifier];
+    }
+    if (accessToken == nil) {
+        SPiDDebugLog(@"Scheduled refresh failed for: %@", entry->_identifier);
+        [self retryRefreshForEntry:entry];
+    } else if (!entry->_cancelled && self.entries[entry->_identifier] == nil) {
+        // Neither cancelled nor rescheduled while running
+        NSTimeInterval jitter = self.jitter * ((double) arc4random() / UINT32_MAX);
+        SPiDRefreshEntry *next = [[SPiDRefreshEntry alloc] init];
+        next->_identifier = entry->_identifier;
+        next->_accessToken = accessToken;
+        next->_dueTime = [accessToken.expiresAt timeIntervalSinceReferenceDate] - self.refreshAhead - jitter;
+        next->_dueTick = next->_dueTime > 0 ? (uint64_t) ceil(next->_dueTime / self.tickInterval) : 0;
+        self.entries[next->_identifier] = next;
+        [self insertEntry:next];
+    }
+    [self startReadyRefreshes];
+}
+
+- (void)retryRefreshForEntry:(SPiDRefreshEntry *)entry {
+    if (entry->_cancelled || self.entries[entry->_identifier] != nil) {
+        // Cancelled or rescheduled with a new token while running
+        return;
+    }
+    NSUInteger failureCount = entry->_failureCount + 1;
+    NSTimeInterval delay = MIN(self.retryInterval * pow(2, MIN(failureCount - 1, 32)), self.maximumRetryInterval);
+    SPiDRefreshEntry *next = [[SPiDRefreshEntry alloc] init];
+    next->_identifier = entry->_identifier;
+    next->_accessToken = entry->_accessToken;
+    next->_failureCount = failureCount;
+    next->_dueTime = [self now] + delay;
+    next->_dueTick = (uint64_t) ceil(next->_dueTime / self.tickInterval);
+    self.entries[next->_identifier] = next;
+    [self insertEntry:next];
+}
+
+- (NSTimeInterval)now {
+    return self.currentTime + MAX([NSProcessInfo processInfo].systemUptime - self.currentUptime, 0);
+}
+
+@end
@@ -7,6 +7,7 @@
 
 #import <Foundation/Foundation.h>
 #import "SPiDClient.h"
+#import "SPiDRequestScheduler.h"
 
 /** `SPiDRequest` handles a request against SPiD. */
 
@@ -24,11 +25,36 @@ NS_ASSUME_NONNULL_BEGIN
 @property (nonatomic, strong, readonly) NSString *HTTPBody;
 @property (nonatomic, assign) NSInteger retryCount;
 
+/** Called with the response when the request is finished, also used by the client to report failed token refreshes */
+@property (nonatomic, copy, readonly, nullable) void (^completionHandler)(SPiDResponse *response);
+
+/** The client the request is sent for, its server, tokens and token refreshes are used
+
+ Set by the factory methods taking a client, defaults to `+[SPiDClient sharedInstance]`.
+ */
+@property (nonatomic, strong) SPiDClient *client;
+
+/** Stores the request in the offline journal if it fails because the device is offline
+
+ The request is replayed with the current access token once SPiD can be reached again. Only used for requests started
+ with `startRequestWithAccessToken` and when `SPiDClient.journalsOfflineRequests` is enabled. The completion handler is
+ still called with the original error, it is not called again when the request is replayed.
+
+ A POST that timed out or lost its connection is not journaled, since SPiD may already have handled it.
+ */
+@property (nonatomic, assign, getter=isDurable) BOOL durable;
+
+/** How urgently the request needs to be sent, defaults to `SPiDRequestDeferralNone`
+
+ Deferrable requests are held back and sent together with the next request that is not deferrable.
+ */
+@property (nonatomic, assign) SPiDRequestDeferral deferral;
+
 ///---------------------------------------------------------------------------------------
 /// @name Public methods
 ///---------------------------------------------------------------------------------------
 
-/** Creates a GET `SPiDRequest`
+/** Creates a GET `SPiDRequest` for the singleton client
 
  @param requestPath API path for GET request e.g. /user
  @param completionHandler Completion handler run after request is finished, will be called on the main thread.
@@ -36,7 +62,7 @@ NS_ASSUME_NONNULL_BEGIN
 */
 + (instancetype)apiGetRequestWithPath:(NSString *)requestPath completionHandler:(void (^)(SPiDResponse * response))completionHandler;
 
-/** Creates a POST `SPiDRequest`
+/** Creates a POST `SPiDRequest` for the singleton client
 
  @param requestPath API path for POST request e.g. /user
  @param body The HTTP body
@@ -45,7 +71,7 @@ NS_ASSUME_NONNULL_BEGIN
 */
 + (instancetype)apiPostRequestWithPath:(NSString *)requestPath body:(nullable NSDictionary *)body completionHandler:(void (^)(SPiDResponse *response))completionHandler;
 
-/** Creates a `SPiDRequest`
+/** Creates a `SPiDRequest` for the singleton client
 
  @param requestPath API path for request
  @param method HTTP method for the request
@@ -55,15 +81,69 @@ NS_ASSUME_NONNULL_BEGIN
 */
 + (instancetype)requestWithPath:( NSString *)requestPath method:(nullable NSString *)method body:(nullable NSDictionary *)body completionHandler:(void (^ __nullable)(SPiDResponse * response))completionHandler;
 
+/** Creates a GET `SPiDRequest` bound to a client
+
+ @param client The client the request is sent for
+ @param requestPath API path for GET request e.g. /user
+ @param completionHandler Completion handler run after request is finished, will be called on the main thread.
+ @return `SPiDRequest`
+ */
++ (instancetype)apiGetRequestWithClient:(SPiDClient *)client path:(NSString *)requestPath completionHandler:(void (^)(SPiDResponse *response))completionHandler;
+
+/** Creates a POST `SPiDRequest` bound to a client
+
+ @param client The client the request is sent for
+ @param requestPath API path for POST request e.g. /user
+ @param body The HTTP body
+ @param completionHandler Completion handler run after request is finished, will be called on the main thread.
+ @return `SPiDRequest`
+ */
++ (instancetype)apiPostRequestWithClient:(SPiDClient *)client path:(NSString *)requestPath body:(nullable NSDictionary *)body completionHandler:(void (^)(SPiDResponse *response))completionHandler;
+
+/** Creates a `SPiDRequest` bound to a client
+
+ @param client The client the request is sent for
+ @param requestPath API path for request
+ @param method HTTP method for the request
+ @param body HTTP body, used if method is POST
+ @param completionHandler Completion handler run after request is finished, will be called on the main thread.
+ @return `SPiDRequest`
+ */
++ (instancetype)requestWithClient:(SPiDClient *)client path:(NSString *)requestPath method:(nullable NSString *)method body:(nullable NSDictionary *)body completionHandler:(void (^ __nullable)(SPiDResponse *response))completionHandler;
+
 /** Runs the request with the current access token */
 - (void)startRequestWithAccessToken; //TODO rename
 
+/** Runs the request with the client token
+
+ @see `SPiDClient.clientAccessToken`
+ */
+- (void)startRequestWithClientToken;
+
 /** Runs the request without access token */
 - (void)start;
 
 /** Runs a SPiDRequest for a given NSURLRequest */
 - (void)startWithRequest:(NSURLRequest *)request;
 
+///---------------------------------------------------------------------------------------
+/// @name Journal
+///---------------------------------------------------------------------------------------
+
+/** Creates a request from a offline journal record
+
+ @param record Record created by `journalRecord`
+ @param completionHandler Completion handler run after request is finished
+ @return `SPiDRequest` or nil if the record is invalid
+ */
++ (nullable instancetype)requestWithJournalRecord:(NSDictionary *)record completionHandler:(void (^ __nullable)(SPiDResponse *response))completionHandler;
+
+/** Describes the request without access token so that it can be stored in the offline journal
+
+ @return Dictionary containing URL, method and body
+ */
+- (NSDictionary *)journalRecord;
+
 @end
 
 NS_ASSUME_NONNULL_END
@@ -10,6 +10,11 @@
 #import "SPiDResponse.h"
 #import "NSError+SPiD.h"
 #import "NSURLRequest+SPiD.h"
+#import "SPiDConfiguration.h"
+
+static NSString *const SPiDRequestJournalURLKey = @"url";
+static NSString *const SPiDRequestJournalMethodKey = @"method";
+static NSString *const SPiDRequestJournalBodyKey = @"body";
 
 NS_ASSUME_NONNULL_BEGIN
 
@@ -17,30 +22,33 @@ NS_ASSUME_NONNULL_BEGIN
 
 /** Initializes a GET `SPiDRequest`
 
+ @param client The client the request is sent for
  @param requestPath Path to endpoint
  @param completionHandler Called on request completion or error
  @return `SPiDRequest`
 */
-- (id)initGetRequestWithPath:(NSString *)requestPath completionHandler:(void (^)(SPiDResponse *response))completionHandler;
+- (id)initGetRequestWithClient:(SPiDClient *)client path:(NSString *)requestPath completionHandler:(void (^)(SPiDResponse *response))completionHandler;
 
 /** Initializes a POST `SPiDRequest`
 
+ @param client The client the request is sent for
  @param requestPath Path to endpoint
  @param body The post body
  @param completionHandler Called on request completion or error
  @return `SPiDRequest`
 */
-- (id)initPostRequestWithPath:(NSString *)requestPath body:(NSDictionary *)body completionHandler:(void (^)(SPiDResponse *response))completionHandler;
+- (id)initPostRequestWithClient:(SPiDClient *)client path:(NSString *)requestPath body:(nullable NSDictionary *)body completionHandler:(void (^)(SPiDResponse *response))completionHandler;
 
 /** Initializes a `SPiDRequest`
 
+ @param client The client the request is sent for
  @param requestPath Path to endpoint
  @param method Http request method
  @param body The post body
  @param completionHandler Called on request completion or error
  @return `SPiDRequest`
 */
-- (id)initRequestWithPath:(NSString *)requestPath method:(NSString *)method body:(nullable NSDictionary *)body completionHandler:(void (^)(SPiDResponse *response))completionHandler;
+- (id)initRequestWithClient:(SPiDClient *)client path:(NSString *)requestPath method:(nullable NSString *)method body:(nullable NSDictionary *)body completionHandler:(void (^ __nullable)(SPiDResponse *response))completionHandler;
 
 /** Starts a SPiD request
 
@@ -49,10 +57,29 @@ NS_ASSUME_NONNULL_BEGIN
  */
 - (void)startWithRequest:(NSURLRequest *)request;
 
+/** Runs the request with the given token added as oauth_token
+
+ @param accessToken The token to use
+ */
+- (void)startRequestWithToken:(nullable SPiDAccessToken *)accessToken;
+
+/** Checks if the request can be journaled and sent again after it failed
+
+ A POST that timed out or lost its connection may already have been handled by SPiD, sending it again could apply it
+ twice. A GET can be sent again after a lost connection.
+
+ @param error The error the request failed with
+ @return YES if replaying the request cannot apply it twice
+ */
+- (BOOL)canReplayAfterError:(NSError *)error;
+
 @property (nonatomic, strong, readwrite) NSURL *URL;
 @property (nonatomic, strong, readwrite) NSString *HTTPMethod;
 @property (nonatomic, strong, readwrite, nullable) NSString *HTTPBody;
-@property (nonatomic, copy, nullable) void (^completionHandler)(SPiDResponse *response);
+@property (nonatomic, copy, nullable) NSData *HTTPBodyData;
+@property (nonatomic, copy, readwrite, nullable) void (^completionHandler)(SPiDResponse *response);
+@property (nonatomic, assign) BOOL usesAccessToken;
+@property (nonatomic, assign) BOOL usesClientToken;
 
 @end
 
@@ -65,24 +92,85 @@ NS_ASSUME_NONNULL_END
 ///---------------------------------------------------------------------------------------
 
 + (instancetype)apiGetRequestWithPath:(NSString *)requestPath completionHandler:(void (^)(SPiDResponse *response))completionHandler {
-    NSString *completePath = [NSString stringWithFormat:@"/api/%@%@", [[SPiDClient sharedInstance] apiVersionSPiD], requestPath];
-    return [[self alloc] initRequestWithPath:completePath method:@"GET" body:nil completionHandler:completionHandler];
+    return [self apiGetRequestWithClient:[SPiDClient sharedInstance] path:requestPath completionHandler:completionHandler];
 }
 
 + (instancetype)apiPostRequestWithPath:(NSString *)requestPath body:(NSDictionary *)body completionHandler:(void (^)(SPiDResponse *response))completionHandler {
-    NSString *completePath = [NSString stringWithFormat:@"/api/%@%@", [[SPiDClient sharedInstance] apiVersionSPiD], requestPath];
-    return [[self alloc] initPostRequestWithPath:completePath body:body completionHandler:completionHandler];
+    return [self apiPostRequestWithClient:[SPiDClient sharedInstance] path:requestPath body:body completionHandler:completionHandler];
 }
 
 + (instancetype)requestWithPath:(NSString *)requestPath method:(NSString *)method body:(NSDictionary *)body completionHandler:(void (^)(SPiDResponse *response))completionHandler {
-    return [[self alloc] initRequestWithPath:requestPath method:method body:body completionHandler:completionHandler];
+    return [self requestWithClient:[SPiDClient sharedInstance] path:requestPath method:method body:body completionHandler:completionHandler];
+}
+
++ (instancetype)apiGetRequestWithClient:(SPiDClient *)client path:(NSString *)requestPath completionHandler:(void (^)(SPiDResponse *response))completionHandler {
+    NSString *completePath = [client.configuration.APIPathPrefix stringByAppendingString:requestPath];
+    return [[self alloc] initGetRequestWithClient:client path:completePath completionHandler:completionHandler];
+}
+
++ (instancetype)apiPostRequestWithClient:(SPiDClient *)client path:(NSString *)requestPath body:(NSDictionary *)body completionHandler:(void (^)(SPiDResponse *response))completionHandler {
+    NSString *completePath = [client.configuration.APIPathPrefix stringByAppendingString:requestPath];
+    return [[self alloc] initPostRequestWithClient:client path:completePath body:body completionHandler:completionHandler];
+}
+
++ (instancetype)requestWithClient:(SPiDClient *)client path:(NSString *)requestPath method:(NSString *)method body:(NSDictionary *)body completionHandler:(void (^)(SPiDResponse *response))completionHandler {
+    return [[self alloc] initRequestWithClient:client path:requestPath method:method body:body completionHandler:completionHandler];
+}
+
++ (instancetype)requestWithJournalRecord:(NSDictionary *)record completionHandler:(void (^)(SPiDResponse *response))completionHandler {
+    NSString *URLString = [record objectForKey:SPiDRequestJournalURLKey];
+    NSString *method = [record objectForKey:SPiDRequestJournalMethodKey];
+    NSString *body = [record objectForKey:SPiDRequestJournalBodyKey];
+    if (![URLString isKindOfClass:[NSString class]] || ![method isKindOfClass:[NSString class]]) {
+        SPiDDebugLog(@"Invalid journal record: %@", record);
+        return nil;
+    }
+
+    SPiDRequest *request = [[self alloc] init];
+    request.URL = [NSURL URLWithString:URLString];
+    request.HTTPMethod = method;
+    request.HTTPBody = [body isKindOfClass:[NSString class]] && body.length > 0 ? body : nil;
+    request.HTTPBodyData = [request.HTTPBody dataUsingEncoding:NSUTF8StringEncoding];
+    request.completionHandler = completionHandler;
+    return request.URL ? request : nil;
+}
+
+- (NSDictionary *)journalRecord {
+    NSMutableDictionary *record = [NSMutableDictionary dictionary];
+    [record setValue:[self.URL absoluteString] forKey:SPiDRequestJournalURLKey];
+    [record setValue:self.HTTPMethod forKey:SPiDRequestJournalMethodKey];
+    [record setValue:self.HTTPBody forKey:SPiDRequestJournalBodyKey];
+    return record;
+}
+
+- (SPiDClient *)client {
+    return _client ?: [SPiDClient sharedInstance];
 }
 
 - (void)startRequestWithAccessToken {
-    SPiDAccessToken *accessToken = [SPiDClient sharedInstance].accessToken;
+    self.usesAccessToken = YES;
+    [self startRequestWithToken:self.client.accessToken];
+}
+
+- (void)startRequestWithClientToken {
+    self.usesClientToken = YES;
+    [self startRequestWithToken:self.client.clientAccessToken];
+}
+
+- (void)start {
+    [self startWithRequest:[NSURLRequest sp_requestWithURL:self.URL method:self.HTTPMethod bodyData:self.HTTPBodyData]];
+}
+
+#pragma mark Private methods
+
+///---------------------------------------------------------------------------------------
+/// @name Private methods
+///---------------------------------------------------------------------------------------
+
+- (void)startRequestWithToken:(SPiDAccessToken *)accessToken {
     //TODO: Should verify this
     NSString *urlStr = [self.URL absoluteString];
-    NSString *body = @"";
+    NSMutableData *body = [NSMutableData data];
     if ([self.HTTPMethod isEqualToString:@"GET"]) {
         if ([urlStr rangeOfString:@"?"].location == NSNotFound) {
             urlStr = [NSString stringWithFormat:@"%@?oauth_token=%@", urlStr, accessToken.accessToken];
@@ -90,45 +178,45 @@ NS_ASSUME_NONNULL_END
             urlStr = [NSString stringWithFormat:@"%@&oauth_token=%@", urlStr, accessToken.accessToken];
         }
     } else if ([self.HTTPMethod isEqualToString:@"POST"]) {
-        if ([self.HTTPBody length] > 0) {
-            body = [self.HTTPBody stringByAppendingFormat:@"&oauth_token=%@", accessToken.accessToken];
-        } else {
-            body = [self.HTTPBody stringByAppendingFormat:@"oauth_token=%@", accessToken.accessToken];
+        if ([self.HTTPBodyData length] > 0) {
+            [body appendData:self.HTTPBodyData];
+            [body appendBytes:"&" length:1];
         }
+        [body appendBytes:"oauth_token=" length:12];
+        [body appendData:[accessToken.accessToken dataUsingEncoding:NSUTF8StringEncoding] ?: [NSData data]];
     }
 
-    [self startWithRequest:[NSURLRequest sp_requestWithURL:[NSURL URLWithString:urlStr] method:self.HTTPMethod andBody:body]];
+    [self startWithRequest:[NSURLRequest sp_requestWithURL:[NSURL URLWithString:urlStr] method:self.HTTPMethod bodyData:body]];
 }
 
-- (void)start {
-    [self startWithRequest:[NSURLRequest sp_requestWithURL:self.URL method:self.HTTPMethod andBody:self.HTTPBody]];
+- (BOOL)canReplayAfterError:(NSError *)error {
+    if ([error sp_isOfflineError]) {
+        return YES;
+    }
+    return [self.HTTPMethod isEqualToString:@"GET"] && [error code] == NSURLErrorNetworkConnectionLost && [error sp_isInterruptedRequestError];
 }
 
-#pragma mark Private methods
-
-///---------------------------------------------------------------------------------------
-/// @name Private methods
-///---------------------------------------------------------------------------------------
-
-- (instancetype)initGetRequestWithPath:(NSString *)requestPath completionHandler:(void (^)(SPiDResponse *response))completionHandler {
-    return [self initRequestWithPath:requestPath method:@"GET" body:nil completionHandler:completionHandler];
+- (instancetype)initGetRequestWithClient:(SPiDClient *)client path:(NSString *)requestPath completionHandler:(void (^)(SPiDResponse *response))completionHandler {
+    return [self initRequestWithClient:client path:requestPath method:@"GET" body:nil completionHandler:completionHandler];
 }
 
-- (instancetype)initPostRequestWithPath:(NSString *)requestPath body:(NSDictionary *)body completionHandler:(void (^)(SPiDResponse *response))completionHandler {
-    return [self initRequestWithPath:requestPath method:@"POST" body:body completionHandler:completionHandler];
+- (instancetype)initPostRequestWithClient:(SPiDClient *)client path:(NSString *)requestPath body:(NSDictionary *)body completionHandler:(void (^)(SPiDResponse *response))completionHandler {
+    return [self initRequestWithClient:client path:requestPath method:@"POST" body:body completionHandler:completionHandler];
 }
 
-- (instancetype)initRequestWithPath:(NSString *)requestPath method:(NSString *)method body:(NSDictionary *)body completionHandler:(void (^)(SPiDResponse *response))completionHandler {
+- (instancetype)initRequestWithClient:(SPiDClient *)client path:(NSString *)requestPath method:(NSString *)method body:(NSDictionary *)body completionHandler:(void (^)(SPiDResponse *response))completionHandler {
     self = [super init];
     if (self) {
-        NSString *requestURL = [NSString stringWithFormat:@"%@%@", [[[SPiDClient sharedInstance] serverURL] absoluteString], requestPath];
+        self.client = client;
+        NSString *requestURL = [client.configuration.serverURLString stringByAppendingString:requestPath];
         if ([method isEqualToString:@""] || [method isEqualToString:@"GET"]) { // Default to GET
             self.URL = [NSURL URLWithString:requestURL];
             self.HTTPMethod = @"GET";
         } else if ([method isEqualToString:@"POST"]) {
             self.URL = [NSURL URLWithString:requestURL];
             self.HTTPMethod = @"POST";
-            self.HTTPBody = [SPiDUtils encodedHttpBodyForDictionary:body];
+            self.HTTPBodyData = [SPiDUtils encodedHttpBodyDataForDictionary:body sortedKeys:NO];
+            self.HTTPBody = [[NSString alloc] initWithData:self.HTTPBodyData encoding:NSASCIIStringEncoding];
         }
         [self setRetryCount:0];
         self.completionHandler = completionHandler;
@@ -139,21 +227,30 @@ NS_ASSUME_NONNULL_END
 - (void)startWithRequest:(NSURLRequest *)request {
     SPiDDebugLog(@"Running request: %@", request.URL);
     
-    NSURLSessionDataTask *task = [[[SPiDClient sharedInstance] URLSession] dataTaskWithRequest:request completionHandler:^(NSData *data, NSURLResponse *response, NSError *error) {
+    NSURLSessionDataTask *task = [[self.client URLSession] dataTaskWithRequest:request completionHandler:^(NSData *data, NSURLResponse *response, NSError *error) {
         if (error) {
             SPiDDebugLog(@"SPiDSDK error: %@", [error description]);
+            if (self.isDurable && self.usesAccessToken && [self canReplayAfterError:error] && [self.client journalsOfflineRequests]) {
+                [self.client journalRequest:self];
+            }
             SPiDResponse *spidResponse = [[SPiDResponse alloc] initWithError:error];
             if (self.completionHandler)
                 self.completionHandler(spidResponse);
         } else {
             SPiDDebugLog(@"Received response from: %@", [self.URL absoluteString]);
+            // SPiD is reachable, a good time to send anything that was stored while offline
+            [self.client replayJournaledRequestsIfNeeded];
             SPiDResponse *spidResponse = [[SPiDResponse alloc] initWithJSONData:data];
             NSError *spidError = [spidResponse error];
             if (spidError && ([spidError code] == SPiDOAuth2InvalidTokenErrorCode || [spidError code] == SPiDOAuth2ExpiredTokenErrorCode)) {
                 if ([self retryCount] < 3) {
                     SPiDDebugLog(@"Invalid token, trying to refresh");
                     [self setRetryCount:[self retryCount] + 1];
-                    [[SPiDClient sharedInstance] refreshAccessTokenAndRerunRequest:self];
+                    if (self.usesClientToken) {
+                        [self.client refreshClientTokenAndRerunRequest:self];
+                    } else {
+                        [self.client refreshAccessTokenAndRerunRequest:self];
+                    }
                 } else {
                     SPiDDebugLog(@"Retried request: %ld times, aborting", [self retryCount]);
                     if (self.completionHandler)
@@ -165,8 +262,10 @@ NS_ASSUME_NONNULL_END
             }
         }
     }];
-    
-    [task resume];
+
+    [[self.client requestScheduler] scheduleTask:^{
+        [task resume];
+    } deferral:self.deferral];
 }
 
 @end
@@ -0,0 +1,89 @@
+//
+//  SPiDRequestJournal.h
+//  SPiDSDK
+//
+//  Copyright (c) 2012 Schibsted Payment. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/** `SPiDRequestJournal` is a append-only on-disk log of request descriptors.
+
+ Every record is written as a length prefix, a checksum and a JSON object, and is flushed to disk before
+ `appendRecord:` returns. A record that was only partially written when the app was terminated fails the checksum
+ and is dropped, together with anything after it, the next time the journal is read.
+ */
+
+@interface SPiDRequestJournal : NSObject
+
+///---------------------------------------------------------------------------------------
+/// @name Properties
+///---------------------------------------------------------------------------------------
+
+/** Location of the journal file */
+@property (nonatomic, strong, readonly) NSURL *fileURL;
+
+/** Stores the journal file with `NSFileProtectionComplete`, default value is NO
+
+ The records can then only be read while the device is unlocked. Use it for journals holding credentials.
+ */
+@property (nonatomic, assign) BOOL usesCompleteFileProtection;
+
+/** Number of records currently in the journal */
+@property (nonatomic, assign, readonly) NSUInteger count;
+
+///---------------------------------------------------------------------------------------
+/// @name Public methods
+///---------------------------------------------------------------------------------------
+
+/** Returns the default location for a journal
+
+ Journals are stored in a SPiD directory in Application Support.
+
+ @param name The journal name
+ @return The journal file URL
+ */
++ (NSURL *)defaultJournalURLWithName:(NSString *)name;
+
+/** Initializes a journal backed by the given file
+
+ The file is created on the first append.
+
+ @param fileURL The journal file
+ @return `SPiDRequestJournal`
+ */
+- (instancetype)initWithFileURL:(NSURL *)fileURL;
+
+/** Appends a record to the end of the journal
+
+ @param record JSON serializable dictionary
+ @return YES if the record was written to disk
+ */
+- (BOOL)appendRecord:(NSDictionary *)record;
+
+/** Returns all intact records in the order they were appended
+
+ @return The records
+ */
+- (NSArray<NSDictionary *> *)records;
+
+/** Returns the oldest record in the journal
+
+ @return The first record or nil if the journal is empty
+ */
+- (nullable NSDictionary *)firstRecord;
+
+/** Removes the oldest record and compacts the journal file
+
+ @return YES if the compacted journal was written to disk
+ */
+- (BOOL)removeFirstRecord;
+
+/** Removes all records and deletes the journal file */
+- (void)removeAllRecords;
+
+@end
+
+NS_ASSUME_NONNULL_END
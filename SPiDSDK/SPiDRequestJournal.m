@@ -0,0 +1,229 @@
+//
+//  SPiDRequestJournal.m
+//  SPiDSDK
+//
+//  Copyright (c) 2012 Schibsted Payment. All rights reserved.
+//
+
+#import "SPiDRequestJournal.h"
+#import "SPiDClient.h"
+#include <fcntl.h>
+#include <unistd.h>
+
+// Each record is <uint32 length><uint32 checksum><length bytes JSON>, integers in network byte order
+static const NSUInteger SPiDRequestJournalHeaderLength = 8;
+
+@interface SPiDRequestJournal ()
+
+/** Loads the journal file into memory, dropping a torn tail if there is one
+
+ `loadedRecords` stays nil if the file exists but can not be read, which happens for protected journals while the
+ device is locked.
+ */
+- (void)loadRecordsIfNeeded;
+
+/** Serializes a record including the record header
+
+ @param record The record
+ @return The serialized record or nil if the record is not JSON serializable
+ */
++ (nullable NSData *)dataForRecord:(NSDictionary *)record;
+
+/** Rewrites the journal file with the records in memory
+
+ @return YES if successful
+ */
+- (BOOL)writeRecords;
+
+@property (nonatomic, strong, readwrite) NSURL *fileURL;
+@property (nonatomic, strong, nullable) NSMutableArray<NSDictionary *> *loadedRecords;
+
+@end
+
+static uint32_t SPiDJournalChecksum(const uint8_t *bytes, NSUInteger length) {
+    // FNV-1a, only used for detecting torn writes
+    uint32_t hash = 2166136261u;
+    for (NSUInteger i = 0; i < length; i++) {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+@implementation SPiDRequestJournal
+
++ (NSURL *)defaultJournalURLWithName:(NSString *)name {
+    NSURL *directory = [[[NSFileManager defaultManager] URLsForDirectory:NSApplicationSupportDirectory inDomains:NSUserDomainMask] firstObject];
+    directory = [directory URLByAppendingPathComponent:@"SPiD" isDirectory:YES];
+    return [directory URLByAppendingPathComponent:[name stringByAppendingPathExtension:@"journal"]];
+}
+
+- (instancetype)initWithFileURL:(NSURL *)fileURL {
+    if (self = [super init]) {
+        self.fileURL = fileURL;
+    }
+    return self;
+}
+
+- (NSUInteger)count {
+    @synchronized (self) {
+        [self loadRecordsIfNeeded];
+        return self.loadedRecords.count;
+    }
+}
+
+- (BOOL)appendRecord:(NSDictionary *)record {
+    NSData *data = [SPiDRequestJournal dataForRecord:record];
+    if (data == nil) {
+        SPiDDebugLog(@"Could not serialize journal record: %@", record);
+        return NO;
+    }
+
+    @synchronized (self) {
+        [self loadRecordsIfNeeded];
+
+        if (self.loadedRecords == nil) {
+            SPiDDebugLog(@"Journal can not be read while the device is locked: %@", self.fileURL);
+            return NO;
+        }
+
+        [[NSFileManager defaultManager] createDirectoryAtURL:[self.fileURL URLByDeletingLastPathComponent] withIntermediateDirectories:YES attributes:nil error:nil];
+        if (self.usesCompleteFileProtection && ![[NSFileManager defaultManager] fileExistsAtPath:self.fileURL.path]) {
+            // Protected before the first record is written to it
+            [[NSFileManager defaultManager] createFileAtPath:self.fileURL.path contents:nil attributes:@{NSFileProtectionKey: NSFileProtectionComplete}];
+        }
+        int fd = open(self.fileURL.fileSystemRepresentation, O_WRONLY | O_CREAT | O_APPEND, 0600);
+        if (fd < 0) {
+            SPiDDebugLog(@"Could not open journal: %@", self.fileURL);
+            return NO;
+        }
+        ssize_t written = write(fd, data.bytes, data.length);
+        BOOL synced = (fsync(fd) == 0);
+        close(fd);
+
+        if (written != (ssize_t) data.length || !synced) {
+            SPiDDebugLog(@"Could not append to journal: %@", self.fileURL);
+            // Drop whatever part of the record reached the disk
+            [self writeRecords];
+            return NO;
+        }
+        [self.loadedRecords addObject:record];
+        return YES;
+    }
+}
+
+- (NSArray<NSDictionary *> *)records {
+    @synchronized (self) {
+        [self loadRecordsIfNeeded];
+        return [self.loadedRecords copy] ?: @[];
+    }
+}
+
+- (NSDictionary *)firstRecord {
+    @synchronized (self) {
+        [self loadRecordsIfNeeded];
+        return [self.loadedRecords firstObject];
+    }
+}
+
+- (BOOL)removeFirstRecord {
+    @synchronized (self) {
+        [self loadRecordsIfNeeded];
+        if (self.loadedRecords == nil) {
+            return NO;
+        }
+        if (self.loadedRecords.count == 0) {
+            return YES;
+        }
+        [self.loadedRecords removeObjectAtIndex:0];
+        return [self writeRecords];
+    }
+}
+
+- (void)removeAllRecords {
+    @synchronized (self) {
+        self.loadedRecords = [NSMutableArray array];
+        [[NSFileManager defaultManager] removeItemAtURL:self.fileURL error:nil];
+    }
+}
+
+#pragma mark Private methods
+
+///---------------------------------------------------------------------------------------
+/// @name Private methods
+///---------------------------------------------------------------------------------------
+
+- (void)loadRecordsIfNeeded {
+    if (self.loadedRecords) {
+        return;
+    }
+
+    NSError *error = nil;
+    NSData *data = [NSData dataWithContentsOfURL:self.fileURL options:(NSDataReadingOptions) 0 error:&error];
+    if (data == nil && !([error.domain isEqualToString:NSCocoaErrorDomain] && error.code == NSFileReadNoSuchFileError)) {
+        // Protected and the device is locked, the journal is read again on next use
+        return;
+    }
+    self.loadedRecords = [NSMutableArray array];
+    const uint8_t *bytes = data.bytes;
+    NSUInteger offset = 0;
+    while (offset + SPiDRequestJournalHeaderLength <= data.length) {
+        uint32_t header[2];
+        memcpy(header, bytes + offset, SPiDRequestJournalHeaderLength);
+        uint32_t length = CFSwapInt32BigToHost(header[0]);
+        uint32_t checksum = CFSwapInt32BigToHost(header[1]);
+        NSUInteger start = offset + SPiDRequestJournalHeaderLength;
+        if (length > data.length - start || SPiDJournalChecksum(bytes + start, length) != checksum) {
+            break;
+        }
+        NSData *json = [data subdataWithRange:NSMakeRange(start, length)];
+        NSDictionary *record = [NSJSONSerialization JSONObjectWithData:json options:(NSJSONReadingOptions) 0 error:nil];
+        if (![record isKindOfClass:[NSDictionary class]]) {
+            break;
+        }
+        [self.loadedRecords addObject:record];
+        offset = start + length;
+    }
+
+    if (offset != data.length) {
+        SPiDDebugLog(@"Dropping %lu bytes of incomplete records from journal", (unsigned long) (data.length - offset));
+        [self writeRecords];
+    }
+}
+
++ (NSData *)dataForRecord:(NSDictionary *)record {
+    if (![NSJSONSerialization isValidJSONObject:record]) {
+        return nil;
+    }
+    NSData *json = [NSJSONSerialization dataWithJSONObject:record options:(NSJSONWritingOptions) 0 error:nil];
+    if (json == nil) {
+        return nil;
+    }
+    uint32_t header[2];
+    header[0] = CFSwapInt32HostToBig((uint32_t) json.length);
+    header[1] = CFSwapInt32HostToBig(SPiDJournalChecksum(json.bytes, json.length));
+
+    NSMutableData *data = [NSMutableData dataWithCapacity:SPiDRequestJournalHeaderLength + json.length];
+    [data appendBytes:header length:SPiDRequestJournalHeaderLength];
+    [data appendData:json];
+    return data;
+}
+
+- (BOOL)writeRecords {
+    if (self.loadedRecords.count == 0) {
+        [[NSFileManager defaultManager] removeItemAtURL:self.fileURL error:nil];
+        return YES;
+    }
+    NSMutableData *data = [NSMutableData data];
+    for (NSDictionary *record in self.loadedRecords) {
+        [data appendData:[SPiDRequestJournal dataForRecord:record]];
+    }
+    // Atomic write, the old journal stays intact until the compacted one has been written
+    NSDataWritingOptions options = NSDataWritingAtomic;
+    if (self.usesCompleteFileProtection) {
+        options |= NSDataWritingFileProtectionComplete;
+    }
+    return [data writeToURL:self.fileURL options:options error:nil];
+}
+
+@end
@@ -0,0 +1,72 @@
+//
+//  SPiDRequestScheduler.h
+//  SPiDSDK
+//
+//  Copyright (c) 2012 Schibsted Payment. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/** How urgently a request needs to be sent */
+typedef NS_ENUM(NSInteger, SPiDRequestDeferral) {
+    /** Sent immediately, also sends all deferred requests */
+    SPiDRequestDeferralNone = 0,
+    /** Held until the next immediate request or until `maximumDelay` has passed */
+    SPiDRequestDeferralDeferrable
+};
+
+/** Starts a one shot timer that calls the handler on the given queue once the delay has passed, returns a block that
+ cancels the timer */
+typedef dispatch_block_t (^SPiDRequestSchedulerTimerFactory)(NSTimeInterval delay, dispatch_queue_t queue, dispatch_block_t handler);
+
+/** `SPiDRequestScheduler` decides when the network tasks of `SPiDRequest` are started.
+
+ Every request that is sent on its own wakes the cellular radio, which then stays powered for several seconds. Non
+ urgent requests such as the status ping are therefore held back and sent together with the next user initiated
+ request, so that they share the same network burst.
+ */
+
+@interface SPiDRequestScheduler : NSObject
+
+///---------------------------------------------------------------------------------------
+/// @name Properties
+///---------------------------------------------------------------------------------------
+
+/** Longest time a deferrable request is held back, defaults to 30 seconds */
+@property (atomic, assign) NSTimeInterval maximumDelay;
+
+/** Number of requests currently held back */
+@property (nonatomic, assign, readonly) NSUInteger deferredCount;
+
+///---------------------------------------------------------------------------------------
+/// @name Public methods
+///---------------------------------------------------------------------------------------
+
+/** Initializes a scheduler whose `maximumDelay` is measured by a dispatch timer
+
+ @return `SPiDRequestScheduler`
+ */
+- (instancetype)init;
+
+/** Initializes a scheduler with its own timers, can be used to drive the scheduler with a simulated clock
+
+ @param timerFactory Starts the timer that sends the deferred tasks when `maximumDelay` has passed
+ @return `SPiDRequestScheduler`
+ */
+- (instancetype)initWithTimerFactory:(SPiDRequestSchedulerTimerFactory)timerFactory NS_DESIGNATED_INITIALIZER;
+
+/** Schedules a network task
+
+ @param task Block that starts the network task, should return without waiting for the response
+ @param deferral How urgently the task needs to be started
+ */
+- (void)scheduleTask:(dispatch_block_t)task deferral:(SPiDRequestDeferral)deferral;
+
+/** Starts all deferred tasks immediately */
+- (void)flush;
+
+@end
+
+NS_ASSUME_NONNULL_END
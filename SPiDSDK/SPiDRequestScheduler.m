@@ -0,0 +1,113 @@
+//
+//  SPiDRequestScheduler.m
+//  SPiDSDK
+//
+//  Copyright (c) 2012 Schibsted Payment. All rights reserved.
+//
+
+#import "SPiDRequestScheduler.h"
+#import "SPiDClient.h"
+
+static const NSTimeInterval SPiDRequestSchedulerDefaultMaximumDelay = 30.0;
+
+@interface SPiDRequestScheduler ()
+
+/** Timer factory backed by a dispatch timer source */
++ (SPiDRequestSchedulerTimerFactory)dispatchTimerFactory;
+
+/** Starts the deferred tasks, must be called on the scheduler queue */
+- (void)flushDeferredTasks;
+
+@property (nonatomic, strong) dispatch_queue_t queue;
+@property (nonatomic, strong) NSMutableArray<dispatch_block_t> *deferredTasks;
+@property (nonatomic, copy) SPiDRequestSchedulerTimerFactory timerFactory;
+/** Cancels the running timer, nil if no timer is running */
+@property (nonatomic, copy, nullable) dispatch_block_t cancelTimer;
+
+@end
+
+@implementation SPiDRequestScheduler
+
+- (instancetype)init {
+    return [self initWithTimerFactory:[SPiDRequestScheduler dispatchTimerFactory]];
+}
+
+- (instancetype)initWithTimerFactory:(SPiDRequestSchedulerTimerFactory)timerFactory {
+    if (self = [super init]) {
+        self.timerFactory = timerFactory;
+        self.queue = dispatch_queue_create("com.spid.sdk.requestscheduler", DISPATCH_QUEUE_SERIAL);
+        self.deferredTasks = [NSMutableArray array];
+        self.maximumDelay = SPiDRequestSchedulerDefaultMaximumDelay;
+    }
+    return self;
+}
+
+- (NSUInteger)deferredCount {
+    __block NSUInteger count;
+    dispatch_sync(self.queue, ^{
+        count = self.deferredTasks.count;
+    });
+    return count;
+}
+
+- (void)scheduleTask:(dispatch_block_t)task deferral:(SPiDRequestDeferral)deferral {
+    if (deferral == SPiDRequestDeferralNone) {
+        task();
+        [self flush];
+        return;
+    }
+
+    dispatch_async(self.queue, ^{
+        [self.deferredTasks addObject:[task copy]];
+        if (self.cancelTimer == nil) {
+            __weak SPiDRequestScheduler *weakSelf = self;
+            self.cancelTimer = self.timerFactory(self.maximumDelay, self.queue, ^{
+                SPiDDebugLog(@"Maximum delay reached, sending deferred requests");
+                [weakSelf flushDeferredTasks];
+            });
+        }
+    });
+}
+
+- (void)flush {
+    dispatch_async(self.queue, ^{
+        [self flushDeferredTasks];
+    });
+}
+
+#pragma mark Private methods
+
+///---------------------------------------------------------------------------------------
+/// @name Private methods
+///---------------------------------------------------------------------------------------
+
++ (SPiDRequestSchedulerTimerFactory)dispatchTimerFactory {
+    return ^dispatch_block_t(NSTimeInterval delay, dispatch_queue_t queue, dispatch_block_t handler) {
+        dispatch_source_t timer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, queue);
+        // Leeway lets the system line the timer up with other wakeups
+        uint64_t leeway = (uint64_t) (delay * 0.1 * NSEC_PER_SEC);
+        dispatch_source_set_timer(timer, dispatch_time(DISPATCH_TIME_NOW, (int64_t) (delay * NSEC_PER_SEC)), DISPATCH_TIME_FOREVER, leeway);
+        dispatch_source_set_event_handler(timer, handler);
+        dispatch_resume(timer);
+        return ^{
+            dispatch_source_cancel(timer);
+        };
+    };
+}
+
+- (void)flushDeferredTasks {
+    if (self.cancelTimer) {
+        self.cancelTimer();
+        self.cancelTimer = nil;
+    }
+    if (self.deferredTasks.count == 0) {
+        return;
+    }
+    NSArray<dispatch_block_t> *tasks = self.deferredTasks;
+    self.deferredTasks = [NSMutableArray array];
+    for (dispatch_block_t task in tasks) {
+        task();
+    }
+}
+
+@end
@@ -28,6 +28,20 @@ FOUNDATION_EXPORT const unsigned char SPiDVersionString[];
 #import "SPiDUser.h"
 #import "SPiDUtils.h"
 #import "SPiDAgreements.h"
+#import "SPiDRequestJournal.h"
+#import "SPiDRequestScheduler.h"
+#import "SPiDAccountStore.h"
+#import "SPiDSharedTokenCoordinator.h"
+#import "SPiDTokenStore.h"
+#import "SPiDKeychainTokenStore.h"
+#import "SPiDFileTokenStore.h"
+#import "SPiDShardedTokenStore.h"
+#import "SPiDRefreshScheduler.h"
+#import "SPiDConfiguration.h"
+#import "SPiDHMAC.h"
+#import "SPiDJwtCodec.h"
+#import "SPiDIdentity.h"
+#import "SPiDUserProfile.h"
 
 #if TARGET_OS_IOS
     #import "SPiDWebView.h"
@@ -0,0 +1,54 @@
+//
+//  SPiDShardedTokenStore.h
+//  SPiDSDK
+//
+//  Copyright (c) 2012 Schibsted Payment. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "SPiDTokenStore.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/** `SPiDShardedTokenStore` is a in-memory token store for services that act for many users at once.
+
+ Tokens are spread over a fixed number of shards by identifier hash, each shard has its own lock so that threads
+ working on different users rarely contend. Every shard is a hash table combined with a least recently used list,
+ lookups, stores and refreshes are O(1). When a shard is full the least recently used token is evicted, and written to
+ the backing store if it has changed since it was loaded. Lookups that miss are loaded from the backing store.
+ */
+
+@interface SPiDShardedTokenStore : NSObject <SPiDTokenStore>
+
+///---------------------------------------------------------------------------------------
+/// @name Properties
+///---------------------------------------------------------------------------------------
+
+/** Maximum number of tokens kept in memory */
+@property (nonatomic, assign, readonly) NSUInteger capacity;
+
+/** Number of shards */
+@property (nonatomic, assign, readonly) NSUInteger shardCount;
+
+/** Number of tokens currently in memory */
+@property (nonatomic, assign, readonly) NSUInteger count;
+
+/** Store that evicted tokens are written to and misses are loaded from */
+@property (nonatomic, strong, readonly, nullable) id<SPiDTokenStore> backingStore;
+
+///---------------------------------------------------------------------------------------
+/// @name Public methods
+///---------------------------------------------------------------------------------------
+
+/** Initializes a sharded store
+
+ @param capacity Maximum number of tokens kept in memory, split evenly over the shards
+ @param shardCount Number of shards, rounded up to a power of two
+ @param backingStore Store for evicted tokens, or nil to drop them
+ @return `SPiDShardedTokenStore`
+ */
+- (instancetype)initWithCapacity:(NSUInteger)capacity shardCount:(NSUInteger)shardCount backingStore:(nullable id<SPiDTokenStore>)backingStore;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,267 @@
+//
+//  SPiDShardedTokenStore.m
+//  SPiDSDK
+//
+//  Copyright (c) 2012 Schibsted Payment. All rights reserved.
+//
+
+#import "SPiDShardedTokenStore.h"
+#import "SPiDAccessToken.h"
+#include <pthread.h>
+
+/** Entry in the least recently used list of a shard, owned by the shard dictionary */
+@interface SPiDTokenNode : NSObject {
+@public
+    NSString *_identifier;
+    SPiDAccessToken *_accessToken;
+    BOOL _dirty;
+    __unsafe_unretained SPiDTokenNode *_previous;
+    __unsafe_unretained SPiDTokenNode *_next;
+}
+@end
+
+@implementation SPiDTokenNode
+@end
+
+/** A lock, a hash table and a least recently used list, most recently used first
+
+ `_mutationGeneration` is bumped by every store, eviction and removal, so a miss that loaded from the backing store
+ without the lock can tell that its token may have been replaced, written back or removed meanwhile.
+ */
+@interface SPiDTokenShard : NSObject {
+@public
+    pthread_mutex_t _mutex;
+    NSMutableDictionary<NSString *, SPiDTokenNode *> *_nodes;
+    __unsafe_unretained SPiDTokenNode *_head;
+    __unsafe_unretained SPiDTokenNode *_tail;
+    NSUInteger _capacity;
+    uint64_t _mutationGeneration;
+}
+@end
+
+@implementation SPiDTokenShard
+
+- (instancetype)initWithCapacity:(NSUInteger)capacity {
+    if (self = [super init]) {
+        pthread_mutex_init(&_mutex, NULL);
+        _nodes = [NSMutableDictionary dictionaryWithCapacity:capacity];
+        _capacity = MAX(capacity, 1u);
+    }
+    return self;
+}
+
+- (void)dealloc {
+    pthread_mutex_destroy(&_mutex);
+}
+
+@end
+
+static void SPiDShardUnlink(SPiDTokenShard *shard, SPiDTokenNode *node) {
+    if (node->_previous) {
+        node->_previous->_next = node->_next;
+    } else {
+        shard->_head = node->_next;
+    }
+    if (node->_next) {
+        node->_next->_previous = node->_previous;
+    } else {
+        shard->_tail = node->_previous;
+    }
+    node->_previous = nil;
+    node->_next = nil;
+}
+
+static void SPiDShardPushFront(SPiDTokenShard *shard, SPiDTokenNode *node) {
+    node->_previous = nil;
+    node->_next = shard->_head;
+    if (shard->_head) {
+        shard->_head->_previous = node;
+    }
+    shard->_head = node;
+    if (shard->_tail == nil) {
+        shard->_tail = node;
+    }
+}
+
+@interface SPiDShardedTokenStore ()
+
+/** Returns the shard responsible for a identifier */
+- (SPiDTokenShard *)shardForIdentifier:(NSString *)identifier;
+
+/** Inserts or replaces a token and evicts from the shard if it is full, the shard must be locked */
+- (void)insertAccessToken:(SPiDAccessToken *)accessToken forIdentifier:(NSString *)identifier dirty:(BOOL)dirty inShard:(SPiDTokenShard *)shard;
+
+@property (nonatomic, assign, readwrite) NSUInteger capacity;
+@property (nonatomic, assign, readwrite) NSUInteger shardCount;
+@property (nonatomic, strong, readwrite) id<SPiDTokenStore> backingStore;
+@property (nonatomic, copy) NSArray<SPiDTokenShard *> *shards;
+@property (nonatomic, assign) NSUInteger shardMask;
+
+@end
+
+@implementation SPiDShardedTokenStore
+
+- (instancetype)initWithCapacity:(NSUInteger)capacity shardCount:(NSUInteger)shardCount backingStore:(id<SPiDTokenStore>)backingStore {
+    if (self = [super init]) {
+        NSUInteger count = 1;
+        while (count < shardCount) {
+            count <<= 1;
+        }
+        self.shardCount = count;
+        self.shardMask = count - 1;
+        self.capacity = capacity;
+        self.backingStore = backingStore;
+
+        NSMutableArray<SPiDTokenShard *> *shards = [NSMutableArray arrayWithCapacity:count];
+        NSUInteger shardCapacity = (capacity + count - 1) / count;
+        for (NSUInteger i = 0; i < count; i++) {
+            [shards addObject:[[SPiDTokenShard alloc] initWithCapacity:shardCapacity]];
+        }
+        self.shards = shards;
+    }
+    return self;
+}
+
+- (NSUInteger)count {
+    NSUInteger count = 0;
+    for (SPiDTokenShard *shard in self.shards) {
+        pthread_mutex_lock(&shard->_mutex);
+        count += shard->_nodes.count;
+        pthread_mutex_unlock(&shard->_mutex);
+    }
+    return count;
+}
+
+- (SPiDAccessToken *)accessTokenForIdentifier:(NSString *)identifier {
+    SPiDTokenShard *shard = [self shardForIdentifier:identifier];
+    for (;;) {
+        pthread_mutex_lock(&shard->_mutex);
+        SPiDTokenNode *node = shard->_nodes[identifier];
+        if (node) {
+            if (shard->_head != node) {
+                SPiDShardUnlink(shard, node);
+                SPiDShardPushFront(shard, node);
+            }
+            SPiDAccessToken *accessToken = node->_accessToken;
+            pthread_mutex_unlock(&shard->_mutex);
+            return accessToken;
+        }
+        uint64_t mutationGeneration = shard->_mutationGeneration;
+        pthread_mutex_unlock(&shard->_mutex);
+
+        SPiDAccessToken *accessToken = [self.backingStore accessTokenForIdentifier:identifier];
+        if (accessToken == nil) {
+            return nil;
+        }
+        pthread_mutex_lock(&shard->_mutex);
+        node = shard->_nodes[identifier];
+        if (node) {
+            // Stored by another thread while loading, that token is newer
+            accessToken = node->_accessToken;
+        } else if (shard->_mutationGeneration == mutationGeneration) {
+            [self insertAccessToken:accessToken forIdentifier:identifier dirty:NO inShard:shard];
+        } else {
+            accessToken = nil;
+        }
+        pthread_mutex_unlock(&shard->_mutex);
+        if (accessToken) {
+            return accessToken;
+        }
+        // The shard changed while loading, this token may have been stored and evicted or removed, so load it again
+    }
+}
+
+- (NSDictionary<NSString *, SPiDAccessToken *> *)accessTokensWithIdentifierPrefix:(NSString *)prefix {
+    NSMutableDictionary<NSString *, SPiDAccessToken *> *accessTokens = [[self.backingStore accessTokensWithIdentifierPrefix:prefix] mutableCopy] ?: [NSMutableDictionary dictionary];
+    for (SPiDTokenShard *shard in self.shards) {
+        pthread_mutex_lock(&shard->_mutex);
+        for (NSString *identifier in shard->_nodes) {
+            if ([identifier hasPrefix:prefix]) {
+                accessTokens[identifier] = shard->_nodes[identifier]->_accessToken;
+            }
+        }
+        pthread_mutex_unlock(&shard->_mutex);
+    }
+    return accessTokens;
+}
+
+- (void)storeAccessToken:(SPiDAccessToken *)accessToken forIdentifier:(NSString *)identifier {
+    SPiDTokenShard *shard = [self shardForIdentifier:identifier];
+    pthread_mutex_lock(&shard->_mutex);
+    [self insertAccessToken:accessToken forIdentifier:identifier dirty:YES inShard:shard];
+    pthread_mutex_unlock(&shard->_mutex);
+}
+
+- (void)removeAccessTokenForIdentifier:(NSString *)identifier {
+    SPiDTokenShard *shard = [self shardForIdentifier:identifier];
+    pthread_mutex_lock(&shard->_mutex);
+    SPiDTokenNode *node = shard->_nodes[identifier];
+    if (node) {
+        SPiDShardUnlink(shard, node);
+        [shard->_nodes removeObjectForKey:identifier];
+    }
+    // Removed while the shard is locked so a miss that loads again after the generation changed cannot see it
+    [self.backingStore removeAccessTokenForIdentifier:identifier];
+    shard->_mutationGeneration++;
+    pthread_mutex_unlock(&shard->_mutex);
+}
+
+- (void)flush {
+    for (SPiDTokenShard *shard in self.shards) {
+        pthread_mutex_lock(&shard->_mutex);
+        for (SPiDTokenNode *node = shard->_head; node; node = node->_next) {
+            if (node->_dirty) {
+                [self.backingStore storeAccessToken:node->_accessToken forIdentifier:node->_identifier];
+                node->_dirty = NO;
+            }
+        }
+        pthread_mutex_unlock(&shard->_mutex);
+    }
+    [self.backingStore flush];
+}
+
+#pragma mark Private methods
+
+///---------------------------------------------------------------------------------------
+/// @name Private methods
+///---------------------------------------------------------------------------------------
+
+- (SPiDTokenShard *)shardForIdentifier:(NSString *)identifier {
+    return self.shards[identifier.hash & self.shardMask];
+}
+
+- (void)insertAccessToken:(SPiDAccessToken *)accessToken forIdentifier:(NSString *)identifier dirty:(BOOL)dirty inShard:(SPiDTokenShard *)shard {
+    if (dirty) {
+        shard->_mutationGeneration++;
+    }
+    SPiDTokenNode *node = shard->_nodes[identifier];
+    if (node) {
+        node->_accessToken = accessToken;
+        node->_dirty = node->_dirty || dirty;
+        if (shard->_head != node) {
+            SPiDShardUnlink(shard, node);
+            SPiDShardPushFront(shard, node);
+        }
+        return;
+    }
+
+    if (shard->_nodes.count >= shard->_capacity) {
+        SPiDTokenNode *evicted = shard->_tail;
+        SPiDShardUnlink(shard, evicted);
+        if (evicted->_dirty) {
+            // Written while the shard is locked so a miss cannot load the older value in between
+            [self.backingStore storeAccessToken:evicted->_accessToken forIdentifier:evicted->_identifier];
+        }
+        [shard->_nodes removeObjectForKey:evicted->_identifier];
+        shard->_mutationGeneration++;
+    }
+
+    node = [[SPiDTokenNode alloc] init];
+    node->_identifier = [identifier copy];
+    node->_accessToken = accessToken;
+    node->_dirty = dirty;
+    shard->_nodes[node->_identifier] = node;
+    SPiDShardPushFront(shard, node);
+}
+
+@end
@@ -0,0 +1,75 @@
+//
+//  SPiDSharedTokenCoordinator.h
+//  SPiDSDK
+//
+//  Copyright (c) 2012 Schibsted Payment. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/** `SPiDSharedTokenCoordinator` makes sure only one process refreshes a access token that is shared through a keychain
+ access group, such as a app and its extensions.
+
+ The processes coordinate through two files in a shared container. A lock file acts as the refresh lease: a process
+ must hold an exclusive `flock` on it while refreshing, and the lock is released by the system if the process dies. A
+ generation file is incremented after every refresh, so a process that finds a newer generation than the one its
+ token was loaded at knows that the keychain already holds a fresh token and can skip the network call.
+ */
+
+@interface SPiDSharedTokenCoordinator : NSObject
+
+///---------------------------------------------------------------------------------------
+/// @name Properties
+///---------------------------------------------------------------------------------------
+
+/** Directory holding the lease and generation files */
+@property (nonatomic, strong, readonly) NSURL *directoryURL;
+
+/** Longest time to wait for another process to finish refreshing, defaults to 30 seconds */
+@property (atomic, assign) NSTimeInterval leaseTimeout;
+
+/** Generation of the token this process is currently using */
+@property (atomic, assign, readonly) uint64_t lastSeenGeneration;
+
+///---------------------------------------------------------------------------------------
+/// @name Public methods
+///---------------------------------------------------------------------------------------
+
+/** Initializes a coordinator using files in the given directory
+
+ The directory should be in a app group container that all sharing processes can access.
+
+ @param directoryURL The shared directory
+ @return `SPiDSharedTokenCoordinator`
+ */
+- (instancetype)initWithDirectoryURL:(NSURL *)directoryURL;
+
+/** Reads the current generation from the generation file
+
+ @return The generation, 0 if no process has refreshed yet
+ */
+- (uint64_t)currentGeneration;
+
+/** Records that the token of the current generation has been loaded */
+- (void)markCurrentGenerationSeen;
+
+/** Coordinates a token refresh with other processes
+
+ Waits for the refresh lease on a background queue. If another process has refreshed while waiting, `pickUp` is called
+ with YES and the stored token should be reloaded. Otherwise `refresh` is called while holding the lease and must call
+ the completion block with whether a new token was stored, which bumps the generation and releases the lease.
+
+ If the lease is not released within `leaseTimeout` the refresh is not attempted, since the process holding the lease
+ may be about to rotate the refresh token. `pickUp` is then called with NO, the stored token should be reloaded and the
+ refresh reported as failed.
+
+ @param refresh Block that refreshes and stores the token
+ @param pickUp Block that reloads the stored token, called with YES if another process has refreshed it
+ */
+- (void)coordinateRefresh:(void (^)(void (^completion)(BOOL stored)))refresh pickUp:(void (^)(BOOL refreshed))pickUp;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,164 @@
+//
+//  SPiDSharedTokenCoordinator.m
+//  SPiDSDK
+//
+//  Copyright (c) 2012 Schibsted Payment. All rights reserved.
+//
+
+#import "SPiDSharedTokenCoordinator.h"
+#import "SPiDClient.h"
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+static NSString *const SPiDRefreshLeaseFileName = @"SPiDRefresh.lock";
+static NSString *const SPiDTokenGenerationFileName = @"SPiDToken.generation";
+static const NSTimeInterval SPiDDefaultLeaseTimeout = 30.0;
+static const useconds_t SPiDLeasePollInterval = 20000;
+
+@interface SPiDSharedTokenCoordinator ()
+
+/** Tries to take the refresh lease until it is free or `leaseTimeout` has passed
+
+ @return YES if the lease was taken
+ */
+- (BOOL)acquireRefreshLease;
+
+/** Releases the refresh lease */
+- (void)releaseRefreshLease;
+
+/** Increments the generation, must only be called while holding the lease */
+- (void)bumpGeneration;
+
+/** Opens one of the shared files, creating it if needed */
+- (int)openFileWithName:(NSString *)name;
+
+@property (nonatomic, strong, readwrite) NSURL *directoryURL;
+@property (atomic, assign, readwrite) uint64_t lastSeenGeneration;
+@property (nonatomic, strong) dispatch_queue_t queue;
+@property (nonatomic, assign) int leaseDescriptor;
+
+@end
+
+@implementation SPiDSharedTokenCoordinator
+
+- (instancetype)initWithDirectoryURL:(NSURL *)directoryURL {
+    if (self = [super init]) {
+        self.directoryURL = directoryURL;
+        self.leaseTimeout = SPiDDefaultLeaseTimeout;
+        self.queue = dispatch_queue_create("com.spid.sdk.sharedtoken", DISPATCH_QUEUE_SERIAL);
+        [[NSFileManager defaultManager] createDirectoryAtURL:directoryURL withIntermediateDirectories:YES attributes:nil error:nil];
+        // Each coordinator needs its own open file, flock does not exclude holders of the same descriptor
+        self.leaseDescriptor = [self openFileWithName:SPiDRefreshLeaseFileName];
+        self.lastSeenGeneration = [self currentGeneration];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    if (self.leaseDescriptor >= 0) {
+        close(self.leaseDescriptor);
+    }
+}
+
+- (uint64_t)currentGeneration {
+    int fd = [self openFileWithName:SPiDTokenGenerationFileName];
+    if (fd < 0) {
+        return 0;
+    }
+    uint64_t generation = 0;
+    if (pread(fd, &generation, sizeof(generation), 0) != sizeof(generation)) {
+        generation = 0;
+    }
+    close(fd);
+    return generation;
+}
+
+- (void)markCurrentGenerationSeen {
+    self.lastSeenGeneration = [self currentGeneration];
+}
+
+- (void)coordinateRefresh:(void (^)(void (^completion)(BOOL stored)))refresh pickUp:(void (^)(BOOL refreshed))pickUp {
+    dispatch_async(self.queue, ^{
+        BOOL leased = [self acquireRefreshLease];
+
+        uint64_t generation = [self currentGeneration];
+        if (generation != self.lastSeenGeneration) {
+            SPiDDebugLog(@"Token was refreshed by another process");
+            self.lastSeenGeneration = generation;
+            if (leased) {
+                [self releaseRefreshLease];
+            }
+            pickUp(YES);
+            return;
+        }
+        if (!leased) {
+            // Refreshing now could use a refresh token that the lease holder is rotating
+            SPiDDebugLog(@"Timed out waiting for refresh lease, not refreshing");
+            pickUp(NO);
+            return;
+        }
+
+        // The queue stays blocked until the refresh completes so the lease is not taken twice by this coordinator
+        dispatch_semaphore_t done = dispatch_semaphore_create(0);
+        refresh(^(BOOL stored) {
+            if (stored) {
+                [self bumpGeneration];
+            }
+            [self releaseRefreshLease];
+            dispatch_semaphore_signal(done);
+        });
+        dispatch_semaphore_wait(done, DISPATCH_TIME_FOREVER);
+    });
+}
+
+#pragma mark Private methods
+
+///---------------------------------------------------------------------------------------
+/// @name Private methods
+///---------------------------------------------------------------------------------------
+
+- (BOOL)acquireRefreshLease {
+    if (self.leaseDescriptor < 0) {
+        return NO;
+    }
+    NSDate *deadline = [NSDate dateWithTimeIntervalSinceNow:self.leaseTimeout];
+    while (flock(self.leaseDescriptor, LOCK_EX | LOCK_NB) != 0) {
+        if (errno != EWOULDBLOCK && errno != EINTR) {
+            return NO;
+        }
+        if ([deadline timeIntervalSinceNow] <= 0) {
+            return NO;
+        }
+        usleep(SPiDLeasePollInterval);
+    }
+    return YES;
+}
+
+- (void)releaseRefreshLease {
+    flock(self.leaseDescriptor, LOCK_UN);
+}
+
+- (void)bumpGeneration {
+    uint64_t generation = [self currentGeneration] + 1;
+    int fd = [self openFileWithName:SPiDTokenGenerationFileName];
+    if (fd < 0) {
+        return;
+    }
+    if (pwrite(fd, &generation, sizeof(generation), 0) == sizeof(generation)) {
+        fsync(fd);
+        self.lastSeenGeneration = generation;
+    }
+    close(fd);
+}
+
+- (int)openFileWithName:(NSString *)name {
+    NSURL *fileURL = [self.directoryURL URLByAppendingPathComponent:name];
+    int fd = open(fileURL.fileSystemRepresentation, O_RDWR | O_CREAT, 0600);
+    if (fd < 0) {
+        SPiDDebugLog(@"Could not open shared token file: %@", fileURL);
+    }
+    return fd;
+}
+
+@end
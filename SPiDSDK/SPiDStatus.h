@@ -14,6 +14,10 @@
 
 + (SPiDRequest *)statusRequestWithCompletionHandler:(void (^)(SPiDResponse *))completionHandler;
 
++ (void)runStatusRequestWithClient:(SPiDClient *)client;
+
++ (SPiDRequest *)statusRequestWithClient:(SPiDClient *)client completionHandler:(void (^)(SPiDResponse *))completionHandler;
+
 + (NSString *)vendorId;
 
 + (NSString *)spidUserAgent;
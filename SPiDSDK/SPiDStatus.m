@@ -23,17 +23,27 @@
 @implementation SPiDStatus
 
 + (void)runStatusRequest {
-    SPiDRequest *statusRequest = [SPiDStatus statusRequestWithCompletionHandler:^(SPiDResponse *response) {
+    [self runStatusRequestWithClient:[SPiDClient sharedInstance]];
+}
+
++ (SPiDRequest *)statusRequestWithCompletionHandler:(void (^)(SPiDResponse *response))completionHandler {
+    return [self statusRequestWithClient:[SPiDClient sharedInstance] completionHandler:completionHandler];
+}
+
++ (void)runStatusRequestWithClient:(SPiDClient *)client {
+    SPiDRequest *statusRequest = [SPiDStatus statusRequestWithClient:client completionHandler:^(SPiDResponse *response) {
         SPiDDebugLog(@"Received status response: %@", response.rawJSON);
     }];
-    if ([SPiDClient sharedInstance].isAuthorized && ![SPiDClient sharedInstance].isClientToken) {
+    // Nothing waits for the status, send it with the next request instead of waking the radio for it
+    statusRequest.deferral = SPiDRequestDeferralDeferrable;
+    if (client.isAuthorized && !client.isClientToken) {
         [statusRequest startRequestWithAccessToken];
     } else {
         [statusRequest start];
     }
 }
 
-+ (SPiDRequest *)statusRequestWithCompletionHandler:(void (^)(SPiDResponse *response))completionHandler {
++ (SPiDRequest *)statusRequestWithClient:(SPiDClient *)client completionHandler:(void (^)(SPiDResponse *response))completionHandler {
     NSMutableDictionary *body = [NSMutableDictionary dictionary];
 #if TARGET_OS_IOS || TARGET_OS_TV
     [body setValue:[UIDevice currentDevice].name forKey:@"deviceName"];
@@ -61,9 +71,9 @@
 
     NSMutableDictionary *dict = [NSMutableDictionary dictionary];
     [dict setValue:jsonString forKey:@"fp"];
-    [dict setValue:[[SPiDClient sharedInstance] clientID] forKey:@"clientId"];
+    [dict setValue:[client clientID] forKey:@"clientId"];
 
-    SPiDRequest *request = [SPiDRequest apiPostRequestWithPath:@"/status" body:dict completionHandler:completionHandler];
+    SPiDRequest *request = [SPiDRequest apiPostRequestWithClient:client path:@"/status" body:dict completionHandler:completionHandler];
     return request;
 }
 
@@ -91,20 +101,26 @@
 }
 
 + (NSString *)spidUserAgent {
-    NSDictionary *infoDictionary = [[NSBundle mainBundle] infoDictionary];
-    NSString *bundleDisplayName = [infoDictionary objectForKey:@"CFBundleDisplayName"];
-    NSString *bundleMinorVersion = [infoDictionary objectForKey:@"CFBundleVersion"];
-    
+    // Info.plist and the device do not change while the app runs
+    static NSString *userAgent = nil;
+    static dispatch_once_t predicate;
+    dispatch_once(&predicate, ^{
+        NSDictionary *infoDictionary = [[NSBundle mainBundle] infoDictionary];
+        NSString *bundleDisplayName = [infoDictionary objectForKey:@"CFBundleDisplayName"];
+        NSString *bundleMinorVersion = [infoDictionary objectForKey:@"CFBundleVersion"];
+
 #if TARGET_OS_WATCH
-    NSString *deviceModel = [WKInterfaceDevice currentDevice].model;
-    NSOperatingSystemVersion version = [NSProcessInfo processInfo].operatingSystemVersion;
-    NSString *systemVersion = [NSString stringWithFormat:@"%zd.%zd.%zd", version.majorVersion, version.minorVersion, version.patchVersion];
+        NSString *deviceModel = [WKInterfaceDevice currentDevice].model;
+        NSOperatingSystemVersion version = [NSProcessInfo processInfo].operatingSystemVersion;
+        NSString *systemVersion = [NSString stringWithFormat:@"%zd.%zd.%zd", version.majorVersion, version.minorVersion, version.patchVersion];
 #else
-    NSString *deviceModel = [UIDevice currentDevice].model;
-    NSString *systemVersion = [UIDevice currentDevice].systemVersion;
+        NSString *deviceModel = [UIDevice currentDevice].model;
+        NSString *systemVersion = [UIDevice currentDevice].systemVersion;
 #endif
-    
-    return [NSString stringWithFormat:@"%@/%@ SPiDIOSSDK/%@ %@/%@", bundleDisplayName, bundleMinorVersion, SPID_IOS_SDK_VERSION_STRING, deviceModel, systemVersion];
+
+        userAgent = [NSString stringWithFormat:@"%@/%@ SPiDIOSSDK/%@ %@/%@", bundleDisplayName, bundleMinorVersion, SPID_IOS_SDK_VERSION_STRING, deviceModel, systemVersion];
+    });
+    return userAgent;
 }
 
 @end
@@ -62,6 +62,76 @@ NS_ASSUME_NONNULL_BEGIN
 */
 + (nullable instancetype)refreshTokenRequestWithCompletionHandler:(void (^)(NSError * __nullable))completionHandler;
 
+/** Creates a token refresh token request for a stored account
+
+ The refreshed token replaces the account in `SPiDClient.accountStore`, and only becomes the active access token if
+ the account is the active one.
+
+ @param accessToken The access token of the account to refresh
+ @param completionHandler Called on token request completion or error
+ @return The token request or nil if refresh token is missing
+*/
++ (nullable instancetype)refreshTokenRequestWithAccessToken:(SPiDAccessToken *)accessToken completionHandler:(void (^)(NSError * __nullable))completionHandler;
+
+///---------------------------------------------------------------------------------------
+/// @name Requests bound to a client
+///---------------------------------------------------------------------------------------
+
+/** Creates a client token request, the token is stored in the given client
+
+ @param client The client requesting the token
+ @param completionHandler Called on token request completion or error
+ @return The token request
+*/
++ (nullable instancetype)clientTokenRequestWithClient:(SPiDClient *)client completionHandler:(nullable void (^)(NSError * __nullable))completionHandler;
+
+/** Creates a user token request with authorization code, the token is stored in the given client
+
+ @param client The client requesting the token
+ @param code The authorization code
+ @param completionHandler Called on token request completion or error
+ @return The token request
+*/
++ (nullable instancetype)userTokenRequestWithClient:(SPiDClient *)client code:(NSString *)code completionHandler:(void (^)(NSError * __nullable))completionHandler;
+
+/** Creates a user token request with user credentials, the token is stored in the given client
+
+ @param client The client requesting the token
+ @param username The username
+ @param password The password
+ @param completionHandler Called on token request completion or error
+ @return The token request
+*/
++ (nullable instancetype)userTokenRequestWithClient:(SPiDClient *)client username:(NSString *)username password:(NSString *)password completionHandler:(void (^)(NSError * __nullable error))completionHandler;
+
+/** Creates a JWT facebook token request, the token is stored in the given client
+
+ @param client The client requesting the token
+ @param appId Facebook appID
+ @param facebookToken Facebook access token
+ @param expirationDate Expiration date for the facebook token
+ @param completionHandler Called on token request completion or error
+ @return The token request or nil if JWT could not be created
+*/
++ (nullable instancetype)userTokenRequestWithClient:(SPiDClient *)client facebookAppID:(NSString *)appId facebookToken:(NSString *)facebookToken expirationDate:(NSDate *)expirationDate completionHandler:(void (^)(NSError * __nullable))completionHandler;
+
+/** Creates a token refresh token request with the current access token of the given client
+
+ @param client The client whose access token is refreshed
+ @param completionHandler Called on token request completion or error
+ @return The token request or nil if refresh token is missing
+*/
++ (nullable instancetype)refreshTokenRequestWithClient:(SPiDClient *)client completionHandler:(void (^)(NSError * __nullable))completionHandler;
+
+/** Creates a token refresh token request for a account stored in the given client
+
+ @param client The client the account is stored in
+ @param accessToken The access token of the account to refresh
+ @param completionHandler Called on token request completion or error
+ @return The token request or nil if refresh token is missing
+*/
++ (nullable instancetype)refreshTokenRequestWithClient:(SPiDClient *)client accessToken:(SPiDAccessToken *)accessToken completionHandler:(void (^)(NSError * __nullable))completionHandler;
+
 @end
 
 NS_ASSUME_NONNULL_END
@@ -7,129 +7,188 @@
 
 #import "SPiDTokenRequest.h"
 #import "NSError+SPiD.h"
-#import "SPiDKeychainWrapper.h"
+#import "SPiDTokenStore.h"
 #import "SPiDJwt.h"
+#import "SPiDAccountStore.h"
+#import "SPiDIdentity.h"
 
 @interface SPiDTokenRequest ()
 
 /** Generates a facebook JWT token as a encoded string
 
+ @param client The client the token is requested for
  @param appId Facebook appID
  @param facebookToken Facebook access token
  @param expirationDate Expiration date for the facebook token
  @return JWT as a encoded string
  */
-+ (NSString *)facebookJwtStringWithAppId:(NSString *)appId facebookToken:(NSString *)facebookToken expirationDate:(NSDate *)expirationDate;
++ (NSString *)facebookJwtStringWithClient:(SPiDClient *)client appId:(NSString *)appId facebookToken:(NSString *)facebookToken expirationDate:(NSDate *)expirationDate;
 
 /** Generates post data for a token refresh
 
+ @param client The client the token is requested for
  @param accessToken `SPiDAccessToken` to be refreshed
  @return Dictionary containing the post data
  */
-+ (NSDictionary *)refreshTokenPostDataWithAccessToken:(SPiDAccessToken *)accessToken;
++ (NSDictionary *)refreshTokenPostDataWithClient:(SPiDClient *)client accessToken:(SPiDAccessToken *)accessToken;
 
 /** Generates post data for a user token request using JWT
 
+ @param client The client the token is requested for
  @param jwtString JWT as a encoded string
  @return Dictionary containing the post data
  */
-+ (NSDictionary *)userTokenPostDataWithJwt:(NSString *)jwtString;
++ (NSDictionary *)userTokenPostDataWithClient:(SPiDClient *)client jwt:(NSString *)jwtString;
 
 /** Generates post data for a user token request using user credentials
 
+ @param client The client the token is requested for
  @param username The username
  @param password The password
  @return Dictionary containing the post data
  */
-+ (NSDictionary *)userTokenPostDataWithUsername:(NSString *)username password:(NSString *)password;
++ (NSDictionary *)userTokenPostDataWithClient:(SPiDClient *)client username:(NSString *)username password:(NSString *)password;
 
 /** Generates post data for a access token request using authorization code
 
+ @param client The client the token is requested for
  @param code Authorization code
  @return Dictionary containing the post data
  */
-+ (NSDictionary *)userTokenPostDataWithCode:(NSString *)code;
++ (NSDictionary *)userTokenPostDataWithClient:(SPiDClient *)client code:(NSString *)code;
 
 /** Generates post data for a client token request
 
+ @param client The client the token is requested for
  @return A dictionary containing the post data
  */
-+ (NSDictionary *)clientTokenPostData;
++ (NSDictionary *)clientTokenPostDataWithClient:(SPiDClient *)client;
+
+/** Asks for a id_token in the post data of a user token request if the client requests identity tokens
+
+ @param data The post data
+ @param client The client the token is requested for
+ */
++ (void)addIdentityScopeToPostData:(NSMutableDictionary *)data client:(SPiDClient *)client;
+
+/** Verifies and decodes the id_token of a token response
+
+ @param response The token response
+ @param accessToken The access token from the same response
+ @return The identity, nil if there is no valid id_token for the user of the access token
+ */
+- (SPiDIdentity *)identityFromTokenResponse:(NSDictionary *)response accessToken:(SPiDAccessToken *)accessToken;
 
 /** Initializes a token request
 
+ @param client The client the token is requested for
  @param requestPath Path to token endpoint
  @param body Post body
  @param completionHandler Called on request completion or error
  @return SPiDTokenRequest
  */
-- (instancetype)initPostTokenRequestWithPath:(NSString *)requestPath body:(NSDictionary *)body completionHandler:(void (^ __nullable)(NSError *))completionHandler;
+- (instancetype)initPostTokenRequestWithClient:(SPiDClient *)client path:(NSString *)requestPath body:(NSDictionary *)body completionHandler:(void (^ __nullable)(NSError *))completionHandler;
 
 @property (nonatomic, copy) void(^tokenCompletionHandler)(NSError *error);
+@property (nonatomic, assign) BOOL clientTokenRequest;
+@property (nonatomic, copy, nullable) NSString *accountUserID;
 
 @end
 
 @implementation SPiDTokenRequest
 
 + (instancetype)clientTokenRequestWithCompletionHandler:(void (^)(NSError *error))completionHandler {
-    NSDictionary *postData = [self clientTokenPostData];
-    SPiDTokenRequest *request = [[self alloc] initPostTokenRequestWithPath:@"/oauth/token" body:postData completionHandler:completionHandler];
-    return request;
+    return [self clientTokenRequestWithClient:[SPiDClient sharedInstance] completionHandler:completionHandler];
 }
 
 + (instancetype)userTokenRequestWithCode:(NSString *)code completionHandler:(void (^)(NSError *error))completionHandler {
-    NSDictionary *postData = [self userTokenPostDataWithCode:code];
-    SPiDTokenRequest *request = [[self alloc] initPostTokenRequestWithPath:@"/oauth/token" body:postData completionHandler:completionHandler];
-    return request;
+    return [self userTokenRequestWithClient:[SPiDClient sharedInstance] code:code completionHandler:completionHandler];
 }
 
 + (instancetype)userTokenRequestWithUsername:(NSString *)username password:(NSString *)password completionHandler:(void (^)(NSError *error))completionHandler {
+    return [self userTokenRequestWithClient:[SPiDClient sharedInstance] username:username password:password completionHandler:completionHandler];
+}
+
++ (instancetype)userTokenRequestWithFacebookAppID:(NSString *)appId facebookToken:(NSString *)facebookToken expirationDate:(NSDate *)expirationDate completionHandler:(void (^)(NSError *))completionHandler {
+    return [self userTokenRequestWithClient:[SPiDClient sharedInstance] facebookAppID:appId facebookToken:facebookToken expirationDate:expirationDate completionHandler:completionHandler];
+}
+
++ (instancetype)refreshTokenRequestWithCompletionHandler:(void (^)(NSError *))completionHandler {
+    return [self refreshTokenRequestWithClient:[SPiDClient sharedInstance] completionHandler:completionHandler];
+}
+
++ (instancetype)refreshTokenRequestWithAccessToken:(SPiDAccessToken *)accessToken completionHandler:(void (^)(NSError *))completionHandler {
+    return [self refreshTokenRequestWithClient:[SPiDClient sharedInstance] accessToken:accessToken completionHandler:completionHandler];
+}
+
++ (instancetype)clientTokenRequestWithClient:(SPiDClient *)client completionHandler:(void (^)(NSError *error))completionHandler {
+    NSDictionary *postData = [self clientTokenPostDataWithClient:client];
+    SPiDTokenRequest *request = [[self alloc] initPostTokenRequestWithClient:client path:@"/oauth/token" body:postData completionHandler:completionHandler];
+    request.clientTokenRequest = YES;
+    return request;
+}
+
++ (instancetype)userTokenRequestWithClient:(SPiDClient *)client code:(NSString *)code completionHandler:(void (^)(NSError *error))completionHandler {
+    NSDictionary *postData = [self userTokenPostDataWithClient:client code:code];
+    SPiDTokenRequest *request = [[self alloc] initPostTokenRequestWithClient:client path:@"/oauth/token" body:postData completionHandler:completionHandler];
+    return request;
+}
+
++ (instancetype)userTokenRequestWithClient:(SPiDClient *)client username:(NSString *)username password:(NSString *)password completionHandler:(void (^)(NSError *error))completionHandler {
     NSString *trimmedUserName = [username stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]];
-    NSDictionary *postData = [self userTokenPostDataWithUsername:trimmedUserName password:password];
-    SPiDTokenRequest *request = [[self alloc] initPostTokenRequestWithPath:@"/oauth/token" body:postData completionHandler:completionHandler];
+    NSDictionary *postData = [self userTokenPostDataWithClient:client username:trimmedUserName password:password];
+    SPiDTokenRequest *request = [[self alloc] initPostTokenRequestWithClient:client path:@"/oauth/token" body:postData completionHandler:completionHandler];
     return request;
 }
 
-+ (instancetype)userTokenRequestWithFacebookAppID:(NSString *)appId facebookToken:(NSString *)facebookToken expirationDate:(NSDate *)expirationDate completionHandler:(void (^)(NSError *))completionHandler {
-    NSString *jwtString = [self facebookJwtStringWithAppId:appId facebookToken:facebookToken expirationDate:expirationDate];
++ (instancetype)userTokenRequestWithClient:(SPiDClient *)client facebookAppID:(NSString *)appId facebookToken:(NSString *)facebookToken expirationDate:(NSDate *)expirationDate completionHandler:(void (^)(NSError *))completionHandler {
+    NSString *jwtString = [self facebookJwtStringWithClient:client appId:appId facebookToken:facebookToken expirationDate:expirationDate];
     if (jwtString == nil) {
         return nil; // Should not happen, throw exception
     }
-    NSDictionary *body = [SPiDTokenRequest userTokenPostDataWithJwt:jwtString];
-    SPiDTokenRequest *request = [[self alloc] initPostTokenRequestWithPath:@"/oauth/token" body:body completionHandler:completionHandler];
+    NSDictionary *body = [SPiDTokenRequest userTokenPostDataWithClient:client jwt:jwtString];
+    SPiDTokenRequest *request = [[self alloc] initPostTokenRequestWithClient:client path:@"/oauth/token" body:body completionHandler:completionHandler];
     return request;
 }
 
-+ (instancetype)refreshTokenRequestWithCompletionHandler:(void (^)(NSError *))completionHandler {
-    SPiDAccessToken *accessToken = [SPiDClient sharedInstance].accessToken;
-    if (accessToken == nil || accessToken.refreshToken == nil) {
-        SPiDDebugLog(@"No access token, cannot refreshTrying to refresh access token with refresh token: %@", accessToken.refreshToken);
++ (instancetype)refreshTokenRequestWithClient:(SPiDClient *)client completionHandler:(void (^)(NSError *))completionHandler {
+    SPiDAccessToken *accessToken = client.accessToken;
+    if (accessToken == nil) {
+        SPiDDebugLog(@"No access token, cannot refresh");
+        return nil;
+    }
+    return [self refreshTokenRequestWithClient:client accessToken:accessToken completionHandler:completionHandler];
+}
+
++ (instancetype)refreshTokenRequestWithClient:(SPiDClient *)client accessToken:(SPiDAccessToken *)accessToken completionHandler:(void (^)(NSError *))completionHandler {
+    if (accessToken.refreshToken == nil) {
+        SPiDDebugLog(@"No refresh token, cannot refresh access token for user: %@", accessToken.userID);
         return nil;
     }
     SPiDDebugLog(@"Trying to refresh access token with refresh token: %@", accessToken.refreshToken);
-    NSDictionary *postData = [self refreshTokenPostDataWithAccessToken:accessToken];
-    SPiDTokenRequest *request = [[self alloc] initPostTokenRequestWithPath:@"/oauth/token" body:postData completionHandler:completionHandler];
+    NSDictionary *postData = [self refreshTokenPostDataWithClient:client accessToken:accessToken];
+    SPiDTokenRequest *request = [[self alloc] initPostTokenRequestWithClient:client path:@"/oauth/token" body:postData completionHandler:completionHandler];
+    request.accountUserID = accessToken.userID;
     return request;
 }
 
 ///---------------------------------------------------------------------------------------
 /// @name Private Methods
 ///---------------------------------------------------------------------------------------
-+ (NSString *)facebookJwtStringWithAppId:(NSString *)appId facebookToken:(NSString *)facebookToken expirationDate:(NSDate *)expirationDate {
++ (NSString *)facebookJwtStringWithClient:(SPiDClient *)client appId:(NSString *)appId facebookToken:(NSString *)facebookToken expirationDate:(NSDate *)expirationDate {
     NSMutableDictionary *dictionary = [NSMutableDictionary dictionary];
     [dictionary setValue:appId forKey:@"iss"];
     [dictionary setValue:@"authorization" forKey:@"sub"];
-    [dictionary setValue:[SPiDClient sharedInstance].tokenURL.absoluteString forKey:@"aud"];
+    [dictionary setValue:client.tokenURL.absoluteString forKey:@"aud"];
     [dictionary setValue:expirationDate.description forKey:@"exp"];
     [dictionary setValue:@"facebook" forKey:@"token_type"];
     [dictionary setValue:facebookToken forKey:@"token_value"];
     SPiDJwt *jwt = [SPiDJwt jwtTokenWithDictionary:dictionary];
-    NSString *jwtString = jwt.encodedJwtString;
+    NSString *jwtString = [jwt encodedJwtStringWithSignSecret:client.signSecret];
     return jwtString;
 }
 
-+ (NSDictionary *)refreshTokenPostDataWithAccessToken:(SPiDAccessToken *)accessToken {
-    SPiDClient *client = [SPiDClient sharedInstance];
++ (NSDictionary *)refreshTokenPostDataWithClient:(SPiDClient *)client accessToken:(SPiDAccessToken *)accessToken {
     NSMutableDictionary *data = [NSMutableDictionary dictionary];
     [data setValue:client.clientID forKey:@"client_id"];
     [data setValue:client.clientSecret forKey:@"client_secret"];
@@ -138,30 +197,29 @@
     return data;
 }
 
-+ (NSDictionary *)userTokenPostDataWithJwt:(NSString *)jwtString {
-    SPiDClient *client = [SPiDClient sharedInstance];
++ (NSDictionary *)userTokenPostDataWithClient:(SPiDClient *)client jwt:(NSString *)jwtString {
     NSMutableDictionary *data = [NSMutableDictionary dictionary];
     [data setValue:client.clientSecret forKey:@"client_secret"];
     [data setValue:client.clientID forKey:@"client_id"];
     [data setValue:@"urn:ietf:params:oauth:grant-type:jwt-bearer" forKey:@"grant_type"];
     [data setValue:jwtString forKey:@"assertion"];
+    [self addIdentityScopeToPostData:data client:client];
     //[data setValue:client.tokenURL.absoluteString forKey:@"redirect_uri"];
     return data;
 }
 
-+ (NSDictionary *)userTokenPostDataWithUsername:(NSString *)username password:(NSString *)password {
-    SPiDClient *client = [SPiDClient sharedInstance];
++ (NSDictionary *)userTokenPostDataWithClient:(SPiDClient *)client username:(NSString *)username password:(NSString *)password {
     NSMutableDictionary *data = [NSMutableDictionary dictionary];
     [data setValue:[client clientID] forKey:@"client_id"];
     [data setValue:[client clientSecret] forKey:@"client_secret"];
     [data setValue:@"password" forKey:@"grant_type"];
     [data setValue:username forKey:@"username"];
     [data setValue:password forKey:@"password"];
+    [self addIdentityScopeToPostData:data client:client];
     return data;
 }
 
-+ (NSDictionary *)userTokenPostDataWithCode:(NSString *)code {
-    SPiDClient *client = [SPiDClient sharedInstance];
++ (NSDictionary *)userTokenPostDataWithClient:(SPiDClient *)client code:(NSString *)code {
     NSMutableDictionary *data = [NSMutableDictionary dictionary];
     [data setValue:[client clientID] forKey:@"client_id"];
     [data setValue:[client clientSecret] forKey:@"client_secret"];
@@ -172,11 +230,11 @@
         [data setValue:[client.redirectURI.absoluteString stringByAppendingString:@"/login"] forKey:@"redirect_uri"];
     }
     [data setValue:code forKey:@"code"];
+    [self addIdentityScopeToPostData:data client:client];
     return data;
 }
 
-+ (NSDictionary *)clientTokenPostData {
-    SPiDClient *client = [SPiDClient sharedInstance];
++ (NSDictionary *)clientTokenPostDataWithClient:(SPiDClient *)client {
     NSMutableDictionary *data = [NSMutableDictionary dictionary];
     [data setValue:[client clientID] forKey:@"client_id"];
     [data setValue:[client clientSecret] forKey:@"client_secret"];
@@ -184,8 +242,33 @@
     return data;
 }
 
-- (instancetype)initPostTokenRequestWithPath:(NSString *)requestPath body:(NSDictionary *)body completionHandler:(void (^)(NSError *error))completionHandler {
-    if ((self = [SPiDTokenRequest requestWithPath:requestPath method:@"POST" body:body completionHandler:nil])) {
++ (void)addIdentityScopeToPostData:(NSMutableDictionary *)data client:(SPiDClient *)client {
+    if (client.requestsIdentityToken) {
+        [data setValue:@"openid" forKey:@"scope"];
+    }
+}
+
+- (SPiDIdentity *)identityFromTokenResponse:(NSDictionary *)response accessToken:(SPiDAccessToken *)accessToken {
+    NSString *idToken = [response objectForKey:@"id_token"];
+    SPiDClient *client = self.client;
+    if (![idToken isKindOfClass:[NSString class]] || client.clientID == nil || client.clientSecret == nil || client.serverURL == nil) {
+        return nil;
+    }
+    NSError *error;
+    SPiDIdentity *identity = [SPiDIdentity identityWithIDToken:idToken clientID:client.clientID clientSecret:client.clientSecret issuer:client.serverURL error:&error];
+    if (identity == nil) {
+        SPiDDebugLog(@"Ignoring invalid id_token: %@", error);
+        return nil;
+    }
+    if (accessToken.userID && ![accessToken.userID isEqualToString:identity.userID]) {
+        SPiDDebugLog(@"Ignoring id_token for user: %@, access token is for user: %@", identity.userID, accessToken.userID);
+        return nil;
+    }
+    return identity;
+}
+
+- (instancetype)initPostTokenRequestWithClient:(SPiDClient *)client path:(NSString *)requestPath body:(NSDictionary *)body completionHandler:(void (^)(NSError *error))completionHandler {
+    if ((self = [SPiDTokenRequest requestWithClient:client path:requestPath method:@"POST" body:body completionHandler:nil])) {
         self.tokenCompletionHandler = completionHandler;
     }
     
@@ -195,7 +278,7 @@
 - (void)startWithRequest:(NSURLRequest *)request {
     SPiDDebugLog(@"Running token request: %@", request.URL);
     
-    NSURLSessionDataTask *task = [[[SPiDClient sharedInstance] URLSession] dataTaskWithRequest:request completionHandler:^(NSData *data, NSURLResponse *response, NSError *error) {
+    NSURLSessionDataTask *task = [[self.client URLSession] dataTaskWithRequest:request completionHandler:^(NSData *data, NSURLResponse *response, NSError *error) {
         if(error) {
             SPiDDebugLog(@"SPiDSDK error: %@", [error description]);
             self.tokenCompletionHandler(error);
@@ -215,9 +298,24 @@
                     self.tokenCompletionHandler(error);
                 } else /*if (_receivedData)*/ {
                     SPiDAccessToken *accessToken = [[SPiDAccessToken alloc] initWithDictionary:jsonObject];
-                    [SPiDKeychainWrapper storeInKeychainAccessTokenWithValue:accessToken forIdentifier:AccessTokenKeychainIdentification];
-                    [[SPiDClient sharedInstance] setAccessToken:accessToken];
-                    [[SPiDClient sharedInstance] authorizationComplete];
+                    if (self.clientTokenRequest) {
+                        // Client tokens have their own slot and never replace the user session
+                        [[self.client tokenStore] storeAccessToken:accessToken forIdentifier:[self.client clientAccessTokenIdentifier]];
+                        [self.client setClientAccessToken:accessToken];
+                    } else if (self.accountUserID && ![self.accountUserID isEqualToString:[self.client currentUserID]]) {
+                        // Refreshed a account that is not active, the current session is left as is
+                        [[self.client accountStore] storeAccessToken:accessToken];
+                    } else {
+                        [[self.client accountStore] storeAccessToken:accessToken];
+                        [[self.client tokenStore] storeAccessToken:accessToken forIdentifier:[self.client accessTokenIdentifier]];
+                        [self.client setAccessToken:accessToken];
+                        // A refresh without a id_token keeps the identity, unless it belongs to someone else
+                        SPiDIdentity *identity = [self identityFromTokenResponse:jsonObject accessToken:accessToken];
+                        if (identity || ![self.client.currentIdentity.userID isEqualToString:accessToken.userID]) {
+                            [self.client setCurrentIdentity:identity];
+                        }
+                        [self.client authorizationComplete];
+                    }
                     self.tokenCompletionHandler(nil);
                 }
             } else {
@@ -226,8 +324,11 @@
             }
         }
     }];
-    
-    [task resume];
+
+    // Token requests are always urgent, anything deferred can go out with them
+    [[self.client requestScheduler] scheduleTask:^{
+        [task resume];
+    } deferral:SPiDRequestDeferralNone];
 }
 
 @end
@@ -0,0 +1,55 @@
+//
+//  SPiDTokenStore.h
+//  SPiDSDK
+//
+//  Copyright (c) 2012 Schibsted Payment. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+@class SPiDAccessToken;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/** `SPiDTokenStore` is implemented by the backends that persist access tokens.
+
+ The SDK uses `SPiDKeychainTokenStore` by default, `SPiDFileTokenStore` keeps tokens in encrypted files instead. A
+ store may defer writes, but must return the latest stored value from reads and must have written everything when
+ `flush` returns.
+ */
+
+@protocol SPiDTokenStore <NSObject>
+
+/** Loads a access token
+
+ @param identifier Unique identification of the token
+ @return Access token or nil if none is stored
+ */
+- (nullable SPiDAccessToken *)accessTokenForIdentifier:(NSString *)identifier;
+
+/** Loads all access tokens with a common identifier prefix
+
+ @param prefix Prefix of the token identifiers
+ @return Access tokens keyed by their identifier
+ */
+- (NSDictionary<NSString *, SPiDAccessToken *> *)accessTokensWithIdentifierPrefix:(NSString *)prefix;
+
+/** Stores a access token, replacing any token with the same identifier
+
+ @param accessToken Access token to store
+ @param identifier Unique identification of the token
+ */
+- (void)storeAccessToken:(SPiDAccessToken *)accessToken forIdentifier:(NSString *)identifier;
+
+/** Removes a access token
+
+ @param identifier Unique identification of the token
+ */
+- (void)removeAccessTokenForIdentifier:(NSString *)identifier;
+
+/** Writes all deferred changes before returning */
+- (void)flush;
+
+@end
+
+NS_ASSUME_NONNULL_END
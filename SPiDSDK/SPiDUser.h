@@ -9,13 +9,19 @@
 
 NS_ASSUME_NONNULL_BEGIN
 
+@class SPiDClient;
+
 /** Handles user creation and validation against SPiD.
 
- This requires access to the /signup endpoint with client credentials
+ This requires access to the /signup endpoint with client credentials. The class methods use the singleton client,
+ instances created with `initWithClient:` send their requests for the given client.
 */
 
 @interface SPiDUser : NSObject
 
+/** The client the requests are sent for, defaults to `+[SPiDClient sharedInstance]` */
+@property (nonatomic, strong) SPiDClient *client;
+
 ///---------------------------------------------------------------------------------------
 /// @name Public Methods
 ///---------------------------------------------------------------------------------------
@@ -46,6 +52,39 @@ NS_ASSUME_NONNULL_BEGIN
 */
 + (void)attachAccountWithFacebookAppID:(NSString *)appId facebookToken:(NSString *)facebookToken expirationDate:(NSDate *)expirationDate completionHandler:(void (^)(NSError * __nullable))completionHandler;
 
+/** Initializes a user handler bound to a client
+
+ @param client The client the requests are sent for
+ @return `SPiDUser`
+*/
+- (instancetype)initWithClient:(SPiDClient *)client;
+
+/** Creates a new SPiD user account
+
+ @param email The email
+ @param password The password
+ @param completionHandler Called after user has been created
+*/
+- (void)createAccountWithEmail:(NSString *)email password:(NSString *)password completionHandler:(void (^)(NSError * __nullable))completionHandler;
+
+/** Creates a new SPiD user account using a Facebook user
+
+ @param appId Facebook app id
+ @param facebookToken Facebook access token
+ @param expirationDate Facebook access token expiration date
+ @param completionHandler Called after user has been created
+*/
+- (void)createAccountWithFacebookAppID:(NSString *)appId facebookToken:(NSString *)facebookToken expirationDate:(NSDate *)expirationDate completionHandler:(void (^)(NSError * __nullable))completionHandler;
+
+/** Attaches a Facebook user to the user logged in with the client
+
+ @param appId Facebook app id
+ @param facebookToken Facebook access token
+ @param expirationDate Facebook access token expiration date
+ @param completionHandler Called after user has been created
+*/
+- (void)attachAccountWithFacebookAppID:(NSString *)appId facebookToken:(NSString *)facebookToken expirationDate:(NSDate *)expirationDate completionHandler:(void (^)(NSError * __nullable))completionHandler;
+
 /** Validates user credentials
 
  @param email The email to validate
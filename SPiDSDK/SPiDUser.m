@@ -21,7 +21,7 @@
 * @param
 * @return
 */
-+ (SPiDJwt *)facebookJwtWithAppId:(NSString *)appId facebookToken:(NSString *)facebookToken expirationDate:(NSDate *)expirationDate;
+- (SPiDJwt *)facebookJwtWithAppId:(NSString *)appId facebookToken:(NSString *)facebookToken expirationDate:(NSDate *)expirationDate;
 
 /**
 *
@@ -29,7 +29,7 @@
 * @param
 * @return
 */
-+ (SPiDJwt *)attachFacebookJwtWithAppId:(NSString *)appId facebookToken:(NSString *)facebookToken expirationDate:(NSDate *)expirationDate;
+- (SPiDJwt *)attachFacebookJwtWithAppId:(NSString *)appId facebookToken:(NSString *)facebookToken expirationDate:(NSDate *)expirationDate;
 
 /** Generates user credentials post data
 
@@ -56,61 +56,65 @@
 @implementation SPiDUser
 
 + (void)createAccountWithEmail:(NSString *)email password:(NSString *)password completionHandler:(void (^)(NSError *response))completionHandler {
-    SPiDUser *user = [[SPiDUser alloc] init];
-    // Get client token
-    SPiDAccessToken *accessToken = [SPiDClient sharedInstance].accessToken;
-    if (accessToken == nil || !accessToken.isClientToken) {
-        SPiDDebugLog(@"No client token found, trying to request one");
-        SPiDRequest *clientTokenRequest = [SPiDTokenRequest clientTokenRequestWithCompletionHandler:^(NSError *error) {
-            if (error) {
-                completionHandler(error);
-            } else {
-                SPiDDebugLog(@"Client token received, creating account");
-                [user accountRequestWithEmail:email password:password completionHandler:completionHandler];
-            }
-        }];
-        [clientTokenRequest start];
-    } else {
-        SPiDDebugLog(@"Client token found, creating account");
-        [user accountRequestWithEmail:email password:password completionHandler:completionHandler];
-    }
+    SPiDUser *user = [[SPiDUser alloc] initWithClient:[SPiDClient sharedInstance]];
+    [user createAccountWithEmail:email password:password completionHandler:completionHandler];
 }
 
 + (void)createAccountWithFacebookAppID:(NSString *)appId facebookToken:(NSString *)facebookToken expirationDate:(NSDate *)expirationDate completionHandler:(void (^)(NSError *))completionHandler {
-    SPiDJwt *jwt = [self facebookJwtWithAppId:appId facebookToken:facebookToken expirationDate:expirationDate];
-    SPiDUser *user = [[SPiDUser alloc] init];
-
-    // Get client token
-    SPiDAccessToken *accessToken = [SPiDClient sharedInstance].accessToken;
-    if (accessToken == nil || !accessToken.isClientToken) {
-        SPiDDebugLog(@"No client token found, trying to request one");
-        SPiDRequest *clientTokenRequest = [SPiDTokenRequest clientTokenRequestWithCompletionHandler:^(NSError *error) {
-            if (error) {
-                completionHandler(error);
-            } else {
-                SPiDDebugLog(@"Client token received, creating account");
-                [user accountRequestWithJwt:jwt completionHandler:completionHandler];
-            }
-        }];
-        [clientTokenRequest start];
-    } else {
-        SPiDDebugLog(@"Client token found, creating account");
-        [user accountRequestWithJwt:jwt completionHandler:completionHandler];
-    }
+    SPiDUser *user = [[SPiDUser alloc] initWithClient:[SPiDClient sharedInstance]];
+    [user createAccountWithFacebookAppID:appId facebookToken:facebookToken expirationDate:expirationDate completionHandler:completionHandler];
 }
 
 + (void)attachAccountWithFacebookAppID:(NSString *)appId facebookToken:(NSString *)facebookToken expirationDate:(NSDate *)expirationDate completionHandler:(void (^)(NSError *))completionHandler {
-    if (![SPiDClient sharedInstance].isAuthorized || [SPiDClient sharedInstance].isClientToken) {
+    SPiDUser *user = [[SPiDUser alloc] initWithClient:[SPiDClient sharedInstance]];
+    [user attachAccountWithFacebookAppID:appId facebookToken:facebookToken expirationDate:expirationDate completionHandler:completionHandler];
+}
+
+- (instancetype)initWithClient:(SPiDClient *)client {
+    if (self = [super init]) {
+        self.client = client;
+    }
+    return self;
+}
+
+- (SPiDClient *)client {
+    return _client ?: [SPiDClient sharedInstance];
+}
+
+- (void)createAccountWithEmail:(NSString *)email password:(NSString *)password completionHandler:(void (^)(NSError *response))completionHandler {
+    [self.client clientTokenWithCompletionHandler:^(NSError *error) {
+        if (error) {
+            completionHandler(error);
+        } else {
+            SPiDDebugLog(@"Client token available, creating account");
+            [self accountRequestWithEmail:email password:password completionHandler:completionHandler];
+        }
+    }];
+}
+
+- (void)createAccountWithFacebookAppID:(NSString *)appId facebookToken:(NSString *)facebookToken expirationDate:(NSDate *)expirationDate completionHandler:(void (^)(NSError *))completionHandler {
+    SPiDJwt *jwt = [self facebookJwtWithAppId:appId facebookToken:facebookToken expirationDate:expirationDate];
+    [self.client clientTokenWithCompletionHandler:^(NSError *error) {
+        if (error) {
+            completionHandler(error);
+        } else {
+            SPiDDebugLog(@"Client token available, creating account");
+            [self accountRequestWithJwt:jwt completionHandler:completionHandler];
+        }
+    }];
+}
+
+- (void)attachAccountWithFacebookAppID:(NSString *)appId facebookToken:(NSString *)facebookToken expirationDate:(NSDate *)expirationDate completionHandler:(void (^)(NSError *))completionHandler {
+    if (!self.client.isAuthorized || self.client.isClientToken) {
         completionHandler([NSError sp_oauth2ErrorWithCode:-9999 reason:@"User token needed" descriptions:[NSDictionary dictionaryWithObjectsAndKeys:@"User token needed to attach facebook", @"error", nil]]);
     }
 
     SPiDJwt *jwt = [self attachFacebookJwtWithAppId:appId facebookToken:facebookToken expirationDate:expirationDate];
-    SPiDUser *user = [[SPiDUser alloc] init];
-    [user attachAccountRequestWithJwt:jwt completionHandler:completionHandler];
+    [self attachAccountRequestWithJwt:jwt completionHandler:completionHandler];
 }
 
-+ (SPiDJwt *)facebookJwtWithAppId:(NSString *)appId facebookToken:(NSString *)facebookToken expirationDate:(NSDate *)expirationDate {
-    NSString *aud = [NSString stringWithFormat:@"%@/api/2/signup_jwt", [SPiDClient sharedInstance].serverURL.absoluteString];
+- (SPiDJwt *)facebookJwtWithAppId:(NSString *)appId facebookToken:(NSString *)facebookToken expirationDate:(NSDate *)expirationDate {
+    NSString *aud = [NSString stringWithFormat:@"%@/api/2/signup_jwt", self.client.serverURL.absoluteString];
     NSMutableDictionary *dictionary = [NSMutableDictionary dictionary];
     [dictionary setValue:appId forKey:@"iss"];
     [dictionary setValue:@"registration" forKey:@"sub"];
@@ -122,8 +126,8 @@
     return jwt;
 }
 
-+ (SPiDJwt *)attachFacebookJwtWithAppId:(NSString *)appId facebookToken:(NSString *)facebookToken expirationDate:(NSDate *)expirationDate {
-    NSString *aud = [NSString stringWithFormat:@"%@/api/2/attach_jwt", [SPiDClient sharedInstance].serverURL.absoluteString];
+- (SPiDJwt *)attachFacebookJwtWithAppId:(NSString *)appId facebookToken:(NSString *)facebookToken expirationDate:(NSDate *)expirationDate {
+    NSString *aud = [NSString stringWithFormat:@"%@/api/2/attach_jwt", self.client.serverURL.absoluteString];
     NSMutableDictionary *dictionary = [NSMutableDictionary dictionary];
     [dictionary setValue:appId forKey:@"iss"];
     [dictionary setValue:@"attach" forKey:@"sub"];
@@ -139,14 +143,14 @@
     NSMutableDictionary *data = [NSMutableDictionary dictionary];
     [data setValue:email forKey:@"email"];
     [data setValue:password forKey:@"password"];
-    [data setValue:[[SPiDClient sharedInstance] authorizationURLWithQuery].absoluteString forKey:@"redirectUri"];
+    [data setValue:[self.client authorizationURLWithQuery].absoluteString forKey:@"redirectUri"];
     return data;
 }
 
 - (NSDictionary *)userPostDataWithJwt:(SPiDJwt *)jwt {
     NSMutableDictionary *data = [NSMutableDictionary dictionary];
     // TODO: should check for nil even though it should not happen!
-    [data setValue:jwt.encodedJwtString forKey:@"jwt"];
+    [data setValue:[jwt encodedJwtStringWithSignSecret:self.client.signSecret] forKey:@"jwt"];
     return data;
 }
 
@@ -163,23 +167,23 @@
 
 - (void)accountRequestWithEmail:(NSString *)email password:(NSString *)password completionHandler:(void (^)(NSError *))completionHandler {
     NSDictionary *postBody = [self userPostDataWithEmail:email password:password];
-    SPiDRequest *request = [SPiDRequest apiPostRequestWithPath:@"/signup" body:postBody completionHandler:^(SPiDResponse *response) {
+    SPiDRequest *request = [SPiDRequest apiPostRequestWithClient:self.client path:@"/signup" body:postBody completionHandler:^(SPiDResponse *response) {
         completionHandler([response error]);
     }];
-    [request startRequestWithAccessToken];
+    [request startRequestWithClientToken];
 }
 
 - (void)accountRequestWithJwt:(SPiDJwt *)jwt completionHandler:(void (^)(NSError *))completionHandler {
     NSDictionary *postBody = [self userPostDataWithJwt:jwt];
-    SPiDRequest *request = [SPiDRequest apiPostRequestWithPath:@"/signup_jwt" body:postBody completionHandler:^(SPiDResponse *response) {
+    SPiDRequest *request = [SPiDRequest apiPostRequestWithClient:self.client path:@"/signup_jwt" body:postBody completionHandler:^(SPiDResponse *response) {
         completionHandler([response error]);
     }];
-    [request startRequestWithAccessToken];
+    [request startRequestWithClientToken];
 }
 
 - (void)attachAccountRequestWithJwt:(SPiDJwt *)jwt completionHandler:(void (^)(NSError *))completionHandler {
     NSDictionary *postBody = [self userPostDataWithJwt:jwt];
-    SPiDRequest *request = [SPiDRequest apiPostRequestWithPath:@"/user/attach_jwt" body:postBody completionHandler:^(SPiDResponse *response) {
+    SPiDRequest *request = [SPiDRequest apiPostRequestWithClient:self.client path:@"/user/attach_jwt" body:postBody completionHandler:^(SPiDResponse *response) {
         completionHandler([response error]);
     }];
     [request startRequestWithAccessToken];
@@ -0,0 +1,101 @@
+//
+//  SPiDUserProfile.h
+//  SPiDSDK
+//
+//  Copyright (c) 2012 Schibsted Payment. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+@class SPiDResponse;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/** User object returned by the `/me` and `/user/{id}` endpoints
+
+ Only the user ID is read when the profile is created, every other field is decoded from the response the first time
+ it is read and then cached. Values of the wrong type are treated as missing, times are read as UTC and the birthday
+ as a day in the time zone of the current calendar. Profiles are
+ immutable and can be shared between threads.
+
+ For information about the user object see: <http://www.schibstedpayment.no/docs/doku.php?id=wiki:user_api>
+ */
+
+@interface SPiDUserProfile : NSObject <NSCopying>
+
+///---------------------------------------------------------------------------------------
+/// @name Properties
+///---------------------------------------------------------------------------------------
+
+/** User ID, `userId` */
+@property (nonatomic, copy, readonly) NSString *userID;
+
+/** Global user ID, `uuid` */
+@property (nonatomic, copy, readonly, nullable) NSString *uuid;
+
+/** Primary email address, `email` */
+@property (nonatomic, copy, readonly, nullable) NSString *email;
+
+/** Display name, `displayName` */
+@property (nonatomic, copy, readonly, nullable) NSString *displayName;
+
+/** Given name, `name.givenName` */
+@property (nonatomic, copy, readonly, nullable) NSString *givenName;
+
+/** Family name, `name.familyName` */
+@property (nonatomic, copy, readonly, nullable) NSString *familyName;
+
+/** Preferred username, `preferredUsername` */
+@property (nonatomic, copy, readonly, nullable) NSString *preferredUsername;
+
+/** Phone number, `phoneNumber` */
+@property (nonatomic, copy, readonly, nullable) NSString *phoneNumber;
+
+/** Gender, `gender` */
+@property (nonatomic, copy, readonly, nullable) NSString *gender;
+
+/** Profile photo, `photo` */
+@property (nonatomic, copy, readonly, nullable) NSURL *photoURL;
+
+/** Birthday at midnight in the time zone of the current calendar, `birthday`. Nil if the user has not set it. */
+@property (nonatomic, copy, readonly, nullable) NSDate *birthday;
+
+/** Time the user was verified, `verified`. Nil if the user is not verified. */
+@property (nonatomic, copy, readonly, nullable) NSDate *verifiedAt;
+
+/** Time the user was created, `published` */
+@property (nonatomic, copy, readonly, nullable) NSDate *createdAt;
+
+/** Time the user was last updated, `updated` */
+@property (nonatomic, copy, readonly, nullable) NSDate *updatedAt;
+
+/** The user object as received, for fields without a property */
+@property (nonatomic, copy, readonly) NSDictionary<NSString *, id> *data;
+
+///---------------------------------------------------------------------------------------
+/// @name Public methods
+///---------------------------------------------------------------------------------------
+
+/** Creates a profile from a `/me` or `/user/{id}` response
+
+ @param response Response from `meRequestWithCompletionHandler:` or `userRequestWithID:completionHandler:`
+ @return `SPiDUserProfile`, nil if the response has an error or no user object
+ */
++ (nullable instancetype)profileWithResponse:(SPiDResponse *)response;
+
+/** Initializes the profile from a user object
+
+ The user object is deep copied so that mutable containers of the response can not change the profile. This walks
+ every nested dictionary and array and allocates a copy of each, so the cost grows with the size of the user object
+ even though fields are only decoded when read. `testLazyDecodePerformance` includes the copy.
+
+ @param data The `data` object of the response
+ @return `SPiDUserProfile`, nil if there is no user ID
+ */
+- (nullable instancetype)initWithData:(NSDictionary<NSString *, id> *)data NS_DESIGNATED_INITIALIZER;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+@end
+
+NS_ASSUME_NONNULL_END
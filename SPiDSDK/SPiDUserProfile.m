@@ -0,0 +1,306 @@
+//
+//  SPiDUserProfile.m
+//  SPiDSDK
+//
+//  Copyright (c) 2012 Schibsted Payment. All rights reserved.
+//
+
+#import "SPiDUserProfile.h"
+#import "SPiDResponse.h"
+#include <pthread.h>
+#include <time.h>
+
+static NSString *const SPiDUserProfileDataKey = @"data";
+static NSString *const SPiDUserProfileUserIDKey = @"userId";
+
+typedef NS_ENUM(NSUInteger, SPiDUserProfileValueType) {
+    SPiDUserProfileStringValue,
+    SPiDUserProfileURLValue,
+    SPiDUserProfileDayValue, // YYYY-MM-DD
+    SPiDUserProfileTimeValue, // YYYY-MM-DD hh:mm:ss
+};
+
+typedef NS_ENUM(NSUInteger, SPiDUserProfileField) {
+    SPiDUserProfileUUIDField,
+    SPiDUserProfileEmailField,
+    SPiDUserProfileDisplayNameField,
+    SPiDUserProfileGivenNameField,
+    SPiDUserProfileFamilyNameField,
+    SPiDUserProfilePreferredUsernameField,
+    SPiDUserProfilePhoneNumberField,
+    SPiDUserProfileGenderField,
+    SPiDUserProfilePhotoURLField,
+    SPiDUserProfileBirthdayField,
+    SPiDUserProfileVerifiedAtField,
+    SPiDUserProfileCreatedAtField,
+    SPiDUserProfileUpdatedAtField,
+    SPiDUserProfileFieldCount
+};
+
+/** Where a field is found in the user object, `nestedKey` is set for fields inside a nested object */
+typedef struct {
+    __unsafe_unretained NSString *key;
+    __unsafe_unretained NSString *nestedKey;
+    SPiDUserProfileValueType type;
+} SPiDUserProfileKey;
+
+static const SPiDUserProfileKey SPiDUserProfileKeys[SPiDUserProfileFieldCount] = {
+    [SPiDUserProfileUUIDField] = {@"uuid", nil, SPiDUserProfileStringValue},
+    [SPiDUserProfileEmailField] = {@"email", nil, SPiDUserProfileStringValue},
+    [SPiDUserProfileDisplayNameField] = {@"displayName", nil, SPiDUserProfileStringValue},
+    [SPiDUserProfileGivenNameField] = {@"name", @"givenName", SPiDUserProfileStringValue},
+    [SPiDUserProfileFamilyNameField] = {@"name", @"familyName", SPiDUserProfileStringValue},
+    [SPiDUserProfilePreferredUsernameField] = {@"preferredUsername", nil, SPiDUserProfileStringValue},
+    [SPiDUserProfilePhoneNumberField] = {@"phoneNumber", nil, SPiDUserProfileStringValue},
+    [SPiDUserProfileGenderField] = {@"gender", nil, SPiDUserProfileStringValue},
+    [SPiDUserProfilePhotoURLField] = {@"photo", nil, SPiDUserProfileURLValue},
+    [SPiDUserProfileBirthdayField] = {@"birthday", nil, SPiDUserProfileDayValue},
+    [SPiDUserProfileVerifiedAtField] = {@"verified", nil, SPiDUserProfileTimeValue},
+    [SPiDUserProfileCreatedAtField] = {@"published", nil, SPiDUserProfileTimeValue},
+    [SPiDUserProfileUpdatedAtField] = {@"updated", nil, SPiDUserProfileTimeValue},
+};
+
+static BOOL SPiDParseDigits(const char *string, int count, int *value) {
+    int result = 0;
+    for (int i = 0; i < count; i++) {
+        if (string[i] < '0' || string[i] > '9') {
+            return NO;
+        }
+        result = result * 10 + (string[i] - '0');
+    }
+    *value = result;
+    return YES;
+}
+
+static int SPiDDaysInMonth(int year, int month) {
+    static const int days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    BOOL isLeapYear = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    return month == 2 && isLeapYear ? 29 : days[month - 1];
+}
+
+/** Days are read as midnight in the time zone of the current calendar, times as UTC */
+static NSDate *SPiDUserProfileDate(NSString *string, BOOL hasTime) {
+    char buffer[20];
+    NSUInteger length = hasTime ? 19 : 10;
+    if (string.length != length || ![string getCString:buffer maxLength:sizeof(buffer) encoding:NSASCIIStringEncoding]) {
+        return nil;
+    }
+
+    int year, month, day, hour = 0, minute = 0, second = 0;
+    if (!SPiDParseDigits(buffer, 4, &year) || buffer[4] != '-' || !SPiDParseDigits(buffer + 5, 2, &month) || buffer[7] != '-' || !SPiDParseDigits(buffer + 8, 2, &day)) {
+        return nil;
+    }
+    if (hasTime && ((buffer[10] != ' ' && buffer[10] != 'T') || !SPiDParseDigits(buffer + 11, 2, &hour) || buffer[13] != ':' ||
+            !SPiDParseDigits(buffer + 14, 2, &minute) || buffer[16] != ':' || !SPiDParseDigits(buffer + 17, 2, &second))) {
+        return nil;
+    }
+    // SPiD uses 0000-00-00 for dates that are not set
+    if (year == 0 || month < 1 || month > 12 || day < 1 || day > SPiDDaysInMonth(year, month) || hour > 23 || minute > 59 || second > 60) {
+        return nil;
+    }
+
+    struct tm components = {0};
+    components.tm_year = year - 1900;
+    components.tm_mon = month - 1;
+    components.tm_mday = day;
+    components.tm_hour = hour;
+    components.tm_min = minute;
+    components.tm_sec = second;
+    time_t time = timegm(&components);
+    if (hasTime) {
+        return [NSDate dateWithTimeIntervalSince1970:time];
+    }
+
+    // A birthday is the same day wherever the user is, so it is midnight in the user's time zone rather than in UTC.
+    // The offset is looked up again at local midnight in case a daylight saving change falls between the two.
+    NSTimeZone *timeZone = [[NSCalendar currentCalendar] timeZone];
+    NSTimeInterval offset = [timeZone secondsFromGMTForDate:[NSDate dateWithTimeIntervalSince1970:time]];
+    offset = [timeZone secondsFromGMTForDate:[NSDate dateWithTimeIntervalSince1970:time - offset]];
+    return [NSDate dateWithTimeIntervalSince1970:time - offset];
+}
+
+/** Copies JSON containers into immutable ones, all the way down */
+static id SPiDImmutableCopy(id object) {
+    if ([object isKindOfClass:[NSDictionary class]]) {
+        NSMutableDictionary *copy = [NSMutableDictionary dictionaryWithCapacity:[object count]];
+        [object enumerateKeysAndObjectsUsingBlock:^(id key, id value, BOOL *stop) {
+            [copy setObject:SPiDImmutableCopy(value) forKey:key];
+        }];
+        return [copy copy];
+    }
+    if ([object isKindOfClass:[NSArray class]]) {
+        NSMutableArray *copy = [NSMutableArray arrayWithCapacity:[object count]];
+        for (id value in object) {
+            [copy addObject:SPiDImmutableCopy(value)];
+        }
+        return [copy copy];
+    }
+    return [object copy];
+}
+
+static id SPiDUserProfileDecode(NSDictionary<NSString *, id> *data, SPiDUserProfileKey key) {
+    id value = [data objectForKey:key.key];
+    if (key.nestedKey) {
+        value = [value isKindOfClass:[NSDictionary class]] ? [value objectForKey:key.nestedKey] : nil;
+    }
+    if (![value isKindOfClass:[NSString class]] || [value length] == 0) {
+        return nil;
+    }
+
+    switch (key.type) {
+        case SPiDUserProfileStringValue:
+            return [value copy];
+        case SPiDUserProfileURLValue:
+            return [NSURL URLWithString:value];
+        case SPiDUserProfileDayValue:
+            return SPiDUserProfileDate(value, NO);
+        case SPiDUserProfileTimeValue:
+            return SPiDUserProfileDate(value, YES);
+    }
+    return nil;
+}
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface SPiDUserProfile ()
+
+/** Returns the decoded field, decoding it on first access
+
+ @param field The field to return
+ @return The decoded value, nil if it is missing or of the wrong type
+ */
+- (nullable id)valueForField:(SPiDUserProfileField)field;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+@implementation SPiDUserProfile {
+    pthread_mutex_t _mutex;
+    uint32_t _decodedFields;
+    id _values[SPiDUserProfileFieldCount];
+}
+
++ (instancetype)profileWithResponse:(SPiDResponse *)response {
+    if (response.error) {
+        return nil;
+    }
+    NSDictionary *data = [response.message objectForKey:SPiDUserProfileDataKey];
+    return [data isKindOfClass:[NSDictionary class]] ? [[self alloc] initWithData:data] : nil;
+}
+
+- (instancetype)initWithData:(NSDictionary<NSString *, id> *)data {
+    id userID = [data objectForKey:SPiDUserProfileUserIDKey];
+    if ([userID isKindOfClass:[NSNumber class]]) {
+        userID = [userID stringValue];
+    }
+    if (![userID isKindOfClass:[NSString class]] || [userID length] == 0) {
+        return nil;
+    }
+
+    if (self = [super init]) {
+        pthread_mutex_init(&_mutex, NULL);
+        _userID = [userID copy];
+        // Responses are parsed with mutable containers, nested ones are exposed through data and must not change either
+        _data = SPiDImmutableCopy(data);
+    }
+    return self;
+}
+
+- (void)dealloc {
+    pthread_mutex_destroy(&_mutex);
+}
+
+- (id)copyWithZone:(NSZone *)zone {
+    return self;
+}
+
+- (BOOL)isEqual:(id)object {
+    if (object == self) {
+        return YES;
+    }
+    if (![object isKindOfClass:[SPiDUserProfile class]]) {
+        return NO;
+    }
+    return [self.data isEqualToDictionary:((SPiDUserProfile *)object).data];
+}
+
+- (NSUInteger)hash {
+    return [self.userID hash];
+}
+
+- (NSString *)uuid {
+    return [self valueForField:SPiDUserProfileUUIDField];
+}
+
+- (NSString *)email {
+    return [self valueForField:SPiDUserProfileEmailField];
+}
+
+- (NSString *)displayName {
+    return [self valueForField:SPiDUserProfileDisplayNameField];
+}
+
+- (NSString *)givenName {
+    return [self valueForField:SPiDUserProfileGivenNameField];
+}
+
+- (NSString *)familyName {
+    return [self valueForField:SPiDUserProfileFamilyNameField];
+}
+
+- (NSString *)preferredUsername {
+    return [self valueForField:SPiDUserProfilePreferredUsernameField];
+}
+
+- (NSString *)phoneNumber {
+    return [self valueForField:SPiDUserProfilePhoneNumberField];
+}
+
+- (NSString *)gender {
+    return [self valueForField:SPiDUserProfileGenderField];
+}
+
+- (NSURL *)photoURL {
+    return [self valueForField:SPiDUserProfilePhotoURLField];
+}
+
+- (NSDate *)birthday {
+    return [self valueForField:SPiDUserProfileBirthdayField];
+}
+
+- (NSDate *)verifiedAt {
+    return [self valueForField:SPiDUserProfileVerifiedAtField];
+}
+
+- (NSDate *)createdAt {
+    return [self valueForField:SPiDUserProfileCreatedAtField];
+}
+
+- (NSDate *)updatedAt {
+    return [self valueForField:SPiDUserProfileUpdatedAtField];
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@: %p userID: %@ email: %@ displayName: %@>", NSStringFromClass([self class]), self, self.userID, self.email, self.displayName];
+}
+
+#pragma mark Private methods
+
+///---------------------------------------------------------------------------------------
+/// @name Private methods
+///---------------------------------------------------------------------------------------
+
+- (id)valueForField:(SPiDUserProfileField)field {
+    uint32_t mask = 1u << field;
+    pthread_mutex_lock(&_mutex);
+    if ((_decodedFields & mask) == 0) {
+        _values[field] = SPiDUserProfileDecode(_data, SPiDUserProfileKeys[field]);
+        _decodedFields |= mask;
+    }
+    id value = _values[field];
+    pthread_mutex_unlock(&_mutex);
+    return value;
+}
+
+@end
@@ -31,30 +31,64 @@
  */
 + (NSString *)encodedHttpBodyForDictionary:(NSDictionary *)dictionary;
 
+/** Encodes dictionary to a http post body as UTF-8 data
+
+ Keys and values are percent encoded straight from their UTF-8 bytes into the returned data in a single pass.
+ Values that are not strings are encoded using their description.
+
+ @param dictionary The dictionary to be encoded
+ @param sortedKeys If YES the pairs are written in ascending key order, so that the same dictionary always gives the
+ same bytes, e.g. for cache keys and signatures
+ @return The http post body
+ */
++ (NSData *)encodedHttpBodyDataForDictionary:(NSDictionary *)dictionary sortedKeys:(BOOL)sortedKeys;
+
 /** URL encodes the specified string
 
+ Every UTF-8 byte that is not in `URLQueryPartAllowedCharacterSet` is percent encoded, the same output as
+ `stringByAddingPercentEncodingWithAllowedCharacters:`.
+
  @param unescaped String to be encoded
- @return Encoded NSString
+ @return Encoded NSString, nil if the string can not be converted to UTF-8
  */
 + (NSString *)urlEncodeQueryParameter:(NSString *)unescaped;
 
 /** Extracts a query parameter from a URL
 
+ Use `parametersFromURL:` when more than one parameter is needed.
+
  @param url URL
  @param key Parameter to be found
- @return Value for the specified key otherwise nil
+ @return Decoded value for the specified key otherwise nil
  */
 + (NSString *)getUrlParameter:(NSURL *)url forKey:(NSString *)key;
 
+/** Decodes all query parameters of a URL in a single pass
+
+ Pairs are split on the first '=', so values may contain '='. Keys and values are percent decoded and '+' is read as a
+ space. A key without '=' gets an empty value, and if a key occurs more than once the first value is kept.
+
+ @param url URL
+ @return Decoded parameters, empty if the URL has no query
+ */
++ (NSDictionary<NSString *, NSString *> *)parametersFromURL:(NSURL *)url;
+
 /** Validates a email address
 
- Based on RFC 2822
+ Based on RFC 2822. The expression is compiled once and can be used from any thread, so this is cheap enough to call
+ on every keystroke.
 
  @param email The email to validate
  @return YES if the email is valid, otherwise NO
  */
-//
 + (BOOL)validateEmail:(NSString *)email;
 
+/** Validates a list of email addresses
+
+ @param emails The emails to validate
+ @return Indexes of the valid emails
+ */
++ (NSIndexSet *)indexesOfValidEmails:(NSArray<NSString *> *)emails;
+
 
 @end
\ No newline at end of file
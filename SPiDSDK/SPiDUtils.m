@@ -7,62 +7,307 @@
 
 #import "NSCharacterSet+SPiD.h"
 #import "SPiDUtils.h"
+#import "SPiDClient.h"
 
-@implementation SPiDUtils
+/** Lookup table of the bytes that are written as is, everything else is percent encoded */
+static BOOL SPiDQueryPartAllowedBytes[256];
 
-+ (BOOL)validateEmail:(NSString *)email {
-    NSString *emailRegex =
-            @"(?:[a-z0-9!#$%\\&'*+/=?\\^_`{|}~-]+(?:\\.[a-z0-9!#$%\\&'*+/=?\\^_`{|}"
-                    @"~-]+)*|\"(?:[\\x01-\\x08\\x0b\\x0c\\x0e-\\x1f\\x21\\x23-\\x5b\\x5d-\\"
-                    @"x7f]|\\\\[\\x01-\\x09\\x0b\\x0c\\x0e-\\x7f])*\")@(?:(?:[a-z0-9](?:[a-"
-                    @"z0-9-]*[a-z0-9])?\\.)+[a-z0-9](?:[a-z0-9-]*[a-z0-9])?|\\[(?:(?:25[0-5"
-                    @"]|2[0-4][0-9]|[01]?[0-9][0-9]?)\\.){3}(?:25[0-5]|2[0-4][0-9]|[01]?[0-"
-                    @"9][0-9]?|[a-z0-9-]*[a-z0-9]:(?:[\\x01-\\x08\\x0b\\x0c\\x0e-\\x1f\\x21"
-                    @"-\\x5a\\x53-\\x7f]|\\\\[\\x01-\\x09\\x0b\\x0c\\x0e-\\x7f])+)\\])";
-    NSPredicate *emailTest = [NSPredicate predicateWithFormat:@"SELF MATCHES %@", emailRegex];
-    return [emailTest evaluateWithObject:email];
+static const char SPiDHexDigits[] = "0123456789ABCDEF";
+
+/** Builds `SPiDQueryPartAllowedBytes` from `URLQueryPartAllowedCharacterSet`, all of its members are ASCII */
+static void SPiDInitializeQueryPartAllowedBytes(void) {
+    static dispatch_once_t predicate;
+    dispatch_once(&predicate, ^{
+        NSCharacterSet *allowed = [NSCharacterSet URLQueryPartAllowedCharacterSet];
+        for (unichar c = 0; c < 128; c++) {
+            SPiDQueryPartAllowedBytes[c] = [allowed characterIsMember:c];
+        }
+    });
 }
 
-+ (NSString *)encodedHttpQueryForDictionary:(NSDictionary *)dictionary {
-    NSString *query = @"";
-    for (NSString *key in dictionary) {
-        if ([query length] > 0) {
-            query = [query stringByAppendingFormat:@"&%@=%@", [SPiDUtils urlEncodeQueryParameter:key], [SPiDUtils urlEncodeQueryParameter:[dictionary objectForKey:key]]];
+/** Returns the UTF-8 bytes of a string without copying them when the string already stores them
+
+ @return The bytes, or NULL if the string can not be converted to UTF-8
+ */
+static const uint8_t *SPiDUTF8Bytes(NSString *string, NSUInteger *length) {
+    *length = [string lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+    if (*length == 0) {
+        return string.length == 0 ? (const uint8_t *) "" : NULL;
+    }
+    const char *bytes = CFStringGetCStringPtr((__bridge CFStringRef) string, kCFStringEncodingUTF8);
+    if (bytes == NULL) {
+        bytes = [string UTF8String];
+    }
+    return (const uint8_t *) bytes;
+}
+
+/** Percent encodes bytes with `SPiDQueryPartAllowedBytes`, `out` must have room for three times `length`
+
+ @return Number of bytes written
+ */
+static NSUInteger SPiDPercentEncodeBytes(const uint8_t *bytes, NSUInteger length, uint8_t *out) {
+    uint8_t *start = out;
+    for (NSUInteger i = 0; i < length; i++) {
+        uint8_t byte = bytes[i];
+        if (SPiDQueryPartAllowedBytes[byte]) {
+            *out++ = byte;
         } else {
-            query = [query stringByAppendingFormat:@"?%@=%@", [SPiDUtils urlEncodeQueryParameter:key], [SPiDUtils urlEncodeQueryParameter:[dictionary objectForKey:key]]];
+            *out++ = '%';
+            *out++ = (uint8_t) SPiDHexDigits[byte >> 4];
+            *out++ = (uint8_t) SPiDHexDigits[byte & 0x0F];
         }
     }
-    return query;
+    return (NSUInteger) (out - start);
 }
 
-+ (NSString *)encodedHttpBodyForDictionary:(NSDictionary *)dictionary {
-    NSString *body = @"";
-    for (NSString *key in dictionary) {
-        if ([body length] > 0) {
-            body = [body stringByAppendingFormat:@"&%@=%@", [SPiDUtils urlEncodeQueryParameter:key], [SPiDUtils urlEncodeQueryParameter:[dictionary objectForKey:key]]];
-        } else {
-            body = [body stringByAppendingFormat:@"%@=%@", [SPiDUtils urlEncodeQueryParameter:key], [SPiDUtils urlEncodeQueryParameter:[dictionary objectForKey:key]]];
+/** Returns the value of a hex digit, or -1 if `c` is not one */
+static int SPiDHexDigitValue(uint8_t c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    } else if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    } else if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+/** Decodes a query component, '+' is read as a space and malformed escapes are kept as is
+
+ @param scratch Buffer with room for at least `length` bytes
+ @return The decoded string, the raw component if the decoded bytes are not valid UTF-8
+ */
+static NSString *SPiDDecodeQueryComponent(const uint8_t *bytes, NSUInteger length, uint8_t *scratch) {
+    NSUInteger written = 0;
+    for (NSUInteger i = 0; i < length; i++) {
+        uint8_t byte = bytes[i];
+        if (byte == '+') {
+            byte = ' ';
+        } else if (byte == '%' && i + 2 < length) {
+            int high = SPiDHexDigitValue(bytes[i + 1]);
+            int low = SPiDHexDigitValue(bytes[i + 2]);
+            if (high >= 0 && low >= 0) {
+                byte = (uint8_t) ((high << 4) | low);
+                i += 2;
+            }
+        }
+        scratch[written++] = byte;
+    }
+    NSString *decoded = [[NSString alloc] initWithBytes:scratch length:written encoding:NSUTF8StringEncoding];
+    return decoded ?: [[NSString alloc] initWithBytes:bytes length:length encoding:NSASCIIStringEncoding];
+}
+
+/** Percent encodes the UTF-8 bytes of a string to the end of `data`
+
+ @return NO if the string can not be converted to UTF-8, nothing is written then
+ */
+static BOOL SPiDAppendPercentEncoded(NSMutableData *data, NSString *string) {
+    NSUInteger length;
+    const uint8_t *bytes = SPiDUTF8Bytes(string, &length);
+    if (bytes == NULL) {
+        return NO;
+    }
+
+    // Room for the worst case, every byte encoded, trimmed afterwards
+    NSUInteger offset = data.length;
+    [data setLength:offset + length * 3];
+    NSUInteger written = SPiDPercentEncodeBytes(bytes, length, (uint8_t *) data.mutableBytes + offset);
+    [data setLength:offset + written];
+    return YES;
+}
+
+@interface SPiDUtils ()
+
+/** Returns the email expression, compiled once
+
+ @return The expression
+ */
++ (NSRegularExpression *)emailRegularExpression;
+
+/** Encodes a dictionary as form pairs in a single pass
+
+ @param dictionary The dictionary to be encoded
+ @param prefix Character written before the first pair, or 0 for none
+ @param sortedKeys YES to write the pairs in ascending key order
+ @return The encoded pairs
+ */
++ (NSMutableData *)formDataForDictionary:(NSDictionary *)dictionary prefix:(char)prefix sortedKeys:(BOOL)sortedKeys;
+
+@end
+
+@implementation SPiDUtils
+
++ (BOOL)validateEmail:(NSString *)email {
+    if (![email isKindOfClass:[NSString class]]) {
+        return NO;
+    }
+    NSRegularExpression *expression = [SPiDUtils emailRegularExpression];
+    return [expression firstMatchInString:email options:(NSMatchingOptions) 0 range:NSMakeRange(0, email.length)] != nil;
+}
+
++ (NSIndexSet *)indexesOfValidEmails:(NSArray<NSString *> *)emails {
+    NSUInteger count = emails.count;
+    if (count == 0) {
+        return [NSIndexSet indexSet];
+    }
+    // The expression is immutable and can be shared, so large lists are validated on all cores
+    BOOL *valid = calloc(count, sizeof(BOOL));
+    [emails enumerateObjectsWithOptions:NSEnumerationConcurrent usingBlock:^(NSString *email, NSUInteger index, BOOL *stop) {
+        valid[index] = [SPiDUtils validateEmail:email];
+    }];
+    NSMutableIndexSet *indexes = [NSMutableIndexSet indexSet];
+    for (NSUInteger i = 0; i < count; i++) {
+        if (valid[i]) {
+            [indexes addIndex:i];
         }
     }
-    return body;
+    free(valid);
+    return indexes;
+}
+
++ (NSString *)encodedHttpQueryForDictionary:(NSDictionary *)dictionary {
+    if (dictionary.count == 0) {
+        return @"";
+    }
+    NSData *query = [SPiDUtils formDataForDictionary:dictionary prefix:'?' sortedKeys:NO];
+    return [[NSString alloc] initWithData:query encoding:NSASCIIStringEncoding];
+}
+
++ (NSString *)encodedHttpBodyForDictionary:(NSDictionary *)dictionary {
+    NSData *body = [SPiDUtils formDataForDictionary:dictionary prefix:0 sortedKeys:NO];
+    return [[NSString alloc] initWithData:body encoding:NSASCIIStringEncoding];
+}
+
++ (NSData *)encodedHttpBodyDataForDictionary:(NSDictionary *)dictionary sortedKeys:(BOOL)sortedKeys {
+    return [SPiDUtils formDataForDictionary:dictionary prefix:0 sortedKeys:sortedKeys];
 }
 
 + (NSString *)urlEncodeQueryParameter:(NSString *)unescaped {
-    NSString *escapedString = [unescaped stringByAddingPercentEncodingWithAllowedCharacters:[NSCharacterSet URLQueryPartAllowedCharacterSet]];
-    return escapedString;
+    if (unescaped == nil) {
+        return nil;
+    }
+    SPiDInitializeQueryPartAllowedBytes();
+    NSUInteger length;
+    const uint8_t *bytes = SPiDUTF8Bytes(unescaped, &length);
+    if (bytes == NULL) {
+        return nil;
+    }
+
+    // IDs and tokens usually have nothing to escape
+    NSUInteger prefixLength = 0;
+    while (prefixLength < length && SPiDQueryPartAllowedBytes[bytes[prefixLength]]) {
+        prefixLength++;
+    }
+    if (prefixLength == length) {
+        return [unescaped copy];
+    }
+
+    uint8_t *buffer = malloc(length * 3);
+    memcpy(buffer, bytes, prefixLength);
+    NSUInteger encodedLength = prefixLength + SPiDPercentEncodeBytes(bytes + prefixLength, length - prefixLength, buffer + prefixLength);
+    return [[NSString alloc] initWithBytesNoCopy:buffer length:encodedLength encoding:NSASCIIStringEncoding freeWhenDone:YES];
+}
+
+#pragma mark Private methods
+
+///---------------------------------------------------------------------------------------
+/// @name Private methods
+///---------------------------------------------------------------------------------------
+
++ (NSRegularExpression *)emailRegularExpression {
+    static NSRegularExpression *emailRegularExpression = nil;
+    static dispatch_once_t predicate;
+    dispatch_once(&predicate, ^{
+        // Anchored at both ends, as MATCHES in the NSPredicate this replaced only accepts whole string matches
+        NSString *emailRegex =
+                @"(?:[a-z0-9!#$%\\&'*+/=?\\^_`{|}~-]+(?:\\.[a-z0-9!#$%\\&'*+/=?\\^_`{|}"
+                        @"~-]+)*|\"(?:[\\x01-\\x08\\x0b\\x0c\\x0e-\\x1f\\x21\\x23-\\x5b\\x5d-\\"
+                        @"x7f]|\\\\[\\x01-\\x09\\x0b\\x0c\\x0e-\\x7f])*\")@(?:(?:[a-z0-9](?:[a-"
+                        @"z0-9-]*[a-z0-9])?\\.)+[a-z0-9](?:[a-z0-9-]*[a-z0-9])?|\\[(?:(?:25[0-5"
+                        @"]|2[0-4][0-9]|[01]?[0-9][0-9]?)\\.){3}(?:25[0-5]|2[0-4][0-9]|[01]?[0-"
+                        @"9][0-9]?|[a-z0-9-]*[a-z0-9]:(?:[\\x01-\\x08\\x0b\\x0c\\x0e-\\x1f\\x21"
+                        @"-\\x5a\\x53-\\x7f]|\\\\[\\x01-\\x09\\x0b\\x0c\\x0e-\\x7f])+)\\])";
+        NSString *anchoredRegex = [NSString stringWithFormat:@"\\A(?:%@)\\z", emailRegex];
+        emailRegularExpression = [NSRegularExpression regularExpressionWithPattern:anchoredRegex options:(NSRegularExpressionOptions) 0 error:nil];
+    });
+    return emailRegularExpression;
+}
+
++ (NSMutableData *)formDataForDictionary:(NSDictionary *)dictionary prefix:(char)prefix sortedKeys:(BOOL)sortedKeys {
+    SPiDInitializeQueryPartAllowedBytes();
+    NSArray *keys = sortedKeys ? [dictionary.allKeys sortedArrayUsingSelector:@selector(compare:)] : dictionary.allKeys;
+
+    // Most form values are mostly unreserved ASCII, reserve a little extra for escapes
+    NSUInteger estimate = 1;
+    for (NSString *key in keys) {
+        id value = [dictionary objectForKey:key];
+        estimate += key.length + ([value isKindOfClass:[NSString class]] ? [value length] : 16) + 2;
+    }
+    NSMutableData *data = [NSMutableData dataWithCapacity:estimate + estimate / 4];
+
+    BOOL first = YES;
+    for (NSString *key in keys) {
+        id value = [dictionary objectForKey:key];
+        NSString *string = [value isKindOfClass:[NSString class]] ? value : [value description];
+        char separator = first ? prefix : '&';
+        if (separator) {
+            [data appendBytes:&separator length:1];
+        }
+        first = NO;
+        if (!SPiDAppendPercentEncoded(data, [key description])) {
+            SPiDDebugLog(@"Could not encode key: %@", key);
+        }
+        [data appendBytes:"=" length:1];
+        if (!SPiDAppendPercentEncoded(data, string)) {
+            SPiDDebugLog(@"Could not encode value for key: %@", key);
+        }
+    }
+    return data;
 }
 
 + (NSString *)getUrlParameter:(NSURL *)url forKey:(NSString *)key {
-    NSArray *encodedParameterPairs = [[url query] componentsSeparatedByString:@"&"];
+    return [[SPiDUtils parametersFromURL:url] objectForKey:key];
+}
+
++ (NSDictionary<NSString *, NSString *> *)parametersFromURL:(NSURL *)url {
+    NSString *query = [url query];
+    NSUInteger length;
+    const uint8_t *bytes = query ? SPiDUTF8Bytes(query, &length) : NULL;
+    if (bytes == NULL || length == 0) {
+        return @{};
+    }
 
-    for (NSString *encodedPair in encodedParameterPairs) {
-        NSArray *encodedPairElements = [encodedPair componentsSeparatedByString:@"="];
-        if (encodedPairElements.count == 2) {
-            if ([[encodedPairElements objectAtIndex:0] isEqual:key])
-                return [encodedPairElements objectAtIndex:1];
+    // A decoded component is never longer than the query itself
+    uint8_t stackBuffer[256];
+    uint8_t *scratch = length <= sizeof(stackBuffer) ? stackBuffer : malloc(length);
+    NSMutableDictionary<NSString *, NSString *> *parameters = [NSMutableDictionary dictionary];
+
+    NSUInteger start = 0;
+    while (start < length) {
+        NSUInteger end = start;
+        NSUInteger separator = NSNotFound;
+        while (end < length && bytes[end] != '&') {
+            if (bytes[end] == '=' && separator == NSNotFound) {
+                separator = end;
+            }
+            end++;
+        }
+        if (end > start) {
+            NSUInteger keyEnd = separator == NSNotFound ? end : separator;
+            NSString *key = SPiDDecodeQueryComponent(bytes + start, keyEnd - start, scratch);
+            NSString *value = separator == NSNotFound ? @"" : SPiDDecodeQueryComponent(bytes + separator + 1, end - separator - 1, scratch);
+            // The first occurrence wins, as with the lookup this replaces
+            if (key.length > 0 && value && [parameters objectForKey:key] == nil) {
+                [parameters setObject:value forKey:key];
+            }
         }
+        start = end + 1;
+    }
+
+    if (scratch != stackBuffer) {
+        free(scratch);
     }
-    return nil;
+    return parameters;
 }
 
 @end
\ No newline at end of file
@@ -103,7 +103,8 @@
 - (BOOL)webView:(UIWebView *)webView shouldStartLoadWithRequest:(NSURLRequest *)request navigationType:(UIWebViewNavigationType)navigationType {
     NSURL *url = [request URL];
     SPiDDebugLog(@"Loading url: %@", [url absoluteString]);
-    NSString *error = [SPiDUtils getUrlParameter:url forKey:@"error"];
+    NSDictionary<NSString *, NSString *> *parameters = [SPiDUtils parametersFromURL:url];
+    NSString *error = [parameters objectForKey:@"error"];
     if (error) {
         if ([webView isLoading])
             [webView stopLoading];
@@ -117,11 +118,10 @@
                 [webView stopLoading];
             }
             [webView setDelegate:nil];
-            NSString *code = [SPiDUtils getUrlParameter:url forKey:@"code"];
+            NSString *code = [parameters objectForKey:@"code"];
             if (code) {
                 SPiDDebugLog(@"Received code: %@", code);
-                SPiDTokenRequest *tokenRequest = [SPiDTokenRequest userTokenRequestWithCode:code completionHandler:self.completionHandler];
-                [tokenRequest start];
+                [[SPiDClient sharedInstance] exchangeAuthorizationCode:code completionHandler:self.completionHandler];
                 //self.completionHandler(code, nil);
             } else {
                 self.completionHandler([NSError sp_oauth2ErrorWithCode:SPiDUserAbortedLogin reason:@"UserAbortedLogin" descriptions:[NSDictionary dictionaryWithObjectsAndKeys:@"User aborted login", @"error", nil]]);
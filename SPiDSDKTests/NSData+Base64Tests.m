@@ -0,0 +1,140 @@
+//
+//  NSData+Base64Tests.m
+//  SPiDSDK
+//
+//  Copyright (c) 2012 Schibsted Payment. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import "NSData+Base64.h"
+
+static const NSUInteger SPiDBenchmarkBase64Count = 10000;
+static const NSUInteger SPiDFuzzDataCount = 2000;
+
+@interface NSData_Base64Tests : XCTestCase
+
+@end
+
+@implementation NSData_Base64Tests
+
+/** The url safe encoder as it was before the single pass codec, with Foundation doing the Base64 step, kept as baseline */
+- (NSString *)legacyBase64EncodedUrlSafeString:(NSData *)data {
+    NSString *urlSafeBase64String = [data base64EncodedStringWithOptions:0];
+    urlSafeBase64String = [urlSafeBase64String stringByReplacingOccurrencesOfString:@"+" withString:@"-"];
+    urlSafeBase64String = [urlSafeBase64String stringByReplacingOccurrencesOfString:@"/" withString:@"_"];
+    urlSafeBase64String = [urlSafeBase64String stringByReplacingOccurrencesOfString:@"=" withString:@""];
+    return urlSafeBase64String;
+}
+
+- (NSData *)randomDataWithLength:(NSUInteger)length {
+    NSMutableData *data = [NSMutableData dataWithLength:length];
+    arc4random_buf(data.mutableBytes, length);
+    return data;
+}
+
+/** Roughly the size of a signed JWT claim */
+- (NSData *)jwtSizedData {
+    return [self randomDataWithLength:512];
+}
+
+/** Roughly the size of a device fingerprint or a HMAC-SHA256 signature */
+- (NSData *)fingerprintSizedData {
+    return [self randomDataWithLength:32];
+}
+
+- (void)testRFC4648Vectors {
+    NSDictionary<NSString *, NSString *> *vectors = @{@"f": @"Zg==", @"fo": @"Zm8=", @"foo": @"Zm9v", @"foob": @"Zm9vYg==",
+                                                      @"fooba": @"Zm9vYmE=", @"foobar": @"Zm9vYmFy"};
+    for (NSString *plain in vectors) {
+        NSData *data = [plain dataUsingEncoding:NSASCIIStringEncoding];
+        XCTAssertEqualObjects([data sp_base64EncodedString], vectors[plain]);
+        XCTAssertEqualObjects([NSData sp_dataWithBase64EncodedString:vectors[plain]], data);
+        NSString *unpadded = [vectors[plain] stringByReplacingOccurrencesOfString:@"=" withString:@""];
+        XCTAssertEqualObjects([data sp_base64EncodedUrlSafeString], unpadded);
+        XCTAssertEqualObjects([NSData sp_dataWithBase64UrlEncodedString:unpadded], data);
+    }
+    XCTAssertNil([[NSData data] sp_base64EncodedString]);
+    XCTAssertEqualObjects([NSData sp_dataWithBase64EncodedString:@""], [NSData data]);
+}
+
+- (void)testEncodingMatchesFoundation {
+    for (NSUInteger i = 0; i < SPiDFuzzDataCount; i++) {
+        NSData *data = [self randomDataWithLength:1 + arc4random_uniform(100)];
+        XCTAssertEqualObjects([data sp_base64EncodedString], [data base64EncodedStringWithOptions:0]);
+        XCTAssertEqualObjects([data sp_base64EncodedUrlSafeString], [self legacyBase64EncodedUrlSafeString:data]);
+        XCTAssertEqualObjects([NSData sp_dataWithBase64EncodedString:[data sp_base64EncodedString]], data);
+        XCTAssertEqualObjects([NSData sp_dataWithBase64UrlEncodedString:[data sp_base64EncodedUrlSafeString]], data);
+    }
+}
+
+- (void)testInvalidInput {
+    XCTAssertNil([NSData sp_dataWithBase64EncodedString:@"Z"]);
+    XCTAssertNil([NSData sp_dataWithBase64EncodedString:@"Zm9v!"]);
+    XCTAssertNil([NSData sp_dataWithBase64EncodedString:@"Zg="]);
+    XCTAssertNil([NSData sp_dataWithBase64EncodedString:@"Z==="]);
+    XCTAssertNil([NSData sp_dataWithBase64EncodedString:@"-_8="]);
+    XCTAssertNil([NSData sp_dataWithBase64UrlEncodedString:@"+/8="]);
+    XCTAssertNil([NSData sp_dataWithBase64EncodedString:@"Zm9væ"]);
+    unichar embeddedNul[] = {'Q', 'Q', '=', '=', 0, 'j', 'u', 'n', 'k'};
+    XCTAssertNil([NSData sp_dataWithBase64EncodedString:[NSString stringWithCharacters:embeddedNul length:9]]);
+    unichar unpaddedNul[] = {'Q', 'Q', 0, 'j', 'u', 'n', 'k'};
+    XCTAssertNil([NSData sp_dataWithBase64UrlEncodedString:[NSString stringWithCharacters:unpaddedNul length:7]]);
+    XCTAssertEqualObjects([NSData sp_dataWithBase64UrlEncodedString:@"-_8"], [NSData sp_dataWithBase64EncodedString:@"+/8="]);
+}
+
+- (void)testLegacyJwtSizedEncodingPerformance {
+    NSData *data = [self jwtSizedData];
+    [self measureBlock:^{
+        for (NSUInteger i = 0; i < SPiDBenchmarkBase64Count; i++) {
+            @autoreleasepool {
+                [self legacyBase64EncodedUrlSafeString:data];
+            }
+        }
+    }];
+}
+
+- (void)testJwtSizedEncodingPerformance {
+    NSData *data = [self jwtSizedData];
+    [self measureBlock:^{
+        for (NSUInteger i = 0; i < SPiDBenchmarkBase64Count; i++) {
+            @autoreleasepool {
+                [data sp_base64EncodedUrlSafeString];
+            }
+        }
+    }];
+}
+
+- (void)testJwtSizedDecodingPerformance {
+    NSString *string = [[self jwtSizedData] sp_base64EncodedUrlSafeString];
+    [self measureBlock:^{
+        for (NSUInteger i = 0; i < SPiDBenchmarkBase64Count; i++) {
+            @autoreleasepool {
+                [NSData sp_dataWithBase64UrlEncodedString:string];
+            }
+        }
+    }];
+}
+
+- (void)testFingerprintSizedEncodingPerformance {
+    NSData *data = [self fingerprintSizedData];
+    [self measureBlock:^{
+        for (NSUInteger i = 0; i < SPiDBenchmarkBase64Count; i++) {
+            @autoreleasepool {
+                [data sp_base64EncodedString];
+            }
+        }
+    }];
+}
+
+- (void)testFingerprintSizedDecodingPerformance {
+    NSString *string = [[self fingerprintSizedData] sp_base64EncodedString];
+    [self measureBlock:^{
+        for (NSUInteger i = 0; i < SPiDBenchmarkBase64Count; i++) {
+            @autoreleasepool {
+                [NSData sp_dataWithBase64EncodedString:string];
+            }
+        }
+    }];
+}
+
+@end
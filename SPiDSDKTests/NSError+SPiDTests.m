@@ -0,0 +1,171 @@
+//
+//  NSError+SPiDTests.m
+//  SPiDSDK
+//
+//  Copyright (c) 2012 Schibsted Payment. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import "NSError+SPiD.h"
+
+static const NSUInteger SPiDBenchmarkErrorCount = 10000;
+
+@interface NSError_SPiDTests : XCTestCase
+
+@end
+
+@implementation NSError_SPiDTests
+
+/** The domain lookup as it was before the perfect hash table, kept as reference and baseline */
+- (NSInteger)legacyErrorCodeFromDomain:(NSString *)errorDomain apiErrorCode:(NSInteger)apiError {
+    NSDictionary<NSString *, NSNumber *> *codes = @{@"redirect_uri_mismatch": @(SPiDOAuth2RedirectURIMismatchErrorCode),
+                                                    @"unauthorized_client": @(SPiDOAuth2UnauthorizedClientErrorCode),
+                                                    @"access_denied": @(SPiDOAuth2AccessDeniedErrorCode),
+                                                    @"invalid_request": @(SPiDOAuth2InvalidRequestErrorCode),
+                                                    @"unsupported_response_type": @(SPiDOAuth2UnsupportedResponseTypeErrorCode),
+                                                    @"invalid_scope": @(SPiDOAuth2InvalidScopeErrorCode),
+                                                    @"invalid_grant": @(SPiDOAuth2InvalidGrantErrorCode),
+                                                    @"invalid_client": @(SPiDOAuth2InvalidClientErrorCode),
+                                                    @"invalid_client_id": @(SPiDOAuth2InvalidClientIDErrorCode),
+                                                    @"invalid_client_credentials": @(SPiDOAuth2InvalidClientCredentialsErrorCode),
+                                                    @"invalid_token": @(SPiDOAuth2InvalidTokenErrorCode),
+                                                    @"insufficient_scope": @(SPiDOAuth2InsufficientScopeErrorCode),
+                                                    @"expired_token": @(SPiDOAuth2ExpiredTokenErrorCode),
+                                                    @"ApiException": @(apiError == 302 ? SPiDAPIExceptionExistingUser : SPiDAPIExceptionErrorCode),
+                                                    @"UserAbortedLogin": @(SPiDUserAbortedLogin),
+                                                    @"unverified_user": @(SPiDOAuth2UnverifiedUserErrorCode),
+                                                    @"invalid_user_credentials": @(SPiDOAuth2InvalidUserCredentialsErrorCode),
+                                                    @"unknown_user": @(SPiDOAuth2UnknownUserErrorCode)};
+    // Same order of caseInsensitiveCompare: calls as the old if-else chain
+    NSArray<NSString *> *order = @[@"redirect_uri_mismatch", @"unauthorized_client", @"access_denied", @"invalid_request",
+                                   @"unsupported_response_type", @"invalid_scope", @"invalid_grant", @"invalid_client",
+                                   @"invalid_client_id", @"invalid_client_credentials", @"invalid_token", @"insufficient_scope",
+                                   @"expired_token", @"ApiException", @"UserAbortedLogin", @"unverified_user",
+                                   @"invalid_user_credentials", @"unknown_user"];
+    for (NSString *domain in order) {
+        if ([errorDomain caseInsensitiveCompare:domain] == NSOrderedSame) {
+            return [codes[domain] integerValue];
+        }
+    }
+    return 0;
+}
+
+/** The userInfo as the old sp_errorFromJSONData: built it */
+- (NSDictionary *)legacyDescriptionsFromJSONData:(NSDictionary *)dictionary {
+    NSDictionary *descriptions;
+    NSString *domain;
+    if ([[dictionary objectForKey:@"error"] isKindOfClass:[NSDictionary class]]) {
+        NSDictionary *errorDict = [dictionary objectForKey:@"error"];
+        domain = [errorDict objectForKey:@"type"];
+        if ([[errorDict objectForKey:@"description"] isKindOfClass:[NSDictionary class]]) {
+            descriptions = [errorDict objectForKey:@"description"];
+        } else {
+            descriptions = [NSDictionary dictionaryWithObjectsAndKeys:[errorDict objectForKey:@"description"], @"error", nil];
+        }
+    } else {
+        domain = [dictionary objectForKey:@"error"];
+        descriptions = [NSDictionary dictionaryWithObjectsAndKeys:[dictionary objectForKey:@"error_description"], @"error", nil];
+    }
+    if (descriptions.count == 0) {
+        descriptions = [NSDictionary dictionaryWithObjectsAndKeys:domain, @"error", nil];
+    }
+    return descriptions;
+}
+
+- (NSArray<NSDictionary *> *)errorResponses {
+    return @[@{@"error": @"invalid_token", @"error_description": @"The access token is invalid", @"error_code": @401},
+             @{@"error": @"expired_token"},
+             @{@"error": @{@"type": @"ApiException", @"code": @302, @"description": @{@"email": @"Email already in use"}}},
+             @{@"error": @{@"type": @"ApiException", @"code": @400, @"description": @"Bad request"}},
+             @{@"error": @"something_new", @"error_description": @"Unknown"}];
+}
+
+/** A refresh storm, mostly invalid_token with a few other errors mixed in */
+- (NSArray<NSDictionary *> *)refreshStormResponses {
+    NSMutableArray<NSDictionary *> *responses = [NSMutableArray arrayWithCapacity:100];
+    NSArray<NSDictionary *> *others = [self errorResponses];
+    for (NSUInteger i = 0; i < 100; i++) {
+        [responses addObject:i % 10 == 0 ? others[i / 10 % others.count] : others[0]];
+    }
+    return responses;
+}
+
+- (void)testDomainLookupMatchesLegacyChain {
+    NSArray<NSString *> *domains = @[@"redirect_uri_mismatch", @"unauthorized_client", @"access_denied", @"invalid_request",
+                                     @"unsupported_response_type", @"invalid_scope", @"invalid_grant", @"invalid_client",
+                                     @"invalid_client_id", @"invalid_client_credentials", @"invalid_token", @"insufficient_scope",
+                                     @"expired_token", @"ApiException", @"UserAbortedLogin", @"unverified_user",
+                                     @"invalid_user_credentials", @"unknown_user", @"", @"invalid", @"invalid_token_",
+                                     @"invalid_tokem", @"ïnvalid_token", @"a_domain_that_is_longer_than_any_known_domain"];
+    for (NSString *domain in domains) {
+        for (NSString *variant in @[domain, [domain uppercaseString], [domain capitalizedString]]) {
+            for (NSNumber *apiError in @[@0, @302]) {
+                XCTAssertEqual([NSError sp_OAuth2ErrorCodeFromDomain:variant andAPIErrorCode:apiError.integerValue],
+                        [self legacyErrorCodeFromDomain:variant apiErrorCode:apiError.integerValue], @"Mismatch for %@", variant);
+            }
+        }
+    }
+    XCTAssertEqual([NSError sp_OAuth2ErrorCodeFromDomain:@"ApiException" andAPIErrorCode:302], SPiDAPIExceptionExistingUser);
+    XCTAssertEqual([NSError sp_OAuth2ErrorCodeFromDomain:nil andAPIErrorCode:0], 0);
+}
+
+- (void)testErrorFromJSONData {
+    for (NSDictionary *response in [self errorResponses]) {
+        NSError *error = [NSError sp_errorFromJSONData:response];
+        XCTAssertEqualObjects(error.userInfo, [self legacyDescriptionsFromJSONData:response]);
+
+        NSData *archive = [NSKeyedArchiver archivedDataWithRootObject:error];
+        NSError *unarchived = [NSKeyedUnarchiver unarchiveObjectWithData:archive];
+        XCTAssertEqualObjects([unarchived class], [NSError class]);
+        XCTAssertEqualObjects(unarchived.domain, error.domain);
+        XCTAssertEqual(unarchived.code, error.code);
+        XCTAssertEqualObjects(unarchived.userInfo, error.userInfo);
+    }
+    XCTAssertEqual([NSError sp_errorFromJSONData:[self errorResponses][0]].code, SPiDOAuth2InvalidTokenErrorCode);
+    XCTAssertEqual([NSError sp_errorFromJSONData:[self errorResponses][2]].code, SPiDAPIExceptionExistingUser);
+}
+
+- (void)testOfflineErrorsExcludeInterruptedRequests {
+    XCTAssertTrue([[NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorNotConnectedToInternet userInfo:nil] sp_isOfflineError]);
+    XCTAssertTrue([[NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorCannotConnectToHost userInfo:nil] sp_isOfflineError]);
+    XCTAssertFalse([[NSError errorWithDomain:@"ParseError" code:NSURLErrorNotConnectedToInternet userInfo:nil] sp_isOfflineError]);
+
+    // SPiD may have received these, replaying a POST could apply it twice
+    for (NSNumber *code in @[@(NSURLErrorTimedOut), @(NSURLErrorNetworkConnectionLost)]) {
+        NSError *error = [NSError errorWithDomain:NSURLErrorDomain code:code.integerValue userInfo:nil];
+        XCTAssertFalse([error sp_isOfflineError]);
+        XCTAssertTrue([error sp_isInterruptedRequestError]);
+    }
+    XCTAssertFalse([[NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorNotConnectedToInternet userInfo:nil] sp_isInterruptedRequestError]);
+}
+
+- (void)testLegacyRefreshStormPerformance {
+    NSArray<NSDictionary *> *responses = [self refreshStormResponses];
+    [self measureBlock:^{
+        for (NSUInteger i = 0; i < SPiDBenchmarkErrorCount / 100; i++) {
+            @autoreleasepool {
+                for (NSDictionary *response in responses) {
+                    id error = [response objectForKey:@"error"];
+                    NSString *domain = [error isKindOfClass:[NSDictionary class]] ? [error objectForKey:@"type"] : error;
+                    NSInteger code = [self legacyErrorCodeFromDomain:domain apiErrorCode:0];
+                    [NSError errorWithDomain:domain code:code userInfo:[self legacyDescriptionsFromJSONData:response]];
+                }
+            }
+        }
+    }];
+}
+
+- (void)testRefreshStormPerformance {
+    NSArray<NSDictionary *> *responses = [self refreshStormResponses];
+    [self measureBlock:^{
+        for (NSUInteger i = 0; i < SPiDBenchmarkErrorCount / 100; i++) {
+            @autoreleasepool {
+                for (NSDictionary *response in responses) {
+                    [[NSError sp_errorFromJSONData:response] code];
+                }
+            }
+        }
+    }];
+}
+
+@end
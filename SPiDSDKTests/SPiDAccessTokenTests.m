@@ -69,4 +69,73 @@
     XCTAssertNil(token, "No retry token, should return nil");
 }
 
+- (SPiDAccessToken *)benchmarkToken {
+    return [[SPiDAccessToken alloc] initWithUserID:@"1234567" accessToken:@"a8f1c0d4e7b2938f6a5d1e0c9b8a7f6e5d4c3b2a" expiresAt:[NSDate dateWithTimeIntervalSinceReferenceDate:600000000.5] refreshToken:@"0f9e8d7c6b5a4938271605f4e3d2c1b0a9f8e7d6"];
+}
+
+- (void)testSerializedDataRoundTrip {
+    SPiDAccessToken *token = [self benchmarkToken];
+    SPiDAccessToken *decoded = [[SPiDAccessToken alloc] initWithSerializedData:[token serializedData]];
+    XCTAssertEqualObjects(decoded.userID, token.userID);
+    XCTAssertEqualObjects(decoded.accessToken, token.accessToken);
+    XCTAssertEqualObjects(decoded.refreshToken, token.refreshToken);
+    XCTAssertEqualObjects(decoded.expiresAt, token.expiresAt);
+
+    SPiDAccessToken *clientToken = [[SPiDAccessToken alloc] initWithUserID:nil accessToken:@"client" expiresAt:[NSDate distantFuture] refreshToken:@"\u00e6\u00f8\u00e5"];
+    decoded = [[SPiDAccessToken alloc] initWithSerializedData:[clientToken serializedData]];
+    XCTAssertNil(decoded.userID);
+    XCTAssertEqualObjects(decoded.refreshToken, clientToken.refreshToken);
+}
+
+- (void)testSerializedDataRejectsInvalidData {
+    NSData *data = [[self benchmarkToken] serializedData];
+    XCTAssertNil([[SPiDAccessToken alloc] initWithSerializedData:[data subdataWithRange:NSMakeRange(0, data.length - 1)]]);
+    XCTAssertNil([[SPiDAccessToken alloc] initWithSerializedData:[NSKeyedArchiver archivedDataWithRootObject:[self benchmarkToken]]]);
+    XCTAssertNil([[SPiDAccessToken alloc] initWithSerializedData:[NSData data]]);
+}
+
+- (void)testSerializedDataIsSmallerThanArchive {
+    NSUInteger archived = [NSKeyedArchiver archivedDataWithRootObject:[self benchmarkToken]].length;
+    NSUInteger serialized = [[self benchmarkToken] serializedData].length;
+    // 12 byte header, three 4 byte length prefixes and the 7 + 40 + 40 bytes of the strings
+    XCTAssertEqual(serialized, 12 + 3 * 4 + 7 + 40 + 40);
+    XCTAssertLessThan(serialized * 2, archived);
+}
+
+- (void)testPerformanceArchiveEncode {
+    SPiDAccessToken *token = [self benchmarkToken];
+    [self measureBlock:^{
+        for (NSUInteger i = 0; i < 10000; i++) {
+            [NSKeyedArchiver archivedDataWithRootObject:token];
+        }
+    }];
+}
+
+- (void)testPerformanceSerializedEncode {
+    SPiDAccessToken *token = [self benchmarkToken];
+    [self measureBlock:^{
+        for (NSUInteger i = 0; i < 10000; i++) {
+            [token serializedData];
+        }
+    }];
+}
+
+- (void)testPerformanceArchiveDecode {
+    NSData *data = [NSKeyedArchiver archivedDataWithRootObject:[self benchmarkToken]];
+    [self measureBlock:^{
+        for (NSUInteger i = 0; i < 10000; i++) {
+            [NSKeyedUnarchiver unarchiveObjectWithData:data];
+        }
+    }];
+}
+
+- (void)testPerformanceSerializedDecode {
+    NSData *data = [[self benchmarkToken] serializedData];
+    [self measureBlock:^{
+        for (NSUInteger i = 0; i < 10000; i++) {
+            (void) [[SPiDAccessToken alloc] initWithSerializedData:data];
+        }
+    }];
+}
+
 @end
@@ -0,0 +1,519 @@
+//
+//  SPiDClientTests.m
+//  SPiDSDK
+//
+//  Copyright (c) 2012 Schibsted Payment. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <stdatomic.h>
+#import "SPiDClient.h"
+#import "SPiDAccessToken.h"
+#import "SPiDAccountStore.h"
+#import "SPiDMemoryTokenStore.h"
+#import "SPiDRequest.h"
+#import "SPiDRequestJournal.h"
+#import "SPiDNetworkMonitor.h"
+#import "SPiDRefreshScheduler.h"
+#import "SPiDTokenRequest.h"
+#import "SPiDResponse.h"
+#import "NSData+Base64.h"
+#import "NSDictionary+Test.h"
+#import "NSError+SPiD.h"
+
+/** Answers every request with the response stubbed for its path, requests without a stub fail as offline */
+@interface SPiDStubURLProtocol : NSURLProtocol
+
++ (void)setResponse:(NSDictionary *)response forPath:(NSString *)path;
++ (NSUInteger)requestCountForPath:(NSString *)path;
++ (void)removeAllResponses;
+
+@end
+
+@implementation SPiDStubURLProtocol
+
+static NSMutableDictionary<NSString *, NSData *> *SPiDStubResponses;
+static NSCountedSet<NSString *> *SPiDStubRequestPaths;
+
++ (void)setResponse:(NSDictionary *)response forPath:(NSString *)path {
+    @synchronized (self) {
+        SPiDStubResponses[path] = [NSJSONSerialization dataWithJSONObject:response options:0 error:nil];
+    }
+}
+
++ (NSUInteger)requestCountForPath:(NSString *)path {
+    @synchronized (self) {
+        return [SPiDStubRequestPaths countForObject:path];
+    }
+}
+
++ (void)removeAllResponses {
+    @synchronized (self) {
+        SPiDStubResponses = [NSMutableDictionary dictionary];
+        SPiDStubRequestPaths = [NSCountedSet set];
+    }
+}
+
++ (BOOL)canInitWithRequest:(NSURLRequest *)request {
+    return YES;
+}
+
++ (NSURLRequest *)canonicalRequestForRequest:(NSURLRequest *)request {
+    return request;
+}
+
+- (void)startLoading {
+    NSString *path = self.request.URL.path;
+    NSData *data;
+    @synchronized ([SPiDStubURLProtocol class]) {
+        [SPiDStubRequestPaths addObject:path];
+        data = SPiDStubResponses[path];
+    }
+    if (data == nil) {
+        [self.client URLProtocol:self didFailWithError:[NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorNotConnectedToInternet userInfo:nil]];
+        return;
+    }
+    NSHTTPURLResponse *response = [[NSHTTPURLResponse alloc] initWithURL:self.request.URL statusCode:200 HTTPVersion:@"HTTP/1.1" headerFields:@{@"Content-Type": @"application/json"}];
+    [self.client URLProtocol:self didReceiveResponse:response cacheStoragePolicy:NSURLCacheStorageNotAllowed];
+    [self.client URLProtocol:self didLoadData:data];
+    [self.client URLProtocolDidFinishLoading:self];
+}
+
+- (void)stopLoading {
+}
+
+@end
+
+@interface SPiDClient (Testing)
+
+- (void)setURLSession:(NSURLSession *)URLSession;
+- (nullable SPiDNetworkMonitor *)authorizationNetworkMonitor;
+
+@end
+
+@interface SPiDClientTests : XCTestCase
+
+@end
+
+@implementation SPiDClientTests
+
+- (void)setUp {
+    [super setUp];
+    [SPiDStubURLProtocol removeAllResponses];
+}
+
+/** Client whose tokens are kept in memory and whose requests are answered by `SPiDStubURLProtocol` */
+- (SPiDClient *)stubbedClient {
+    SPiDClient *client = [[SPiDClient alloc] initWithClientID:@"client" clientSecret:@"secret" appURLScheme:@"spidtest://" serverURL:[NSURL URLWithString:@"https://login.example.com"]];
+    client.tokenStore = [[SPiDMemoryTokenStore alloc] init];
+    NSURLSessionConfiguration *configuration = [NSURLSessionConfiguration ephemeralSessionConfiguration];
+    configuration.protocolClasses = @[[SPiDStubURLProtocol class]];
+    [client setURLSession:[NSURLSession sessionWithConfiguration:configuration]];
+    return client;
+}
+
+- (NSString *)emailStatusPathForEmail:(NSString *)email {
+    NSString *encodedEmail = [[email dataUsingEncoding:NSUTF8StringEncoding] sp_base64EncodedUrlSafeString];
+    return [NSString stringWithFormat:@"/api/2/email/%@/status", encodedEmail];
+}
+
+- (void)testConcurrentAccessTokenReadsAndWrites {
+    SPiDClient *client = [[SPiDClient alloc] init];
+    SPiDAccessToken *first = [[SPiDAccessToken alloc] initWithUserID:@"1" accessToken:@"first" expiresAt:[NSDate distantFuture] refreshToken:@"refresh-first"];
+    SPiDAccessToken *second = [[SPiDAccessToken alloc] initWithUserID:@"2" accessToken:@"second" expiresAt:[NSDate distantFuture] refreshToken:@"refresh-second"];
+    NSArray *tokens = @[first, second, [NSNull null]];
+
+    __block atomic_int tornReads = 0;
+    dispatch_apply(200000, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t i) {
+        if (i % 16 == 0) {
+            id token = tokens[(i / 16) % tokens.count];
+            client.accessToken = (token == [NSNull null]) ? nil : token;
+            return;
+        }
+
+        SPiDAccessToken *token = client.accessToken;
+        if (token) {
+            BOOL consistent = ([token.userID isEqualToString:@"1"] && [token.accessToken isEqualToString:@"first"]) ||
+                    ([token.userID isEqualToString:@"2"] && [token.accessToken isEqualToString:@"second"]);
+            if (!consistent) {
+                atomic_fetch_add(&tornReads, 1);
+            }
+        }
+        NSString *userID = [client currentUserID];
+        if (userID && !([userID isEqualToString:@"1"] || [userID isEqualToString:@"2"])) {
+            atomic_fetch_add(&tornReads, 1);
+        }
+        [client isAuthorized];
+        [client isClientToken];
+    });
+
+    XCTAssertEqual(atomic_load(&tornReads), 0);
+}
+
+- (void)testStoredTokenLoadsInBackground {
+    SPiDClient *client = [[SPiDClient alloc] init];
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Stored token loaded"];
+    [client notifyWhenAccessTokenLoaded:^{
+        XCTAssertTrue([NSThread isMainThread]);
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:5.0 handler:nil];
+
+    NSDictionary<NSString *, NSNumber *> *timings = client.startupTimings;
+    XCTAssertNotNil(timings[SPiDStartupTimingInitKey]);
+    XCTAssertNotNil(timings[SPiDStartupTimingKeychainLoadKey]);
+    XCTAssertNotNil(timings[SPiDStartupTimingAccountStoreLoadKey]);
+    XCTAssertNil(timings[SPiDStartupTimingWaitKey]);
+    // The keychain is not read on the launch path, which stays within a frame or a few on a slow simulator
+    XCTAssertLessThan([timings[SPiDStartupTimingInitKey] doubleValue], 0.05);
+    XCTAssertLessThan([timings[SPiDStartupTimingKeychainLoadKey] doubleValue], 1.0);
+    XCTAssertLessThan([timings[SPiDStartupTimingAccountStoreLoadKey] doubleValue], 1.0);
+}
+
+- (void)testNewTokenStoreIsLoadedInBackgroundOnce {
+    SPiDClient *client = [self stubbedClient];
+    XCTestExpectation *loaded = [self expectationWithDescription:@"Stored token loaded"];
+    [client notifyWhenAccessTokenLoaded:^{
+        [loaded fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:5.0 handler:nil];
+    NSDictionary<NSString *, NSNumber *> *timings = client.startupTimings;
+
+    __block NSUInteger notificationCount = 0;
+    id observer = [[NSNotificationCenter defaultCenter] addObserverForName:SPiDClientDidLoadAccessTokenNotification object:client queue:nil usingBlock:^(NSNotification *notification) {
+        notificationCount++;
+    }];
+    SPiDMemoryTokenStore *tokenStore = [[SPiDMemoryTokenStore alloc] init];
+    SPiDAccessToken *accessToken = [[SPiDAccessToken alloc] initWithUserID:@"101" accessToken:@"stored" expiresAt:[NSDate distantFuture] refreshToken:@"refresh"];
+    [tokenStore storeAccessToken:accessToken forIdentifier:client.accessTokenIdentifier];
+    client.tokenStore = tokenStore;
+    XCTAssertEqualObjects(client.accessToken.accessToken, @"stored");
+    XCTAssertEqualObjects([client.accountStore accessTokenForUserID:@"101"].accessToken, @"stored");
+
+    // Let a notification posted on the main queue arrive
+    [[NSRunLoop mainRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.1]];
+    [[NSNotificationCenter defaultCenter] removeObserver:observer];
+    XCTAssertEqual(notificationCount, 0u);
+    XCTAssertEqualObjects(client.startupTimings[SPiDStartupTimingKeychainLoadKey], timings[SPiDStartupTimingKeychainLoadKey]);
+    XCTAssertEqualObjects(client.startupTimings[SPiDStartupTimingAccountStoreLoadKey], timings[SPiDStartupTimingAccountStoreLoadKey]);
+}
+
+- (void)testSwitchBetweenStoredAccounts {
+    SPiDClient *client = [[SPiDClient alloc] init];
+    // The accounts must not end up in the keychain of the test host
+    SPiDMemoryTokenStore *tokenStore = [[SPiDMemoryTokenStore alloc] init];
+    client.tokenStore = tokenStore;
+    SPiDAccessToken *first = [[SPiDAccessToken alloc] initWithUserID:@"101" accessToken:@"first" expiresAt:[NSDate distantFuture] refreshToken:@"refresh-first"];
+    SPiDAccessToken *second = [[SPiDAccessToken alloc] initWithUserID:@"102" accessToken:@"second" expiresAt:[NSDate distantFuture] refreshToken:@"refresh-second"];
+    [client.accountStore storeAccessToken:first];
+    [client.accountStore storeAccessToken:second];
+
+    XCTAssertTrue([client switchToAccountWithUserID:@"101"]);
+    XCTAssertEqualObjects([client currentUserID], @"101");
+    XCTAssertTrue([client switchToAccountWithUserID:@"102"]);
+    XCTAssertEqualObjects(client.accessToken.accessToken, @"second");
+    XCTAssertFalse([client switchToAccountWithUserID:@"103"]);
+    XCTAssertEqualObjects([client currentUserID], @"102");
+
+    // Only the user ID of the active account is persisted, a restarted client finds its token among the accounts
+    XCTAssertNil([tokenStore accessTokenForIdentifier:client.accessTokenIdentifier]);
+    SPiDClient *restarted = [[SPiDClient alloc] init];
+    restarted.tokenStore = tokenStore;
+    XCTAssertEqualObjects(restarted.accessToken.accessToken, @"second");
+
+    [client.accountStore removeAccessTokenForUserID:@"101"];
+    [client.accountStore removeAccessTokenForUserID:@"102"];
+    XCTAssertNil([client.accountStore accessTokenForUserID:@"101"]);
+    // Clears the persisted user ID
+    client.accessToken = nil;
+}
+
+- (void)testStoredAccountsAreRefreshedAhead {
+    SPiDClient *client = [self stubbedClient];
+    [SPiDStubURLProtocol setResponse:[NSDictionary sp_JSONStubWithName:@"ValidUserToken"] forPath:@"/oauth/token"];
+    // Due as soon as it is scheduled
+    SPiDAccessToken *expiring = [[SPiDAccessToken alloc] initWithUserID:@"19823123" accessToken:@"expiring" expiresAt:[NSDate dateWithTimeIntervalSinceNow:30] refreshToken:@"refresh-expiring"];
+    SPiDAccessToken *valid = [[SPiDAccessToken alloc] initWithUserID:@"101" accessToken:@"valid" expiresAt:[NSDate distantFuture] refreshToken:@"refresh-valid"];
+    [client.accountStore storeAccessToken:expiring];
+    [client.accountStore storeAccessToken:valid];
+
+    client.refreshesAccountsAhead = YES;
+    XCTAssertNotNil(client.refreshScheduler);
+    NSPredicate *refreshed = [NSPredicate predicateWithBlock:^BOOL(SPiDClient *evaluatedClient, NSDictionary *bindings) {
+        return [[evaluatedClient.accountStore accessTokenForUserID:@"19823123"].accessToken isEqualToString:@"kjaskdjhasdkjhasdkjh12k3j412k3j"];
+    }];
+    [self expectationForPredicate:refreshed evaluatedWithObject:client handler:nil];
+    [self waitForExpectationsWithTimeout:5.0 handler:nil];
+    XCTAssertEqual([SPiDStubURLProtocol requestCountForPath:@"/oauth/token"], 1u);
+    XCTAssertEqualObjects([client.accountStore accessTokenForUserID:@"101"].accessToken, @"valid");
+
+    // The refreshed token was scheduled again when it was stored
+    NSDate *deadline = [NSDate dateWithTimeIntervalSinceNow:1.0];
+    while (client.refreshScheduler.inFlightCount > 0 && [deadline timeIntervalSinceNow] > 0) {
+        [NSThread sleepForTimeInterval:0.01];
+    }
+    XCTAssertEqual(client.refreshScheduler.inFlightCount, 0u);
+    XCTAssertEqual(client.refreshScheduler.queueDepth, 2u);
+
+    [client.accountStore removeAccessTokenForUserID:@"101"];
+    XCTAssertEqual(client.refreshScheduler.queueDepth, 1u);
+
+    client.refreshesAccountsAhead = NO;
+    XCTAssertNil(client.refreshScheduler);
+}
+
+- (void)testClientTokenIsStoredSeparatelyFromUserToken {
+    SPiDClient *client = [self stubbedClient];
+    SPiDAccessToken *userToken = [[SPiDAccessToken alloc] initWithUserID:@"101" accessToken:@"user" expiresAt:[NSDate distantFuture] refreshToken:@"refresh-user"];
+    client.accessToken = userToken;
+    [client.tokenStore storeAccessToken:userToken forIdentifier:client.accessTokenIdentifier];
+    [SPiDStubURLProtocol setResponse:[NSDictionary sp_JSONStubWithName:@"ValidClientToken"] forPath:@"/oauth/token"];
+
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Client token received"];
+    [client clientTokenWithCompletionHandler:^(NSError *error) {
+        XCTAssertNil(error);
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:5.0 handler:nil];
+
+    XCTAssertTrue(client.clientAccessToken.isClientToken);
+    XCTAssertEqualObjects(client.accessToken.accessToken, @"user");
+    XCTAssertEqualObjects([client.tokenStore accessTokenForIdentifier:client.accessTokenIdentifier].accessToken, @"user");
+    XCTAssertEqualObjects([client.tokenStore accessTokenForIdentifier:client.clientAccessTokenIdentifier].accessToken, client.clientAccessToken.accessToken);
+}
+
+- (void)testUserTokenSurvivesSignupRequests {
+    SPiDClient *client = [self stubbedClient];
+    SPiDAccessToken *userToken = [[SPiDAccessToken alloc] initWithUserID:@"101" accessToken:@"user" expiresAt:[NSDate distantFuture] refreshToken:@"refresh-user"];
+    client.accessToken = userToken;
+    [SPiDStubURLProtocol setResponse:[NSDictionary sp_JSONStubWithName:@"ValidClientToken"] forPath:@"/oauth/token"];
+    [SPiDStubURLProtocol setResponse:@{@"data": @{@"exists": @NO}} forPath:[self emailStatusPathForEmail:@"new@example.com"]];
+
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Email status received"];
+    [client emailStatusWithEmail:@"new@example.com" completionHandler:^(SPiDResponse *response) {
+        XCTAssertNil(response.error);
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:5.0 handler:nil];
+
+    XCTAssertTrue([client isAuthorized]);
+    XCTAssertEqualObjects([client currentUserID], @"101");
+    XCTAssertEqualObjects(client.accessToken.accessToken, @"user");
+    XCTAssertNotNil(client.clientAccessToken);
+}
+
+- (void)testClientTokenIsReusedUntilExpired {
+    SPiDClient *client = [self stubbedClient];
+    [SPiDStubURLProtocol setResponse:[NSDictionary sp_JSONStubWithName:@"ValidClientToken"] forPath:@"/oauth/token"];
+    client.clientAccessToken = [[SPiDAccessToken alloc] initWithUserID:nil accessToken:@"cached" expiresAt:[NSDate dateWithTimeIntervalSinceNow:3600] refreshToken:@"refresh"];
+
+    XCTestExpectation *cached = [self expectationWithDescription:@"Cached client token used"];
+    [client clientTokenWithCompletionHandler:^(NSError *error) {
+        XCTAssertNil(error);
+        [cached fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:5.0 handler:nil];
+    XCTAssertEqual([SPiDStubURLProtocol requestCountForPath:@"/oauth/token"], 0u);
+    XCTAssertEqualObjects(client.clientAccessToken.accessToken, @"cached");
+
+    client.clientAccessToken = [[SPiDAccessToken alloc] initWithUserID:nil accessToken:@"expired" expiresAt:[NSDate dateWithTimeIntervalSinceNow:-1] refreshToken:@"refresh"];
+    XCTestExpectation *requested = [self expectationWithDescription:@"New client token requested"];
+    [client clientTokenWithCompletionHandler:^(NSError *error) {
+        XCTAssertNil(error);
+        [requested fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:5.0 handler:nil];
+    XCTAssertEqual([SPiDStubURLProtocol requestCountForPath:@"/oauth/token"], 1u);
+    XCTAssertNotEqualObjects(client.clientAccessToken.accessToken, @"expired");
+}
+
+- (void)testFailedClientTokenRefreshIsReported {
+    SPiDClient *client = [self stubbedClient];
+    client.clientAccessToken = [[SPiDAccessToken alloc] initWithUserID:nil accessToken:@"revoked" expiresAt:[NSDate distantFuture] refreshToken:@"refresh"];
+    NSString *statusPath = [self emailStatusPathForEmail:@"new@example.com"];
+    [SPiDStubURLProtocol setResponse:@{@"error": @{@"code": @401, @"type": @"invalid_token", @"description": @"Token revoked"}} forPath:statusPath];
+    [SPiDStubURLProtocol setResponse:@{@"error": @"invalid_client", @"error_description": @"Unknown client"} forPath:@"/oauth/token"];
+
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Email status failed"];
+    [client emailStatusWithEmail:@"new@example.com" completionHandler:^(SPiDResponse *response) {
+        XCTAssertEqual(response.error.code, SPiDOAuth2InvalidClientErrorCode);
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:5.0 handler:nil];
+
+    // Not rerun with a missing token
+    XCTAssertEqual([SPiDStubURLProtocol requestCountForPath:statusPath], 1u);
+    XCTAssertEqual([SPiDStubURLProtocol requestCountForPath:@"/oauth/token"], 1u);
+}
+
+- (void)testSharedTokenIsRefreshedByOneClient {
+    // Two clients for the same environment sharing a store and a container, as a app and its extension do
+    NSURL *containerURL = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]] isDirectory:YES];
+    SPiDMemoryTokenStore *sharedStore = [[SPiDMemoryTokenStore alloc] init];
+    SPiDClient *app = [self stubbedClient];
+    SPiDClient *extension = [self stubbedClient];
+    SPiDAccessToken *expired = [[SPiDAccessToken alloc] initWithUserID:@"19823123" accessToken:@"expired" expiresAt:[NSDate distantPast] refreshToken:@"refresh"];
+    [sharedStore storeAccessToken:expired forIdentifier:app.accessTokenIdentifier];
+    SPiDAccessToken *clientToken = [[SPiDAccessToken alloc] initWithUserID:nil accessToken:@"client" expiresAt:[NSDate distantFuture] refreshToken:nil];
+    [sharedStore storeAccessToken:clientToken forIdentifier:app.clientAccessTokenIdentifier];
+    for (SPiDClient *client in @[app, extension]) {
+        // The keychain is not available to the tests, the memory store stands in for the shared access group
+        client.tokenStore = sharedStore;
+        [client enableSharedTokenStorageWithAccessGroup:@"group.com.example.spid" containerURL:containerURL];
+        // A custom store is kept
+        XCTAssertEqual(client.tokenStore, sharedStore);
+    }
+    [SPiDStubURLProtocol setResponse:[NSDictionary sp_JSONStubWithName:@"ValidUserToken"] forPath:@"/oauth/token"];
+    [SPiDStubURLProtocol setResponse:@{@"data": @{}} forPath:@"/api/2/me"];
+
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Both requests were run again"];
+    expectation.expectedFulfillmentCount = 2;
+    for (SPiDClient *client in @[app, extension]) {
+        SPiDRequest *request = [SPiDRequest apiGetRequestWithClient:client path:@"/me" completionHandler:^(SPiDResponse *response) {
+            XCTAssertNil(response.error);
+            [expectation fulfill];
+        }];
+        [client refreshAccessTokenAndRerunRequest:request];
+    }
+    [self waitForExpectationsWithTimeout:5.0 handler:nil];
+
+    XCTAssertEqual([SPiDStubURLProtocol requestCountForPath:@"/oauth/token"], 1u);
+    for (SPiDClient *client in @[app, extension]) {
+        XCTAssertEqualObjects(client.accessToken.accessToken, @"kjaskdjhasdkjhasdkjh12k3j412k3j");
+        XCTAssertEqualObjects(client.clientAccessToken.accessToken, @"client");
+        XCTAssertEqualObjects([client.accountStore accessTokenForUserID:@"19823123"].accessToken, @"kjaskdjhasdkjhasdkjh12k3j412k3j");
+    }
+    [[NSFileManager defaultManager] removeItemAtURL:containerURL error:nil];
+}
+
+- (void)exchangeAuthorizationCodeOfflineWithClient:(SPiDClient *)client {
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Authorization code exchange failed"];
+    [client exchangeAuthorizationCode:@"code" completionHandler:^(NSError *error) {
+        XCTAssertTrue([error sp_isOfflineError]);
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:5.0 handler:nil];
+}
+
+- (void)testOfflineAuthorizationCodeExchangeKeepsCode {
+    SPiDClient *client = [self stubbedClient];
+    [self exchangeAuthorizationCodeOfflineWithClient:client];
+
+    // Read back from disk, as after a restart
+    SPiDRequestJournal *journal = [[SPiDRequestJournal alloc] initWithFileURL:client.authorizationJournal.fileURL];
+    XCTAssertEqual(journal.count, 1u);
+    XCTAssertEqualObjects(journal.firstRecord[@"code"], @"code");
+    XCTAssertTrue(client.authorizationJournal.usesCompleteFileProtection);
+    [client.authorizationJournal removeAllRecords];
+}
+
+- (void)testPendingAuthorizationCodeIsResumed {
+    SPiDClient *client = [self stubbedClient];
+    [self exchangeAuthorizationCodeOfflineWithClient:client];
+
+    [SPiDStubURLProtocol setResponse:[NSDictionary sp_JSONStubWithName:@"ValidUserToken"] forPath:@"/oauth/token"];
+    [self expectationForNotification:SPiDClientDidRecoverAuthorizationNotification object:client handler:^BOOL(NSNotification *notification) {
+        // A attempt started by the system network monitor before the stub was set fails as offline
+        return notification.userInfo[SPiDAuthorizationRecoveryErrorKey] == nil;
+    }];
+    [client resumePendingAuthorizationIfNeeded];
+    [self waitForExpectationsWithTimeout:5.0 handler:nil];
+
+    XCTAssertGreaterThanOrEqual([SPiDStubURLProtocol requestCountForPath:@"/oauth/token"], 2u);
+    XCTAssertEqualObjects([client currentUserID], @"19823123");
+    XCTAssertEqual(client.authorizationJournal.count, 0u);
+    XCTAssertEqual([[SPiDRequestJournal alloc] initWithFileURL:client.authorizationJournal.fileURL].count, 0u);
+    XCTAssertNil(client.authorizationNetworkMonitor);
+}
+
+- (void)testOfflineAuthorizationCodeExchangeIsResumedWhenReachable {
+    SPiDClient *client = [self stubbedClient];
+    [self exchangeAuthorizationCodeOfflineWithClient:client];
+    SPiDNetworkMonitor *monitor = client.authorizationNetworkMonitor;
+    XCTAssertNotNil(monitor);
+
+    [SPiDStubURLProtocol setResponse:[NSDictionary sp_JSONStubWithName:@"ValidUserToken"] forPath:@"/oauth/token"];
+    [self expectationForNotification:SPiDClientDidRecoverAuthorizationNotification object:client handler:^BOOL(NSNotification *notification) {
+        // A attempt started by the system network monitor before the stub was set fails as offline
+        return notification.userInfo[SPiDAuthorizationRecoveryErrorKey] == nil;
+    }];
+    [monitor pathDidUpdateWithSatisfied:NO];
+    [monitor pathDidUpdateWithSatisfied:YES];
+    [self waitForExpectationsWithTimeout:5.0 handler:nil];
+
+    XCTAssertEqualObjects([client currentUserID], @"19823123");
+    XCTAssertEqual(client.authorizationJournal.count, 0u);
+    XCTAssertNil(client.authorizationNetworkMonitor);
+}
+
+- (void)testExpiredAuthorizationCodeIsDropped {
+    SPiDClient *client = [self stubbedClient];
+    [client.authorizationJournal appendRecord:@{@"code": @"code", @"received_at": @([[NSDate date] timeIntervalSince1970] - 3600)}];
+
+    // Resumed in the background by the next client for the same environment, as after a restart
+    SPiDClient *restarted = [[SPiDClient alloc] initWithClientID:@"client" clientSecret:@"secret" appURLScheme:@"spidtest://" serverURL:[NSURL URLWithString:@"https://login.example.com"]];
+    XCTAssertEqualObjects(restarted.authorizationJournal.fileURL, client.authorizationJournal.fileURL);
+    [self expectationForPredicate:[NSPredicate predicateWithFormat:@"count == 0"] evaluatedWithObject:restarted.authorizationJournal handler:nil];
+    [self waitForExpectationsWithTimeout:5.0 handler:nil];
+    XCTAssertEqual([[SPiDRequestJournal alloc] initWithFileURL:client.authorizationJournal.fileURL].count, 0u);
+    XCTAssertEqual(restarted.authorizationRecoveryLatency, 0);
+    XCTAssertEqual([SPiDStubURLProtocol requestCountForPath:@"/oauth/token"], 0u);
+}
+
+- (void)testIndependentClientsKeepTheirTokensApart {
+    // One token store, as both clients would use the same keychain
+    SPiDMemoryTokenStore *tokenStore = [[SPiDMemoryTokenStore alloc] init];
+    SPiDClient *production = [[SPiDClient alloc] initWithClientID:@"client" clientSecret:@"secret" appURLScheme:@"spidtest://" serverURL:[NSURL URLWithString:@"https://login.example.com"]];
+    SPiDClient *staging = [[SPiDClient alloc] initWithClientID:@"client" clientSecret:@"secret" appURLScheme:@"spidtest://" serverURL:[NSURL URLWithString:@"https://stage.example.com"]];
+    production.tokenStore = tokenStore;
+    staging.tokenStore = tokenStore;
+    XCTAssertNotEqualObjects(production.storageKey, staging.storageKey);
+    XCTAssertNotEqualObjects(production.accessTokenIdentifier, staging.accessTokenIdentifier);
+    XCTAssertNotEqualObjects(production.requestJournal.fileURL, staging.requestJournal.fileURL);
+
+    SPiDAccessToken *productionToken = [[SPiDAccessToken alloc] initWithUserID:@"101" accessToken:@"production" expiresAt:[NSDate distantFuture] refreshToken:@"refresh-production"];
+    SPiDAccessToken *productionClientToken = [[SPiDAccessToken alloc] initWithUserID:nil accessToken:@"production-client" expiresAt:[NSDate distantFuture] refreshToken:@"refresh-production-client"];
+    SPiDAccessToken *stagingToken = [[SPiDAccessToken alloc] initWithUserID:@"101" accessToken:@"staging" expiresAt:[NSDate distantFuture] refreshToken:@"refresh-staging"];
+    [tokenStore storeAccessToken:productionToken forIdentifier:production.accessTokenIdentifier];
+    [tokenStore storeAccessToken:productionClientToken forIdentifier:production.clientAccessTokenIdentifier];
+    [production.accountStore storeAccessToken:productionToken];
+    [tokenStore storeAccessToken:stagingToken forIdentifier:staging.accessTokenIdentifier];
+    [staging.accountStore storeAccessToken:stagingToken];
+
+    // Reloaded from the store, as after a restart
+    production.tokenStore = tokenStore;
+    staging.tokenStore = tokenStore;
+    XCTAssertEqualObjects(production.accessToken.accessToken, @"production");
+    XCTAssertEqualObjects(production.clientAccessToken.accessToken, @"production-client");
+    XCTAssertEqualObjects([production.accountStore accessTokenForUserID:@"101"].accessToken, @"production");
+    XCTAssertEqualObjects(staging.accessToken.accessToken, @"staging");
+    XCTAssertNil(staging.clientAccessToken);
+    XCTAssertEqualObjects([staging.accountStore accessTokenForUserID:@"101"].accessToken, @"staging");
+    XCTAssertEqual(staging.accountStore.userIDs.count, 1u);
+
+    // Clients that are not bound to a environment keep the names of earlier versions
+    SPiDClient *unprefixed = [[SPiDClient alloc] init];
+    XCTAssertNil(unprefixed.storageKey);
+    XCTAssertEqualObjects(unprefixed.accessTokenIdentifier, AccessTokenKeychainIdentification);
+    XCTAssertEqualObjects(unprefixed.clientAccessTokenIdentifier, ClientAccessTokenKeychainIdentification);
+}
+
+- (void)testIndependentClientsShareTransport {
+    SPiDClient *production = [[SPiDClient alloc] initWithClientID:@"production-client" clientSecret:@"secret" appURLScheme:@"spidtest://" serverURL:[NSURL URLWithString:@"https://login.example.com"]];
+    SPiDClient *staging = [[SPiDClient alloc] initWithClientID:@"staging-client" clientSecret:@"secret" appURLScheme:@"spidtest://" serverURL:[NSURL URLWithString:@"https://stage.example.com"]];
+    XCTAssertEqualObjects(staging.tokenURL.absoluteString, @"https://stage.example.com/oauth/token");
+    XCTAssertEqual(production.URLSession, staging.URLSession);
+    XCTAssertEqual(production.requestScheduler, staging.requestScheduler);
+
+    SPiDRequest *productionRequest = [SPiDRequest apiGetRequestWithClient:production path:@"/me" completionHandler:^(SPiDResponse *response) {}];
+    SPiDRequest *stagingRequest = [SPiDRequest apiGetRequestWithClient:staging path:@"/me" completionHandler:^(SPiDResponse *response) {}];
+    XCTAssertEqual(productionRequest.client, production);
+    XCTAssertEqualObjects(productionRequest.URL.absoluteString, @"https://login.example.com/api/2/me");
+    XCTAssertEqualObjects(stagingRequest.URL.absoluteString, @"https://stage.example.com/api/2/me");
+
+    SPiDTokenRequest *tokenRequest = [SPiDTokenRequest clientTokenRequestWithClient:staging completionHandler:nil];
+    XCTAssertEqual(tokenRequest.client, staging);
+    XCTAssertTrue([tokenRequest.HTTPBody rangeOfString:@"client_id=staging-client"].location != NSNotFound);
+}
+
+@end
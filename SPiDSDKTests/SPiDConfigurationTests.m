@@ -0,0 +1,92 @@
+//
+//  SPiDConfigurationTests.m
+//  SPiDSDK
+//
+//  Copyright (c) 2012 Schibsted Payment. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import "SPiDClient.h"
+#import "SPiDConfiguration.h"
+#import "SPiDRequest.h"
+#import "NSURLRequest+SPiD.h"
+
+static const NSUInteger SPiDBenchmarkRequestCount = 10000;
+
+@interface SPiDConfigurationTests : XCTestCase
+
+@end
+
+@implementation SPiDConfigurationTests
+
+- (SPiDClient *)configuredClient {
+    return [[SPiDClient alloc] initWithClientID:@"client" clientSecret:@"secret" appURLScheme:@"spidtest://" serverURL:[NSURL URLWithString:@"https://login.example.com"]];
+}
+
+- (void)testConfigurationIsRebuiltWhenSettingsChange {
+    SPiDClient *client = [self configuredClient];
+    SPiDConfiguration *configuration = client.configuration;
+    XCTAssertEqual(client.configuration, configuration);
+    XCTAssertEqualObjects(configuration.APIPathPrefix, @"/api/2");
+    XCTAssertTrue([configuration.authorizationURLWithQuery.absoluteString hasPrefix:@"https://login.example.com/flow/login?"]);
+    XCTAssertTrue([configuration.authorizationQuery rangeOfString:@"client_id=client"].location != NSNotFound);
+    XCTAssertNotNil(configuration.HTTPHeaders[@"User-Agent"]);
+
+    client.useMobileWeb = NO;
+    XCTAssertNotEqual(client.configuration, configuration);
+    XCTAssertTrue([client.configuration.authorizationQuery rangeOfString:@"platform"].location == NSNotFound);
+
+    client.apiVersionSPiD = @"3";
+    XCTAssertEqualObjects(client.configuration.APIPathPrefix, @"/api/3");
+    SPiDRequest *request = [SPiDRequest apiGetRequestWithClient:client path:@"/me" completionHandler:^(SPiDResponse *response) {}];
+    XCTAssertEqualObjects(request.URL.absoluteString, @"https://login.example.com/api/3/me");
+}
+
+- (void)testPerRequestConstructionPerformance {
+    SPiDClient *client = [self configuredClient];
+    [self measureBlock:^{
+        for (NSUInteger i = 0; i < SPiDBenchmarkRequestCount; i++) {
+            @autoreleasepool {
+                SPiDRequest *request = [SPiDRequest apiGetRequestWithClient:client path:@"/me" completionHandler:^(SPiDResponse *response) {}];
+                [NSURLRequest sp_requestWithURL:request.URL method:request.HTTPMethod andBody:nil];
+                [client authorizationURLWithQuery];
+            }
+        }
+    }];
+}
+
+- (void)testPerRequestConstructionWithoutSnapshotPerformance {
+    // Baseline, does for every request what was done before the snapshot: formats the API path and URL, builds the
+    // User-Agent from Info.plist and the device, and encodes the authorization query
+    SPiDClient *client = [self configuredClient];
+    [self measureBlock:^{
+        for (NSUInteger i = 0; i < SPiDBenchmarkRequestCount; i++) {
+            @autoreleasepool {
+                NSString *path = [NSString stringWithFormat:@"/api/%@%@", [client apiVersionSPiD], @"/me"];
+                NSURL *URL = [NSURL URLWithString:[NSString stringWithFormat:@"%@%@", [[client serverURL] absoluteString], path]];
+                NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:URL cachePolicy:NSURLRequestUseProtocolCachePolicy timeoutInterval:60.0];
+                [request setHTTPMethod:@"GET"];
+                NSDictionary *infoDictionary = [[NSBundle mainBundle] infoDictionary];
+                NSString *userAgent = [NSString stringWithFormat:@"%@/%@ SPiDIOSSDK/%@ %@/%@", [infoDictionary objectForKey:@"CFBundleDisplayName"], [infoDictionary objectForKey:@"CFBundleVersion"], SPID_IOS_SDK_VERSION_STRING, [UIDevice currentDevice].model, [UIDevice currentDevice].systemVersion];
+                [request setValue:userAgent forHTTPHeaderField:@"User-Agent"];
+                [request copy];
+
+                NSMutableDictionary *query = [NSMutableDictionary dictionary];
+                [query setObject:client.clientID forKey:@"client_id"];
+                if ([client.redirectURI.absoluteString hasSuffix:@"/"]) {
+                    [query setObject:[client.redirectURI.absoluteString stringByAppendingString:@"login"] forKey:@"redirect_uri"];
+                } else {
+                    [query setObject:[client.redirectURI.absoluteString stringByAppendingString:@"/login"] forKey:@"redirect_uri"];
+                }
+                [query setObject:@"authorization_code" forKey:@"grant_type"];
+                [query setObject:@"code" forKey:@"response_type"];
+                if (client.useMobileWeb)
+                    [query setObject:@"mobile" forKey:@"platform"];
+                [query setObject:@"1" forKey:@"force"];
+                [NSURL URLWithString:[client.authorizationURL.absoluteString stringByAppendingString:[SPiDUtils encodedHttpQueryForDictionary:query]]];
+            }
+        }
+    }];
+}
+
+@end
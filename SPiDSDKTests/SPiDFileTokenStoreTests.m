@@ -0,0 +1,107 @@
+//
+//  SPiDFileTokenStoreTests.m
+//  SPiDSDK
+//
+//  Copyright (c) 2012 Schibsted Payment. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import "SPiDFileTokenStore.h"
+#import "SPiDAccessToken.h"
+
+@interface SPiDFileTokenStoreTests : XCTestCase
+
+@property (nonatomic, strong) NSURL *directoryURL;
+@property (nonatomic, strong) NSData *key;
+
+@end
+
+@implementation SPiDFileTokenStoreTests
+
+- (void)setUp {
+    [super setUp];
+    NSString *name = [NSString stringWithFormat:@"SPiDFileTokenStoreTests-%@", [[NSUUID UUID] UUIDString]];
+    self.directoryURL = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:name] isDirectory:YES];
+    self.key = [@"0123456789abcdef0123456789abcdef" dataUsingEncoding:NSUTF8StringEncoding];
+}
+
+- (void)tearDown {
+    [[NSFileManager defaultManager] removeItemAtURL:self.directoryURL error:nil];
+    [super tearDown];
+}
+
+- (SPiDAccessToken *)tokenForUserID:(NSString *)userID {
+    return [[SPiDAccessToken alloc] initWithUserID:userID accessToken:[@"access-" stringByAppendingString:userID] expiresAt:[NSDate dateWithTimeIntervalSinceReferenceDate:600000000] refreshToken:[@"refresh-" stringByAppendingString:userID]];
+}
+
+- (void)testStoreLoadAndRemove {
+    SPiDFileTokenStore *store = [[SPiDFileTokenStore alloc] initWithDirectoryURL:self.directoryURL key:self.key];
+    [store storeAccessToken:[self tokenForUserID:@"1"] forIdentifier:@"AccessToken-1"];
+    [store storeAccessToken:[self tokenForUserID:@"2"] forIdentifier:@"AccessToken-2"];
+    [store storeAccessToken:[self tokenForUserID:@"3"] forIdentifier:@"ClientAccessToken"];
+
+    XCTAssertEqualObjects([store accessTokenForIdentifier:@"AccessToken-1"].accessToken, @"access-1");
+    NSDictionary<NSString *, SPiDAccessToken *> *accounts = [store accessTokensWithIdentifierPrefix:@"AccessToken-"];
+    XCTAssertEqual(accounts.count, 2u);
+    XCTAssertEqualObjects(accounts[@"AccessToken-2"].refreshToken, @"refresh-2");
+
+    [store storeAccessToken:[self tokenForUserID:@"4"] forIdentifier:@"AccessToken-1"];
+    XCTAssertEqualObjects([store accessTokenForIdentifier:@"AccessToken-1"].accessToken, @"access-4");
+
+    [store removeAccessTokenForIdentifier:@"AccessToken-1"];
+    XCTAssertNil([store accessTokenForIdentifier:@"AccessToken-1"]);
+}
+
+- (void)testFileIsEncrypted {
+    SPiDFileTokenStore *store = [[SPiDFileTokenStore alloc] initWithDirectoryURL:self.directoryURL key:self.key];
+    [store storeAccessToken:[self tokenForUserID:@"1"] forIdentifier:@"AccessToken-1"];
+
+    NSURL *fileURL = [[[NSFileManager defaultManager] contentsOfDirectoryAtURL:self.directoryURL includingPropertiesForKeys:nil options:0 error:nil] firstObject];
+    NSData *contents = [NSData dataWithContentsOfURL:fileURL];
+    XCTAssertEqual([contents rangeOfData:[@"access-1" dataUsingEncoding:NSUTF8StringEncoding] options:0 range:NSMakeRange(0, contents.length)].location, NSNotFound);
+}
+
+#if !TARGET_OS_SIMULATOR
+- (void)testFileIsReadableAfterFirstUnlock {
+    SPiDFileTokenStore *store = [[SPiDFileTokenStore alloc] initWithDirectoryURL:self.directoryURL key:self.key];
+    [store storeAccessToken:[self tokenForUserID:@"1"] forIdentifier:@"AccessToken-1"];
+
+    NSURL *fileURL = [[[NSFileManager defaultManager] contentsOfDirectoryAtURL:self.directoryURL includingPropertiesForKeys:nil options:0 error:nil] firstObject];
+    NSDictionary *attributes = [[NSFileManager defaultManager] attributesOfItemAtPath:fileURL.path error:nil];
+    XCTAssertEqualObjects(attributes[NSFileProtectionKey], NSFileProtectionCompleteUntilFirstUserAuthentication);
+}
+#endif
+
+- (void)testModifiedFileIsRejected {
+    SPiDFileTokenStore *store = [[SPiDFileTokenStore alloc] initWithDirectoryURL:self.directoryURL key:self.key];
+    [store storeAccessToken:[self tokenForUserID:@"1"] forIdentifier:@"AccessToken-1"];
+
+    NSURL *fileURL = [[[NSFileManager defaultManager] contentsOfDirectoryAtURL:self.directoryURL includingPropertiesForKeys:nil options:0 error:nil] firstObject];
+    NSMutableData *contents = [NSMutableData dataWithContentsOfURL:fileURL];
+    ((uint8_t *) contents.mutableBytes)[20] ^= 0x01;
+    [contents writeToURL:fileURL atomically:YES];
+    XCTAssertNil([store accessTokenForIdentifier:@"AccessToken-1"]);
+}
+
+- (void)testOtherKeyIsRejected {
+    SPiDFileTokenStore *store = [[SPiDFileTokenStore alloc] initWithDirectoryURL:self.directoryURL key:self.key];
+    [store storeAccessToken:[self tokenForUserID:@"1"] forIdentifier:@"AccessToken-1"];
+
+    NSData *otherKey = [@"fedcba9876543210fedcba9876543210" dataUsingEncoding:NSUTF8StringEncoding];
+    SPiDFileTokenStore *other = [[SPiDFileTokenStore alloc] initWithDirectoryURL:self.directoryURL key:otherKey];
+    XCTAssertNil([other accessTokenForIdentifier:@"AccessToken-1"]);
+    XCTAssertNil([[SPiDFileTokenStore alloc] initWithDirectoryURL:self.directoryURL key:[NSData dataWithBytes:"short" length:5]]);
+}
+
+- (void)testPerformanceStoreAndLoad {
+    SPiDFileTokenStore *store = [[SPiDFileTokenStore alloc] initWithDirectoryURL:self.directoryURL key:self.key];
+    SPiDAccessToken *token = [self tokenForUserID:@"1"];
+    [self measureBlock:^{
+        for (NSUInteger i = 0; i < 200; i++) {
+            [store storeAccessToken:token forIdentifier:@"AccessToken-1"];
+            [store accessTokenForIdentifier:@"AccessToken-1"];
+        }
+    }];
+}
+
+@end
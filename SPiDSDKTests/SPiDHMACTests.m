@@ -0,0 +1,117 @@
+//
+//  SPiDHMACTests.m
+//  SPiDSDK
+//
+//  Copyright (c) 2012 Schibsted Payment. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <CommonCrypto/CommonHMAC.h>
+#import "SPiDHMAC.h"
+#import "NSString+Crypto.h"
+
+static const NSUInteger SPiDBenchmarkSignatureCount = 10000;
+
+@interface SPiDHMACTests : XCTestCase
+
+@end
+
+@implementation SPiDHMACTests
+
+- (NSData *)dataWithByte:(uint8_t)byte length:(NSUInteger)length {
+    NSMutableData *data = [NSMutableData dataWithLength:length];
+    memset(data.mutableBytes, byte, length);
+    return data;
+}
+
+- (NSData *)jwtPayload {
+    return [@"eyJhbGciOiJIUzI1NiIsInR5cCI6IkpXVCJ9.eyJpc3MiOiJodHRwczovL2xvZ2luLmV4YW1wbGUuY29tIiwic3ViIjoiMTIzNDUiLCJleHAiOjE3MDAwMDAwMDB9" dataUsingEncoding:NSUTF8StringEncoding];
+}
+
+- (void)testRFC4231Vectors {
+    SPiDHMAC *hmac = [[SPiDHMAC alloc] initWithKey:[self dataWithByte:0x0b length:20]];
+    XCTAssertEqualObjects([hmac hexSignatureForData:[@"Hi There" dataUsingEncoding:NSASCIIStringEncoding]],
+            @"b0344c61d8db38535ca8afceaf0bf12b881dc200c9833da726e9376c2e32cff7");
+
+    hmac = [[SPiDHMAC alloc] initWithKey:[@"Jefe" dataUsingEncoding:NSASCIIStringEncoding]];
+    XCTAssertEqualObjects([hmac hexSignatureForData:[@"what do ya want for nothing?" dataUsingEncoding:NSASCIIStringEncoding]],
+            @"5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843");
+
+    hmac = [[SPiDHMAC alloc] initWithKey:[self dataWithByte:0xaa length:131]];
+    XCTAssertEqualObjects([hmac hexSignatureForData:[@"Test Using Larger Than Block-Size Key - Hash Key First" dataUsingEncoding:NSASCIIStringEncoding]],
+            @"60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54");
+}
+
+- (void)testStreamingMatchesOneShot {
+    SPiDHMAC *hmac = [[SPiDHMAC alloc] initWithKey:[@"secret" dataUsingEncoding:NSUTF8StringEncoding]];
+    NSData *payload = [self jwtPayload];
+    NSData *expected = [hmac signatureForData:payload];
+    XCTAssertEqual(expected.length, SPiDHMACSignatureLength);
+
+    for (NSUInteger split = 0; split <= payload.length; split += 7) {
+        [hmac updateWithData:[payload subdataWithRange:NSMakeRange(0, split)]];
+        [hmac updateWithBytes:(const uint8_t *) payload.bytes + split length:payload.length - split];
+        XCTAssertEqualObjects([hmac finalSignature], expected);
+    }
+
+    [hmac updateWithData:[payload subdataWithRange:NSMakeRange(0, 10)]];
+    SPiDHMAC *copy = [hmac copy];
+    [copy updateWithData:[payload subdataWithRange:NSMakeRange(10, payload.length - 10)]];
+    XCTAssertEqualObjects([copy finalSignature], expected);
+    XCTAssertEqualObjects([hmac signatureForData:payload], expected);
+}
+
+- (void)testVerifySignature {
+    SPiDHMAC *hmac = [[SPiDHMAC alloc] initWithKey:[@"secret" dataUsingEncoding:NSUTF8StringEncoding]];
+    NSData *payload = [self jwtPayload];
+    NSMutableData *signature = [[hmac signatureForData:payload] mutableCopy];
+    XCTAssertTrue([hmac verifySignature:signature forData:payload]);
+    ((uint8_t *) signature.mutableBytes)[31] ^= 1;
+    XCTAssertFalse([hmac verifySignature:signature forData:payload]);
+    XCTAssertFalse([hmac verifySignature:[signature subdataWithRange:NSMakeRange(0, 16)] forData:payload]);
+    XCTAssertTrue([SPiDHMAC isData:[NSData data] constantTimeEqualToData:[NSData data]]);
+}
+
+- (void)testStringSignature {
+    XCTAssertEqualObjects([@"what do ya want for nothing?" hmacSHA256withKey:@"Jefe"], @"5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843");
+    // Non ASCII and embedded NUL used to crash or truncate
+    NSString *unicode = @"blåbærsyltetøy";
+    NSData *unicodeData = [unicode dataUsingEncoding:NSUTF8StringEncoding];
+    SPiDHMAC *hmac = [[SPiDHMAC alloc] initWithKey:[@"nøkkel" dataUsingEncoding:NSUTF8StringEncoding]];
+    XCTAssertEqualObjects([unicode hmacSHA256withKey:@"nøkkel"], [hmac hexSignatureForData:unicodeData]);
+    unichar embeddedNul[] = {'a', 0, 'b'};
+    NSString *withNul = [NSString stringWithCharacters:embeddedNul length:3];
+    XCTAssertNotEqualObjects([withNul hmacSHA256withKey:@"key"], [@"a" hmacSHA256withKey:@"key"]);
+    XCTAssertEqualObjects([SPiDHMAC hexStringWithData:[NSData dataWithBytes:"\x00\x0f\xf0\xff" length:4]], @"000ff0ff");
+}
+
+- (void)testLegacySigningPerformance {
+    NSData *key = [@"a9b8c7d6e5f4g3h2i1j0" dataUsingEncoding:NSUTF8StringEncoding];
+    NSData *payload = [self jwtPayload];
+    [self measureBlock:^{
+        for (NSUInteger i = 0; i < SPiDBenchmarkSignatureCount; i++) {
+            @autoreleasepool {
+                unsigned char signature[CC_SHA256_DIGEST_LENGTH];
+                CCHmac(kCCHmacAlgSHA256, key.bytes, key.length, payload.bytes, payload.length, signature);
+                NSMutableString *result = [NSMutableString string];
+                for (int j = 0; j < sizeof signature; j++) {
+                    [result appendFormat:@"%02hhx", signature[j]];
+                }
+            }
+        }
+    }];
+}
+
+- (void)testSigningPerformance {
+    SPiDHMAC *hmac = [[SPiDHMAC alloc] initWithKey:[@"a9b8c7d6e5f4g3h2i1j0" dataUsingEncoding:NSUTF8StringEncoding]];
+    NSData *payload = [self jwtPayload];
+    [self measureBlock:^{
+        for (NSUInteger i = 0; i < SPiDBenchmarkSignatureCount; i++) {
+            @autoreleasepool {
+                [hmac hexSignatureForData:payload];
+            }
+        }
+    }];
+}
+
+@end
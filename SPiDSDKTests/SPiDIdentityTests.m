@@ -0,0 +1,118 @@
+//
+//  SPiDIdentityTests.m
+//  SPiDSDK
+//
+//  Copyright (c) 2012 Schibsted Payment. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import "SPiDIdentity.h"
+#import "SPiDJwtCodec.h"
+#import "NSError+SPiD.h"
+
+static NSString *const SPiDTestClientID = @"4ef1cfb0e962dd2e0d8d0000";
+static NSString *const SPiDTestClientSecret = @"a9b8c7d6e5f4g3h2i1j0";
+static NSString *const SPiDTestServerURL = @"https://login.example.com";
+
+@interface SPiDIdentityTests : XCTestCase
+
+@end
+
+@implementation SPiDIdentityTests
+
+- (NSMutableDictionary *)claims {
+    NSTimeInterval now = [[NSDate date] timeIntervalSince1970];
+    return [@{@"iss": @"https://login.example.com/",
+              @"sub": @"12345",
+              @"aud": SPiDTestClientID,
+              @"iat": @((long long) now),
+              @"exp": @((long long) now + 3600),
+              @"email": @"kari.nordmann@example.com",
+              @"name": @"Kari Nordmann",
+              @"given_name": @"Kari",
+              @"family_name": @"Nordmann"} mutableCopy];
+}
+
+- (NSString *)idTokenWithClaims:(NSDictionary *)claims secret:(NSString *)secret {
+    return [[[SPiDJwtCodec alloc] initWithSignSecret:secret] encodedJwtWithClaims:claims];
+}
+
+- (void)testIdentityFromIDToken {
+    NSDictionary *claims = [self claims];
+    NSString *idToken = [self idTokenWithClaims:claims secret:SPiDTestClientSecret];
+    NSError *error;
+    SPiDIdentity *identity = [SPiDIdentity identityWithIDToken:idToken clientID:SPiDTestClientID clientSecret:SPiDTestClientSecret issuer:[NSURL URLWithString:SPiDTestServerURL] error:&error];
+    XCTAssertNil(error);
+    XCTAssertEqualObjects(identity.userID, @"12345");
+    XCTAssertEqualObjects(identity.email, @"kari.nordmann@example.com");
+    XCTAssertEqualObjects(identity.displayName, @"Kari Nordmann");
+    XCTAssertEqualObjects(identity.givenName, @"Kari");
+    XCTAssertEqualObjects(identity.familyName, @"Nordmann");
+    XCTAssertEqualObjects(identity.expiresAt, [NSDate dateWithTimeIntervalSince1970:[claims[@"exp"] doubleValue]]);
+    XCTAssertEqualObjects(identity.claims, claims);
+}
+
+- (void)testAudienceList {
+    NSMutableDictionary *claims = [self claims];
+    claims[@"aud"] = @[@"other", SPiDTestClientID];
+    NSString *idToken = [self idTokenWithClaims:claims secret:SPiDTestClientSecret];
+    XCTAssertNotNil([SPiDIdentity identityWithIDToken:idToken clientID:SPiDTestClientID clientSecret:SPiDTestClientSecret issuer:[NSURL URLWithString:SPiDTestServerURL] error:nil]);
+}
+
+- (void)testRejectedIDTokens {
+    NSError *error;
+    NSString *idToken = [self idTokenWithClaims:[self claims] secret:@"other secret"];
+    XCTAssertNil([SPiDIdentity identityWithIDToken:idToken clientID:SPiDTestClientID clientSecret:SPiDTestClientSecret issuer:[NSURL URLWithString:SPiDTestServerURL] error:&error]);
+    XCTAssertEqual(error.code, SPiDJwtInvalidSignatureErrorCode);
+
+    NSMutableDictionary *claims = [self claims];
+    claims[@"aud"] = @"other client";
+    idToken = [self idTokenWithClaims:claims secret:SPiDTestClientSecret];
+    XCTAssertNil([SPiDIdentity identityWithIDToken:idToken clientID:SPiDTestClientID clientSecret:SPiDTestClientSecret issuer:[NSURL URLWithString:SPiDTestServerURL] error:&error]);
+    XCTAssertEqual(error.code, SPiDJwtInvalidAudienceErrorCode);
+
+    claims = [self claims];
+    claims[@"exp"] = @((long long) [[NSDate date] timeIntervalSince1970] - 3600);
+    idToken = [self idTokenWithClaims:claims secret:SPiDTestClientSecret];
+    XCTAssertNil([SPiDIdentity identityWithIDToken:idToken clientID:SPiDTestClientID clientSecret:SPiDTestClientSecret issuer:[NSURL URLWithString:SPiDTestServerURL] error:&error]);
+    XCTAssertEqual(error.code, SPiDJwtExpiredErrorCode);
+
+    claims = [self claims];
+    [claims removeObjectForKey:@"sub"];
+    idToken = [self idTokenWithClaims:claims secret:SPiDTestClientSecret];
+    XCTAssertNil([SPiDIdentity identityWithIDToken:idToken clientID:SPiDTestClientID clientSecret:SPiDTestClientSecret issuer:[NSURL URLWithString:SPiDTestServerURL] error:&error]);
+    XCTAssertEqual(error.code, SPiDJwtMalformedErrorCode);
+
+    claims = [self claims];
+    [claims removeObjectForKey:@"exp"];
+    idToken = [self idTokenWithClaims:claims secret:SPiDTestClientSecret];
+    XCTAssertNil([SPiDIdentity identityWithIDToken:idToken clientID:SPiDTestClientID clientSecret:SPiDTestClientSecret issuer:[NSURL URLWithString:SPiDTestServerURL] error:&error]);
+    XCTAssertEqual(error.code, SPiDJwtMalformedErrorCode);
+
+    claims = [self claims];
+    claims[@"iss"] = @"https://login.other.com/";
+    idToken = [self idTokenWithClaims:claims secret:SPiDTestClientSecret];
+    XCTAssertNil([SPiDIdentity identityWithIDToken:idToken clientID:SPiDTestClientID clientSecret:SPiDTestClientSecret issuer:[NSURL URLWithString:SPiDTestServerURL] error:&error]);
+    XCTAssertEqual(error.code, SPiDJwtInvalidIssuerErrorCode);
+
+    claims = [self claims];
+    [claims removeObjectForKey:@"iss"];
+    idToken = [self idTokenWithClaims:claims secret:SPiDTestClientSecret];
+    XCTAssertNil([SPiDIdentity identityWithIDToken:idToken clientID:SPiDTestClientID clientSecret:SPiDTestClientSecret issuer:[NSURL URLWithString:SPiDTestServerURL] error:&error]);
+    XCTAssertEqual(error.code, SPiDJwtInvalidIssuerErrorCode);
+}
+
+- (void)testIssuerIgnoresTrailingSlash {
+    NSString *idToken = [self idTokenWithClaims:[self claims] secret:SPiDTestClientSecret];
+    XCTAssertNotNil([SPiDIdentity identityWithIDToken:idToken clientID:SPiDTestClientID clientSecret:SPiDTestClientSecret issuer:[NSURL URLWithString:@"https://login.example.com/"] error:nil]);
+    XCTAssertNotNil([SPiDIdentity identityWithIDToken:idToken clientID:SPiDTestClientID clientSecret:SPiDTestClientSecret issuer:[NSURL URLWithString:@"https://login.example.com"] error:nil]);
+}
+
+- (void)testDisplayNameFallsBackToPreferredUsername {
+    SPiDIdentity *identity = [[SPiDIdentity alloc] initWithClaims:@{@"sub": @"12345", @"preferred_username": @"kari", @"email": @42}];
+    XCTAssertEqualObjects(identity.displayName, @"kari");
+    XCTAssertNil(identity.email);
+    XCTAssertNil([[SPiDIdentity alloc] initWithClaims:@{@"sub": @12345}]);
+}
+
+@end
@@ -0,0 +1,121 @@
+//
+//  SPiDJwtCodecTests.m
+//  SPiDSDK
+//
+//  Copyright (c) 2012 Schibsted Payment. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import "SPiDJwtCodec.h"
+#import "SPiDJwt.h"
+#import "NSData+Base64.h"
+#import "NSError+SPiD.h"
+
+static const NSUInteger SPiDBenchmarkJwtCount = 10000;
+
+@interface SPiDJwtCodecTests : XCTestCase
+
+@end
+
+@implementation SPiDJwtCodecTests
+
+- (NSDictionary *)claimsExpiringIn:(NSTimeInterval)interval {
+    return @{@"iss": @"https://login.example.com/",
+             @"sub": @"12345",
+             @"aud": @"4ef1cfb0e962dd2e0d8d0000",
+             @"exp": @((long long) ([[NSDate date] timeIntervalSince1970] + interval))};
+}
+
+- (void)testRoundTrip {
+    SPiDJwtCodec *codec = [[SPiDJwtCodec alloc] initWithSignSecret:@"payment"];
+    NSDictionary *claims = [self claimsExpiringIn:3600];
+    NSString *jwt = [codec encodedJwtWithClaims:claims];
+    XCTAssertTrue([jwt hasPrefix:@"eyJhbGciOiJIUzI1NiIsInR5cCI6IkpXVCJ9."]);
+    XCTAssertEqual([jwt rangeOfCharacterFromSet:[NSCharacterSet characterSetWithCharactersInString:@"+/="]].location, NSNotFound);
+
+    NSError *error;
+    XCTAssertEqualObjects([codec verifiedClaimsFromJwt:jwt error:&error], claims);
+    XCTAssertNil(error);
+    XCTAssertEqualObjects([SPiDJwtCodec unverifiedClaimsFromJwt:jwt], claims);
+    SPiDJwtCodec *signCodec = [SPiDJwtCodec codecWithSignSecret:@"payment"];
+    SPiDJwtCodec *clientCodec = [SPiDJwtCodec codecWithSignSecret:@"client secret"];
+    XCTAssertNotEqual(signCodec, clientCodec);
+    XCTAssertEqual([SPiDJwtCodec codecWithSignSecret:@"payment"], signCodec);
+    XCTAssertEqual([SPiDJwtCodec codecWithSignSecret:@"client secret"], clientCodec);
+}
+
+- (void)testRFC7515Example {
+    NSData *key = [NSData sp_dataWithBase64UrlEncodedString:@"AyM1SysPpbyDfgZld3umj1qzKObwVMkoqQ-EstJQLr_T-1qS0gZH75aKtMN3Yj0iPS4hcgUuTwjAzZr1Z9CAow"];
+    SPiDJwtCodec *codec = [[SPiDJwtCodec alloc] initWithKey:key];
+    NSString *jwt = @"eyJ0eXAiOiJKV1QiLA0KICJhbGciOiJIUzI1NiJ9"
+                    @".eyJpc3MiOiJqb2UiLA0KICJleHAiOjEzMDA4MTkzODAsDQogImh0dHA6Ly9leGFtcGxlLmNvbS9pc19yb290Ijp0cnVlfQ"
+                    @".dBjftJeZ4CVP-mB92K27uhbUJU1p1r_wW1gFWFOEjXk";
+    // The signature is valid, but the example expired in 2011
+    NSError *error;
+    XCTAssertNil([codec verifiedClaimsFromJwt:jwt error:&error]);
+    XCTAssertEqual(error.code, SPiDJwtExpiredErrorCode);
+
+    codec.expirationLeeway = [[NSDate date] timeIntervalSince1970];
+    NSDictionary *claims = [codec verifiedClaimsFromJwt:jwt error:nil];
+    XCTAssertEqualObjects([claims objectForKey:@"iss"], @"joe");
+}
+
+- (void)testRejectedJwts {
+    SPiDJwtCodec *codec = [[SPiDJwtCodec alloc] initWithSignSecret:@"payment"];
+    NSString *jwt = [codec encodedJwtWithClaims:[self claimsExpiringIn:3600]];
+    NSError *error;
+
+    SPiDJwtCodec *otherCodec = [[SPiDJwtCodec alloc] initWithSignSecret:@"other"];
+    XCTAssertNil([otherCodec verifiedClaimsFromJwt:jwt error:&error]);
+    XCTAssertEqual(error.code, SPiDJwtInvalidSignatureErrorCode);
+
+    NSString *expired = [codec encodedJwtWithClaims:[self claimsExpiringIn:-3600]];
+    XCTAssertNil([codec verifiedClaimsFromJwt:expired error:&error]);
+    XCTAssertEqual(error.code, SPiDJwtExpiredErrorCode);
+
+    NSArray<NSString *> *segments = [jwt componentsSeparatedByString:@"."];
+    NSString *none = [NSString stringWithFormat:@"%@.%@.", [[@"{\"alg\":\"none\"}" dataUsingEncoding:NSUTF8StringEncoding] sp_base64EncodedUrlSafeString], segments[1]];
+    XCTAssertNil([codec verifiedClaimsFromJwt:none error:&error]);
+    XCTAssertEqual(error.code, SPiDJwtMalformedErrorCode);
+
+    for (NSString *malformed in @[@"", @"a.b", @"a.b.c.d", @"!!.??.**"]) {
+        XCTAssertNil([codec verifiedClaimsFromJwt:malformed error:&error]);
+        XCTAssertEqual(error.code, SPiDJwtMalformedErrorCode);
+    }
+}
+
+- (void)testFacebookAssertion {
+    NSDate *expirationDate = [NSDate dateWithTimeIntervalSinceNow:3600];
+    SPiDJwt *jwt = [SPiDJwt jwtTokenWithDictionary:@{@"iss": @"1234", @"sub": @"authorization", @"aud": @"https://login.example.com/oauth/token",
+                                                     @"exp": expirationDate, @"token_type": @"facebook", @"token_value": @"token"}];
+    NSString *encoded = [jwt encodedJwtStringWithSignSecret:@"payment"];
+    NSDictionary *claims = [[SPiDJwtCodec codecWithSignSecret:@"payment"] verifiedClaimsFromJwt:encoded error:nil];
+    XCTAssertEqualObjects([claims objectForKey:@"token_type"], @"facebook");
+    XCTAssertEqualObjects([claims objectForKey:@"exp"], @((long long) [expirationDate timeIntervalSince1970]));
+}
+
+- (void)testEncodingPerformance {
+    SPiDJwtCodec *codec = [[SPiDJwtCodec alloc] initWithSignSecret:@"payment"];
+    NSDictionary *claims = [self claimsExpiringIn:3600];
+    [self measureBlock:^{
+        for (NSUInteger i = 0; i < SPiDBenchmarkJwtCount; i++) {
+            @autoreleasepool {
+                [codec encodedJwtWithClaims:claims];
+            }
+        }
+    }];
+}
+
+- (void)testVerificationPerformance {
+    SPiDJwtCodec *codec = [[SPiDJwtCodec alloc] initWithSignSecret:@"payment"];
+    NSString *jwt = [codec encodedJwtWithClaims:[self claimsExpiringIn:3600]];
+    [self measureBlock:^{
+        for (NSUInteger i = 0; i < SPiDBenchmarkJwtCount; i++) {
+            @autoreleasepool {
+                [codec verifiedClaimsFromJwt:jwt error:nil];
+            }
+        }
+    }];
+}
+
+@end
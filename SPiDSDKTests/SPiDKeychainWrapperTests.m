@@ -0,0 +1,183 @@
+//
+//  SPiDKeychainWrapperTests.m
+//  SPiDSDK
+//
+//  Copyright (c) 2012 Schibsted Payment. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import "SPiDKeychainWrapper.h"
+#import "SPiDAccessToken.h"
+
+static NSString *const SPiDTestKeychainIdentifier = @"SPiDKeychainWrapperTests";
+
+@interface SPiDKeychainWrapper (Testing)
+
++ (nullable NSString *)labelForIdentifier:(NSString *)identifier;
+
+@end
+
+/** Records the writes that reach it, the first one can be held back to let later writes queue up behind it */
+@interface SPiDRecordingKeychainWriter : NSObject <SPiDKeychainWriter>
+
+@property (nonatomic, strong) NSMutableArray<NSString *> *operations;
+@property (nonatomic, strong) dispatch_semaphore_t firstWriteStarted;
+@property (nonatomic, strong) dispatch_semaphore_t resumeFirstWrite;
+@property (atomic, assign) BOOL holdsFirstWrite;
+
+@end
+
+@implementation SPiDRecordingKeychainWriter
+
+- (instancetype)init {
+    if (self = [super init]) {
+        self.operations = [NSMutableArray array];
+        self.firstWriteStarted = dispatch_semaphore_create(0);
+        self.resumeFirstWrite = dispatch_semaphore_create(0);
+    }
+    return self;
+}
+
+- (void)recordOperation:(NSString *)operation {
+    @synchronized (self) {
+        [self.operations addObject:operation];
+    }
+    if (self.holdsFirstWrite) {
+        self.holdsFirstWrite = NO;
+        dispatch_semaphore_signal(self.firstWriteStarted);
+        dispatch_semaphore_wait(self.resumeFirstWrite, DISPATCH_TIME_FOREVER);
+    }
+}
+
+- (NSArray<NSString *> *)recordedOperations {
+    @synchronized (self) {
+        return [self.operations copy];
+    }
+}
+
+- (BOOL)writeAccessToken:(SPiDAccessToken *)accessToken forIdentifier:(NSString *)identifier {
+    [self recordOperation:[NSString stringWithFormat:@"store %@ %@", identifier, accessToken.accessToken]];
+    return YES;
+}
+
+- (void)deleteAccessTokenForIdentifier:(NSString *)identifier {
+    [self recordOperation:[NSString stringWithFormat:@"remove %@", identifier]];
+}
+
+@end
+
+@interface SPiDKeychainWrapperTests : XCTestCase
+
+@property (nonatomic, strong) SPiDRecordingKeychainWriter *writer;
+
+@end
+
+@implementation SPiDKeychainWrapperTests
+
+- (void)setUp {
+    [super setUp];
+    self.writer = [[SPiDRecordingKeychainWriter alloc] init];
+    [SPiDKeychainWrapper setWriter:self.writer];
+}
+
+- (void)tearDown {
+    [SPiDKeychainWrapper flushPendingWrites];
+    [SPiDKeychainWrapper setWriter:nil];
+    [super tearDown];
+}
+
+- (SPiDAccessToken *)accessTokenWithValue:(NSString *)value {
+    return [[SPiDAccessToken alloc] initWithUserID:@"1" accessToken:value expiresAt:[NSDate distantFuture] refreshToken:@"refresh"];
+}
+
+- (void)testBackgroundWritesAreCoalesced {
+    // The first write reaches the writer and is held there while the rest queue up
+    self.writer.holdsFirstWrite = YES;
+    [SPiDKeychainWrapper storeAccessTokenInBackground:[self accessTokenWithValue:@"token-0"] forIdentifier:SPiDTestKeychainIdentifier];
+    dispatch_semaphore_wait(self.writer.firstWriteStarted, DISPATCH_TIME_FOREVER);
+
+    for (NSUInteger i = 1; i < 1000; i++) {
+        [SPiDKeychainWrapper storeAccessTokenInBackground:[self accessTokenWithValue:[NSString stringWithFormat:@"token-%lu", (unsigned long) i]] forIdentifier:SPiDTestKeychainIdentifier];
+        XCTAssertEqual([SPiDKeychainWrapper pendingWriteCount], 1u);
+    }
+    // Readers see the latest token before it has been written
+    XCTAssertEqualObjects([SPiDKeychainWrapper accessTokenFromKeychainForIdentifier:SPiDTestKeychainIdentifier].accessToken, @"token-999");
+
+    dispatch_semaphore_signal(self.writer.resumeFirstWrite);
+    [SPiDKeychainWrapper flushPendingWrites];
+    XCTAssertEqual([SPiDKeychainWrapper pendingWriteCount], 0u);
+    NSArray *expected = @[[@"store " stringByAppendingFormat:@"%@ token-0", SPiDTestKeychainIdentifier],
+                          [@"store " stringByAppendingFormat:@"%@ token-999", SPiDTestKeychainIdentifier]];
+    XCTAssertEqualObjects([self.writer recordedOperations], expected);
+}
+
+- (void)testRemovalIsOrderedAfterWrite {
+    self.writer.holdsFirstWrite = YES;
+    [SPiDKeychainWrapper storeAccessTokenInBackground:[self accessTokenWithValue:@"token"] forIdentifier:SPiDTestKeychainIdentifier];
+    dispatch_semaphore_wait(self.writer.firstWriteStarted, DISPATCH_TIME_FOREVER);
+
+    [SPiDKeychainWrapper removeAccessTokenInBackgroundForIdentifier:SPiDTestKeychainIdentifier];
+    XCTAssertEqual([SPiDKeychainWrapper pendingWriteCount], 1u);
+    XCTAssertNil([SPiDKeychainWrapper accessTokenFromKeychainForIdentifier:SPiDTestKeychainIdentifier]);
+
+    dispatch_semaphore_signal(self.writer.resumeFirstWrite);
+    [SPiDKeychainWrapper flushPendingWrites];
+    XCTAssertEqual([SPiDKeychainWrapper pendingWriteCount], 0u);
+    NSArray *expected = @[[@"store " stringByAppendingFormat:@"%@ token", SPiDTestKeychainIdentifier],
+                          [@"remove " stringByAppendingString:SPiDTestKeychainIdentifier]];
+    XCTAssertEqualObjects([self.writer recordedOperations], expected);
+}
+
+- (void)testPendingWritesAreDroppedBySynchronousRemoval {
+    self.writer.holdsFirstWrite = YES;
+    [SPiDKeychainWrapper storeAccessTokenInBackground:[self accessTokenWithValue:@"first"] forIdentifier:@"other"];
+    dispatch_semaphore_wait(self.writer.firstWriteStarted, DISPATCH_TIME_FOREVER);
+    [SPiDKeychainWrapper storeAccessTokenInBackground:[self accessTokenWithValue:@"token"] forIdentifier:SPiDTestKeychainIdentifier];
+    XCTAssertEqual([SPiDKeychainWrapper pendingWriteCount], 2u);
+
+    // The removal drops the pending write right away and then waits for the write queue
+    dispatch_group_t group = dispatch_group_create();
+    dispatch_group_async(group, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        [SPiDKeychainWrapper removeAccessTokenFromKeychainForIdentifier:SPiDTestKeychainIdentifier];
+    });
+    NSDate *deadline = [NSDate dateWithTimeIntervalSinceNow:1.0];
+    while ([SPiDKeychainWrapper pendingWriteCount] > 1 && [deadline timeIntervalSinceNow] > 0) {
+        [NSThread sleepForTimeInterval:0.01];
+    }
+    XCTAssertEqual([SPiDKeychainWrapper pendingWriteCount], 1u);
+
+    dispatch_semaphore_signal(self.writer.resumeFirstWrite);
+    dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+    [SPiDKeychainWrapper flushPendingWrites];
+    XCTAssertEqual([SPiDKeychainWrapper pendingWriteCount], 0u);
+    NSArray *expected = @[@"store other first", [@"remove " stringByAppendingString:SPiDTestKeychainIdentifier]];
+    XCTAssertEqualObjects([self.writer recordedOperations], expected);
+}
+
+- (void)testAccessGroupsKeepTheirItemsApart {
+    self.writer.holdsFirstWrite = YES;
+    [SPiDKeychainWrapper storeAccessTokenInBackground:[self accessTokenWithValue:@"private"] forIdentifier:SPiDTestKeychainIdentifier];
+    dispatch_semaphore_wait(self.writer.firstWriteStarted, DISPATCH_TIME_FOREVER);
+    [SPiDKeychainWrapper storeAccessTokenInBackground:[self accessTokenWithValue:@"shared"] forIdentifier:SPiDTestKeychainIdentifier accessGroup:@"group.com.example.spid"];
+    XCTAssertEqual([SPiDKeychainWrapper pendingWriteCount], 2u);
+
+    // The same identifier in another access group is a different item
+    XCTAssertEqualObjects([SPiDKeychainWrapper accessTokenFromKeychainForIdentifier:SPiDTestKeychainIdentifier].accessToken, @"private");
+    XCTAssertEqualObjects([SPiDKeychainWrapper accessTokenFromKeychainForIdentifier:SPiDTestKeychainIdentifier accessGroup:@"group.com.example.spid"].accessToken, @"shared");
+    XCTAssertEqualObjects([SPiDKeychainWrapper accessTokensFromKeychainWithIdentifierPrefix:SPiDTestKeychainIdentifier accessGroup:@"group.com.example.spid"][SPiDTestKeychainIdentifier].accessToken, @"shared");
+
+    dispatch_semaphore_signal(self.writer.resumeFirstWrite);
+    [SPiDKeychainWrapper flushPendingWrites];
+    XCTAssertEqual([SPiDKeychainWrapper pendingWriteCount], 0u);
+    XCTAssertEqual([self.writer recordedOperations].count, 2u);
+}
+
+- (void)testAccountsShareTheLabelOfTheirPrefix {
+    XCTAssertEqualObjects([SPiDKeychainWrapper labelForIdentifier:@"AccessToken-101"], @"AccessToken-");
+    XCTAssertEqualObjects([SPiDKeychainWrapper labelForIdentifier:@"0123456789abcdef-AccessToken-101"], @"0123456789abcdef-AccessToken-");
+    // The active token of a client is not one of its accounts
+    XCTAssertEqualObjects([SPiDKeychainWrapper labelForIdentifier:@"0123456789abcdef-AccessToken"], @"0123456789abcdef-");
+    XCTAssertNil([SPiDKeychainWrapper labelForIdentifier:@"AccessToken"]);
+}
+
+@end
@@ -0,0 +1,21 @@
+//
+//  SPiDMemoryTokenStore.h
+//  SPiDSDK
+//
+//  Copyright (c) 2012 Schibsted Payment. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "SPiDTokenStore.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/** Dictionary backed store that counts writes, used by tests instead of the keychain */
+@interface SPiDMemoryTokenStore : NSObject <SPiDTokenStore>
+
+@property (nonatomic, strong) NSMutableDictionary<NSString *, SPiDAccessToken *> *accessTokens;
+@property (nonatomic, assign) NSUInteger writeCount;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,54 @@
+//
+//  SPiDMemoryTokenStore.m
+//  SPiDSDK
+//
+//  Copyright (c) 2012 Schibsted Payment. All rights reserved.
+//
+
+#import "SPiDMemoryTokenStore.h"
+#import "SPiDAccessToken.h"
+
+@implementation SPiDMemoryTokenStore
+
+- (instancetype)init {
+    if (self = [super init]) {
+        self.accessTokens = [NSMutableDictionary dictionary];
+    }
+    return self;
+}
+
+- (SPiDAccessToken *)accessTokenForIdentifier:(NSString *)identifier {
+    @synchronized (self) {
+        return self.accessTokens[identifier];
+    }
+}
+
+- (NSDictionary<NSString *, SPiDAccessToken *> *)accessTokensWithIdentifierPrefix:(NSString *)prefix {
+    NSMutableDictionary<NSString *, SPiDAccessToken *> *accessTokens = [NSMutableDictionary dictionary];
+    @synchronized (self) {
+        [self.accessTokens enumerateKeysAndObjectsUsingBlock:^(NSString *identifier, SPiDAccessToken *accessToken, BOOL *stop) {
+            if ([identifier hasPrefix:prefix]) {
+                accessTokens[identifier] = accessToken;
+            }
+        }];
+    }
+    return accessTokens;
+}
+
+- (void)storeAccessToken:(SPiDAccessToken *)accessToken forIdentifier:(NSString *)identifier {
+    @synchronized (self) {
+        self.accessTokens[identifier] = accessToken;
+        self.writeCount++;
+    }
+}
+
+- (void)removeAccessTokenForIdentifier:(NSString *)identifier {
+    @synchronized (self) {
+        [self.accessTokens removeObjectForKey:identifier];
+    }
+}
+
+- (void)flush {
+}
+
+@end
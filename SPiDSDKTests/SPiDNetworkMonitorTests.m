@@ -0,0 +1,42 @@
+//
+//  SPiDNetworkMonitorTests.m
+//  SPiDSDK
+//
+//  Copyright (c) 2012 Schibsted Payment. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import "SPiDNetworkMonitor.h"
+
+@interface SPiDNetworkMonitorTests : XCTestCase
+
+@end
+
+@implementation SPiDNetworkMonitorTests
+
+- (void)testHandlerRunsWhenConnectivityReturns {
+    __block NSUInteger reachableCount = 0;
+    // Not started, the path updates come from the test only
+    SPiDNetworkMonitor *monitor = [[SPiDNetworkMonitor alloc] initWithReachableHandler:^{
+        reachableCount++;
+    }];
+
+    [monitor pathDidUpdateWithSatisfied:YES];
+    XCTAssertEqual(reachableCount, 1u);
+    XCTAssertTrue(monitor.isSatisfied);
+
+    [monitor pathDidUpdateWithSatisfied:YES];
+    XCTAssertEqual(reachableCount, 1u);
+
+    [monitor pathDidUpdateWithSatisfied:NO];
+    XCTAssertFalse(monitor.isSatisfied);
+    [monitor pathDidUpdateWithSatisfied:YES];
+    XCTAssertEqual(reachableCount, 2u);
+
+    [monitor cancel];
+    [monitor pathDidUpdateWithSatisfied:NO];
+    [monitor pathDidUpdateWithSatisfied:YES];
+    XCTAssertEqual(reachableCount, 2u);
+}
+
+@end
@@ -0,0 +1,217 @@
+//
+//  SPiDRefreshSchedulerTests.m
+//  SPiDSDK
+//
+//  Copyright (c) 2012 Schibsted Payment. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import "SPiDRefreshScheduler.h"
+#import "SPiDAccessToken.h"
+
+@interface SPiDRefreshSchedulerTests : XCTestCase
+
+@end
+
+@implementation SPiDRefreshSchedulerTests
+
+- (SPiDAccessToken *)accessTokenForUserID:(NSString *)userID expiresAt:(NSDate *)expiresAt {
+    return [[SPiDAccessToken alloc] initWithUserID:userID accessToken:@"access" expiresAt:expiresAt refreshToken:@"refresh"];
+}
+
+- (void)waitForIdleScheduler:(SPiDRefreshScheduler *)scheduler {
+    // The completion returns to the scheduler asynchronously
+    NSDate *deadline = [NSDate dateWithTimeIntervalSinceNow:1.0];
+    while (scheduler.inFlightCount > 0 && [deadline timeIntervalSinceNow] > 0) {
+        [NSThread sleepForTimeInterval:0.01];
+    }
+    XCTAssertEqual(scheduler.inFlightCount, 0u);
+}
+
+- (void)testTokensExpiringTogetherAreSpreadAndCapped {
+    NSMutableArray *completions = [NSMutableArray array];
+    SPiDRefreshScheduler *scheduler = [[SPiDRefreshScheduler alloc] initWithTickInterval:1.0 refreshHandler:^(NSString *identifier, SPiDAccessToken *accessToken, void (^completion)(SPiDAccessToken *)) {
+        @synchronized (completions) {
+            [completions addObject:completion];
+        }
+    }];
+    scheduler.refreshAhead = 60;
+    scheduler.jitter = 30;
+    scheduler.maximumConcurrentRefreshes = 8;
+
+    NSDate *start = [NSDate date];
+    NSDate *expiresAt = [start dateByAddingTimeInterval:3600];
+    NSUInteger tokenCount = 10000;
+    for (NSUInteger i = 0; i < tokenCount; i++) {
+        NSString *userID = [NSString stringWithFormat:@"%lu", (unsigned long) i];
+        [scheduler scheduleAccessToken:[self accessTokenForUserID:userID expiresAt:expiresAt] forIdentifier:userID];
+    }
+    XCTAssertEqual(scheduler.queueDepth, tokenCount);
+
+    // Nothing is due before the jitter window
+    [scheduler advanceToDate:[start dateByAddingTimeInterval:3600 - 91]];
+    XCTAssertEqual(scheduler.readyCount, 0u);
+    XCTAssertEqual(scheduler.inFlightCount, 0u);
+
+    // Driven one tick at a time, as the timer would
+    NSUInteger readyHalfWay = 0;
+    for (NSInteger second = -90; second <= -59; second++) {
+        [scheduler advanceToDate:[start dateByAddingTimeInterval:3600 + second]];
+        XCTAssertLessThanOrEqual(scheduler.inFlightCount, 8u);
+        if (second == -75) {
+            readyHalfWay = scheduler.readyCount;
+        }
+    }
+    XCTAssertGreaterThan(readyHalfWay, tokenCount / 4);
+    XCTAssertLessThan(readyHalfWay, tokenCount * 3 / 4);
+
+    XCTAssertEqual(scheduler.inFlightCount, 8u);
+    XCTAssertEqual(scheduler.readyCount, tokenCount - 8);
+    XCTAssertEqual(scheduler.queueDepth, tokenCount - 8);
+    // Started on the tick that follows the due time, without waiting for a slot
+    XCTAssertGreaterThan(scheduler.averageLateness, 0);
+    XCTAssertLessThanOrEqual(scheduler.averageLateness, scheduler.maximumLateness);
+    XCTAssertLessThanOrEqual(scheduler.maximumLateness, 1.0);
+}
+
+- (void)testLatenessIncludesTheWaitForAFreeSlot {
+    NSMutableArray *completions = [NSMutableArray array];
+    dispatch_semaphore_t started = dispatch_semaphore_create(0);
+    SPiDRefreshScheduler *scheduler = [[SPiDRefreshScheduler alloc] initWithTickInterval:1.0 refreshHandler:^(NSString *identifier, SPiDAccessToken *accessToken, void (^completion)(SPiDAccessToken *)) {
+        @synchronized (completions) {
+            [completions addObject:completion];
+        }
+        dispatch_semaphore_signal(started);
+    }];
+    scheduler.jitter = 0;
+    scheduler.maximumConcurrentRefreshes = 1;
+
+    NSDate *expiresAt = [NSDate dateWithTimeIntervalSinceNow:600];
+    [scheduler scheduleAccessToken:[self accessTokenForUserID:@"1" expiresAt:expiresAt] forIdentifier:@"1"];
+    [scheduler scheduleAccessToken:[self accessTokenForUserID:@"2" expiresAt:expiresAt] forIdentifier:@"2"];
+    [scheduler advanceToDate:[expiresAt dateByAddingTimeInterval:-59]];
+    XCTAssertEqual(dispatch_semaphore_wait(started, dispatch_time(DISPATCH_TIME_NOW, NSEC_PER_SEC)), 0);
+    XCTAssertEqual(scheduler.readyCount, 1u);
+    NSTimeInterval firstLateness = scheduler.maximumLateness;
+
+    // The second refresh starts when the first completes, later than the tick that made it due
+    [NSThread sleepForTimeInterval:0.3];
+    void (^completion)(SPiDAccessToken *);
+    @synchronized (completions) {
+        completion = completions.firstObject;
+    }
+    completion(nil);
+    XCTAssertEqual(dispatch_semaphore_wait(started, dispatch_time(DISPATCH_TIME_NOW, NSEC_PER_SEC)), 0);
+    XCTAssertGreaterThanOrEqual(scheduler.maximumLateness, firstLateness + 0.3);
+    XCTAssertLessThan(scheduler.maximumLateness, firstLateness + 5.0);
+}
+
+- (void)testFailedRefreshIsRetriedWithCappedBackoff {
+    dispatch_semaphore_t started = dispatch_semaphore_create(0);
+    SPiDRefreshScheduler *scheduler = [[SPiDRefreshScheduler alloc] initWithTickInterval:1.0 refreshHandler:^(NSString *identifier, SPiDAccessToken *accessToken, void (^completion)(SPiDAccessToken *)) {
+        completion(nil);
+        dispatch_semaphore_signal(started);
+    }];
+    scheduler.jitter = 0;
+    scheduler.retryInterval = 10;
+    scheduler.maximumRetryInterval = 25;
+
+    NSDate *expiresAt = [NSDate dateWithTimeIntervalSinceNow:600];
+    [scheduler scheduleAccessToken:[self accessTokenForUserID:@"1" expiresAt:expiresAt] forIdentifier:@"1"];
+    NSDate *failedAt = [expiresAt dateByAddingTimeInterval:-59];
+    [scheduler advanceToDate:failedAt];
+    XCTAssertEqual(dispatch_semaphore_wait(started, dispatch_time(DISPATCH_TIME_NOW, NSEC_PER_SEC)), 0);
+
+    // Retried after 10, 20 and then 25 seconds instead of 40
+    for (NSNumber *delay in @[@10, @20, @25, @25]) {
+        [self waitForIdleScheduler:scheduler];
+        XCTAssertEqual(scheduler.queueDepth, 1u);
+        [scheduler advanceToDate:[failedAt dateByAddingTimeInterval:delay.doubleValue - 2]];
+        XCTAssertNotEqual(dispatch_semaphore_wait(started, dispatch_time(DISPATCH_TIME_NOW, 100 * NSEC_PER_MSEC)), 0);
+        failedAt = [failedAt dateByAddingTimeInterval:delay.doubleValue + 2];
+        [scheduler advanceToDate:failedAt];
+        XCTAssertEqual(dispatch_semaphore_wait(started, dispatch_time(DISPATCH_TIME_NOW, NSEC_PER_SEC)), 0);
+    }
+
+    // A cancelled account is not retried
+    [self waitForIdleScheduler:scheduler];
+    [scheduler cancelRefreshForIdentifier:@"1"];
+    XCTAssertEqual(scheduler.queueDepth, 0u);
+}
+
+- (void)testRefreshedTokenIsRescheduledAcrossLevels {
+    __block NSUInteger refreshCount = 0;
+    NSDate *start = [NSDate date];
+    // Four hours ahead is beyond the first two levels of a one second wheel
+    NSDate *expiresAt = [start dateByAddingTimeInterval:4 * 3600];
+    SPiDAccessToken *refreshed = [self accessTokenForUserID:@"1" expiresAt:[expiresAt dateByAddingTimeInterval:3600]];
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Token refreshed"];
+    SPiDRefreshScheduler *scheduler = [[SPiDRefreshScheduler alloc] initWithTickInterval:1.0 refreshHandler:^(NSString *identifier, SPiDAccessToken *accessToken, void (^completion)(SPiDAccessToken *)) {
+        refreshCount++;
+        XCTAssertEqualObjects(identifier, @"1");
+        completion(refreshed);
+        [expectation fulfill];
+    }];
+    scheduler.jitter = 0;
+
+    [scheduler scheduleAccessToken:[self accessTokenForUserID:@"1" expiresAt:expiresAt] forIdentifier:@"1"];
+    [scheduler advanceToDate:[expiresAt dateByAddingTimeInterval:-61]];
+    XCTAssertEqual(scheduler.inFlightCount, 0u);
+
+    [scheduler advanceToDate:[expiresAt dateByAddingTimeInterval:-59]];
+    [self waitForExpectationsWithTimeout:1.0 handler:nil];
+    XCTAssertEqual(refreshCount, 1u);
+
+    // The completion returns to the scheduler asynchronously
+    NSDate *deadline = [NSDate dateWithTimeIntervalSinceNow:1.0];
+    while (scheduler.inFlightCount > 0 && [deadline timeIntervalSinceNow] > 0) {
+        [NSThread sleepForTimeInterval:0.01];
+    }
+    XCTAssertEqual(scheduler.inFlightCount, 0u);
+    XCTAssertEqual(scheduler.queueDepth, 1u);
+    XCTAssertEqual(scheduler.readyCount, 0u);
+}
+
+- (void)testCancelledRefreshIsNotStarted {
+    SPiDRefreshScheduler *scheduler = [[SPiDRefreshScheduler alloc] initWithTickInterval:1.0 refreshHandler:^(NSString *identifier, SPiDAccessToken *accessToken, void (^completion)(SPiDAccessToken *)) {
+        XCTFail(@"Cancelled refresh started");
+    }];
+    NSDate *expiresAt = [NSDate dateWithTimeIntervalSinceNow:600];
+    [scheduler scheduleAccessToken:[self accessTokenForUserID:@"1" expiresAt:expiresAt] forIdentifier:@"1"];
+    [scheduler cancelRefreshForIdentifier:@"1"];
+    XCTAssertEqual(scheduler.queueDepth, 0u);
+
+    [scheduler advanceToDate:expiresAt];
+    XCTAssertEqual(scheduler.inFlightCount, 0u);
+}
+
+- (void)testRunningRefreshCancelledBeforeCompletionIsNotRescheduled {
+    NSDate *expiresAt = [NSDate dateWithTimeIntervalSinceNow:600];
+    SPiDAccessToken *refreshed = [self accessTokenForUserID:@"1" expiresAt:[expiresAt dateByAddingTimeInterval:3600]];
+    __block void (^pendingCompletion)(SPiDAccessToken *) = nil;
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Refresh started"];
+    SPiDRefreshScheduler *scheduler = [[SPiDRefreshScheduler alloc] initWithTickInterval:1.0 refreshHandler:^(NSString *identifier, SPiDAccessToken *accessToken, void (^completion)(SPiDAccessToken *)) {
+        pendingCompletion = completion;
+        [expectation fulfill];
+    }];
+    scheduler.jitter = 0;
+
+    [scheduler scheduleAccessToken:[self accessTokenForUserID:@"1" expiresAt:expiresAt] forIdentifier:@"1"];
+    [scheduler advanceToDate:expiresAt];
+    [self waitForExpectationsWithTimeout:1.0 handler:nil];
+    XCTAssertEqual(scheduler.inFlightCount, 1u);
+
+    // Logged out while the refresh request is on its way
+    [scheduler cancelRefreshForIdentifier:@"1"];
+    pendingCompletion(refreshed);
+
+    NSDate *deadline = [NSDate dateWithTimeIntervalSinceNow:1.0];
+    while (scheduler.inFlightCount > 0 && [deadline timeIntervalSinceNow] > 0) {
+        [NSThread sleepForTimeInterval:0.01];
+    }
+    XCTAssertEqual(scheduler.inFlightCount, 0u);
+    XCTAssertEqual(scheduler.queueDepth, 0u);
+    XCTAssertEqual(scheduler.readyCount, 0u);
+}
+
+@end
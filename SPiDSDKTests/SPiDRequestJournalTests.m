@@ -0,0 +1,135 @@
+//
+//  SPiDRequestJournalTests.m
+//  SPiDSDK
+//
+//  Copyright (c) 2012 Schibsted Payment. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import "SPiDRequestJournal.h"
+
+@interface SPiDRequestJournalTests : XCTestCase
+
+@property (nonatomic, strong) NSURL *fileURL;
+
+@end
+
+@implementation SPiDRequestJournalTests
+
+- (void)setUp {
+    [super setUp];
+    NSString *name = [[NSUUID UUID].UUIDString stringByAppendingPathExtension:@"journal"];
+    self.fileURL = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:name]];
+}
+
+- (void)tearDown {
+    [[NSFileManager defaultManager] removeItemAtURL:self.fileURL error:nil];
+    [super tearDown];
+}
+
+- (NSDictionary *)recordWithIndex:(NSUInteger)index {
+    return @{@"url": [NSString stringWithFormat:@"https://login.example.com/api/2/request/%lu", (unsigned long) index], @"method": @"POST", @"body": @"key=value"};
+}
+
+- (unsigned long long)fileSize {
+    return [[[NSFileManager defaultManager] attributesOfItemAtPath:self.fileURL.path error:nil] fileSize];
+}
+
+/** Appends the records and returns the file size after each append */
+- (NSArray<NSNumber *> *)appendRecordCount:(NSUInteger)count {
+    SPiDRequestJournal *journal = [[SPiDRequestJournal alloc] initWithFileURL:self.fileURL];
+    NSMutableArray<NSNumber *> *sizes = [NSMutableArray array];
+    for (NSUInteger i = 0; i < count; i++) {
+        XCTAssertTrue([journal appendRecord:[self recordWithIndex:i]]);
+        [sizes addObject:@([self fileSize])];
+    }
+    return sizes;
+}
+
+- (void)truncateFileAtOffset:(unsigned long long)offset {
+    NSFileHandle *fileHandle = [NSFileHandle fileHandleForWritingToURL:self.fileURL error:nil];
+    [fileHandle truncateFileAtOffset:offset];
+    [fileHandle closeFile];
+}
+
+- (void)testRecordsSurviveReload {
+    [self appendRecordCount:3];
+
+    SPiDRequestJournal *journal = [[SPiDRequestJournal alloc] initWithFileURL:self.fileURL];
+    NSArray *expected = @[[self recordWithIndex:0], [self recordWithIndex:1], [self recordWithIndex:2]];
+    XCTAssertEqualObjects([journal records], expected);
+}
+
+- (void)testTornRecordIsTruncated {
+    NSArray<NSNumber *> *sizes = [self appendRecordCount:3];
+    // Terminated halfway through writing the last record
+    unsigned long long intact = sizes[1].unsignedLongLongValue;
+    [self truncateFileAtOffset:intact + (sizes[2].unsignedLongLongValue - intact) / 2];
+
+    SPiDRequestJournal *journal = [[SPiDRequestJournal alloc] initWithFileURL:self.fileURL];
+    NSArray *expected = @[[self recordWithIndex:0], [self recordWithIndex:1]];
+    XCTAssertEqualObjects([journal records], expected);
+    XCTAssertEqual([self fileSize], intact);
+}
+
+- (void)testTornHeaderIsTruncated {
+    NSArray<NSNumber *> *sizes = [self appendRecordCount:3];
+    unsigned long long intact = sizes[1].unsignedLongLongValue;
+    [self truncateFileAtOffset:intact + 3];
+
+    SPiDRequestJournal *journal = [[SPiDRequestJournal alloc] initWithFileURL:self.fileURL];
+    XCTAssertEqual(journal.count, 2u);
+    XCTAssertEqual([self fileSize], intact);
+}
+
+- (void)testRecordFailingChecksumIsDroppedWithTheRest {
+    NSArray<NSNumber *> *sizes = [self appendRecordCount:3];
+    // Flip a byte in the JSON of the second record, after its 8 byte header
+    NSMutableData *data = [NSMutableData dataWithContentsOfURL:self.fileURL];
+    uint8_t *bytes = data.mutableBytes;
+    bytes[sizes[0].unsignedLongLongValue + 8 + 2] ^= 0x01;
+    [data writeToURL:self.fileURL atomically:YES];
+
+    SPiDRequestJournal *journal = [[SPiDRequestJournal alloc] initWithFileURL:self.fileURL];
+    XCTAssertEqualObjects([journal records], @[[self recordWithIndex:0]]);
+    XCTAssertEqual([self fileSize], sizes[0].unsignedLongLongValue);
+}
+
+- (void)testAppendAfterTruncationKeepsJournalReadable {
+    NSArray<NSNumber *> *sizes = [self appendRecordCount:2];
+    [self truncateFileAtOffset:sizes[1].unsignedLongLongValue - 1];
+
+    SPiDRequestJournal *journal = [[SPiDRequestJournal alloc] initWithFileURL:self.fileURL];
+    XCTAssertTrue([journal appendRecord:[self recordWithIndex:5]]);
+    XCTAssertEqual([self fileSize], sizes[1].unsignedLongLongValue);
+
+    SPiDRequestJournal *reloaded = [[SPiDRequestJournal alloc] initWithFileURL:self.fileURL];
+    NSArray *expected = @[[self recordWithIndex:0], [self recordWithIndex:5]];
+    XCTAssertEqualObjects([reloaded records], expected);
+}
+
+- (void)testRemoveFirstRecordCompactsFile {
+    NSArray<NSNumber *> *sizes = [self appendRecordCount:3];
+
+    SPiDRequestJournal *journal = [[SPiDRequestJournal alloc] initWithFileURL:self.fileURL];
+    XCTAssertTrue([journal removeFirstRecord]);
+    XCTAssertEqual([self fileSize], sizes[2].unsignedLongLongValue - sizes[0].unsignedLongLongValue);
+
+    SPiDRequestJournal *reloaded = [[SPiDRequestJournal alloc] initWithFileURL:self.fileURL];
+    NSArray *expected = @[[self recordWithIndex:1], [self recordWithIndex:2]];
+    XCTAssertEqualObjects([reloaded records], expected);
+
+    XCTAssertTrue([reloaded removeFirstRecord]);
+    XCTAssertTrue([reloaded removeFirstRecord]);
+    XCTAssertEqual(reloaded.count, 0u);
+    XCTAssertFalse([[NSFileManager defaultManager] fileExistsAtPath:self.fileURL.path]);
+}
+
+- (void)testUnserializableRecordIsRejected {
+    SPiDRequestJournal *journal = [[SPiDRequestJournal alloc] initWithFileURL:self.fileURL];
+    XCTAssertFalse([journal appendRecord:@{@"date": [NSDate date]}]);
+    XCTAssertEqual(journal.count, 0u);
+    XCTAssertFalse([[NSFileManager defaultManager] fileExistsAtPath:self.fileURL.path]);
+}
+
+@end
@@ -0,0 +1,128 @@
+//
+//  SPiDRequestSchedulerTests.m
+//  SPiDSDK
+//
+//  Copyright (c) 2012 Schibsted Payment. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import "SPiDRequestScheduler.h"
+
+// Time the radio stays powered after a transfer, scaled down together with the timelines below
+static const NSTimeInterval SPiDRadioTailTime = 0.1;
+
+/** A timer on the simulated clock of the test */
+@interface SPiDSimulatedTimer : NSObject
+
+@property (nonatomic, assign) NSTimeInterval fireTime;
+@property (nonatomic, strong) dispatch_queue_t queue;
+@property (nonatomic, copy) dispatch_block_t handler;
+@property (atomic, assign) BOOL cancelled;
+
+@end
+
+@implementation SPiDSimulatedTimer
+@end
+
+@interface SPiDRequestSchedulerTests : XCTestCase
+
+@end
+
+@implementation SPiDRequestSchedulerTests
+
+/** Runs a timeline of (start time, deferrable) pairs on a simulated clock and counts the network bursts */
+- (NSUInteger)burstsForTimeline:(NSArray<NSArray *> *)timeline withDeferral:(BOOL)useDeferral {
+    __block NSTimeInterval now = 0;
+    NSMutableArray<SPiDSimulatedTimer *> *timers = [NSMutableArray array];
+    SPiDRequestScheduler *scheduler = [[SPiDRequestScheduler alloc] initWithTimerFactory:^dispatch_block_t(NSTimeInterval delay, dispatch_queue_t queue, dispatch_block_t handler) {
+        SPiDSimulatedTimer *timer = [[SPiDSimulatedTimer alloc] init];
+        timer.fireTime = now + delay;
+        timer.queue = queue;
+        timer.handler = handler;
+        @synchronized (timers) {
+            [timers addObject:timer];
+        }
+        return ^{
+            timer.cancelled = YES;
+        };
+    }];
+    scheduler.maximumDelay = 1.0;
+
+    NSMutableArray<NSNumber *> *sentAt = [NSMutableArray array];
+    void (^advanceToTime)(NSTimeInterval) = ^(NSTimeInterval time) {
+        while (YES) {
+            SPiDSimulatedTimer *next = nil;
+            @synchronized (timers) {
+                for (SPiDSimulatedTimer *timer in timers) {
+                    if (!timer.cancelled && timer.fireTime <= time && (next == nil || timer.fireTime < next.fireTime)) {
+                        next = timer;
+                    }
+                }
+                [timers removeObject:next];
+            }
+            if (next == nil) {
+                break;
+            }
+            now = next.fireTime;
+            dispatch_sync(next.queue, next.handler);
+        }
+        now = MAX(now, time);
+    };
+
+    for (NSArray *event in timeline) {
+        advanceToTime([event[0] doubleValue]);
+        SPiDRequestDeferral deferral = (useDeferral && [event[1] boolValue]) ? SPiDRequestDeferralDeferrable : SPiDRequestDeferralNone;
+        [scheduler scheduleTask:^{
+            @synchronized (sentAt) {
+                [sentAt addObject:@(now)];
+            }
+        } deferral:deferral];
+        // Waits for the scheduler queue, which starts the timer or the flushed tasks
+        (void) scheduler.deferredCount;
+    }
+    advanceToTime(DBL_MAX);
+    XCTAssertEqual(scheduler.deferredCount, 0u);
+    XCTAssertEqual(sentAt.count, timeline.count);
+
+    NSArray<NSNumber *> *sorted = [sentAt sortedArrayUsingSelector:@selector(compare:)];
+    NSUInteger bursts = 0;
+    NSTimeInterval last = -DBL_MAX;
+    for (NSNumber *time in sorted) {
+        if (time.doubleValue - last > SPiDRadioTailTime) {
+            bursts++;
+        }
+        last = time.doubleValue;
+    }
+    return bursts;
+}
+
+- (void)testDeferrableRequestsShareBursts {
+    // Status pings (deferrable) mixed with user initiated requests
+    NSArray *timeline = @[@[@0.0, @YES], @[@0.2, @YES], @[@0.4, @YES], @[@0.6, @NO], @[@1.0, @NO], @[@1.2, @YES]];
+
+    XCTAssertEqual([self burstsForTimeline:timeline withDeferral:NO], 6u);
+    // The first three wait for the request at 0.6, the last one for the maximum delay
+    XCTAssertEqual([self burstsForTimeline:timeline withDeferral:YES], 3u);
+}
+
+- (void)testMaximumDelaySendsDeferredTasks {
+    NSArray *timeline = @[@[@0.0, @YES], @[@0.5, @YES], @[@1.5, @YES]];
+
+    // The first two go out together after 1 second, the last one on its own
+    XCTAssertEqual([self burstsForTimeline:timeline withDeferral:YES], 2u);
+}
+
+- (void)testFlushSendsDeferredTasks {
+    SPiDRequestScheduler *scheduler = [[SPiDRequestScheduler alloc] init];
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Deferred task sent"];
+    [scheduler scheduleTask:^{
+        [expectation fulfill];
+    } deferral:SPiDRequestDeferralDeferrable];
+    XCTAssertEqual(scheduler.deferredCount, 1u);
+
+    [scheduler flush];
+    [self waitForExpectationsWithTimeout:1.0 handler:nil];
+    XCTAssertEqual(scheduler.deferredCount, 0u);
+}
+
+@end
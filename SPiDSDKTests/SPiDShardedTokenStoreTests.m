@@ -0,0 +1,176 @@
+//
+//  SPiDShardedTokenStoreTests.m
+//  SPiDSDK
+//
+//  Copyright (c) 2012 Schibsted Payment. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import "SPiDShardedTokenStore.h"
+#import "SPiDAccessToken.h"
+#import "SPiDMemoryTokenStore.h"
+
+/** Memory store whose first load waits until the test lets it finish */
+@interface SPiDPausingTokenStore : SPiDMemoryTokenStore
+
+@property (nonatomic, strong) dispatch_semaphore_t loadStarted;
+@property (nonatomic, strong) dispatch_semaphore_t resumeLoad;
+@property (atomic, assign) BOOL paused;
+
+@end
+
+@implementation SPiDPausingTokenStore
+
+- (instancetype)init {
+    if (self = [super init]) {
+        self.loadStarted = dispatch_semaphore_create(0);
+        self.resumeLoad = dispatch_semaphore_create(0);
+    }
+    return self;
+}
+
+- (SPiDAccessToken *)accessTokenForIdentifier:(NSString *)identifier {
+    SPiDAccessToken *accessToken = [super accessTokenForIdentifier:identifier];
+    if (!self.paused) {
+        self.paused = YES;
+        dispatch_semaphore_signal(self.loadStarted);
+        dispatch_semaphore_wait(self.resumeLoad, DISPATCH_TIME_FOREVER);
+    }
+    return accessToken;
+}
+
+@end
+
+@interface SPiDShardedTokenStoreTests : XCTestCase
+
+@end
+
+@implementation SPiDShardedTokenStoreTests
+
+- (SPiDAccessToken *)tokenForUserID:(NSString *)userID {
+    return [[SPiDAccessToken alloc] initWithUserID:userID accessToken:[@"access-" stringByAppendingString:userID] expiresAt:[NSDate distantFuture] refreshToken:@"refresh"];
+}
+
+- (void)testLeastRecentlyUsedTokenIsEvictedToBackingStore {
+    SPiDMemoryTokenStore *backingStore = [[SPiDMemoryTokenStore alloc] init];
+    SPiDShardedTokenStore *store = [[SPiDShardedTokenStore alloc] initWithCapacity:2 shardCount:1 backingStore:backingStore];
+    [store storeAccessToken:[self tokenForUserID:@"1"] forIdentifier:@"1"];
+    [store storeAccessToken:[self tokenForUserID:@"2"] forIdentifier:@"2"];
+    // Using 1 makes 2 the least recently used
+    XCTAssertNotNil([store accessTokenForIdentifier:@"1"]);
+    [store storeAccessToken:[self tokenForUserID:@"3"] forIdentifier:@"3"];
+
+    XCTAssertEqual(store.count, 2u);
+    XCTAssertEqual(backingStore.writeCount, 1u);
+    XCTAssertNotNil(backingStore.accessTokens[@"2"]);
+
+    // A miss is loaded from the backing store and evicts 1, which is written since it has never been persisted
+    XCTAssertEqualObjects([store accessTokenForIdentifier:@"2"].accessToken, @"access-2");
+    XCTAssertEqual(backingStore.writeCount, 2u);
+    XCTAssertNotNil(backingStore.accessTokens[@"1"]);
+}
+
+- (void)testCleanTokensAreNotWrittenAgain {
+    SPiDMemoryTokenStore *backingStore = [[SPiDMemoryTokenStore alloc] init];
+    backingStore.accessTokens[@"1"] = [self tokenForUserID:@"1"];
+    SPiDShardedTokenStore *store = [[SPiDShardedTokenStore alloc] initWithCapacity:1 shardCount:1 backingStore:backingStore];
+    XCTAssertNotNil([store accessTokenForIdentifier:@"1"]);
+    [store storeAccessToken:[self tokenForUserID:@"2"] forIdentifier:@"2"];
+    XCTAssertEqual(backingStore.writeCount, 0u);
+
+    [store flush];
+    XCTAssertEqual(backingStore.writeCount, 1u);
+}
+
+- (void)testRefreshReplacesToken {
+    SPiDShardedTokenStore *store = [[SPiDShardedTokenStore alloc] initWithCapacity:16 shardCount:4 backingStore:nil];
+    [store storeAccessToken:[self tokenForUserID:@"1"] forIdentifier:@"1"];
+    SPiDAccessToken *refreshed = [[SPiDAccessToken alloc] initWithUserID:@"1" accessToken:@"refreshed" expiresAt:[NSDate distantFuture] refreshToken:@"refresh"];
+    [store storeAccessToken:refreshed forIdentifier:@"1"];
+    XCTAssertEqualObjects([store accessTokenForIdentifier:@"1"].accessToken, @"refreshed");
+    XCTAssertEqual(store.count, 1u);
+
+    [store removeAccessTokenForIdentifier:@"1"];
+    XCTAssertNil([store accessTokenForIdentifier:@"1"]);
+}
+
+- (void)testRemovalWhileLoadingIsNotUndone {
+    SPiDPausingTokenStore *backingStore = [[SPiDPausingTokenStore alloc] init];
+    backingStore.accessTokens[@"1"] = [self tokenForUserID:@"1"];
+    SPiDShardedTokenStore *store = [[SPiDShardedTokenStore alloc] initWithCapacity:16 shardCount:1 backingStore:backingStore];
+
+    __block SPiDAccessToken *loaded = [self tokenForUserID:@"loaded"];
+    dispatch_group_t group = dispatch_group_create();
+    dispatch_group_async(group, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        loaded = [store accessTokenForIdentifier:@"1"];
+    });
+    // The miss has read the old token from the backing store but not inserted it yet
+    dispatch_semaphore_wait(backingStore.loadStarted, DISPATCH_TIME_FOREVER);
+    [store removeAccessTokenForIdentifier:@"1"];
+    dispatch_semaphore_signal(backingStore.resumeLoad);
+    dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+
+    XCTAssertNil(loaded);
+    XCTAssertEqual(store.count, 0u);
+    XCTAssertNil([store accessTokenForIdentifier:@"1"]);
+}
+
+- (void)testStoreAndEvictionWhileLoadingAreNotUndone {
+    SPiDPausingTokenStore *backingStore = [[SPiDPausingTokenStore alloc] init];
+    backingStore.accessTokens[@"1"] = [self tokenForUserID:@"1"];
+    SPiDShardedTokenStore *store = [[SPiDShardedTokenStore alloc] initWithCapacity:1 shardCount:1 backingStore:backingStore];
+
+    __block SPiDAccessToken *loaded = nil;
+    dispatch_group_t group = dispatch_group_create();
+    dispatch_group_async(group, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        loaded = [store accessTokenForIdentifier:@"1"];
+    });
+    // The miss has read the old token, meanwhile a refreshed token is stored and evicted to the backing store
+    dispatch_semaphore_wait(backingStore.loadStarted, DISPATCH_TIME_FOREVER);
+    SPiDAccessToken *refreshed = [[SPiDAccessToken alloc] initWithUserID:@"1" accessToken:@"refreshed" expiresAt:[NSDate distantFuture] refreshToken:@"rotated"];
+    [store storeAccessToken:refreshed forIdentifier:@"1"];
+    [store storeAccessToken:[self tokenForUserID:@"2"] forIdentifier:@"2"];
+    XCTAssertEqualObjects(backingStore.accessTokens[@"1"].accessToken, @"refreshed");
+    dispatch_semaphore_signal(backingStore.resumeLoad);
+    dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+
+    XCTAssertEqualObjects(loaded.accessToken, @"refreshed");
+    XCTAssertEqualObjects([store accessTokenForIdentifier:@"1"].refreshToken, @"rotated");
+}
+
+- (void)measureThroughputWithUserCount:(NSUInteger)userCount capacity:(NSUInteger)capacity backingStore:(id<SPiDTokenStore>)backingStore {
+    const NSUInteger operationCount = 1000000;
+    NSMutableArray<NSString *> *identifiers = [NSMutableArray arrayWithCapacity:userCount];
+    NSMutableArray<SPiDAccessToken *> *tokens = [NSMutableArray arrayWithCapacity:userCount];
+    for (NSUInteger i = 0; i < userCount; i++) {
+        NSString *userID = [NSString stringWithFormat:@"%lu", (unsigned long) i];
+        [identifiers addObject:userID];
+        [tokens addObject:[self tokenForUserID:userID]];
+        [backingStore storeAccessToken:tokens[i] forIdentifier:userID];
+    }
+    SPiDShardedTokenStore *store = [[SPiDShardedTokenStore alloc] initWithCapacity:capacity shardCount:64 backingStore:backingStore];
+
+    [self measureBlock:^{
+        // One store for every nine lookups, spread over all cores
+        dispatch_apply(operationCount, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t i) {
+            NSUInteger user = (i * 2654435761u) % userCount;
+            if (i % 10 == 0) {
+                [store storeAccessToken:tokens[user] forIdentifier:identifiers[user]];
+            } else {
+                [store accessTokenForIdentifier:identifiers[user]];
+            }
+        });
+    }];
+    XCTAssertLessThanOrEqual(store.count, capacity);
+}
+
+- (void)testPerformanceConcurrentThroughput {
+    [self measureThroughputWithUserCount:200000 capacity:200000 backingStore:nil];
+}
+
+- (void)testPerformanceConcurrentThroughputWithEviction {
+    // A quarter of the users fit, so most lookups miss, load from the backing store and evict a dirty token
+    [self measureThroughputWithUserCount:200000 capacity:51200 backingStore:[[SPiDMemoryTokenStore alloc] init]];
+}
+
+@end
@@ -0,0 +1,239 @@
+//
+//  SPiDSharedTokenCoordinatorTests.m
+//  SPiDSDK
+//
+//  Copyright (c) 2012 Schibsted Payment. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import <TargetConditionals.h>
+#import <stdatomic.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#import "SPiDSharedTokenCoordinator.h"
+
+static const NSUInteger SPiDSharingProcessCount = 4;
+
+#if TARGET_OS_SIMULATOR
+/** Forks a process that takes the refresh lease the way a app extension would, without using the coordinator
+
+ The child only makes async-signal-safe calls. It writes a byte to `readyDescriptor` once it holds the lease, holds it
+ for the given time, optionally increments the generation and then exits without releasing the lease, leaving that to
+ the system.
+
+ @return The process ID of the child, or -1 if processes cannot be forked
+ */
+static pid_t SPiDForkLeaseHolder(NSURL *directoryURL, int readyDescriptor, NSTimeInterval holdTime, BOOL bumpsGeneration) {
+    // Paths are converted before forking, the child cannot use Foundation
+    const char *leasePath = strdup([directoryURL URLByAppendingPathComponent:@"SPiDRefresh.lock"].fileSystemRepresentation);
+    const char *generationPath = strdup([directoryURL URLByAppendingPathComponent:@"SPiDToken.generation"].fileSystemRepresentation);
+    struct timespec hold = { (time_t) holdTime, (long) ((holdTime - (time_t) holdTime) * NSEC_PER_SEC) };
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        int lease = open(leasePath, O_RDWR | O_CREAT, 0600);
+        if (lease < 0 || flock(lease, LOCK_EX) != 0) {
+            _exit(1);
+        }
+        char ready = 1;
+        write(readyDescriptor, &ready, 1);
+        nanosleep(&hold, NULL);
+        if (bumpsGeneration) {
+            int fd = open(generationPath, O_RDWR | O_CREAT, 0600);
+            uint64_t generation = 0;
+            if (pread(fd, &generation, sizeof(generation), 0) != sizeof(generation)) {
+                generation = 0;
+            }
+            generation++;
+            pwrite(fd, &generation, sizeof(generation), 0);
+            fsync(fd);
+            close(fd);
+        }
+        _exit(0);
+    }
+    free((void *) leasePath);
+    free((void *) generationPath);
+    return pid;
+}
+#endif
+
+@interface SPiDSharedTokenCoordinatorTests : XCTestCase
+
+@property (nonatomic, strong) NSURL *directoryURL;
+
+@end
+
+@implementation SPiDSharedTokenCoordinatorTests
+
+- (void)setUp {
+    [super setUp];
+    NSString *name = [NSString stringWithFormat:@"SPiDSharedTokenCoordinatorTests-%@", [[NSUUID UUID] UUIDString]];
+    self.directoryURL = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:name] isDirectory:YES];
+}
+
+- (void)tearDown {
+    [[NSFileManager defaultManager] removeItemAtURL:self.directoryURL error:nil];
+    [super tearDown];
+}
+
+- (void)testOnlyOneProcessRefreshes {
+    // Every coordinator opens its own lease file descriptor, which is what separate processes sharing the container do
+    NSMutableArray<SPiDSharedTokenCoordinator *> *processes = [NSMutableArray array];
+    for (NSUInteger i = 0; i < SPiDSharingProcessCount; i++) {
+        [processes addObject:[[SPiDSharedTokenCoordinator alloc] initWithDirectoryURL:self.directoryURL]];
+    }
+    NSURL *storeURL = [self.directoryURL URLByAppendingPathComponent:@"token"];
+
+    __block atomic_int networkCalls = 0;
+    __block atomic_int pickUps = 0;
+    NSMutableArray<NSString *> *tokens = [NSMutableArray array];
+    XCTestExpectation *expectation = [self expectationWithDescription:@"All processes have a token"];
+    expectation.expectedFulfillmentCount = SPiDSharingProcessCount;
+
+    for (SPiDSharedTokenCoordinator *process in processes) {
+        [process coordinateRefresh:^(void (^completion)(BOOL stored)) {
+            int call = atomic_fetch_add(&networkCalls, 1) + 1;
+            // Refresh responses take a while, the other processes are waiting for the lease meanwhile
+            dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t) (0.2 * NSEC_PER_SEC)), dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+                NSString *token = [NSString stringWithFormat:@"token-%d", call];
+                [token writeToURL:storeURL atomically:YES encoding:NSUTF8StringEncoding error:nil];
+                completion(YES);
+                @synchronized (tokens) {
+                    [tokens addObject:token];
+                }
+                [expectation fulfill];
+            });
+        } pickUp:^(BOOL refreshed) {
+            XCTAssertTrue(refreshed);
+            atomic_fetch_add(&pickUps, 1);
+            NSString *token = [NSString stringWithContentsOfURL:storeURL encoding:NSUTF8StringEncoding error:nil];
+            @synchronized (tokens) {
+                [tokens addObject:token ?: @""];
+            }
+            [expectation fulfill];
+        }];
+    }
+    [self waitForExpectationsWithTimeout:5.0 handler:nil];
+
+    XCTAssertEqual(atomic_load(&networkCalls), 1);
+    XCTAssertEqual(atomic_load(&pickUps), (int) SPiDSharingProcessCount - 1);
+    XCTAssertEqual([[NSSet setWithArray:tokens] count], 1u);
+    XCTAssertEqualObjects(tokens.firstObject, @"token-1");
+    for (SPiDSharedTokenCoordinator *process in processes) {
+        XCTAssertEqual(process.lastSeenGeneration, 1u);
+    }
+}
+
+- (void)testFailedRefreshKeepsGeneration {
+    SPiDSharedTokenCoordinator *process = [[SPiDSharedTokenCoordinator alloc] initWithDirectoryURL:self.directoryURL];
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Refresh failed"];
+    [process coordinateRefresh:^(void (^completion)(BOOL stored)) {
+        completion(NO);
+        [expectation fulfill];
+    } pickUp:^(BOOL refreshed) {
+        XCTFail(@"Nothing to pick up");
+    }];
+    [self waitForExpectationsWithTimeout:1.0 handler:nil];
+
+    SPiDSharedTokenCoordinator *other = [[SPiDSharedTokenCoordinator alloc] initWithDirectoryURL:self.directoryURL];
+    XCTAssertEqual([other currentGeneration], 0u);
+}
+
+- (void)testLeaseTimeoutDoesNotRefresh {
+    SPiDSharedTokenCoordinator *holder = [[SPiDSharedTokenCoordinator alloc] initWithDirectoryURL:self.directoryURL];
+    SPiDSharedTokenCoordinator *waiter = [[SPiDSharedTokenCoordinator alloc] initWithDirectoryURL:self.directoryURL];
+    waiter.leaseTimeout = 0.2;
+
+    // The holder keeps the lease, as a process that is slow to rotate the refresh token
+    dispatch_semaphore_t leased = dispatch_semaphore_create(0);
+    __block void (^finishRefresh)(BOOL stored) = nil;
+    [holder coordinateRefresh:^(void (^completion)(BOOL stored)) {
+        finishRefresh = completion;
+        dispatch_semaphore_signal(leased);
+    } pickUp:^(BOOL refreshed) {
+        XCTFail(@"Nothing to pick up");
+    }];
+    dispatch_semaphore_wait(leased, DISPATCH_TIME_FOREVER);
+
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Gave up waiting for the lease"];
+    [waiter coordinateRefresh:^(void (^completion)(BOOL stored)) {
+        XCTFail(@"Refreshed while another process held the lease");
+        completion(NO);
+    } pickUp:^(BOOL refreshed) {
+        XCTAssertFalse(refreshed);
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:5.0 handler:nil];
+
+    finishRefresh(YES);
+    XCTAssertEqual([waiter currentGeneration], 1u);
+}
+
+#if TARGET_OS_SIMULATOR
+- (void)testRefreshByAnotherProcessIsPickedUp {
+    SPiDSharedTokenCoordinator *coordinator = [[SPiDSharedTokenCoordinator alloc] initWithDirectoryURL:self.directoryURL];
+    int ready[2];
+    XCTAssertEqual(pipe(ready), 0);
+    pid_t pid = SPiDForkLeaseHolder(self.directoryURL, ready[1], 0.3, YES);
+    XCTAssertGreaterThan(pid, 0);
+    char byte;
+    XCTAssertEqual(read(ready[0], &byte, 1), 1);
+
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Picked up the other process's token"];
+    [coordinator coordinateRefresh:^(void (^completion)(BOOL stored)) {
+        XCTFail(@"Refreshed although the other process did");
+        completion(NO);
+    } pickUp:^(BOOL refreshed) {
+        XCTAssertTrue(refreshed);
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:5.0 handler:nil];
+
+    int status = 0;
+    XCTAssertEqual(waitpid(pid, &status, 0), pid);
+    XCTAssertEqual(WEXITSTATUS(status), 0);
+    XCTAssertEqual(coordinator.lastSeenGeneration, 1u);
+    close(ready[0]);
+    close(ready[1]);
+}
+
+- (void)testLeaseOfAExitedProcessIsReleased {
+    SPiDSharedTokenCoordinator *coordinator = [[SPiDSharedTokenCoordinator alloc] initWithDirectoryURL:self.directoryURL];
+    coordinator.leaseTimeout = 0.2;
+    int ready[2];
+    XCTAssertEqual(pipe(ready), 0);
+    pid_t pid = SPiDForkLeaseHolder(self.directoryURL, ready[1], 1.0, NO);
+    XCTAssertGreaterThan(pid, 0);
+    char byte;
+    XCTAssertEqual(read(ready[0], &byte, 1), 1);
+
+    XCTestExpectation *timedOut = [self expectationWithDescription:@"Gave up waiting for the other process"];
+    [coordinator coordinateRefresh:^(void (^completion)(BOOL stored)) {
+        XCTFail(@"Refreshed while the other process held the lease");
+        completion(NO);
+    } pickUp:^(BOOL refreshed) {
+        XCTAssertFalse(refreshed);
+        [timedOut fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:5.0 handler:nil];
+
+    // The process exits without releasing the lease, the system releases it
+    XCTAssertEqual(waitpid(pid, NULL, 0), pid);
+    XCTestExpectation *refreshedAfterExit = [self expectationWithDescription:@"Refreshed after the other process exited"];
+    [coordinator coordinateRefresh:^(void (^completion)(BOOL stored)) {
+        completion(YES);
+        [refreshedAfterExit fulfill];
+    } pickUp:^(BOOL refreshed) {
+        XCTFail(@"Nothing to pick up");
+    }];
+    [self waitForExpectationsWithTimeout:5.0 handler:nil];
+    XCTAssertEqual(coordinator.lastSeenGeneration, 1u);
+    close(ready[0]);
+    close(ready[1]);
+}
+#endif
+
+@end
@@ -0,0 +1,240 @@
+//
+//  SPiDUserProfileTests.m
+//  SPiDSDK
+//
+//  Copyright (c) 2012 Schibsted Payment. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import "SPiDUserProfile.h"
+#import "SPiDResponse.h"
+
+static const NSUInteger SPiDBenchmarkProfileCount = 10000;
+
+@interface SPiDUserProfileTests : XCTestCase
+
+@end
+
+@implementation SPiDUserProfileTests
+
+- (NSData *)userResponseData {
+    return [@"{\"name\":\"SPP Container\",\"version\":\"0.2\",\"api\":2,\"object\":\"User\",\"type\":\"element\",\"code\":200,"
+            "\"data\":{\"userId\":12345,\"uuid\":\"b1b8bd3e-2e3b-4e86-8a18-5fd5c5e0e2a1\",\"id\":\"4ef1cfb0e962dd2e0d8d0000\","
+            "\"email\":\"kari.nordmann@example.com\",\"displayName\":\"Kari Nordmann\","
+            "\"name\":{\"givenName\":\"Kari\",\"familyName\":\"Nordmann\",\"formatted\":\"Kari Nordmann\"},"
+            "\"preferredUsername\":\"kari\",\"phoneNumber\":\"+4712345678\",\"gender\":\"female\","
+            "\"photo\":\"https://secure.gravatar.com/avatar/0123456789abcdef\",\"birthday\":\"1980-12-31\","
+            "\"verified\":\"2012-11-08 10:40:16\",\"published\":\"2012-11-08 10:38:02\",\"updated\":\"2014-05-13 11:43:28\","
+            "\"emails\":[{\"value\":\"kari.nordmann@example.com\",\"type\":\"other\",\"primary\":\"true\"}],"
+            "\"status\":1}}" dataUsingEncoding:NSUTF8StringEncoding];
+}
+
+- (SPiDResponse *)userResponse {
+    return [[SPiDResponse alloc] initWithJSONData:[self userResponseData]];
+}
+
+/** How callers read the user object before `SPiDUserProfile`, every field checked and converted up front */
+- (NSDictionary *)eagerProfileFromMessage:(NSDictionary *)message {
+    static NSDateFormatter *dayFormatter;
+    static NSDateFormatter *timeFormatter;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        dayFormatter = [[NSDateFormatter alloc] init];
+        dayFormatter.locale = [NSLocale localeWithLocaleIdentifier:@"en_US_POSIX"];
+        dayFormatter.timeZone = [[NSCalendar currentCalendar] timeZone];
+        dayFormatter.dateFormat = @"yyyy-MM-dd";
+        timeFormatter = [[NSDateFormatter alloc] init];
+        timeFormatter.locale = dayFormatter.locale;
+        timeFormatter.timeZone = [NSTimeZone timeZoneForSecondsFromGMT:0];
+        timeFormatter.dateFormat = @"yyyy-MM-dd HH:mm:ss";
+    });
+
+    NSDictionary *data = message[@"data"];
+    if (![data isKindOfClass:[NSDictionary class]]) {
+        return nil;
+    }
+    NSMutableDictionary *profile = [NSMutableDictionary dictionary];
+    id userID = data[@"userId"];
+    profile[@"userID"] = [userID isKindOfClass:[NSNumber class]] ? [userID stringValue] : userID;
+    for (NSString *key in @[@"uuid", @"email", @"displayName", @"preferredUsername", @"phoneNumber", @"gender"]) {
+        if ([data[key] isKindOfClass:[NSString class]]) {
+            profile[key] = data[key];
+        }
+    }
+    NSDictionary *name = data[@"name"];
+    if ([name isKindOfClass:[NSDictionary class]]) {
+        if ([name[@"givenName"] isKindOfClass:[NSString class]]) profile[@"givenName"] = name[@"givenName"];
+        if ([name[@"familyName"] isKindOfClass:[NSString class]]) profile[@"familyName"] = name[@"familyName"];
+    }
+    if ([data[@"photo"] isKindOfClass:[NSString class]]) {
+        [profile setValue:[NSURL URLWithString:data[@"photo"]] forKey:@"photoURL"];
+    }
+    if ([data[@"birthday"] isKindOfClass:[NSString class]]) {
+        [profile setValue:[dayFormatter dateFromString:data[@"birthday"]] forKey:@"birthday"];
+    }
+    NSDictionary *times = @{@"verified": @"verifiedAt", @"published": @"createdAt", @"updated": @"updatedAt"};
+    for (NSString *key in times) {
+        if ([data[key] isKindOfClass:[NSString class]]) {
+            [profile setValue:[timeFormatter dateFromString:data[key]] forKey:times[key]];
+        }
+    }
+    return profile;
+}
+
+- (void)testProfileFromResponse {
+    SPiDUserProfile *profile = [SPiDUserProfile profileWithResponse:[self userResponse]];
+    XCTAssertEqualObjects(profile.userID, @"12345");
+    XCTAssertEqualObjects(profile.uuid, @"b1b8bd3e-2e3b-4e86-8a18-5fd5c5e0e2a1");
+    XCTAssertEqualObjects(profile.email, @"kari.nordmann@example.com");
+    XCTAssertEqualObjects(profile.displayName, @"Kari Nordmann");
+    XCTAssertEqualObjects(profile.givenName, @"Kari");
+    XCTAssertEqualObjects(profile.familyName, @"Nordmann");
+    XCTAssertEqualObjects(profile.preferredUsername, @"kari");
+    XCTAssertEqualObjects(profile.phoneNumber, @"+4712345678");
+    XCTAssertEqualObjects(profile.gender, @"female");
+    XCTAssertEqualObjects(profile.photoURL, [NSURL URLWithString:@"https://secure.gravatar.com/avatar/0123456789abcdef"]);
+    XCTAssertEqualObjects(profile.verifiedAt, [NSDate dateWithTimeIntervalSince1970:1352371216]);
+    XCTAssertEqualObjects(profile.data[@"status"], @1);
+
+    NSDictionary *eager = [self eagerProfileFromMessage:[self userResponse].message];
+    for (NSString *key in eager) {
+        XCTAssertEqualObjects([profile valueForKey:key], eager[key], @"%@", key);
+    }
+}
+
+- (void)testMissingAndInvalidFields {
+    SPiDUserProfile *profile = [[SPiDUserProfile alloc] initWithData:@{@"userId": @"12345",
+                                                                       @"email": @42,
+                                                                       @"displayName": @"",
+                                                                       @"name": @"Kari Nordmann",
+                                                                       @"birthday": @"0000-00-00",
+                                                                       @"verified": @"0000-00-00 00:00:00",
+                                                                       @"published": @"2012-11-08",
+                                                                       @"updated": @"2012-13-08 10:40:16"}];
+    XCTAssertEqualObjects(profile.userID, @"12345");
+    XCTAssertNil(profile.uuid);
+    XCTAssertNil(profile.email);
+    XCTAssertNil(profile.displayName);
+    XCTAssertNil(profile.givenName);
+    XCTAssertNil(profile.photoURL);
+    XCTAssertNil(profile.birthday);
+    XCTAssertNil(profile.verifiedAt);
+    XCTAssertNil(profile.createdAt);
+    XCTAssertNil(profile.updatedAt);
+
+    XCTAssertNil([[SPiDUserProfile alloc] initWithData:@{@"email": @"kari.nordmann@example.com"}]);
+    XCTAssertNil([[SPiDUserProfile alloc] initWithData:@{@"userId": @[@12345]}]);
+    XCTAssertNil([SPiDUserProfile profileWithResponse:[[SPiDResponse alloc] initWithError:[NSError errorWithDomain:@"test" code:1 userInfo:nil]]]);
+    XCTAssertNil([SPiDUserProfile profileWithResponse:[[SPiDResponse alloc] initWithJSONData:[@"{\"data\":[]}" dataUsingEncoding:NSUTF8StringEncoding]]]);
+}
+
+- (void)testBirthdayIsMidnightInCurrentTimeZone {
+    NSTimeZone *defaultTimeZone = [NSTimeZone defaultTimeZone];
+    for (NSString *name in @[@"UTC", @"Europe/Oslo", @"America/Los_Angeles", @"Pacific/Auckland"]) {
+        [NSTimeZone setDefaultTimeZone:[NSTimeZone timeZoneWithName:name]];
+        NSDate *birthday = [[SPiDUserProfile alloc] initWithData:@{@"userId": @"12345", @"birthday": @"1980-12-31"}].birthday;
+        NSDateComponents *components = [[NSCalendar currentCalendar] components:NSCalendarUnitYear | NSCalendarUnitMonth | NSCalendarUnitDay | NSCalendarUnitHour | NSCalendarUnitMinute fromDate:birthday];
+        XCTAssertEqual(components.year, 1980, @"%@", name);
+        XCTAssertEqual(components.month, 12, @"%@", name);
+        XCTAssertEqual(components.day, 31, @"%@", name);
+        XCTAssertEqual(components.hour, 0, @"%@", name);
+        XCTAssertEqual(components.minute, 0, @"%@", name);
+    }
+    [NSTimeZone setDefaultTimeZone:defaultTimeZone];
+}
+
+- (void)testDaysThatDoNotExistAreRejected {
+    XCTAssertNil([[SPiDUserProfile alloc] initWithData:@{@"userId": @"12345", @"birthday": @"2023-02-31"}].birthday);
+    XCTAssertNil([[SPiDUserProfile alloc] initWithData:@{@"userId": @"12345", @"birthday": @"2023-02-29"}].birthday);
+    XCTAssertNil([[SPiDUserProfile alloc] initWithData:@{@"userId": @"12345", @"birthday": @"1900-02-29"}].birthday);
+    XCTAssertNil([[SPiDUserProfile alloc] initWithData:@{@"userId": @"12345", @"birthday": @"2023-04-31"}].birthday);
+    XCTAssertNil([[SPiDUserProfile alloc] initWithData:@{@"userId": @"12345", @"updated": @"2023-06-31 10:40:16"}].updatedAt);
+    XCTAssertNotNil([[SPiDUserProfile alloc] initWithData:@{@"userId": @"12345", @"birthday": @"2024-02-29"}].birthday);
+    XCTAssertNotNil([[SPiDUserProfile alloc] initWithData:@{@"userId": @"12345", @"birthday": @"2000-02-29"}].birthday);
+    XCTAssertNotNil([[SPiDUserProfile alloc] initWithData:@{@"userId": @"12345", @"birthday": @"2023-01-31"}].birthday);
+}
+
+- (void)testProfileIsImmutable {
+    SPiDResponse *response = [self userResponse];
+    SPiDUserProfile *profile = [SPiDUserProfile profileWithResponse:response];
+    response.message[@"data"][@"name"][@"givenName"] = @"Ola";
+    response.message[@"data"][@"email"] = @"ola.nordmann@example.com";
+    XCTAssertEqualObjects(profile.givenName, @"Kari");
+    XCTAssertEqualObjects(profile.email, @"kari.nordmann@example.com");
+
+    response.message[@"data"][@"emails"][0][@"value"] = @"ola.nordmann@example.com";
+    [response.message[@"data"][@"emails"] addObject:@{@"value": @"kari@example.com"}];
+    XCTAssertEqual([profile.data[@"emails"] count], 1u);
+    XCTAssertEqualObjects(profile.data[@"emails"][0][@"value"], @"kari.nordmann@example.com");
+    XCTAssertFalse([profile.data[@"emails"] isKindOfClass:[NSMutableArray class]]);
+    XCTAssertFalse([profile.data[@"emails"][0] isKindOfClass:[NSMutableDictionary class]]);
+    XCTAssertFalse([profile.data[@"name"] isKindOfClass:[NSMutableDictionary class]]);
+
+    XCTAssertEqual([profile copy], profile);
+    XCTAssertEqualObjects(profile, [SPiDUserProfile profileWithResponse:[self userResponse]]);
+    XCTAssertEqual([profile hash], [[SPiDUserProfile profileWithResponse:[self userResponse]] hash]);
+}
+
+- (void)testConcurrentAccess {
+    SPiDUserProfile *profile = [SPiDUserProfile profileWithResponse:[self userResponse]];
+    NSArray *keys = @[@"uuid", @"email", @"displayName", @"givenName", @"familyName", @"preferredUsername", @"phoneNumber",
+            @"gender", @"photoURL", @"birthday", @"verifiedAt", @"createdAt", @"updatedAt"];
+    NSMutableArray *results = [NSMutableArray array];
+    for (NSUInteger i = 0; i < 64; i++) {
+        [results addObject:[NSNull null]];
+    }
+    dispatch_apply(results.count, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t i) {
+        NSMutableArray *values = [NSMutableArray array];
+        for (NSUInteger j = 0; j < keys.count; j++) {
+            NSString *key = keys[(i + j) % keys.count];
+            [values addObject:[profile valueForKey:key] ?: [NSNull null]];
+        }
+        @synchronized (results) {
+            results[i] = values;
+        }
+    });
+    for (NSUInteger i = 0; i < results.count; i++) {
+        for (NSUInteger j = 0; j < keys.count; j++) {
+            NSString *key = keys[(i + j) % keys.count];
+            XCTAssertEqual(results[i][j], [profile valueForKey:key], @"%@", key);
+        }
+    }
+}
+
+- (void)testEagerDecodePerformance {
+    NSDictionary *message = [self userResponse].message;
+    [self measureBlock:^{
+        for (NSUInteger i = 0; i < SPiDBenchmarkProfileCount; i++) {
+            @autoreleasepool {
+                NSDictionary *profile = [self eagerProfileFromMessage:message];
+                XCTAssertNotNil(profile[@"displayName"]);
+            }
+        }
+    }];
+}
+
+- (void)testLazyDecodePerformance {
+    SPiDResponse *response = [self userResponse];
+    [self measureBlock:^{
+        for (NSUInteger i = 0; i < SPiDBenchmarkProfileCount; i++) {
+            @autoreleasepool {
+                SPiDUserProfile *profile = [SPiDUserProfile profileWithResponse:response];
+                XCTAssertNotNil(profile.displayName);
+            }
+        }
+    }];
+}
+
+- (void)testCachedFieldPerformance {
+    SPiDUserProfile *profile = [SPiDUserProfile profileWithResponse:[self userResponse]];
+    [self measureBlock:^{
+        for (NSUInteger i = 0; i < SPiDBenchmarkProfileCount; i++) {
+            @autoreleasepool {
+                XCTAssertNotNil(profile.displayName);
+                XCTAssertNotNil(profile.updatedAt);
+            }
+        }
+    }];
+}
+
+@end
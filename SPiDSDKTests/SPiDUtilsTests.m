@@ -0,0 +1,337 @@
+//
+//  SPiDUtilsTests.m
+//  SPiDSDK
+//
+//  Copyright (c) 2012 Schibsted Payment. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#import "SPiDUtils.h"
+#import "NSCharacterSet+SPiD.h"
+
+static const NSUInteger SPiDBenchmarkBodyCount = 10000;
+static const NSUInteger SPiDBenchmarkParameterCount = 10000;
+static const NSUInteger SPiDFuzzStringCount = 2000;
+static const NSUInteger SPiDBenchmarkURLCount = 10000;
+static const NSUInteger SPiDEmailCorpusCount = 20000;
+
+@interface SPiDUtilsTests : XCTestCase
+
+@end
+
+@implementation SPiDUtilsTests
+
+/** The body encoder as it was before the single pass encoder, kept as reference and baseline */
+- (NSString *)legacyEncodedHttpBodyForDictionary:(NSDictionary *)dictionary {
+    NSCharacterSet *allowed = [self legacyURLQueryPartAllowedCharacterSet];
+    NSString *body = @"";
+    for (NSString *key in dictionary) {
+        NSString *encodedKey = [key stringByAddingPercentEncodingWithAllowedCharacters:allowed];
+        NSString *encodedValue = [[dictionary objectForKey:key] stringByAddingPercentEncodingWithAllowedCharacters:allowed];
+        if ([body length] > 0) {
+            body = [body stringByAppendingFormat:@"&%@=%@", encodedKey, encodedValue];
+        } else {
+            body = [body stringByAppendingFormat:@"%@=%@", encodedKey, encodedValue];
+        }
+    }
+    return body;
+}
+
+/** The allowed set as it was built before being cached, a fresh copy on every call */
+- (NSCharacterSet *)legacyURLQueryPartAllowedCharacterSet {
+    NSMutableCharacterSet *characterSet = [[NSCharacterSet URLQueryAllowedCharacterSet] mutableCopy];
+    [characterSet removeCharactersInString:@"!*'();:@&=+$,/?%#[]"];
+    return characterSet;
+}
+
+/** Random string mixing ASCII, Latin-1, other BMP characters and surrogate pairs */
+- (NSString *)randomStringWithLength:(NSUInteger)length {
+    NSMutableString *string = [NSMutableString stringWithCapacity:length * 2];
+    for (NSUInteger i = 0; i < length; i++) {
+        unichar characters[2];
+        NSUInteger count = 1;
+        switch (arc4random_uniform(4)) {
+            case 0:
+                characters[0] = (unichar) arc4random_uniform(0x80);
+                break;
+            case 1:
+                characters[0] = (unichar) (0x80 + arc4random_uniform(0x80));
+                break;
+            case 2:
+                characters[0] = (unichar) (0x100 + arc4random_uniform(0xD800 - 0x100));
+                break;
+            default:
+                characters[0] = (unichar) (0xD800 + arc4random_uniform(0x400));
+                characters[1] = (unichar) (0xDC00 + arc4random_uniform(0x400));
+                count = 2;
+                break;
+        }
+        [string appendString:[NSString stringWithCharacters:characters length:count]];
+    }
+    return string;
+}
+
+/** The parameter lookup as it was before the single pass parser, kept as baseline */
+- (NSString *)legacyUrlParameter:(NSURL *)url forKey:(NSString *)key {
+    NSArray *encodedParameterPairs = [[url query] componentsSeparatedByString:@"&"];
+    for (NSString *encodedPair in encodedParameterPairs) {
+        NSArray *encodedPairElements = [encodedPair componentsSeparatedByString:@"="];
+        if (encodedPairElements.count == 2) {
+            if ([[encodedPairElements objectAtIndex:0] isEqual:key])
+                return [encodedPairElements objectAtIndex:1];
+        }
+    }
+    return nil;
+}
+
+/** The email validation as it was before the expression was cached, kept as reference and baseline */
+- (BOOL)legacyValidateEmail:(NSString *)email {
+    NSString *emailRegex =
+            @"(?:[a-z0-9!#$%\\&'*+/=?\\^_`{|}~-]+(?:\\.[a-z0-9!#$%\\&'*+/=?\\^_`{|}"
+                    @"~-]+)*|\"(?:[\\x01-\\x08\\x0b\\x0c\\x0e-\\x1f\\x21\\x23-\\x5b\\x5d-\\"
+                    @"x7f]|\\\\[\\x01-\\x09\\x0b\\x0c\\x0e-\\x7f])*\")@(?:(?:[a-z0-9](?:[a-"
+                    @"z0-9-]*[a-z0-9])?\\.)+[a-z0-9](?:[a-z0-9-]*[a-z0-9])?|\\[(?:(?:25[0-5"
+                    @"]|2[0-4][0-9]|[01]?[0-9][0-9]?)\\.){3}(?:25[0-5]|2[0-4][0-9]|[01]?[0-"
+                    @"9][0-9]?|[a-z0-9-]*[a-z0-9]:(?:[\\x01-\\x08\\x0b\\x0c\\x0e-\\x1f\\x21"
+                    @"-\\x5a\\x53-\\x7f]|\\\\[\\x01-\\x09\\x0b\\x0c\\x0e-\\x7f])+)\\])";
+    NSPredicate *emailTest = [NSPredicate predicateWithFormat:@"SELF MATCHES %@", emailRegex];
+    return [emailTest evaluateWithObject:email];
+}
+
+/** Mix of well formed addresses, near misses and random strings over the characters the expression cares about */
+- (NSArray<NSString *> *)emailCorpus {
+    NSArray<NSString *> *fixed = @[@"kari.nordmann@example.com", @"kari.nordmann+test@example.co.uk", @"Kari@example.com",
+                                   @"kari@EXAMPLE.com", @"\"kari nordmann\"@example.com", @"kari@[192.168.0.1]", @"kari@[256.0.0.1]",
+                                   @"kari@[IPv6:abc]", @"kari@example", @"kari@-example.com", @"kari@example-.com", @".kari@example.com",
+                                   @"kari..nordmann@example.com", @"kari@", @"@example.com", @"", @"kari@example.com\n", @" kari@example.com",
+                                   @"kari@example.com ", @"kåri@example.com", @"kari@exämple.com", @"a@b.c", @"a@b@c.d"];
+    NSMutableArray<NSString *> *corpus = [fixed mutableCopy];
+    NSString *alphabet = @"abcxyzABZ0189.-_+@@@\"\\[]:!#$%&'*/=?^`{|}~ \x01\x7få";
+    NSArray<NSString *> *locals = @[@"kari", @"k.n", @"k+n", @"\"k n\"", @"\"k\\\"n\"", @"K", @"k..n", @"-k"];
+    NSArray<NSString *> *domains = @[@"example.com", @"a.b", @"ex-ample.no", @"[10.0.0.1]", @"[1.2.3]", @"[x:1]", @"example", @"Example.com", @"a-.no"];
+    while (corpus.count < SPiDEmailCorpusCount) {
+        if (arc4random_uniform(2) == 0) {
+            [corpus addObject:[NSString stringWithFormat:@"%@@%@", locals[arc4random_uniform((uint32_t) locals.count)], domains[arc4random_uniform((uint32_t) domains.count)]]];
+        } else {
+            NSUInteger length = 1 + arc4random_uniform(24);
+            NSMutableString *email = [NSMutableString stringWithCapacity:length];
+            for (NSUInteger i = 0; i < length; i++) {
+                [email appendString:[alphabet substringWithRange:NSMakeRange(arc4random_uniform((uint32_t) alphabet.length), 1)]];
+            }
+            [corpus addObject:email];
+        }
+    }
+    return corpus;
+}
+
+- (NSURL *)loginRedirectURL {
+    return [NSURL URLWithString:@"spidtest://spid/login?code=9a4bd59a2d61a6f0cb43c6b6a0b6e3a4&state=c3RhdGU%3D&scope=openid+profile&expires_in=600"];
+}
+
+- (NSDictionary *)tokenBody {
+    return @{@"client_id": @"4ef1cfb0e962dd2e0d8d0000",
+             @"client_secret": @"a9b8c7d6e5f4g3h2i1j0",
+             @"grant_type": @"refresh_token",
+             @"refresh_token": @"9a4bd59a2d61a6f0cb43c6b6a0b6e3a4a05e8d8a1d4b0f25a8f3e1f5b70c2c9e"};
+}
+
+- (NSDictionary *)signupBody {
+    return @{@"email": @"kari.nordmann+test@example.com",
+             @"password": @"Sjølvvalgt p@ss/ord&=?",
+             @"redirectUri": @"https://login.example.com/flow/login?client_id=4ef1cfb0e962dd2e0d8d0000&redirect_uri=spidtest%3A%2F%2Fspid%2Flogin&grant_type=authorization_code&response_type=code&platform=mobile&force=1"};
+}
+
+- (void)testBodyMatchesLegacyEncoder {
+    NSArray<NSDictionary *> *bodies = @[[self tokenBody], [self signupBody], @{}, @{@"empty": @"", @"emoji": @"\U0001F600 æøå", @"reserved": @"!*'();:@&=+$,/?%#[]"}];
+    for (NSDictionary *body in bodies) {
+        NSString *expected = [self legacyEncodedHttpBodyForDictionary:body];
+        XCTAssertEqualObjects([SPiDUtils encodedHttpBodyForDictionary:body], expected);
+        NSData *data = [SPiDUtils encodedHttpBodyDataForDictionary:body sortedKeys:NO];
+        XCTAssertEqualObjects(data, [expected dataUsingEncoding:NSUTF8StringEncoding]);
+    }
+    XCTAssertEqualObjects([SPiDUtils encodedHttpQueryForDictionary:@{@"a": @"b c"}], @"?a=b%20c");
+    XCTAssertEqualObjects([SPiDUtils encodedHttpQueryForDictionary:@{}], @"");
+}
+
+- (void)testSortedKeysAreDeterministic {
+    NSDictionary *body = @{@"b": @"2", @"c": @"3", @"a": @"1", @"number": @42};
+    NSData *data = [SPiDUtils encodedHttpBodyDataForDictionary:body sortedKeys:YES];
+    XCTAssertEqualObjects([[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding], @"a=1&b=2&c=3&number=42");
+}
+
+- (void)testQueryParameterMatchesFoundationEncoder {
+    NSCharacterSet *allowed = [self legacyURLQueryPartAllowedCharacterSet];
+    NSArray<NSString *> *fixed = @[@"", @"4ef1cfb0e962dd2e0d8d0000", @"!*'();:@&=+$,/?%#[]", @"a b~c-d_e.f", @"Sjølvvalgt p@ss/ord", @"\U0001F600"];
+    for (NSString *string in fixed) {
+        XCTAssertEqualObjects([SPiDUtils urlEncodeQueryParameter:string], [string stringByAddingPercentEncodingWithAllowedCharacters:allowed]);
+    }
+    for (NSUInteger i = 0; i < SPiDFuzzStringCount; i++) {
+        NSString *string = [self randomStringWithLength:arc4random_uniform(40)];
+        XCTAssertEqualObjects([SPiDUtils urlEncodeQueryParameter:string], [string stringByAddingPercentEncodingWithAllowedCharacters:allowed], @"Mismatch for %@", string);
+    }
+}
+
+- (void)testQueryParameterWithInvalidUTF8 {
+    unichar loneSurrogate[] = {'a', 0xD800, 'b'};
+    NSString *string = [NSString stringWithCharacters:loneSurrogate length:3];
+    XCTAssertNil([SPiDUtils urlEncodeQueryParameter:string]);
+    XCTAssertNil([SPiDUtils urlEncodeQueryParameter:nil]);
+}
+
+- (void)testAllowedCharacterSetIsCached {
+    XCTAssertEqual([NSCharacterSet URLQueryPartAllowedCharacterSet], [NSCharacterSet URLQueryPartAllowedCharacterSet]);
+    XCTAssertEqualObjects([NSCharacterSet URLQueryPartAllowedCharacterSet], [self legacyURLQueryPartAllowedCharacterSet]);
+}
+
+- (void)testLegacyQueryParameterEncodingPerformance {
+    NSDictionary *signupBody = [self signupBody];
+    [self measureBlock:^{
+        for (NSUInteger i = 0; i < SPiDBenchmarkParameterCount; i++) {
+            @autoreleasepool {
+                for (NSString *key in signupBody) {
+                    [key stringByAddingPercentEncodingWithAllowedCharacters:[self legacyURLQueryPartAllowedCharacterSet]];
+                    [signupBody[key] stringByAddingPercentEncodingWithAllowedCharacters:[self legacyURLQueryPartAllowedCharacterSet]];
+                }
+            }
+        }
+    }];
+}
+
+- (void)testQueryParameterEncodingPerformance {
+    NSDictionary *signupBody = [self signupBody];
+    [self measureBlock:^{
+        for (NSUInteger i = 0; i < SPiDBenchmarkParameterCount; i++) {
+            @autoreleasepool {
+                for (NSString *key in signupBody) {
+                    [SPiDUtils urlEncodeQueryParameter:key];
+                    [SPiDUtils urlEncodeQueryParameter:signupBody[key]];
+                }
+            }
+        }
+    }];
+}
+
+- (void)testParametersFromURL {
+    NSURL *url = [NSURL URLWithString:@"spidtest://spid/login?code=abc&state=a%3Db==&name=Kari+Nordmann&empty=&flag&code=second&bad=%zz%4&utf8=%C3%A6%C3%B8%C3%A5&&=orphan"];
+    NSDictionary *expected = @{@"code": @"abc", @"state": @"a=b==", @"name": @"Kari Nordmann", @"empty": @"", @"flag": @"",
+                               @"bad": @"%zz%4", @"utf8": @"æøå"};
+    XCTAssertEqualObjects([SPiDUtils parametersFromURL:url], expected);
+    XCTAssertEqualObjects([SPiDUtils getUrlParameter:url forKey:@"state"], @"a=b==");
+    XCTAssertNil([SPiDUtils getUrlParameter:url forKey:@"missing"]);
+    XCTAssertEqualObjects([SPiDUtils parametersFromURL:[NSURL URLWithString:@"spidtest://spid/logout"]], @{});
+    XCTAssertEqualObjects([SPiDUtils parametersFromURL:[NSURL URLWithString:@"spidtest://spid/login?%FF=1&ok=%FE"]], @{@"%FF": @"1", @"ok": @"%FE"});
+}
+
+- (void)testParametersRoundTripEncodedQuery {
+    for (NSUInteger i = 0; i < SPiDFuzzStringCount; i++) {
+        NSMutableDictionary *parameters = [NSMutableDictionary dictionary];
+        NSUInteger count = 1 + arc4random_uniform(6);
+        for (NSUInteger j = 0; j < count; j++) {
+            NSString *key = [self randomStringWithLength:1 + arc4random_uniform(10)];
+            [parameters setObject:[self randomStringWithLength:arc4random_uniform(30)] forKey:key];
+        }
+        NSString *query = [SPiDUtils encodedHttpQueryForDictionary:parameters];
+        NSURL *url = [NSURL URLWithString:[@"spidtest://spid/login" stringByAppendingString:query]];
+        XCTAssertEqualObjects([SPiDUtils parametersFromURL:url], parameters, @"Mismatch for %@", query);
+    }
+}
+
+- (void)testLegacyUrlParameterPerformance {
+    NSURL *url = [self loginRedirectURL];
+    [self measureBlock:^{
+        for (NSUInteger i = 0; i < SPiDBenchmarkURLCount; i++) {
+            @autoreleasepool {
+                [self legacyUrlParameter:url forKey:@"error"];
+                [self legacyUrlParameter:url forKey:@"code"];
+                [self legacyUrlParameter:url forKey:@"state"];
+            }
+        }
+    }];
+}
+
+- (void)testParametersFromURLPerformance {
+    NSURL *url = [self loginRedirectURL];
+    [self measureBlock:^{
+        for (NSUInteger i = 0; i < SPiDBenchmarkURLCount; i++) {
+            @autoreleasepool {
+                NSDictionary *parameters = [SPiDUtils parametersFromURL:url];
+                [parameters objectForKey:@"error"];
+                [parameters objectForKey:@"code"];
+                [parameters objectForKey:@"state"];
+            }
+        }
+    }];
+}
+
+- (void)testEmailValidationMatchesLegacyPredicate {
+    NSArray<NSString *> *corpus = [self emailCorpus];
+    NSMutableIndexSet *expected = [NSMutableIndexSet indexSet];
+    [corpus enumerateObjectsUsingBlock:^(NSString *email, NSUInteger index, BOOL *stop) {
+        BOOL valid = [self legacyValidateEmail:email];
+        XCTAssertEqual([SPiDUtils validateEmail:email], valid, @"Mismatch for %@", email);
+        if (valid) {
+            [expected addIndex:index];
+        }
+    }];
+    XCTAssertGreaterThan(expected.count, 0);
+    XCTAssertEqualObjects([SPiDUtils indexesOfValidEmails:corpus], expected);
+    XCTAssertEqualObjects([SPiDUtils indexesOfValidEmails:@[]], [NSIndexSet indexSet]);
+    XCTAssertFalse([SPiDUtils validateEmail:nil]);
+}
+
+- (void)testLegacyEmailValidationPerformance {
+    NSArray<NSString *> *corpus = [[self emailCorpus] subarrayWithRange:NSMakeRange(0, 1000)];
+    [self measureBlock:^{
+        for (NSString *email in corpus) {
+            @autoreleasepool {
+                [self legacyValidateEmail:email];
+            }
+        }
+    }];
+}
+
+- (void)testEmailValidationPerformance {
+    NSArray<NSString *> *corpus = [[self emailCorpus] subarrayWithRange:NSMakeRange(0, 1000)];
+    [self measureBlock:^{
+        for (NSString *email in corpus) {
+            @autoreleasepool {
+                [SPiDUtils validateEmail:email];
+            }
+        }
+    }];
+}
+
+- (void)testBatchEmailValidationPerformance {
+    NSArray<NSString *> *corpus = [self emailCorpus];
+    [self measureBlock:^{
+        [SPiDUtils indexesOfValidEmails:corpus];
+    }];
+}
+
+- (void)testLegacyBodyEncodingPerformance {
+    NSDictionary *tokenBody = [self tokenBody];
+    NSDictionary *signupBody = [self signupBody];
+    [self measureBlock:^{
+        for (NSUInteger i = 0; i < SPiDBenchmarkBodyCount; i++) {
+            @autoreleasepool {
+                [[self legacyEncodedHttpBodyForDictionary:tokenBody] dataUsingEncoding:NSUTF8StringEncoding];
+                [[self legacyEncodedHttpBodyForDictionary:signupBody] dataUsingEncoding:NSUTF8StringEncoding];
+            }
+        }
+    }];
+}
+
+- (void)testBodyEncodingPerformance {
+    NSDictionary *tokenBody = [self tokenBody];
+    NSDictionary *signupBody = [self signupBody];
+    [self measureBlock:^{
+        for (NSUInteger i = 0; i < SPiDBenchmarkBodyCount; i++) {
+            @autoreleasepool {
+                [SPiDUtils encodedHttpBodyDataForDictionary:tokenBody sortedKeys:NO];
+                [SPiDUtils encodedHttpBodyDataForDictionary:signupBody sortedKeys:NO];
+            }
+        }
+    }];
+}
+
+@end